@@ -0,0 +1,1137 @@
+//***************************************************************************************
+// BlockDecoder.cpp
+//
+// Bit layouts, partition tables and interpolation weights follow the Direct3D 11
+// block compression specification.
+//***************************************************************************************
+
+#include "BlockDecoder.h"
+#include "BlockDecoderKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define BLOCK_DECODER_X86 1
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define BLOCK_DECODER_X86 1
+#endif
+
+using std::uint8_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace
+{
+	// Block rows handed to a worker at a time (32 texel rows).
+	const uint32_t TileBlockRows = 8;
+
+	const int Weights2[4] = { 0, 21, 43, 64 };
+	const int Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const int Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Two subset partitions, bit i is the subset of texel i.
+	const uint16_t Partitions2[64] =
+	{
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+	};
+
+	// Three subset partitions, bits 2i..2i+1 are the subset of texel i.
+	const uint32_t Partitions3[64] =
+	{
+		0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+		0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+		0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+		0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+		0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+		0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+		0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+		0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+	};
+
+	// Texel whose index is stored with one bit less, for the second subset of Partitions2.
+	const uint8_t Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+	};
+
+	// Anchors of the second and third subsets of Partitions3.
+	const uint8_t Anchors3a[64] =
+	{
+		 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+		 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+		 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+		 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+	};
+	const uint8_t Anchors3b[64] =
+	{
+		15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+		15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+		15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+		15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+	};
+
+	/**
+	 * @brief Sequential LSB-first reader over a 128-bit block
+	 */
+	class BlockBits
+	{
+	public:
+		explicit BlockBits(const uint8_t* block)
+		{
+			std::memcpy(&mLow, block, 8);
+			std::memcpy(&mHigh, block + 8, 8);
+		}
+
+		uint32_t Read(uint32_t count)
+		{
+			if (count == 0)
+				return 0;
+
+			uint64_t value;
+			if (mPos >= 64)
+				value = mHigh >> (mPos - 64);
+			else if (mPos + count <= 64)
+				value = mLow >> mPos;
+			else
+				value = (mLow >> mPos) | (mHigh << (64 - mPos));
+
+			mPos += count;
+			return (uint32_t)(value & ((1ull << count) - 1));
+		}
+
+		// Reads a field stored most significant bit first.
+		uint32_t ReadReversed(uint32_t count)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < count; ++i)
+				value |= Read(1) << (count - 1 - i);
+			return value;
+		}
+
+	private:
+		uint64_t mLow = 0;
+		uint64_t mHigh = 0;
+		uint32_t mPos = 0;
+	};
+
+	inline uint32_t PackRGBA(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	inline int Interpolate(int e0, int e1, int weight)
+	{
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	inline int SignExtend(uint32_t value, uint32_t bits)
+	{
+		return (int)(value << (32 - bits)) >> (32 - bits);
+	}
+
+	void StoreTexels(const uint32_t texels[16], uint8_t* dst, size_t dstRowPitch)
+	{
+		for (int y = 0; y < 4; ++y)
+			std::memcpy(dst + y * dstRowPitch, texels + y * 4, 16);
+	}
+}
+
+//-----------------------------------------------------------------------------------
+// BC1 - BC5 palettes, shared with the SIMD kernels
+//-----------------------------------------------------------------------------------
+
+namespace BlockDecoderKernels
+{
+	void BuildColorPalette(const uint8_t* block, bool punchThrough, uint32_t palette[4])
+	{
+		uint32_t c0 = block[0] | (block[1] << 8);
+		uint32_t c1 = block[2] | (block[3] << 8);
+
+		int r0 = (c0 >> 11) & 31, g0 = (c0 >> 5) & 63, b0 = c0 & 31;
+		int r1 = (c1 >> 11) & 31, g1 = (c1 >> 5) & 63, b1 = c1 & 31;
+		r0 = (r0 << 3) | (r0 >> 2); g0 = (g0 << 2) | (g0 >> 4); b0 = (b0 << 3) | (b0 >> 2);
+		r1 = (r1 << 3) | (r1 >> 2); g1 = (g1 << 2) | (g1 >> 4); b1 = (b1 << 3) | (b1 >> 2);
+
+		palette[0] = PackRGBA(r0, g0, b0, 255);
+		palette[1] = PackRGBA(r1, g1, b1, 255);
+
+		if (!punchThrough || c0 > c1)
+		{
+			palette[2] = PackRGBA((2 * r0 + r1 + 1) / 3, (2 * g0 + g1 + 1) / 3, (2 * b0 + b1 + 1) / 3, 255);
+			palette[3] = PackRGBA((r0 + 2 * r1 + 1) / 3, (g0 + 2 * g1 + 1) / 3, (b0 + 2 * b1 + 1) / 3, 255);
+		}
+		else
+		{
+			palette[2] = PackRGBA((r0 + r1 + 1) / 2, (g0 + g1 + 1) / 2, (b0 + b1 + 1) / 2, 255);
+			palette[3] = 0;
+		}
+	}
+
+	// Signed blocks are remapped from [-1, 1] to [0, 255] so every format decodes
+	// to the same unsigned RGBA8 layout.
+	void BuildChannelPalette(const uint8_t* block, bool isSigned, uint8_t palette[8])
+	{
+		if (!isSigned)
+		{
+			int a0 = block[0];
+			int a1 = block[1];
+			palette[0] = (uint8_t)a0;
+			palette[1] = (uint8_t)a1;
+			if (a0 > a1)
+			{
+				for (int i = 1; i < 7; ++i)
+					palette[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1 + 3) / 7);
+			}
+			else
+			{
+				for (int i = 1; i < 5; ++i)
+					palette[i + 1] = (uint8_t)(((5 - i) * a0 + i * a1 + 2) / 5);
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+			return;
+		}
+
+		// -128 and -127 both mean -1.0.
+		float s0 = (float)std::max<int>((int8_t)block[0], -127);
+		float s1 = (float)std::max<int>((int8_t)block[1], -127);
+		float values[8] = { s0, s1 };
+		if (s0 > s1)
+		{
+			for (int i = 1; i < 7; ++i)
+				values[i + 1] = ((7 - i) * s0 + i * s1) / 7.0f;
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i)
+				values[i + 1] = ((5 - i) * s0 + i * s1) / 5.0f;
+			values[6] = -127.0f;
+			values[7] = 127.0f;
+		}
+
+		for (int i = 0; i < 8; ++i)
+			palette[i] = (uint8_t)((values[i] + 127.0f) * (255.0f / 254.0f) + 0.5f);
+	}
+
+	void UnpackChannelIndices(const uint8_t* block, uint8_t indices[16])
+	{
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= (uint64_t)block[2 + i] << (8 * i);
+
+		for (int i = 0; i < 16; ++i)
+			indices[i] = (uint8_t)((bits >> (3 * i)) & 7);
+	}
+
+	ShuffleTables::ShuffleTables()
+	{
+		for (int b = 0; b < 256; ++b)
+		{
+			for (int x = 0; x < 4; ++x)
+			{
+				int index = (b >> (2 * x)) & 3;
+				for (int c = 0; c < 4; ++c)
+					ColorRow[b][x * 4 + c] = (uint8_t)(index * 4 + c);
+			}
+		}
+
+		std::memset(ChannelToByte, 0x80, sizeof(ChannelToByte));
+		for (int row = 0; row < 4; ++row)
+			for (int c = 0; c < 4; ++c)
+				for (int x = 0; x < 4; ++x)
+					ChannelToByte[row][c][x * 4 + c] = (uint8_t)(row * 4 + x);
+	}
+
+	const ShuffleTables& GetShuffleTables()
+	{
+		static const ShuffleTables tables;
+		return tables;
+	}
+}
+
+namespace
+{
+	using namespace BlockDecoderKernels;
+
+	//-----------------------------------------------------------------------------------
+	// BC1 - BC5 scalar kernels, used when the CPU has no SSE4.1
+	//-----------------------------------------------------------------------------------
+
+	void DecodeColorTexels(const uint8_t* block, bool punchThrough, uint32_t texels[16])
+	{
+		uint32_t palette[4];
+		BuildColorPalette(block, punchThrough, palette);
+		for (int i = 0; i < 16; ++i)
+			texels[i] = palette[(block[4 + i / 4] >> (2 * (i % 4))) & 3];
+	}
+
+	void InsertChannel(const uint8_t* block, bool isSigned, int c, uint32_t texels[16])
+	{
+		uint8_t palette[8];
+		uint8_t indices[16];
+		BuildChannelPalette(block, isSigned, palette);
+		UnpackChannelIndices(block, indices);
+
+		uint32_t keep = ~(0xFFu << (8 * c));
+		for (int i = 0; i < 16; ++i)
+			texels[i] = (texels[i] & keep) | ((uint32_t)palette[indices[i]] << (8 * c));
+	}
+
+	void DecodeBC1(const uint8_t* block, uint8_t* dst, size_t dstRowPitch)
+	{
+		uint32_t texels[16];
+		DecodeColorTexels(block, true, texels);
+		StoreTexels(texels, dst, dstRowPitch);
+	}
+
+	void DecodeBC2(const uint8_t* block, uint8_t* dst, size_t dstRowPitch)
+	{
+		uint32_t texels[16];
+		DecodeColorTexels(block + 8, false, texels);
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t alpha = (block[i / 2] >> (4 * (i % 2))) & 0x0F;
+			texels[i] = (texels[i] & 0x00FFFFFF) | ((alpha * 17) << 24);
+		}
+		StoreTexels(texels, dst, dstRowPitch);
+	}
+
+	void DecodeBC3(const uint8_t* block, uint8_t* dst, size_t dstRowPitch)
+	{
+		uint32_t texels[16];
+		DecodeColorTexels(block + 8, false, texels);
+		InsertChannel(block, false, 3, texels);
+		StoreTexels(texels, dst, dstRowPitch);
+	}
+
+	void DecodeBC4(const uint8_t* block, bool isSigned, uint8_t* dst, size_t dstRowPitch)
+	{
+		uint32_t texels[16];
+		std::fill(texels, texels + 16, 0xFF000000u);
+		InsertChannel(block, isSigned, 0, texels);
+		StoreTexels(texels, dst, dstRowPitch);
+	}
+
+	void DecodeBC5(const uint8_t* block, bool isSigned, uint8_t* dst, size_t dstRowPitch)
+	{
+		uint32_t texels[16];
+		std::fill(texels, texels + 16, 0xFF000000u);
+		InsertChannel(block, isSigned, 0, texels);
+		InsertChannel(block + 8, isSigned, 1, texels);
+		StoreTexels(texels, dst, dstRowPitch);
+	}
+
+	//-----------------------------------------------------------------------------------
+	// BC6H
+	//-----------------------------------------------------------------------------------
+
+	int UnquantizeBC6H(int comp, int bits, bool isSigned)
+	{
+		if (!isSigned)
+		{
+			if (bits >= 15)
+				return comp;
+			if (comp == 0)
+				return 0;
+			if (comp == (1 << bits) - 1)
+				return 0xFFFF;
+			return ((comp << 16) + 0x8000) >> bits;
+		}
+
+		if (bits >= 16)
+			return comp;
+
+		bool negative = comp < 0;
+		if (negative)
+			comp = -comp;
+
+		int result;
+		if (comp == 0)
+			result = 0;
+		else if (comp >= (1 << (bits - 1)) - 1)
+			result = 0x7FFF;
+		else
+			result = ((comp << 15) + 0x4000) >> (bits - 1);
+
+		return negative ? -result : result;
+	}
+
+	// Converts an interpolated BC6H value to a clamped 8-bit channel.
+	uint32_t FinishBC6H(int comp, bool isSigned)
+	{
+		uint32_t half;
+		if (!isSigned)
+		{
+			half = (uint32_t)((comp * 31) >> 6);
+		}
+		else
+		{
+			// Negative values clamp to zero below anyway.
+			if (comp <= 0)
+				return 0;
+			half = (uint32_t)((comp * 31) >> 5);
+		}
+
+		uint32_t exponent = (half >> 10) & 31;
+		uint32_t mantissa = half & 0x3FF;
+		if (exponent == 31)
+			return mantissa ? 0 : 255;
+
+		float value = exponent == 0
+			? mantissa / 1024.0f / 16384.0f
+			: (1.0f + mantissa / 1024.0f) * (float)(1 << exponent) / 32768.0f;
+
+		return value >= 1.0f ? 255 : (uint32_t)(value * 255.0f + 0.5f);
+	}
+
+	void DecodeBC6H(const uint8_t* block, bool isSigned, uint8_t* dst, size_t dstRowPitch)
+	{
+		BlockBits bits(block);
+
+		uint32_t mode = bits.Read(2);
+		if (mode >= 2)
+			mode |= bits.Read(3) << 2;
+
+		// Endpoints w, x, y, z of the specification are [0] .. [3].
+		int r[4] = {}, g[4] = {}, b[4] = {};
+		int regions = 2;
+		int endpointBits = 0;
+		int deltaR = 0, deltaG = 0, deltaB = 0;
+		bool transformed = true;
+
+		auto R = [&](int e, uint32_t count, uint32_t shift = 0) { r[e] |= (int)(bits.Read(count) << shift); };
+		auto G = [&](int e, uint32_t count, uint32_t shift = 0) { g[e] |= (int)(bits.Read(count) << shift); };
+		auto B = [&](int e, uint32_t count, uint32_t shift = 0) { b[e] |= (int)(bits.Read(count) << shift); };
+
+		switch (mode)
+		{
+		case 0:
+			endpointBits = 10; deltaR = deltaG = deltaB = 5;
+			G(2, 1, 4); B(2, 1, 4); B(3, 1, 4); R(0, 10); G(0, 10); B(0, 10);
+			R(1, 5); G(3, 1, 4); G(2, 4); G(1, 5); B(3, 1); G(3, 4); B(1, 5); B(3, 1, 1); B(2, 4);
+			R(2, 5); B(3, 1, 2); R(3, 5); B(3, 1, 3);
+			break;
+		case 1:
+			endpointBits = 7; deltaR = deltaG = deltaB = 6;
+			G(2, 1, 5); G(3, 1, 4); G(3, 1, 5); R(0, 7); B(3, 1); B(3, 1, 1); B(2, 1, 4);
+			G(0, 7); B(2, 1, 5); B(3, 1, 2); G(2, 1, 4); B(0, 7); B(3, 1, 3); B(3, 1, 5); B(3, 1, 4);
+			R(1, 6); G(2, 4); G(1, 6); G(3, 4); B(1, 6); B(2, 4); R(2, 6); R(3, 6);
+			break;
+		case 2:
+			endpointBits = 11; deltaR = 5; deltaG = deltaB = 4;
+			R(0, 10); G(0, 10); B(0, 10); R(1, 5); R(0, 1, 10); G(2, 4); G(1, 4); G(0, 1, 10);
+			B(3, 1); G(3, 4); B(1, 4); B(0, 1, 10); B(3, 1, 1); B(2, 4); R(2, 5); B(3, 1, 2); R(3, 5); B(3, 1, 3);
+			break;
+		case 6:
+			endpointBits = 11; deltaG = 5; deltaR = deltaB = 4;
+			R(0, 10); G(0, 10); B(0, 10); R(1, 4); R(0, 1, 10); G(3, 1, 4); G(2, 4); G(1, 5); G(0, 1, 10);
+			G(3, 4); B(1, 4); B(0, 1, 10); B(3, 1, 1); B(2, 4); R(2, 4); B(3, 1); B(3, 1, 2); R(3, 4);
+			G(2, 1, 4); B(3, 1, 3);
+			break;
+		case 10:
+			endpointBits = 11; deltaB = 5; deltaR = deltaG = 4;
+			R(0, 10); G(0, 10); B(0, 10); R(1, 4); R(0, 1, 10); B(2, 1, 4); G(2, 4); G(1, 4); G(0, 1, 10);
+			B(3, 1); G(3, 4); B(1, 5); B(0, 1, 10); B(2, 4); R(2, 4); B(3, 1, 1); B(3, 1, 2); R(3, 4);
+			B(3, 1, 4); B(3, 1, 3);
+			break;
+		case 14:
+			endpointBits = 9; deltaR = deltaG = deltaB = 5;
+			R(0, 9); B(2, 1, 4); G(0, 9); G(2, 1, 4); B(0, 9); B(3, 1, 4); R(1, 5); G(3, 1, 4); G(2, 4);
+			G(1, 5); B(3, 1); G(3, 4); B(1, 5); B(3, 1, 1); B(2, 4); R(2, 5); B(3, 1, 2); R(3, 5); B(3, 1, 3);
+			break;
+		case 18:
+			endpointBits = 8; deltaR = 6; deltaG = deltaB = 5;
+			R(0, 8); G(3, 1, 4); B(2, 1, 4); G(0, 8); B(3, 1, 2); G(2, 1, 4); B(0, 8); B(3, 1, 3); B(3, 1, 4);
+			R(1, 6); G(2, 4); G(1, 5); B(3, 1); G(3, 4); B(1, 5); B(3, 1, 1); B(2, 4); R(2, 6); R(3, 6);
+			break;
+		case 22:
+			endpointBits = 8; deltaG = 6; deltaR = deltaB = 5;
+			R(0, 8); B(3, 1); B(2, 1, 4); G(0, 8); G(2, 1, 5); G(2, 1, 4); B(0, 8); G(3, 1, 5); B(3, 1, 4);
+			R(1, 5); G(3, 1, 4); G(2, 4); G(1, 6); G(3, 4); B(1, 5); B(3, 1, 1); B(2, 4); R(2, 5); B(3, 1, 2);
+			R(3, 5); B(3, 1, 3);
+			break;
+		case 26:
+			endpointBits = 8; deltaB = 6; deltaR = deltaG = 5;
+			R(0, 8); B(3, 1, 1); B(2, 1, 4); G(0, 8); B(2, 1, 5); G(2, 1, 4); B(0, 8); B(3, 1, 5); B(3, 1, 4);
+			R(1, 5); G(3, 1, 4); G(2, 4); G(1, 5); B(3, 1); G(3, 4); B(1, 6); B(2, 4); R(2, 5); B(3, 1, 2);
+			R(3, 5); B(3, 1, 3);
+			break;
+		case 30:
+			endpointBits = 6; deltaR = deltaG = deltaB = 6; transformed = false;
+			R(0, 6); G(3, 1, 4); B(3, 1); B(3, 1, 1); B(2, 1, 4); G(0, 6); G(2, 1, 5); B(2, 1, 5); B(3, 1, 2);
+			G(2, 1, 4); B(0, 6); G(3, 1, 5); B(3, 1, 3); B(3, 1, 5); B(3, 1, 4); R(1, 6); G(2, 4); G(1, 6);
+			G(3, 4); B(1, 6); B(2, 4); R(2, 6); R(3, 6);
+			break;
+		case 3:
+			regions = 1; endpointBits = 10; deltaR = deltaG = deltaB = 10; transformed = false;
+			R(0, 10); G(0, 10); B(0, 10); R(1, 10); G(1, 10); B(1, 10);
+			break;
+		case 7:
+			regions = 1; endpointBits = 11; deltaR = deltaG = deltaB = 9;
+			R(0, 10); G(0, 10); B(0, 10); R(1, 9); R(0, 1, 10); G(1, 9); G(0, 1, 10); B(1, 9); B(0, 1, 10);
+			break;
+		case 11:
+			regions = 1; endpointBits = 12; deltaR = deltaG = deltaB = 8;
+			R(0, 10); G(0, 10); B(0, 10);
+			R(1, 8); r[0] |= (int)(bits.ReadReversed(2) << 10);
+			G(1, 8); g[0] |= (int)(bits.ReadReversed(2) << 10);
+			B(1, 8); b[0] |= (int)(bits.ReadReversed(2) << 10);
+			break;
+		case 15:
+			regions = 1; endpointBits = 16; deltaR = deltaG = deltaB = 4;
+			R(0, 10); G(0, 10); B(0, 10);
+			R(1, 4); r[0] |= (int)(bits.ReadReversed(6) << 10);
+			G(1, 4); g[0] |= (int)(bits.ReadReversed(6) << 10);
+			B(1, 4); b[0] |= (int)(bits.ReadReversed(6) << 10);
+			break;
+		default:
+		{
+			// Reserved modes decode to opaque black.
+			uint32_t texels[16];
+			std::fill(texels, texels + 16, 0xFF000000u);
+			StoreTexels(texels, dst, dstRowPitch);
+			return;
+		}
+		}
+
+		uint32_t partition = regions == 2 ? bits.Read(5) : 0;
+		int endpointCount = regions * 2;
+
+		if (isSigned)
+		{
+			r[0] = SignExtend(r[0], endpointBits);
+			g[0] = SignExtend(g[0], endpointBits);
+			b[0] = SignExtend(b[0], endpointBits);
+		}
+
+		if (isSigned || transformed)
+		{
+			for (int e = 1; e < endpointCount; ++e)
+			{
+				r[e] = SignExtend(r[e], deltaR);
+				g[e] = SignExtend(g[e], deltaG);
+				b[e] = SignExtend(b[e], deltaB);
+			}
+		}
+
+		if (transformed)
+		{
+			int mask = (1 << endpointBits) - 1;
+			for (int e = 1; e < endpointCount; ++e)
+			{
+				r[e] = (r[0] + r[e]) & mask;
+				g[e] = (g[0] + g[e]) & mask;
+				b[e] = (b[0] + b[e]) & mask;
+				if (isSigned)
+				{
+					r[e] = SignExtend(r[e], endpointBits);
+					g[e] = SignExtend(g[e], endpointBits);
+					b[e] = SignExtend(b[e], endpointBits);
+				}
+			}
+		}
+
+		for (int e = 0; e < endpointCount; ++e)
+		{
+			r[e] = UnquantizeBC6H(r[e], endpointBits, isSigned);
+			g[e] = UnquantizeBC6H(g[e], endpointBits, isSigned);
+			b[e] = UnquantizeBC6H(b[e], endpointBits, isSigned);
+		}
+
+		const int* weights = regions == 2 ? Weights3 : Weights4;
+		uint32_t indexBits = regions == 2 ? 3 : 4;
+
+		uint32_t texels[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			bool anchor = i == 0 || (regions == 2 && i == Anchors2[partition]);
+			uint32_t index = bits.Read(anchor ? indexBits - 1 : indexBits);
+			int subset = regions == 2 ? (Partitions2[partition] >> i) & 1 : 0;
+			int e0 = subset * 2;
+			int e1 = e0 + 1;
+			int w = weights[index];
+
+			texels[i] = PackRGBA(
+				FinishBC6H(Interpolate(r[e0], r[e1], w), isSigned),
+				FinishBC6H(Interpolate(g[e0], g[e1], w), isSigned),
+				FinishBC6H(Interpolate(b[e0], b[e1], w), isSigned),
+				255);
+		}
+
+		StoreTexels(texels, dst, dstRowPitch);
+	}
+
+	//-----------------------------------------------------------------------------------
+	// BC7
+	//-----------------------------------------------------------------------------------
+
+	/**
+	 * @brief Layout of one BC7 mode
+	 */
+	struct BC7Mode
+	{
+		uint8_t Subsets;
+		uint8_t PartitionBits;
+		uint8_t RotationBits;
+		uint8_t IndexSelectionBits;
+		uint8_t ColorBits;
+		uint8_t AlphaBits;
+		uint8_t EndpointPBits;   ///< One P-bit per endpoint
+		uint8_t SharedPBits;     ///< One P-bit per subset
+		uint8_t IndexBits;
+		uint8_t SecondaryIndexBits;
+	};
+
+	const BC7Mode BC7Modes[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+	};
+
+	inline const int* WeightsFor(uint32_t indexBits)
+	{
+		return indexBits == 2 ? Weights2 : (indexBits == 3 ? Weights3 : Weights4);
+	}
+
+	inline int ExpandBits(int value, int bits)
+	{
+		value <<= 8 - bits;
+		return value | (value >> bits);
+	}
+
+	void DecodeBC7(const uint8_t* block, uint8_t* dst, size_t dstRowPitch)
+	{
+		uint32_t texels[16];
+
+		int modeIndex = 0;
+		while (modeIndex < 8 && !(block[0] & (1 << modeIndex)))
+			++modeIndex;
+
+		// Reserved mode, decodes to transparent black.
+		if (modeIndex == 8)
+		{
+			std::fill(texels, texels + 16, 0u);
+			StoreTexels(texels, dst, dstRowPitch);
+			return;
+		}
+
+		const BC7Mode& mode = BC7Modes[modeIndex];
+		BlockBits bits(block);
+		bits.Read(modeIndex + 1);
+
+		uint32_t partition = bits.Read(mode.PartitionBits);
+		uint32_t rotation = bits.Read(mode.RotationBits);
+		uint32_t indexSelection = bits.Read(mode.IndexSelectionBits);
+
+		int endpointCount = mode.Subsets * 2;
+		int endpoints[6][4];
+
+		for (int c = 0; c < 3; ++c)
+			for (int e = 0; e < endpointCount; ++e)
+				endpoints[e][c] = (int)bits.Read(mode.ColorBits);
+
+		for (int e = 0; e < endpointCount; ++e)
+			endpoints[e][3] = mode.AlphaBits ? (int)bits.Read(mode.AlphaBits) : 255;
+
+		int colorBits = mode.ColorBits;
+		int alphaBits = mode.AlphaBits;
+		if (mode.EndpointPBits || mode.SharedPBits)
+		{
+			int pbits[6];
+			if (mode.EndpointPBits)
+			{
+				for (int e = 0; e < endpointCount; ++e)
+					pbits[e] = (int)bits.Read(1);
+			}
+			else
+			{
+				for (int s = 0; s < mode.Subsets; ++s)
+					pbits[s * 2] = pbits[s * 2 + 1] = (int)bits.Read(1);
+			}
+
+			for (int e = 0; e < endpointCount; ++e)
+			{
+				for (int c = 0; c < 3; ++c)
+					endpoints[e][c] = (endpoints[e][c] << 1) | pbits[e];
+				if (mode.AlphaBits)
+					endpoints[e][3] = (endpoints[e][3] << 1) | pbits[e];
+			}
+
+			++colorBits;
+			if (alphaBits)
+				++alphaBits;
+		}
+
+		for (int e = 0; e < endpointCount; ++e)
+		{
+			for (int c = 0; c < 3; ++c)
+				endpoints[e][c] = ExpandBits(endpoints[e][c], colorBits);
+			if (alphaBits)
+				endpoints[e][3] = ExpandBits(endpoints[e][3], alphaBits);
+		}
+
+		int subsets[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			if (mode.Subsets == 2)
+				subsets[i] = (Partitions2[partition] >> i) & 1;
+			else if (mode.Subsets == 3)
+				subsets[i] = (Partitions3[partition] >> (2 * i)) & 3;
+			else
+				subsets[i] = 0;
+		}
+
+		uint32_t indices[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			bool anchor = i == 0
+				|| (mode.Subsets == 2 && i == Anchors2[partition])
+				|| (mode.Subsets == 3 && (i == Anchors3a[partition] || i == Anchors3b[partition]));
+			indices[i] = bits.Read(anchor ? mode.IndexBits - 1 : mode.IndexBits);
+		}
+
+		uint32_t secondary[16] = {};
+		if (mode.SecondaryIndexBits)
+		{
+			for (int i = 0; i < 16; ++i)
+				secondary[i] = bits.Read(i == 0 ? mode.SecondaryIndexBits - 1 : mode.SecondaryIndexBits);
+		}
+
+		const int* colorWeights = WeightsFor(mode.IndexBits);
+		const int* alphaWeights = colorWeights;
+		const uint32_t* colorIndices = indices;
+		const uint32_t* alphaIndices = indices;
+		if (mode.SecondaryIndexBits)
+		{
+			alphaWeights = WeightsFor(mode.SecondaryIndexBits);
+			alphaIndices = secondary;
+			if (indexSelection)
+			{
+				std::swap(colorWeights, alphaWeights);
+				std::swap(colorIndices, alphaIndices);
+			}
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* e0 = endpoints[subsets[i] * 2];
+			const int* e1 = endpoints[subsets[i] * 2 + 1];
+			int cw = colorWeights[colorIndices[i]];
+			int aw = alphaWeights[alphaIndices[i]];
+
+			int rgba[4] =
+			{
+				Interpolate(e0[0], e1[0], cw),
+				Interpolate(e0[1], e1[1], cw),
+				Interpolate(e0[2], e1[2], cw),
+				Interpolate(e0[3], e1[3], aw),
+			};
+
+			if (rotation)
+				std::swap(rgba[3], rgba[rotation - 1]);
+
+			texels[i] = PackRGBA(rgba[0], rgba[1], rgba[2], rgba[3]);
+		}
+
+		StoreTexels(texels, dst, dstRowPitch);
+	}
+
+	//-----------------------------------------------------------------------------------
+	// DDS header
+	//-----------------------------------------------------------------------------------
+
+	const uint32_t DDSMagic = 0x20534444; // "DDS "
+	const uint32_t DDSHeaderSize = 124;
+	const uint32_t DDSFlagMipCount = 0x20000;
+	const uint32_t DDSPixelFormatFourCC = 0x4;
+	const uint32_t DDSDimensionTexture3D = 4;
+
+	inline uint32_t ReadU32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, 4);
+		return value;
+	}
+
+	inline uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+}
+
+BlockFormat BlockDecoder::FormatFromDXGI(uint32_t dxgiFormat)
+{
+	switch (dxgiFormat)
+	{
+	case 70: case 71: case 72: return BlockFormat::BC1;   // DXGI_FORMAT_BC1_*
+	case 73: case 74: case 75: return BlockFormat::BC2;   // DXGI_FORMAT_BC2_*
+	case 76: case 77: case 78: return BlockFormat::BC3;   // DXGI_FORMAT_BC3_*
+	case 79: case 80: return BlockFormat::BC4UNorm;       // DXGI_FORMAT_BC4_TYPELESS / UNORM
+	case 81: return BlockFormat::BC4SNorm;
+	case 82: case 83: return BlockFormat::BC5UNorm;       // DXGI_FORMAT_BC5_TYPELESS / UNORM
+	case 84: return BlockFormat::BC5SNorm;
+	case 94: case 95: return BlockFormat::BC6HUF16;       // DXGI_FORMAT_BC6H_TYPELESS / UF16
+	case 96: return BlockFormat::BC6HSF16;
+	case 97: case 98: case 99: return BlockFormat::BC7;   // DXGI_FORMAT_BC7_*
+	default: return BlockFormat::Unknown;
+	}
+}
+
+uint32_t BlockDecoder::BytesPerBlock(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC4UNorm:
+	case BlockFormat::BC4SNorm:
+		return 8;
+	case BlockFormat::Unknown:
+		return 0;
+	default:
+		return 16;
+	}
+}
+
+size_t BlockDecoder::SurfaceSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+	size_t blocksWide = std::max<size_t>(1, (width + 3) / 4);
+	size_t blocksHigh = std::max<size_t>(1, (height + 3) / 4);
+	return blocksWide * blocksHigh * BytesPerBlock(format);
+}
+
+const char* BlockDecoder::FormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC2: return "BC2";
+	case BlockFormat::BC3: return "BC3";
+	case BlockFormat::BC4UNorm: return "BC4_UNORM";
+	case BlockFormat::BC4SNorm: return "BC4_SNORM";
+	case BlockFormat::BC5UNorm: return "BC5_UNORM";
+	case BlockFormat::BC5SNorm: return "BC5_SNORM";
+	case BlockFormat::BC6HUF16: return "BC6H_UF16";
+	case BlockFormat::BC6HSF16: return "BC6H_SF16";
+	case BlockFormat::BC7: return "BC7";
+	default: return "Unknown";
+	}
+}
+
+SimdLevel BlockDecoder::GetSupportedSimdLevel()
+{
+	bool sse41 = false;
+	bool avx2 = false;
+#if BLOCK_DECODER_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	sse41 = (info[2] & (1 << 19)) != 0;
+
+	// AVX registers are only usable if the OS saves them (OSXSAVE, then XCR0).
+	bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	if (osSavesAvx && maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#elif BLOCK_DECODER_X86
+	__builtin_cpu_init();
+	sse41 = __builtin_cpu_supports("sse4.1") != 0;
+	avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+	return avx2 ? SimdLevel::Avx2 : sse41 ? SimdLevel::Sse41 : SimdLevel::Scalar;
+}
+
+namespace
+{
+	std::atomic<SimdLevel>& ActiveSimdLevel()
+	{
+		static std::atomic<SimdLevel> level(BlockDecoder::GetSupportedSimdLevel());
+		return level;
+	}
+}
+
+SimdLevel BlockDecoder::GetSimdLevel()
+{
+	return ActiveSimdLevel().load(std::memory_order_relaxed);
+}
+
+void BlockDecoder::SetSimdLevel(SimdLevel level)
+{
+	ActiveSimdLevel().store(std::min(level, GetSupportedSimdLevel()), std::memory_order_relaxed);
+}
+
+const char* BlockDecoder::SimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::Sse41: return "SSE4.1";
+	case SimdLevel::Avx2: return "AVX2";
+	default: return "Scalar";
+	}
+}
+
+bool BlockDecoder::IsSimdEnabled()
+{
+	return GetSimdLevel() != SimdLevel::Scalar;
+}
+
+bool BlockDecoder::ParseDDS(const uint8_t* data, size_t size, BlockImage& image)
+{
+	image = BlockImage();
+
+	if (data == nullptr || size < 4 + DDSHeaderSize || ReadU32(data) != DDSMagic)
+		return false;
+
+	const uint8_t* header = data + 4;
+	if (ReadU32(header) != DDSHeaderSize)
+		return false;
+
+	uint32_t flags = ReadU32(header + 4);
+	uint32_t height = ReadU32(header + 8);
+	uint32_t width = ReadU32(header + 12);
+	uint32_t mipCount = (flags & DDSFlagMipCount) ? std::max(1u, ReadU32(header + 24)) : 1u;
+
+	const uint8_t* pixelFormat = header + 72;
+	if (!(ReadU32(pixelFormat + 4) & DDSPixelFormatFourCC))
+		return false;
+
+	size_t offset = 4 + DDSHeaderSize;
+	uint32_t fourCC = ReadU32(pixelFormat + 8);
+
+	BlockFormat format = BlockFormat::Unknown;
+	if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < offset + 20)
+			return false;
+
+		const uint8_t* dx10 = data + offset;
+		if (ReadU32(dx10 + 4) == DDSDimensionTexture3D)
+			return false;
+
+		format = FormatFromDXGI(ReadU32(dx10));
+		offset += 20;
+	}
+	else if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+		format = BlockFormat::BC1;
+	else if (fourCC == MakeFourCC('D', 'X', 'T', '2') || fourCC == MakeFourCC('D', 'X', 'T', '3'))
+		format = BlockFormat::BC2;
+	else if (fourCC == MakeFourCC('D', 'X', 'T', '4') || fourCC == MakeFourCC('D', 'X', 'T', '5'))
+		format = BlockFormat::BC3;
+	else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+		format = BlockFormat::BC4UNorm;
+	else if (fourCC == MakeFourCC('B', 'C', '4', 'S'))
+		format = BlockFormat::BC4SNorm;
+	else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+		format = BlockFormat::BC5UNorm;
+	else if (fourCC == MakeFourCC('B', 'C', '5', 'S'))
+		format = BlockFormat::BC5SNorm;
+
+	if (format == BlockFormat::Unknown || width == 0 || height == 0)
+		return false;
+
+	image.Format = format;
+	for (uint32_t level = 0; level < mipCount; ++level)
+	{
+		BlockSurface surface;
+		surface.Width = std::max(1u, width >> level);
+		surface.Height = std::max(1u, height >> level);
+		surface.Size = SurfaceSize(format, surface.Width, surface.Height);
+		if (size < offset + surface.Size)
+		{
+			image = BlockImage();
+			return false;
+		}
+
+		surface.Data = data + offset;
+		offset += surface.Size;
+		image.Mips.push_back(surface);
+
+		if (surface.Width == 1 && surface.Height == 1)
+			break;
+	}
+
+	return true;
+}
+
+void BlockDecoder::DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* dst, size_t dstRowPitch)
+{
+	if (GetSimdLevel() != SimdLevel::Scalar && BlockDecoderKernels::DecodeBlockSse41(format, block, dst, dstRowPitch))
+		return;
+
+	switch (format)
+	{
+	case BlockFormat::BC1: DecodeBC1(block, dst, dstRowPitch); break;
+	case BlockFormat::BC2: DecodeBC2(block, dst, dstRowPitch); break;
+	case BlockFormat::BC3: DecodeBC3(block, dst, dstRowPitch); break;
+	case BlockFormat::BC4UNorm: DecodeBC4(block, false, dst, dstRowPitch); break;
+	case BlockFormat::BC4SNorm: DecodeBC4(block, true, dst, dstRowPitch); break;
+	case BlockFormat::BC5UNorm: DecodeBC5(block, false, dst, dstRowPitch); break;
+	case BlockFormat::BC5SNorm: DecodeBC5(block, true, dst, dstRowPitch); break;
+	case BlockFormat::BC6HUF16: DecodeBC6H(block, false, dst, dstRowPitch); break;
+	case BlockFormat::BC6HSF16: DecodeBC6H(block, true, dst, dstRowPitch); break;
+	case BlockFormat::BC7: DecodeBC7(block, dst, dstRowPitch); break;
+	default: break;
+	}
+}
+
+void BlockDecoder::DecodeRows(BlockFormat format, const uint8_t* src, uint32_t width, uint32_t height,
+	uint32_t firstBlockRow, uint32_t lastBlockRow, uint8_t* dst, size_t dstRowPitch)
+{
+	uint32_t blocksWide = std::max(1u, (width + 3) / 4);
+	uint32_t blockSize = BytesPerBlock(format);
+
+	// The AVX2 kernels decode two full blocks side by side.
+	bool decodePairs = GetSimdLevel() == SimdLevel::Avx2 && format >= BlockFormat::BC1 && format <= BlockFormat::BC5SNorm;
+
+	for (uint32_t by = firstBlockRow; by < lastBlockRow; ++by)
+	{
+		const uint8_t* block = src + (size_t)by * blocksWide * blockSize;
+		uint32_t y = by * 4;
+		uint32_t rows = std::min(4u, height - y);
+
+		for (uint32_t bx = 0; bx < blocksWide; ++bx, block += blockSize)
+		{
+			uint32_t x = bx * 4;
+			uint32_t columns = std::min(4u, width - x);
+			uint8_t* out = dst + (size_t)y * dstRowPitch + (size_t)x * 4;
+
+			if (rows == 4 && columns == 4)
+			{
+				if (decodePairs && width - x >= 8
+					&& BlockDecoderKernels::DecodeBlockPairAvx2(format, block, out, dstRowPitch))
+				{
+					++bx;
+					block += blockSize;
+					continue;
+				}
+
+				DecodeBlock(format, block, out, dstRowPitch);
+				continue;
+			}
+
+			// Edge blocks of surfaces that are not a multiple of four.
+			uint8_t texels[4 * 4 * 4];
+			DecodeBlock(format, block, texels, 16);
+			for (uint32_t row = 0; row < rows; ++row)
+				std::memcpy(out + row * dstRowPitch, texels + row * 16, columns * 4);
+		}
+	}
+}
+
+void BlockDecoder::DecodeSurface(BlockFormat format, const uint8_t* src, uint32_t width, uint32_t height,
+	uint8_t* dst, size_t dstRowPitch, unsigned threadCount)
+{
+	if (format == BlockFormat::Unknown || width == 0 || height == 0)
+		return;
+
+	uint32_t blocksHigh = (height + 3) / 4;
+	uint32_t tileCount = (blocksHigh + TileBlockRows - 1) / TileBlockRows;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min<unsigned>(threadCount, tileCount);
+
+	if (threadCount <= 1)
+	{
+		DecodeRows(format, src, width, height, 0, blocksHigh, dst, dstRowPitch);
+		return;
+	}
+
+	// Workers pull tiles from a shared counter so that uneven BC6H / BC7 mode mixes
+	// still balance.
+	std::atomic<uint32_t> nextTile(0);
+	auto worker = [&]()
+	{
+		for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++)
+		{
+			uint32_t first = tile * TileBlockRows;
+			uint32_t last = std::min(first + TileBlockRows, blocksHigh);
+			DecodeRows(format, src, width, height, first, last, dst, dstRowPitch);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (unsigned i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+bool BlockDecoder::DecodeMips(const BlockImage& image, std::vector<DecodedSurface>& mips, unsigned threadCount)
+{
+	mips.clear();
+	mips.resize(image.Mips.size());
+
+	for (size_t level = 0; level < image.Mips.size(); ++level)
+	{
+		const BlockSurface& surface = image.Mips[level];
+		if (surface.Data == nullptr || surface.Size < SurfaceSize(image.Format, surface.Width, surface.Height))
+		{
+			mips.clear();
+			return false;
+		}
+
+		DecodedSurface& decoded = mips[level];
+		decoded.Width = surface.Width;
+		decoded.Height = surface.Height;
+		decoded.Pixels.resize((size_t)surface.Width * surface.Height * 4);
+		DecodeSurface(image.Format, surface.Data, surface.Width, surface.Height,
+			decoded.Pixels.data(), (size_t)surface.Width * 4, threadCount);
+	}
+
+	return true;
+}
+
+double BlockDecoder::MeasureThroughput(BlockFormat format, uint32_t width, uint32_t height,
+	uint32_t iterations, unsigned threadCount)
+{
+	if (format == BlockFormat::Unknown || width == 0 || height == 0 || iterations == 0)
+		return 0.0;
+
+	std::vector<uint8_t> blocks(SurfaceSize(format, width, height));
+	uint32_t state = 0x9E3779B9u;
+	for (uint8_t& byte : blocks)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		byte = (uint8_t)state;
+	}
+
+	std::vector<uint8_t> pixels((size_t)width * height * 4);
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < iterations; ++i)
+		DecodeSurface(format, blocks.data(), width, height, pixels.data(), (size_t)width * 4, threadCount);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	double megabytes = (double)pixels.size() * iterations / (1024.0 * 1024.0);
+	return elapsed.count() > 0.0 ? megabytes / elapsed.count() : 0.0;
+}
@@ -0,0 +1,186 @@
+//***************************************************************************************
+// BlockDecoder.h
+//
+// CPU decoder for the block compressed (BC1 - BC7) formats accepted by the DDS loader.
+// It expands compressed mip levels to tightly packed RGBA8 so that tools, thumbnails,
+// collision masks and image comparisons can read texture data without a GPU.
+//
+// The code is free of Windows and Direct3D headers so it also builds on the headless
+// Linux machines.  BC1 - BC5 are decoded with AVX2, two blocks at a time, or SSE4.1,
+// whichever the CPU supports, and in scalar code otherwise; every path produces
+// identical output.  The SIMD kernels are compiled for their instruction set on
+// their own (BlockDecoderKernels.h), so the choice is made at run time.  BC6H and
+// BC7 are bit-stream driven and decoded per block in scalar code.  Large surfaces are
+// split into tiles of block rows that are decoded on several threads.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Block compressed formats understood by BlockDecoder
+ */
+enum class BlockFormat
+{
+	Unknown,
+	BC1,        ///< DXT1, 1-bit punch-through alpha
+	BC2,        ///< DXT3, explicit 4-bit alpha
+	BC3,        ///< DXT5, interpolated alpha
+	BC4UNorm,   ///< Single channel, written to R
+	BC4SNorm,
+	BC5UNorm,   ///< Two channels, written to R and G
+	BC5SNorm,
+	BC6HUF16,   ///< HDR, clamped to [0, 1] on decode
+	BC6HSF16,
+	BC7
+};
+
+/**
+ * @brief Instruction sets the BC1 - BC5 kernels can use, in increasing order
+ */
+enum class SimdLevel
+{
+	Scalar,
+	Sse41,
+	Avx2    ///< Also uses the SSE4.1 kernel for blocks decoded on their own
+};
+
+/**
+ * @brief One mip level of a compressed image
+ */
+struct BlockSurface
+{
+	std::uint32_t Width = 0;    ///< Width in texels
+	std::uint32_t Height = 0;   ///< Height in texels
+	const std::uint8_t* Data = nullptr; ///< First block of the level
+	std::size_t Size = 0;       ///< Size of the level in bytes
+};
+
+/**
+ * @brief View of a compressed 2D image and its mip chain
+ *
+ * The surfaces point into the buffer handed to BlockDecoder::ParseDDS(), which must
+ * stay alive for as long as the image is used.
+ */
+struct BlockImage
+{
+	BlockFormat Format = BlockFormat::Unknown;
+	std::vector<BlockSurface> Mips;
+};
+
+/**
+ * @brief A decoded RGBA8 mip level
+ */
+struct DecodedSurface
+{
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::vector<std::uint8_t> Pixels; ///< Width * Height * 4 bytes, rows tightly packed
+};
+
+class BlockDecoder
+{
+public:
+
+	/**
+	 * @brief Maps a numeric DXGI_FORMAT value (including TYPELESS and SRGB variants)
+	 * @return Unknown if the format is not block compressed
+	 */
+	static BlockFormat FormatFromDXGI(std::uint32_t dxgiFormat);
+
+	/**
+	 * @brief Size of one 4x4 block in bytes (8 or 16)
+	 */
+	static std::uint32_t BytesPerBlock(BlockFormat format);
+
+	/**
+	 * @brief Size in bytes of a compressed surface
+	 */
+	static std::size_t SurfaceSize(BlockFormat format, std::uint32_t width, std::uint32_t height);
+
+	/**
+	 * @brief Human readable format name, used by the benchmark report
+	 */
+	static const char* FormatName(BlockFormat format);
+
+	/**
+	 * @brief Best kernel the CPU can run
+	 */
+	static SimdLevel GetSupportedSimdLevel();
+
+	/**
+	 * @brief Kernel used by the decode functions, GetSupportedSimdLevel() unless lowered
+	 */
+	static SimdLevel GetSimdLevel();
+
+	/**
+	 * @brief Caps the kernel used by the decode functions, e.g. to compare them
+	 * @param level Clamped to GetSupportedSimdLevel()
+	 */
+	static void SetSimdLevel(SimdLevel level);
+
+	static const char* SimdLevelName(SimdLevel level);
+
+	/**
+	 * @brief True if a SIMD kernel decodes BC1 - BC5
+	 */
+	static bool IsSimdEnabled();
+
+	/**
+	 * @brief Reads the header of an in-memory DDS file
+	 *
+	 * Only the first array slice of 2D textures is exposed.
+	 * @param data File contents, must outlive the returned image
+	 * @param size Size of the file in bytes
+	 * @param image Receives the format and one surface per mip level
+	 * @return False if the file is malformed or not block compressed
+	 */
+	static bool ParseDDS(const std::uint8_t* data, std::size_t size, BlockImage& image);
+
+	/**
+	 * @brief Decodes one 4x4 block
+	 * @param format Block format
+	 * @param block Compressed block (8 or 16 bytes)
+	 * @param dst Top left texel of the destination, RGBA8
+	 * @param dstRowPitch Distance between destination rows in bytes
+	 */
+	static void DecodeBlock(BlockFormat format, const std::uint8_t* block, std::uint8_t* dst, std::size_t dstRowPitch);
+
+	/**
+	 * @brief Decodes a whole surface
+	 * @param format Block format
+	 * @param src Compressed blocks, rows of ceil(width / 4) blocks
+	 * @param width Width in texels
+	 * @param height Height in texels
+	 * @param dst Destination RGBA8 texels
+	 * @param dstRowPitch Distance between destination rows in bytes
+	 * @param threadCount Worker threads, 0 to use every hardware thread
+	 */
+	static void DecodeSurface(BlockFormat format, const std::uint8_t* src, std::uint32_t width, std::uint32_t height,
+		std::uint8_t* dst, std::size_t dstRowPitch, unsigned threadCount = 0);
+
+	/**
+	 * @brief Decodes every mip level of an image
+	 * @param image Image returned by ParseDDS()
+	 * @param mips Receives one decoded surface per level
+	 * @param threadCount Worker threads, 0 to use every hardware thread
+	 * @return False if a level is smaller than its block data requires
+	 */
+	static bool DecodeMips(const BlockImage& image, std::vector<DecodedSurface>& mips, unsigned threadCount = 0);
+
+	/**
+	 * @brief Measures decode throughput on generated data
+	 *
+	 * The input is pseudo random, which for BC6H and BC7 exercises every mode.
+	 * @return Decoded RGBA8 output in megabytes per second
+	 */
+	static double MeasureThroughput(BlockFormat format, std::uint32_t width, std::uint32_t height,
+		std::uint32_t iterations, unsigned threadCount = 0);
+
+private:
+	static void DecodeRows(BlockFormat format, const std::uint8_t* src, std::uint32_t width, std::uint32_t height,
+		std::uint32_t firstBlockRow, std::uint32_t lastBlockRow, std::uint8_t* dst, std::size_t dstRowPitch);
+};
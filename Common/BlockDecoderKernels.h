@@ -0,0 +1,66 @@
+//***************************************************************************************
+// BlockDecoderKernels.h
+//
+// Internal to BlockDecoder.  The SSE4.1 and AVX2 kernels for BC1 - BC5 live in their
+// own files, which are the only ones compiled for those instruction sets (see
+// CMakeLists.txt and the vcxproj), so the rest of the program runs on any x86-64
+// CPU.  BlockDecoder picks a kernel at run time from what the CPU supports.  The
+// kernels share the palette builders and shuffle tables below, which are plain C++
+// defined in BlockDecoder.cpp.
+//***************************************************************************************
+
+#pragma once
+
+#include "BlockDecoder.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace BlockDecoderKernels
+{
+	/**
+	 * @brief Builds the four colour palette of a BC1 style colour block
+	 * @param punchThrough Allow the three colour + transparent mode (BC1 only)
+	 */
+	void BuildColorPalette(const std::uint8_t* block, bool punchThrough, std::uint32_t palette[4]);
+
+	/**
+	 * @brief Builds the eight entry palette of a BC3 alpha / BC4 / BC5 channel block
+	 */
+	void BuildChannelPalette(const std::uint8_t* block, bool isSigned, std::uint8_t palette[8]);
+
+	/**
+	 * @brief Unpacks the sixteen 3-bit indices of a channel block
+	 */
+	void UnpackChannelIndices(const std::uint8_t* block, std::uint8_t indices[16]);
+
+	/**
+	 * @brief Byte shuffle masks of the SIMD kernels
+	 *
+	 * ColorRow[b] expands one byte of BC1 indices (one row of four texels) into byte
+	 * offsets of a 4 x 32-bit palette register.  ChannelToByte[r][c] moves the four
+	 * channel values of row r into byte c of each texel.
+	 */
+	struct ShuffleTables
+	{
+		alignas(16) std::uint8_t ColorRow[256][16];
+		alignas(16) std::uint8_t ChannelToByte[4][4][16];
+
+		ShuffleTables();
+	};
+
+	const ShuffleTables& GetShuffleTables();
+
+	/**
+	 * @brief Decodes one BC1 - BC5 block with SSE4.1
+	 * @return False for the other formats, or if the kernel was not compiled in
+	 */
+	bool DecodeBlockSse41(BlockFormat format, const std::uint8_t* block, std::uint8_t* dst, std::size_t dstRowPitch);
+
+	/**
+	 * @brief Decodes two horizontally adjacent BC1 - BC5 blocks with AVX2
+	 * @param blocks The left block, followed by the right one
+	 * @param dst Top left texel of the left block; the right one is stored 16 bytes on
+	 * @return False for the other formats, or if the kernel was not compiled in
+	 */
+	bool DecodeBlockPairAvx2(BlockFormat format, const std::uint8_t* blocks, std::uint8_t* dst, std::size_t dstRowPitch);
+}
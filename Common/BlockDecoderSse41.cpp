@@ -0,0 +1,127 @@
+//***************************************************************************************
+// BlockDecoderSse41.cpp
+//
+// SSE4.1 kernels for BC1 - BC5.  Built with -msse4.1 by GCC and Clang; MSVC allows
+// the intrinsics without an /arch switch.  Only called once BlockDecoder has seen
+// SSE4.1 on the CPU.
+//***************************************************************************************
+
+#include "BlockDecoderKernels.h"
+
+#if defined(__SSE4_1__) || defined(_M_X64) || defined(_M_IX86)
+#define BLOCK_DECODER_SSE41 1
+#include <smmintrin.h>
+#endif
+
+using std::uint8_t;
+using std::uint32_t;
+using std::size_t;
+
+#if BLOCK_DECODER_SSE41
+
+namespace
+{
+	using namespace BlockDecoderKernels;
+
+	inline __m128i Load128(const uint8_t* p)
+	{
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+	}
+
+	// Looks up sixteen 3-bit channel indices in an eight entry palette.
+	inline __m128i LookupChannel(const uint8_t* block, bool isSigned)
+	{
+		alignas(16) uint8_t palette[16] = {};
+		alignas(16) uint8_t indices[16];
+		BuildChannelPalette(block, isSigned, palette);
+		UnpackChannelIndices(block, indices);
+		return _mm_shuffle_epi8(Load128(palette), Load128(indices));
+	}
+
+	// Expands a colour block into four rows of RGBA texels.
+	inline void DecodeColorRows(const uint8_t* block, bool punchThrough, __m128i rows[4])
+	{
+		const ShuffleTables& tables = GetShuffleTables();
+
+		alignas(16) uint32_t palette[4];
+		BuildColorPalette(block, punchThrough, palette);
+		__m128i pal = Load128(reinterpret_cast<const uint8_t*>(palette));
+
+		for (int y = 0; y < 4; ++y)
+			rows[y] = _mm_shuffle_epi8(pal, Load128(tables.ColorRow[block[4 + y]]));
+	}
+
+	// Replaces byte c of every texel with the matching value from channel.
+	inline void InsertChannel(__m128i rows[4], __m128i channel, int c)
+	{
+		const ShuffleTables& tables = GetShuffleTables();
+		const __m128i keep = _mm_set1_epi32((int)~(0xFFu << (8 * c)));
+
+		for (int y = 0; y < 4; ++y)
+		{
+			__m128i values = _mm_shuffle_epi8(channel, Load128(tables.ChannelToByte[y][c]));
+			rows[y] = _mm_or_si128(_mm_and_si128(rows[y], keep), values);
+		}
+	}
+
+	// Sixteen 4-bit alphas, low nibble first, scaled to 8 bits by replication.
+	inline __m128i ExplicitAlpha(const uint8_t* block)
+	{
+		__m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+		__m128i nibbleMask = _mm_set1_epi8(0x0F);
+		__m128i lo = _mm_and_si128(packed, nibbleMask);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(packed, 4), nibbleMask);
+		__m128i alpha = _mm_unpacklo_epi8(lo, hi);
+		return _mm_or_si128(alpha, _mm_slli_epi16(alpha, 4));
+	}
+
+	inline void StoreRows(const __m128i rows[4], uint8_t* dst, size_t dstRowPitch)
+	{
+		for (int y = 0; y < 4; ++y)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + y * dstRowPitch), rows[y]);
+	}
+}
+
+bool BlockDecoderKernels::DecodeBlockSse41(BlockFormat format, const uint8_t* block, uint8_t* dst, size_t dstRowPitch)
+{
+	const __m128i opaqueBlack = _mm_set1_epi32((int)0xFF000000);
+	__m128i rows[4] = { opaqueBlack, opaqueBlack, opaqueBlack, opaqueBlack };
+
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		DecodeColorRows(block, true, rows);
+		break;
+	case BlockFormat::BC2:
+		DecodeColorRows(block + 8, false, rows);
+		InsertChannel(rows, ExplicitAlpha(block), 3);
+		break;
+	case BlockFormat::BC3:
+		DecodeColorRows(block + 8, false, rows);
+		InsertChannel(rows, LookupChannel(block, false), 3);
+		break;
+	case BlockFormat::BC4UNorm:
+	case BlockFormat::BC4SNorm:
+		InsertChannel(rows, LookupChannel(block, format == BlockFormat::BC4SNorm), 0);
+		break;
+	case BlockFormat::BC5UNorm:
+	case BlockFormat::BC5SNorm:
+		InsertChannel(rows, LookupChannel(block, format == BlockFormat::BC5SNorm), 0);
+		InsertChannel(rows, LookupChannel(block + 8, format == BlockFormat::BC5SNorm), 1);
+		break;
+	default:
+		return false;
+	}
+
+	StoreRows(rows, dst, dstRowPitch);
+	return true;
+}
+
+#else
+
+bool BlockDecoderKernels::DecodeBlockSse41(BlockFormat, const uint8_t*, uint8_t*, size_t)
+{
+	return false;
+}
+
+#endif
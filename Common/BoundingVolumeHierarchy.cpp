@@ -0,0 +1,488 @@
+//***************************************************************************************
+// BoundingVolumeHierarchy.cpp
+//***************************************************************************************
+
+#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+#include <utility>
+
+using uint32 = BoundingVolumeHierarchy::uint32;
+
+const uint32 BoundingVolumeHierarchy::NullNode;
+
+namespace
+{
+	// Buckets of the binned SAH split; more barely improves the trees of a game scene.
+	const int SahBinCount = 12;
+
+	float Centroid(const Aabb& bounds, int axis)
+	{
+		return 0.5f * (bounds.Min[axis] + bounds.Max[axis]);
+	}
+}
+
+Aabb Aabb::Union(const Aabb& a, const Aabb& b)
+{
+	Aabb result;
+	for (int k = 0; k < 3; ++k)
+	{
+		result.Min[k] = std::min(a.Min[k], b.Min[k]);
+		result.Max[k] = std::max(a.Max[k], b.Max[k]);
+	}
+	return result;
+}
+
+bool Aabb::Overlaps(const Aabb& a, const Aabb& b)
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		if (a.Max[k] < b.Min[k] || b.Max[k] < a.Min[k])
+			return false;
+	}
+	return true;
+}
+
+float Aabb::SurfaceArea() const
+{
+	float dx = Max[0] - Min[0];
+	float dy = Max[1] - Min[1];
+	float dz = Max[2] - Min[2];
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+bool Aabb::Contains(const Aabb& other) const
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		if (other.Min[k] < Min[k] || other.Max[k] > Max[k])
+			return false;
+	}
+	return true;
+}
+
+uint32 BoundingVolumeHierarchy::Insert(const Aabb& bounds, uint32 userData)
+{
+	uint32 leaf = AllocateNode();
+	mNodes[leaf].Bounds = bounds;
+	mNodes[leaf].UserData = userData;
+	++mLeafCount;
+
+	InsertLeaf(leaf);
+	return leaf;
+}
+
+void BoundingVolumeHierarchy::Remove(uint32 leaf)
+{
+	--mLeafCount;
+
+	if (leaf == mRoot)
+	{
+		mRoot = NullNode;
+		FreeNode(leaf);
+		return;
+	}
+
+	uint32 parent = mNodes[leaf].Parent;
+	uint32 grandParent = mNodes[parent].Parent;
+	uint32 sibling = mNodes[parent].Left == leaf ? mNodes[parent].Right : mNodes[parent].Left;
+
+	// The sibling takes the parent's place.
+	mNodes[sibling].Parent = grandParent;
+	if (grandParent == NullNode)
+	{
+		mRoot = sibling;
+	}
+	else
+	{
+		Node& node = mNodes[grandParent];
+		(node.Left == parent ? node.Left : node.Right) = sibling;
+	}
+
+	mInternalArea -= mNodes[parent].Bounds.SurfaceArea();
+	FreeNode(parent);
+	FreeNode(leaf);
+
+	RefitAncestors(grandParent);
+}
+
+void BoundingVolumeHierarchy::Update(uint32 leaf, const Aabb& bounds)
+{
+	Node& node = mNodes[leaf];
+	node.Bounds = bounds;
+	if (!node.Moved)
+	{
+		node.Moved = true;
+		mMovedLeaves.push_back(leaf);
+	}
+}
+
+void BoundingVolumeHierarchy::Refit()
+{
+	for (uint32 leaf : mMovedLeaves)
+	{
+		// Removed leaves have had their flag cleared.
+		if (!mNodes[leaf].Moved)
+			continue;
+		mNodes[leaf].Moved = false;
+		RefitAncestors(mNodes[leaf].Parent);
+	}
+	mMovedLeaves.clear();
+
+	if (mRebuildRatio > 0.0f && mLeafCount > 2 && GetCost() > mRebuildRatio * mRebuildCost)
+		Rebuild();
+}
+
+void BoundingVolumeHierarchy::Rebuild()
+{
+	std::vector<uint32> leaves;
+	leaves.reserve(mLeafCount);
+
+	// Collect the leaves and free every internal node.
+	if (mRoot != NullNode)
+	{
+		std::vector<uint32> stack(1, mRoot);
+		while (!stack.empty())
+		{
+			uint32 index = stack.back();
+			stack.pop_back();
+
+			if (mNodes[index].IsLeaf())
+			{
+				leaves.push_back(index);
+				continue;
+			}
+
+			stack.push_back(mNodes[index].Left);
+			stack.push_back(mNodes[index].Right);
+			FreeNode(index);
+		}
+	}
+
+	// Pending refits are covered by the rebuild.
+	for (uint32 leaf : leaves)
+		mNodes[leaf].Moved = false;
+	mMovedLeaves.clear();
+
+	mInternalArea = 0.0f;
+	mRoot = leaves.empty() ? NullNode : BuildSubtree(leaves.data(), leaves.size());
+	if (mRoot != NullNode)
+		mNodes[mRoot].Parent = NullNode;
+
+	mRebuildCost = GetCost();
+	++mRebuildCount;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+	mNodes.clear();
+	mMovedLeaves.clear();
+	mRoot = NullNode;
+	mFreeList = NullNode;
+	mLeafCount = 0;
+	mInternalArea = 0.0f;
+	mRebuildCost = 0.0f;
+}
+
+uint32 BoundingVolumeHierarchy::GetHeight() const
+{
+	if (mRoot == NullNode)
+		return 0;
+
+	uint32 height = 0;
+	std::vector<std::pair<uint32, uint32>> stack(1, std::make_pair(mRoot, 1u));
+	while (!stack.empty())
+	{
+		auto entry = stack.back();
+		stack.pop_back();
+
+		height = std::max(height, entry.second);
+		const Node& node = mNodes[entry.first];
+		if (!node.IsLeaf())
+		{
+			stack.emplace_back(node.Left, entry.second + 1);
+			stack.emplace_back(node.Right, entry.second + 1);
+		}
+	}
+	return height;
+}
+
+float BoundingVolumeHierarchy::GetCost() const
+{
+	if (mRoot == NullNode || mNodes[mRoot].IsLeaf())
+		return 0.0f;
+
+	float rootArea = mNodes[mRoot].Bounds.SurfaceArea();
+	return rootArea > 0.0f ? mInternalArea / rootArea : 0.0f;
+}
+
+float BoundingVolumeHierarchy::IntersectRay(const Aabb& bounds, const float origin[3], const float inverseDirection[3], float maxDistance)
+{
+	float entry = 0.0f;
+	float exit = maxDistance;
+	for (int k = 0; k < 3; ++k)
+	{
+		float t0 = (bounds.Min[k] - origin[k]) * inverseDirection[k];
+		float t1 = (bounds.Max[k] - origin[k]) * inverseDirection[k];
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		// Written so that the NaN of a ray lying in a slab plane leaves the interval alone.
+		entry = t0 > entry ? t0 : entry;
+		exit = t1 < exit ? t1 : exit;
+		if (entry > exit)
+			return -1.0f;
+	}
+	return entry;
+}
+
+uint32 BoundingVolumeHierarchy::AllocateNode()
+{
+	uint32 index;
+	if (mFreeList != NullNode)
+	{
+		index = mFreeList;
+		mFreeList = mNodes[index].Parent;
+	}
+	else
+	{
+		index = (uint32)mNodes.size();
+		mNodes.emplace_back();
+	}
+
+	mNodes[index] = Node();
+	return index;
+}
+
+void BoundingVolumeHierarchy::FreeNode(uint32 node)
+{
+	mNodes[node].Moved = false;
+	mNodes[node].Parent = mFreeList;
+	mFreeList = node;
+}
+
+void BoundingVolumeHierarchy::InsertLeaf(uint32 leaf)
+{
+	if (mRoot == NullNode)
+	{
+		mRoot = leaf;
+		mNodes[leaf].Parent = NullNode;
+		return;
+	}
+
+	const Aabb bounds = mNodes[leaf].Bounds;
+
+	// Descend towards the sibling that adds the least area to the tree.  Going down
+	// a child costs the growth of every node passed on the way (Box2D's heuristic).
+	uint32 index = mRoot;
+	while (!mNodes[index].IsLeaf())
+	{
+		const Node& node = mNodes[index];
+		float area = node.Bounds.SurfaceArea();
+		float combinedArea = Aabb::Union(node.Bounds, bounds).SurfaceArea();
+
+		// Pairing with this node creates a parent of the combined area.
+		float cost = 2.0f * combinedArea;
+		float inheritedCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		const uint32 children[2] = { node.Left, node.Right };
+		for (int c = 0; c < 2; ++c)
+		{
+			const Node& child = mNodes[children[c]];
+			float grown = Aabb::Union(child.Bounds, bounds).SurfaceArea();
+			childCost[c] = (child.IsLeaf() ? grown : grown - child.Bounds.SurfaceArea()) + inheritedCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+
+		index = childCost[0] <= childCost[1] ? children[0] : children[1];
+	}
+
+	uint32 sibling = index;
+	uint32 oldParent = mNodes[sibling].Parent;
+	uint32 newParent = AllocateNode();
+	mNodes[newParent].Parent = oldParent;
+	mNodes[newParent].Left = sibling;
+	mNodes[newParent].Right = leaf;
+	mNodes[newParent].Bounds = Aabb::Union(mNodes[sibling].Bounds, bounds);
+	mInternalArea += mNodes[newParent].Bounds.SurfaceArea();
+
+	if (oldParent == NullNode)
+	{
+		mRoot = newParent;
+	}
+	else
+	{
+		Node& node = mNodes[oldParent];
+		(node.Left == sibling ? node.Left : node.Right) = newParent;
+	}
+
+	mNodes[sibling].Parent = newParent;
+	mNodes[leaf].Parent = newParent;
+
+	RefitAncestors(oldParent);
+}
+
+void BoundingVolumeHierarchy::RefitAncestors(uint32 node)
+{
+	while (node != NullNode)
+	{
+		const Node& current = mNodes[node];
+		Aabb bounds = Aabb::Union(mNodes[current.Left].Bounds, mNodes[current.Right].Bounds);
+
+		// Ancestors of an unchanged node need nothing from this walk.
+		const Aabb& old = current.Bounds;
+		if (std::equal(bounds.Min, bounds.Min + 3, old.Min) && std::equal(bounds.Max, bounds.Max + 3, old.Max))
+			return;
+
+		SetInternalBounds(node, bounds);
+		node = current.Parent;
+	}
+}
+
+void BoundingVolumeHierarchy::SetInternalBounds(uint32 node, const Aabb& bounds)
+{
+	mInternalArea += bounds.SurfaceArea() - mNodes[node].Bounds.SurfaceArea();
+	mNodes[node].Bounds = bounds;
+}
+
+uint32 BoundingVolumeHierarchy::BuildSubtree(uint32* leaves, std::size_t count)
+{
+	struct Task
+	{
+		uint32* Leaves;
+		std::size_t Count;
+		uint32 Parent;
+		bool Left;
+	};
+
+	uint32 root = NullNode;
+	std::vector<Task> tasks(1, Task{ leaves, count, NullNode, true });
+
+	while (!tasks.empty())
+	{
+		Task task = tasks.back();
+		tasks.pop_back();
+
+		uint32 index;
+		if (task.Count == 1)
+		{
+			index = task.Leaves[0];
+		}
+		else
+		{
+			Aabb bounds = mNodes[task.Leaves[0]].Bounds;
+			Aabb centroids;
+			for (int k = 0; k < 3; ++k)
+				centroids.Min[k] = centroids.Max[k] = Centroid(bounds, k);
+
+			for (std::size_t i = 1; i < task.Count; ++i)
+			{
+				const Aabb& leafBounds = mNodes[task.Leaves[i]].Bounds;
+				bounds = Aabb::Union(bounds, leafBounds);
+				for (int k = 0; k < 3; ++k)
+				{
+					float c = Centroid(leafBounds, k);
+					centroids.Min[k] = std::min(centroids.Min[k], c);
+					centroids.Max[k] = std::max(centroids.Max[k], c);
+				}
+			}
+
+			int axis = 0;
+			for (int k = 1; k < 3; ++k)
+			{
+				if (centroids.Max[k] - centroids.Min[k] > centroids.Max[axis] - centroids.Min[axis])
+					axis = k;
+			}
+
+			std::size_t split = task.Count / 2;
+			float extent = centroids.Max[axis] - centroids.Min[axis];
+			if (extent > 0.0f)
+			{
+				// Bin the centroids and take the bin boundary with the lowest SAH cost.
+				Aabb binBounds[SahBinCount];
+				std::size_t binCounts[SahBinCount] = {};
+				float scale = SahBinCount / extent;
+				auto binOf = [&](uint32 leaf)
+				{
+					int bin = (int)((Centroid(mNodes[leaf].Bounds, axis) - centroids.Min[axis]) * scale);
+					return std::min(std::max(bin, 0), SahBinCount - 1);
+				};
+
+				for (std::size_t i = 0; i < task.Count; ++i)
+				{
+					uint32 leaf = task.Leaves[i];
+					int bin = binOf(leaf);
+					binBounds[bin] = binCounts[bin]++ == 0 ? mNodes[leaf].Bounds : Aabb::Union(binBounds[bin], mNodes[leaf].Bounds);
+				}
+
+				float rightArea[SahBinCount];
+				std::size_t rightCount[SahBinCount];
+				Aabb accumulated;
+				std::size_t accumulatedCount = 0;
+				for (int b = SahBinCount - 1; b > 0; --b)
+				{
+					if (binCounts[b] != 0)
+						accumulated = accumulatedCount == 0 ? binBounds[b] : Aabb::Union(accumulated, binBounds[b]);
+					accumulatedCount += binCounts[b];
+					rightArea[b] = accumulated.SurfaceArea();
+					rightCount[b] = accumulatedCount;
+				}
+
+				int bestBoundary = 0;
+				float bestCost = 0.0f;
+				accumulatedCount = 0;
+				for (int b = 1; b < SahBinCount; ++b)
+				{
+					if (binCounts[b - 1] != 0)
+						accumulated = accumulatedCount == 0 ? binBounds[b - 1] : Aabb::Union(accumulated, binBounds[b - 1]);
+					accumulatedCount += binCounts[b - 1];
+					if (accumulatedCount == 0 || rightCount[b] == 0)
+						continue;
+
+					float cost = accumulated.SurfaceArea() * accumulatedCount + rightArea[b] * rightCount[b];
+					if (bestBoundary == 0 || cost < bestCost)
+					{
+						bestBoundary = b;
+						bestCost = cost;
+					}
+				}
+
+				if (bestBoundary != 0)
+				{
+					uint32* middle = std::partition(task.Leaves, task.Leaves + task.Count,
+						[&](uint32 leaf) { return binOf(leaf) < bestBoundary; });
+					split = (std::size_t)(middle - task.Leaves);
+				}
+			}
+
+			// Centroids too close to bin apart fall back to a median split.
+			if (split == 0 || split == task.Count)
+			{
+				split = task.Count / 2;
+				std::nth_element(task.Leaves, task.Leaves + split, task.Leaves + task.Count, [&](uint32 a, uint32 b)
+				{
+					return Centroid(mNodes[a].Bounds, axis) < Centroid(mNodes[b].Bounds, axis);
+				});
+			}
+
+			index = AllocateNode();
+			mNodes[index].Bounds = bounds;
+			mInternalArea += bounds.SurfaceArea();
+
+			tasks.push_back(Task{ task.Leaves, split, index, true });
+			tasks.push_back(Task{ task.Leaves + split, task.Count - split, index, false });
+		}
+
+		mNodes[index].Parent = task.Parent;
+		if (task.Parent == NullNode)
+			root = index;
+		else if (task.Left)
+			mNodes[task.Parent].Left = index;
+		else
+			mNodes[task.Parent].Right = index;
+	}
+
+	return root;
+}
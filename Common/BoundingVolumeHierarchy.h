@@ -0,0 +1,219 @@
+//***************************************************************************************
+// BoundingVolumeHierarchy.h
+//
+// Dynamic tree of axis-aligned boxes for culling, picking and overlap queries.
+//
+// Leaves are inserted by a greedy descent that picks the sibling adding the least
+// surface area, and removed by collapsing their parent, so both cost O(log n) on a
+// balanced tree.  Moving a leaf only stores its new box; Refit() then walks up from
+// the moved leaves once per frame.  Refitting keeps the tree valid but not good, so
+// Refit() also tracks the surface area heuristic cost of the tree and rebuilds it
+// top-down with binned SAH once the cost has grown past RebuildRatio times its cost
+// after the last rebuild.  Leaf ids stay valid across rebuilds.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Axis-aligned box
+ */
+struct Aabb
+{
+	float Min[3] = { 0.0f, 0.0f, 0.0f };
+	float Max[3] = { 0.0f, 0.0f, 0.0f };
+
+	static Aabb Union(const Aabb& a, const Aabb& b);
+	static bool Overlaps(const Aabb& a, const Aabb& b);
+	float SurfaceArea() const;
+	bool Contains(const Aabb& other) const;
+};
+
+class BoundingVolumeHierarchy
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	static const uint32 NullNode = 0xffffffffu;
+
+	BoundingVolumeHierarchy() = default;
+
+	/**
+	 * @brief Adds a leaf
+	 * @param userData Returned by GetUserData(), e.g. the index of the object
+	 * @return Id of the leaf, valid until Remove()
+	 */
+	uint32 Insert(const Aabb& bounds, uint32 userData);
+
+	/**
+	 * @brief Removes a leaf and collapses its parent
+	 */
+	void Remove(uint32 leaf);
+
+	/**
+	 * @brief Moves a leaf; its ancestors are refitted by the next Refit()
+	 */
+	void Update(uint32 leaf, const Aabb& bounds);
+
+	/**
+	 * @brief Refits the ancestors of the leaves moved since the last call
+	 *
+	 * Rebuilds the tree if refitting has made it RebuildRatio times costlier than
+	 * after the last rebuild.
+	 */
+	void Refit();
+
+	/**
+	 * @brief Rebuilds every internal node top-down with binned SAH
+	 */
+	void Rebuild();
+
+	void Clear();
+
+	/**
+	 * @brief Rebuild threshold of Refit(), 1.5 by default; 0 disables rebuilds
+	 */
+	void SetRebuildRatio(float ratio) { mRebuildRatio = ratio; }
+
+	uint32 GetUserData(uint32 leaf) const { return mNodes[leaf].UserData; }
+	const Aabb& GetBounds(uint32 leaf) const { return mNodes[leaf].Bounds; }
+	uint32 GetLeafCount() const { return mLeafCount; }
+	uint32 GetRebuildCount() const { return mRebuildCount; }
+	uint32 GetHeight() const;
+
+	/**
+	 * @brief Surface area heuristic cost: total area of the internal nodes over the root's
+	 */
+	float GetCost() const;
+
+	/**
+	 * @brief Visits the leaves whose box passes a test, skipping subtrees that fail it
+	 * @param test bool(const Aabb&); must pass every box that contains a passing box
+	 * @param visit bool(uint32 leaf); return false to stop the traversal
+	 */
+	template<typename Test, typename Visit>
+	void Traverse(Test&& test, Visit&& visit) const;
+
+	/**
+	 * @brief Visits the leaves whose box overlaps a box
+	 * @param visit bool(uint32 leaf); return false to stop the query
+	 */
+	template<typename Visit>
+	void QueryAabb(const Aabb& bounds, Visit&& visit) const;
+
+	/**
+	 * @brief Visits the leaves whose box a ray segment crosses
+	 * @param visit float(uint32 leaf, float entryDistance), returns the new maximum
+	 *              distance: 0 stops, a smaller value clips the ray
+	 */
+	template<typename Visit>
+	void RayCast(const float origin[3], const float direction[3], float maxDistance, Visit&& visit) const;
+
+	/**
+	 * @brief Distance along a ray at which it enters a box, or a negative value if it misses
+	 * @param inverseDirection 1 / direction per axis, may be infinite
+	 */
+	static float IntersectRay(const Aabb& bounds, const float origin[3], const float inverseDirection[3], float maxDistance);
+
+private:
+
+	struct Node
+	{
+		Aabb Bounds;
+		uint32 Parent = NullNode;   // Next free node while on the free list
+		uint32 Left = NullNode;     // NullNode for leaves
+		uint32 Right = NullNode;
+		uint32 UserData = 0;
+		bool Moved = false;         // Leaf queued for Refit()
+		bool IsLeaf() const { return Left == NullNode; }
+	};
+
+	uint32 AllocateNode();
+	void FreeNode(uint32 node);
+	void InsertLeaf(uint32 leaf);
+	void RefitAncestors(uint32 node);
+	void SetInternalBounds(uint32 node, const Aabb& bounds);
+	uint32 BuildSubtree(uint32* leaves, std::size_t count);
+
+	std::vector<Node> mNodes;
+	uint32 mRoot = NullNode;
+	uint32 mFreeList = NullNode;
+	uint32 mLeafCount = 0;
+	uint32 mRebuildCount = 0;
+	std::vector<uint32> mMovedLeaves;
+
+	float mInternalArea = 0.0f;    // Sum of the internal node areas, kept up to date
+	float mRebuildCost = 0.0f;     // GetCost() right after the last rebuild
+	float mRebuildRatio = 1.5f;
+};
+
+template<typename Test, typename Visit>
+void BoundingVolumeHierarchy::Traverse(Test&& test, Visit&& visit) const
+{
+	if (mRoot == NullNode)
+		return;
+
+	uint32 fixedStack[64];
+	std::vector<uint32> overflow;
+	std::size_t size = 0;
+	fixedStack[size++] = mRoot;
+
+	while (size > 0 || !overflow.empty())
+	{
+		uint32 index;
+		if (!overflow.empty())
+		{
+			index = overflow.back();
+			overflow.pop_back();
+		}
+		else
+		{
+			index = fixedStack[--size];
+		}
+
+		const Node& node = mNodes[index];
+		if (!test(node.Bounds))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			if (!visit(index))
+				return;
+			continue;
+		}
+
+		for (uint32 child : { node.Left, node.Right })
+		{
+			if (size < 64)
+				fixedStack[size++] = child;
+			else
+				overflow.push_back(child);
+		}
+	}
+}
+
+template<typename Visit>
+void BoundingVolumeHierarchy::QueryAabb(const Aabb& bounds, Visit&& visit) const
+{
+	Traverse([&bounds](const Aabb& box) { return Aabb::Overlaps(box, bounds); }, visit);
+}
+
+template<typename Visit>
+void BoundingVolumeHierarchy::RayCast(const float origin[3], const float direction[3], float maxDistance, Visit&& visit) const
+{
+	float inverseDirection[3];
+	for (int k = 0; k < 3; ++k)
+		inverseDirection[k] = 1.0f / direction[k];
+
+	Traverse([&](const Aabb& box) { return IntersectRay(box, origin, inverseDirection, maxDistance) >= 0.0f; },
+		[&](uint32 leaf)
+	{
+		float entry = IntersectRay(mNodes[leaf].Bounds, origin, inverseDirection, maxDistance);
+		maxDistance = visit(leaf, entry);
+		return maxDistance > 0.0f;
+	});
+}
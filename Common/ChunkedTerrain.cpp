@@ -0,0 +1,409 @@
+//***************************************************************************************
+// ChunkedTerrain.cpp
+//***************************************************************************************
+
+#include "ChunkedTerrain.h"
+#include "TerrainGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using uint32 = ChunkedTerrain::uint32;
+using int32 = ChunkedTerrain::int32;
+
+const uint32 ChunkedTerrain::FloatsPerVertex;
+
+ChunkedTerrain::ChunkedTerrain(const ChunkedTerrainDesc& desc)
+	: mDesc(desc)
+{
+	// Levels halve the grid, so the resolution must be a power of two.
+	uint32 quads = 1;
+	while (quads * 2 <= std::max(mDesc.ChunkQuads, 1u))
+		quads *= 2;
+	mDesc.ChunkQuads = quads;
+
+	uint32 maxLods = 1;
+	while ((quads >> maxLods) != 0)
+		++maxLods;
+	mDesc.LodCount = std::min(std::max(mDesc.LodCount, 1u), maxLods);
+
+	// Every chunk within one of the view radius can be resident, and a focus moving one
+	// chunk per update retires a row of them that cannot be reused for SlotReuseDelay updates.
+	uint32 side = 2 * (mDesc.ViewRadius + 1) + 1;
+	mSlotCount = side * side + mDesc.SlotReuseDelay * side;
+
+	mFreeSlots.reserve(mSlotCount);
+	for (uint32 slot = mSlotCount; slot > 0; --slot)
+		mFreeSlots.push_back(slot - 1);
+
+	BuildIndexLists();
+
+	unsigned workerCount = mDesc.WorkerCount;
+	if (workerCount == 0)
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+	mWorkers.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back(&ChunkedTerrain::WorkerMain, this);
+}
+
+ChunkedTerrain::~ChunkedTerrain()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+		mJobs.clear();
+	}
+	mWorkAvailable.notify_all();
+
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+const std::vector<uint32>& ChunkedTerrain::GetIndices(uint32 lod, uint32 stitchMask) const
+{
+	lod = std::min(lod, mDesc.LodCount - 1);
+	return mIndexLists[lod * StitchVariants + (stitchMask & (StitchVariants - 1))];
+}
+
+void ChunkedTerrain::GetChunkCenter(int32 x, int32 z, float& centerX, float& centerZ) const
+{
+	centerX = x * mDesc.ChunkSize;
+	centerZ = z * mDesc.ChunkSize;
+}
+
+void ChunkedTerrain::Update(float focusX, float focusZ)
+{
+	++mUpdateCount;
+
+	int32 focusChunkX, focusChunkZ;
+	FocusChunk(focusX, focusZ, focusChunkX, focusChunkZ);
+
+	// Chunks are requested within the view radius and kept one chunk beyond it, so a
+	// focus moving back and forth across a chunk border does not regenerate anything.
+	const int32 requestRadius = (int32)mDesc.ViewRadius;
+	const int32 keepRadius = requestRadius + 1;
+	auto within = [&](int32 x, int32 z, int32 radius)
+	{
+		return std::abs(x - focusChunkX) <= radius && std::abs(z - focusChunkZ) <= radius;
+	};
+
+	for (auto it = mResident.begin(); it != mResident.end();)
+	{
+		if (within(it->second.X, it->second.Z, keepRadius))
+		{
+			++it;
+			continue;
+		}
+
+		// Frames still in flight may draw from the slot.
+		mRetiredSlots.emplace_back(it->second.Slot, mUpdateCount + mDesc.SlotReuseDelay);
+		it = mResident.erase(it);
+	}
+
+	while (!mRetiredSlots.empty() && mRetiredSlots.front().second <= mUpdateCount)
+	{
+		mFreeSlots.push_back(mRetiredSlots.front().first);
+		mRetiredSlots.pop_front();
+	}
+
+	std::vector<Finished> finished;
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// Jobs nobody has started and that the focus has left are dropped.
+		for (auto it = mJobs.begin(); it != mJobs.end();)
+		{
+			if (within(it->X, it->Z, keepRadius))
+			{
+				++it;
+				continue;
+			}
+			mRequested.erase(Key(it->X, it->Z));
+			it = mJobs.erase(it);
+		}
+
+		for (int32 z = focusChunkZ - requestRadius; z <= focusChunkZ + requestRadius; ++z)
+		{
+			for (int32 x = focusChunkX - requestRadius; x <= focusChunkX + requestRadius; ++x)
+			{
+				std::uint64_t key = Key(x, z);
+				if (mResident.count(key) != 0 || !mRequested.insert(key).second)
+					continue;
+
+				mJobs.push_back({ x, z });
+				queued = true;
+			}
+		}
+
+		// Nearest chunks first, both for new and older jobs.
+		if (queued)
+		{
+			std::stable_sort(mJobs.begin(), mJobs.end(), [&](const Job& a, const Job& b)
+			{
+				int32 da = std::max(std::abs(a.X - focusChunkX), std::abs(a.Z - focusChunkZ));
+				int32 db = std::max(std::abs(b.X - focusChunkX), std::abs(b.Z - focusChunkZ));
+				return da < db;
+			});
+		}
+
+		finished.swap(mFinished);
+	}
+
+	if (queued)
+		mWorkAvailable.notify_all();
+
+	// Chunks that found no free slot last time go first.
+	std::vector<Finished> waiting;
+	waiting.swap(mWaitingForSlot);
+	finished.insert(finished.begin(), std::make_move_iterator(waiting.begin()), std::make_move_iterator(waiting.end()));
+
+	for (Finished& chunk : finished)
+	{
+		std::uint64_t key = Key(chunk.X, chunk.Z);
+		if (!within(chunk.X, chunk.Z, keepRadius))
+		{
+			mRequested.erase(key);
+			continue;
+		}
+
+		if (mFreeSlots.empty())
+		{
+			mWaitingForSlot.push_back(std::move(chunk));
+			continue;
+		}
+
+		uint32 slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+		mRequested.erase(key);
+		mResident[key] = { chunk.X, chunk.Z, slot };
+
+		TerrainChunkUpload upload;
+		upload.X = chunk.X;
+		upload.Z = chunk.Z;
+		upload.Slot = slot;
+		upload.Vertices = std::move(chunk.Vertices);
+		mUploads.push_back(std::move(upload));
+	}
+}
+
+std::vector<TerrainChunkUpload> ChunkedTerrain::TakeUploads()
+{
+	std::vector<TerrainChunkUpload> uploads;
+	uploads.swap(mUploads);
+	return uploads;
+}
+
+void ChunkedTerrain::BuildDrawList(float focusX, float focusZ, std::vector<TerrainChunkDraw>& draws) const
+{
+	draws.clear();
+
+	const float halfSize = 0.5f * mDesc.ChunkSize;
+	std::unordered_map<std::uint64_t, uint32> lods;
+	lods.reserve(mResident.size());
+
+	for (const auto& entry : mResident)
+	{
+		// Distance from the focus to the nearest point of the chunk, so the chunk
+		// holding the focus is always drawn at full resolution.
+		float centerX, centerZ;
+		GetChunkCenter(entry.second.X, entry.second.Z, centerX, centerZ);
+		float dx = std::max(std::fabs(focusX - centerX) - halfSize, 0.0f);
+		float dz = std::max(std::fabs(focusZ - centerZ) - halfSize, 0.0f);
+		float distance = std::sqrt(dx * dx + dz * dz);
+
+		uint32 lod = 0;
+		if (mDesc.LodDistance > 0.0f)
+			lod = (uint32)std::min(distance / mDesc.LodDistance, (float)(mDesc.LodCount - 1));
+		lods[entry.first] = lod;
+	}
+
+	const int32 neighbours[4][2] = { { -1, 0 }, { 1, 0 }, { 0, 1 }, { 0, -1 } };
+	const uint32 sides[4] = { StitchWest, StitchEast, StitchNorth, StitchSouth };
+
+	// Stitching only bridges one level, so refine chunks until no neighbour is finer
+	// by more than that.  Each pass lowers a level at most once per chunk.
+	for (uint32 pass = 0; pass < mDesc.LodCount; ++pass)
+	{
+		bool changed = false;
+		for (const auto& entry : mResident)
+		{
+			uint32& lod = lods[entry.first];
+			for (const auto& offset : neighbours)
+			{
+				auto neighbour = lods.find(Key(entry.second.X + offset[0], entry.second.Z + offset[1]));
+				if (neighbour != lods.end() && lod > neighbour->second + 1)
+				{
+					lod = neighbour->second + 1;
+					changed = true;
+				}
+			}
+		}
+		if (!changed)
+			break;
+	}
+
+	draws.reserve(mResident.size());
+	for (const auto& entry : mResident)
+	{
+		TerrainChunkDraw draw;
+		draw.X = entry.second.X;
+		draw.Z = entry.second.Z;
+		draw.Slot = entry.second.Slot;
+		draw.Lod = lods[entry.first];
+
+		for (int side = 0; side < 4; ++side)
+		{
+			auto neighbour = lods.find(Key(draw.X + neighbours[side][0], draw.Z + neighbours[side][1]));
+			if (neighbour != lods.end() && neighbour->second > draw.Lod)
+				draw.StitchMask |= sides[side];
+		}
+
+		draws.push_back(draw);
+	}
+
+	// Near chunks first so they fill the depth buffer before the far ones.
+	std::sort(draws.begin(), draws.end(), [](const TerrainChunkDraw& a, const TerrainChunkDraw& b)
+	{
+		return a.Lod != b.Lod ? a.Lod < b.Lod : a.Slot < b.Slot;
+	});
+}
+
+void ChunkedTerrain::WaitForPending()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkDone.wait(lock, [this]() { return mJobs.empty() && mBusyWorkers == 0; });
+}
+
+void ChunkedTerrain::GenerateChunk(const ChunkedTerrainDesc& desc, int32 x, int32 z, float* vertices)
+{
+	// Chunk (x, z) is the window of one infinite grid starting at grid vertex
+	// (-z * quads, x * quads), so neighbours compute identical edge vertices.
+	HillTerrainDesc hills;
+	hills.Width = desc.ChunkSize;
+	hills.Depth = desc.ChunkSize;
+	hills.Rows = desc.ChunkQuads + 1;
+	hills.Columns = desc.ChunkQuads + 1;
+	hills.Amplitude = desc.Amplitude;
+	hills.Frequency = desc.Frequency;
+	hills.ColumnOffset = x * (int32)desc.ChunkQuads;
+	hills.RowOffset = -z * (int32)desc.ChunkQuads;
+
+	TerrainVertexLayout layout;
+	layout.Positions = vertices;
+	layout.Normals = vertices + 3;
+	layout.TexCoords = vertices + 6;
+	layout.Stride = FloatsPerVertex * sizeof(float);
+
+	// The workers already run in parallel, one chunk each.
+	TerrainGenerator::GenerateHills(hills, layout, 1);
+}
+
+std::uint64_t ChunkedTerrain::Key(int32 x, int32 z)
+{
+	return ((std::uint64_t)(std::uint32_t)x << 32) | (std::uint32_t)z;
+}
+
+void ChunkedTerrain::FocusChunk(float focusX, float focusZ, int32& x, int32& z) const
+{
+	x = (int32)std::floor(focusX / mDesc.ChunkSize + 0.5f);
+	z = (int32)std::floor(focusZ / mDesc.ChunkSize + 0.5f);
+}
+
+void ChunkedTerrain::BuildIndexLists()
+{
+	const uint32 quads = mDesc.ChunkQuads;
+	const uint32 rowStride = quads + 1;
+
+	mIndexLists.resize((std::size_t)mDesc.LodCount * StitchVariants);
+	for (uint32 lod = 0; lod < mDesc.LodCount; ++lod)
+	{
+		const uint32 step = 1u << lod;
+		const uint32 cells = quads >> lod;
+
+		for (uint32 mask = 0; mask < StitchVariants; ++mask)
+		{
+			// On a stitched edge every odd vertex of this level collapses onto an even
+			// neighbour along the edge, leaving only the vertices of the coarser chunk.
+			// The triangles it degenerates are dropped.  Odd vertices move towards the
+			// corners the grid diagonals do not touch, (0, 0) and (quads, quads): if both
+			// vertices next to the other corners moved away from it, the triangle between
+			// them would fold over.
+			auto vertex = [&](uint32 i, uint32 j)
+			{
+				if (cells >= 2)
+				{
+					if ((mask & StitchNorth) && i == 0 && (j / step) % 2 == 1)
+						j -= step;
+					if ((mask & StitchSouth) && i == quads && (j / step) % 2 == 1)
+						j += step;
+					if ((mask & StitchWest) && j == 0 && (i / step) % 2 == 1)
+						i -= step;
+					if ((mask & StitchEast) && j == quads && (i / step) % 2 == 1)
+						i += step;
+				}
+				return i * rowStride + j;
+			};
+
+			std::vector<uint32>& indices = mIndexLists[(std::size_t)lod * StitchVariants + mask];
+			indices.reserve((std::size_t)cells * cells * 6);
+
+			auto triangle = [&](uint32 a, uint32 b, uint32 c)
+			{
+				if (a == b || b == c || a == c)
+					return;
+				indices.push_back(a);
+				indices.push_back(b);
+				indices.push_back(c);
+			};
+
+			// Same winding and diagonal as GeometryGenerator::CreateGrid().
+			for (uint32 row = 0; row < cells; ++row)
+			{
+				for (uint32 column = 0; column < cells; ++column)
+				{
+					uint32 i = row * step;
+					uint32 j = column * step;
+
+					uint32 topLeft = vertex(i, j);
+					uint32 topRight = vertex(i, j + step);
+					uint32 bottomLeft = vertex(i + step, j);
+					uint32 bottomRight = vertex(i + step, j + step);
+
+					triangle(topLeft, topRight, bottomLeft);
+					triangle(bottomLeft, topRight, bottomRight);
+				}
+			}
+		}
+	}
+}
+
+void ChunkedTerrain::WorkerMain()
+{
+	const std::size_t floatCount = (std::size_t)GetVerticesPerChunk() * FloatsPerVertex;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWorkAvailable.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+		if (mStopping)
+			return;
+
+		Job job = mJobs.front();
+		mJobs.pop_front();
+		++mBusyWorkers;
+		lock.unlock();
+
+		Finished chunk;
+		chunk.X = job.X;
+		chunk.Z = job.Z;
+		chunk.Vertices.resize(floatCount);
+		GenerateChunk(mDesc, job.X, job.Z, chunk.Vertices.data());
+
+		lock.lock();
+		mFinished.push_back(std::move(chunk));
+		--mBusyWorkers;
+		mWorkDone.notify_all();
+	}
+}
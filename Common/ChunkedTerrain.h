@@ -0,0 +1,198 @@
+//***************************************************************************************
+// ChunkedTerrain.h
+//
+// Streams an unbounded hills terrain (see TerrainGenerator) as square chunks around a
+// moving focus point.  Chunks within ViewRadius of the focus chunk are generated on
+// worker threads, nearest first, and handed to the caller to upload into a fixed pool
+// of vertex slots; chunks that fall more than one chunk outside the radius are retired
+// and their slot is reused a few updates later, once no frame in flight can read it.
+// Memory therefore stays bounded however far the focus travels.
+//
+// Every chunk stores its full resolution vertex grid.  Level of detail k draws every
+// 2^k-th vertex with one of 16 shared index lists per level: where a neighbour is one
+// level coarser the odd vertices of the shared edge are collapsed onto their even
+// neighbours, so both sides of the edge use the same vertices and no cracks open.
+//***************************************************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Shape, resolution and streaming range of a chunked terrain
+ */
+struct ChunkedTerrainDesc
+{
+	float ChunkSize = 4.0f;            ///< Side of a chunk in world units
+	std::uint32_t ChunkQuads = 16;     ///< Quads along a chunk side at level 0, a power of two
+	std::uint32_t LodCount = 3;        ///< Level k has ChunkQuads >> k quads along a side
+	float LodDistance = 4.0f;          ///< Level k is used from k * LodDistance away from the focus
+	std::uint32_t ViewRadius = 3;      ///< Chunks kept on each side of the focus chunk
+	std::uint32_t SlotReuseDelay = 3;  ///< Update() calls before the slot of a retired chunk is reused
+	unsigned WorkerCount = 2;          ///< Generation threads, 0 to use every hardware thread
+	float Amplitude = 0.1f;
+	float Frequency = 0.1f;
+};
+
+/**
+ * @brief A generated chunk waiting to be copied into its vertex slot
+ */
+struct TerrainChunkUpload
+{
+	std::int32_t X = 0;          ///< Chunk coordinates; chunk (0, 0) is centred on the origin
+	std::int32_t Z = 0;
+	std::uint32_t Slot = 0;      ///< Vertex slot the chunk was given
+	std::vector<float> Vertices; ///< Position, normal and texture coordinate of each vertex, row by row
+};
+
+/**
+ * @brief One resident chunk to draw this frame
+ */
+struct TerrainChunkDraw
+{
+	std::int32_t X = 0;
+	std::int32_t Z = 0;
+	std::uint32_t Slot = 0;
+	std::uint32_t Lod = 0;
+	std::uint32_t StitchMask = 0;  ///< ChunkedTerrain::StitchSide bits of the coarser neighbours
+};
+
+class ChunkedTerrain
+{
+public:
+
+	using uint32 = std::uint32_t;
+	using int32 = std::int32_t;
+
+	static const uint32 FloatsPerVertex = 8;  ///< Three position, three normal and two texture coordinate floats
+
+	/**
+	 * @brief Chunk edges that are stitched to a coarser neighbour
+	 */
+	enum StitchSide : uint32
+	{
+		StitchWest = 1,   ///< -x, first column
+		StitchEast = 2,   ///< +x, last column
+		StitchNorth = 4,  ///< +z, first row
+		StitchSouth = 8,  ///< -z, last row
+		StitchVariants = 16
+	};
+
+	/**
+	 * @brief Builds the shared index lists and starts the worker threads
+	 */
+	explicit ChunkedTerrain(const ChunkedTerrainDesc& desc);
+	ChunkedTerrain(const ChunkedTerrain& rhs) = delete;
+	ChunkedTerrain& operator=(const ChunkedTerrain& rhs) = delete;
+
+	/**
+	 * @brief Drops queued work and joins the worker threads
+	 */
+	~ChunkedTerrain();
+
+	const ChunkedTerrainDesc& GetDesc() const { return mDesc; }
+	uint32 GetSlotCount() const { return mSlotCount; }  ///< Most chunks ever resident at once
+	uint32 GetVerticesPerChunk() const { return (mDesc.ChunkQuads + 1) * (mDesc.ChunkQuads + 1); }
+	uint32 GetResidentCount() const { return (uint32)mResident.size(); }
+	uint32 GetPendingCount() const { return (uint32)mRequested.size(); }  ///< Chunks requested but not yet resident
+
+	/**
+	 * @brief Triangle list of a chunk at a level of detail, relative to the chunk's first vertex
+	 */
+	const std::vector<uint32>& GetIndices(uint32 lod, uint32 stitchMask) const;
+
+	/**
+	 * @brief Centre of a chunk on the xz plane
+	 */
+	void GetChunkCenter(int32 x, int32 z, float& centerX, float& centerZ) const;
+
+	/**
+	 * @brief Requests the chunks around the focus and retires the ones left behind
+	 *
+	 * Also moves the chunks finished by the workers into free slots; TakeUploads()
+	 * returns them.  Call once per frame from the thread that owns the terrain.
+	 */
+	void Update(float focusX, float focusZ);
+
+	/**
+	 * @brief Chunks given a slot since the last call; the caller copies their vertices
+	 */
+	std::vector<TerrainChunkUpload> TakeUploads();
+
+	/**
+	 * @brief Lists the resident chunks with their level of detail and stitching
+	 *
+	 * Each chunk takes the level of its distance to the focus, lowered where needed so
+	 * that neighbours never differ by more than one level.
+	 */
+	void BuildDrawList(float focusX, float focusZ, std::vector<TerrainChunkDraw>& draws) const;
+
+	/**
+	 * @brief Blocks until the workers have finished every queued chunk
+	 */
+	void WaitForPending();
+
+	/**
+	 * @brief Generates the vertices of one chunk on the calling thread
+	 * @param vertices Receives GetVerticesPerChunk() * FloatsPerVertex floats
+	 */
+	static void GenerateChunk(const ChunkedTerrainDesc& desc, int32 x, int32 z, float* vertices);
+
+private:
+
+	struct Resident
+	{
+		int32 X;
+		int32 Z;
+		uint32 Slot;
+	};
+
+	struct Job
+	{
+		int32 X;
+		int32 Z;
+	};
+
+	struct Finished
+	{
+		int32 X;
+		int32 Z;
+		std::vector<float> Vertices;
+	};
+
+	static std::uint64_t Key(int32 x, int32 z);
+	void FocusChunk(float focusX, float focusZ, int32& x, int32& z) const;
+	void BuildIndexLists();
+	void WorkerMain();
+
+	ChunkedTerrainDesc mDesc;
+	uint32 mSlotCount = 0;
+	std::vector<std::vector<uint32>> mIndexLists;  // LodCount * StitchVariants
+
+	// Owned by the updating thread.
+	std::unordered_map<std::uint64_t, Resident> mResident;
+	std::unordered_set<std::uint64_t> mRequested;  // Queued, being generated or waiting for a slot
+	std::vector<uint32> mFreeSlots;
+	std::deque<std::pair<uint32, std::uint64_t>> mRetiredSlots;  // Slot and the update it frees on
+	std::vector<Finished> mWaitingForSlot;
+	std::vector<TerrainChunkUpload> mUploads;
+	std::uint64_t mUpdateCount = 0;
+
+	// Shared with the workers.
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::condition_variable mWorkDone;
+	std::deque<Job> mJobs;
+	std::vector<Finished> mFinished;
+	unsigned mBusyWorkers = 0;
+	bool mStopping = false;
+	std::vector<std::thread> mWorkers;
+};
@@ -0,0 +1,73 @@
+//***************************************************************************************
+// D3D12FrameFence.cpp
+//***************************************************************************************
+
+#include "D3D12FrameFence.h"
+
+D3D12FrameFence::D3D12FrameFence(ID3D12Device* device, ID3D12CommandQueue* queue)
+	: mQueue(queue)
+{
+	ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+}
+
+D3D12FrameFence::~D3D12FrameFence()
+{
+	for (HANDLE event : mFreeEvents)
+		CloseHandle(event);
+}
+
+std::uint64_t D3D12FrameFence::Signal()
+{
+	// The values must reach the queue in the order they are handed out.
+	std::lock_guard<std::mutex> lock(mMutex);
+	ThrowIfFailed(mQueue->Signal(mFence.Get(), mLastSignaled + 1));
+	return ++mLastSignaled;
+}
+
+std::uint64_t D3D12FrameFence::GetCompletedValue() const
+{
+	return mFence->GetCompletedValue();
+}
+
+std::uint64_t D3D12FrameFence::GetLastSignaledValue() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mLastSignaled;
+}
+
+void D3D12FrameFence::Wait(std::uint64_t value)
+{
+	if (mFence->GetCompletedValue() >= value)
+		return;
+
+	HANDLE event = AcquireEvent();
+	HRESULT hr = mFence->SetEventOnCompletion(value, event);
+	if (SUCCEEDED(hr))
+		WaitForSingleObject(event, INFINITE);
+	ReleaseEvent(event);
+	ThrowIfFailed(hr);
+}
+
+HANDLE D3D12FrameFence::AcquireEvent()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!mFreeEvents.empty())
+		{
+			HANDLE event = mFreeEvents.back();
+			mFreeEvents.pop_back();
+			return event;
+		}
+	}
+
+	HANDLE event = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if (event == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	return event;
+}
+
+void D3D12FrameFence::ReleaseEvent(HANDLE event)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mFreeEvents.push_back(event);
+}
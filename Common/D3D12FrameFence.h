@@ -0,0 +1,47 @@
+//***************************************************************************************
+// D3D12FrameFence.h
+//
+// FrameFence over an ID3D12Fence signalled on one command queue.  Every signal on
+// the queue goes through Signal(), which hands out the increasing values.  Waits
+// block on Win32 events kept in a pool and reused, rather than one created and
+// destroyed per wait; the pool also lets two threads wait at once.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FrameScheduler.h"
+#include <mutex>
+#include <vector>
+
+class D3D12FrameFence : public FrameFence
+{
+public:
+	/**
+	 * @brief Creates the fence at value 0
+	 * @param device Direct3D 12 device
+	 * @param queue Queue the signals are added to
+	 */
+	D3D12FrameFence(ID3D12Device* device, ID3D12CommandQueue* queue);
+	D3D12FrameFence(const D3D12FrameFence& rhs) = delete;
+	D3D12FrameFence& operator=(const D3D12FrameFence& rhs) = delete;
+	~D3D12FrameFence();
+
+	std::uint64_t Signal() override;
+	std::uint64_t GetCompletedValue() const override;
+	std::uint64_t GetLastSignaledValue() const override;
+	void Wait(std::uint64_t value) override;
+
+	ID3D12Fence* Get() const { return mFence.Get(); }
+
+private:
+	HANDLE AcquireEvent();
+	void ReleaseEvent(HANDLE event);
+
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+	ID3D12CommandQueue* mQueue = nullptr;
+
+	mutable std::mutex mMutex;         // Guards the value counter and the event pool
+	std::uint64_t mLastSignaled = 0;
+	std::vector<HANDLE> mFreeEvents;   // Auto-reset events not being waited on
+};
@@ -0,0 +1,130 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator(uint32 persistentCapacity, uint32 transientCapacity)
+{
+	Reset(persistentCapacity, transientCapacity);
+}
+
+void DescriptorAllocator::Reset(uint32 persistentCapacity, uint32 transientCapacity)
+{
+	mPersistentCapacity = persistentCapacity;
+	mTransientCapacity = transientCapacity;
+	mPersistentUsed = 0;
+
+	mFreeRanges.clear();
+	if (persistentCapacity > 0)
+		mFreeRanges.push_back({ 0, persistentCapacity });
+
+	mRingHead = 0;
+	mRingTail = 0;
+	mFrames.clear();
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::Allocate(uint32 count)
+{
+	if (count == 0)
+		return InvalidIndex;
+
+	for (size_t i = 0; i < mFreeRanges.size(); ++i)
+	{
+		Range& range = mFreeRanges[i];
+		if (range.Count < count)
+			continue;
+
+		uint32 first = range.First;
+		range.First += count;
+		range.Count -= count;
+		if (range.Count == 0)
+			mFreeRanges.erase(mFreeRanges.begin() + i);
+
+		mPersistentUsed += count;
+		return first;
+	}
+
+	return InvalidIndex;
+}
+
+void DescriptorAllocator::Free(uint32 first, uint32 count)
+{
+	if (count == 0 || first == InvalidIndex)
+		return;
+
+	assert(first + count <= mPersistentCapacity && "Freeing a slot outside the persistent region");
+
+	auto next = std::lower_bound(mFreeRanges.begin(), mFreeRanges.end(), first,
+		[](const Range& range, uint32 value) { return range.First < value; });
+
+	assert((next == mFreeRanges.end() || first + count <= next->First) && "Double free of a descriptor range");
+	assert((next == mFreeRanges.begin() || std::prev(next)->First + std::prev(next)->Count <= first) && "Double free of a descriptor range");
+
+	mPersistentUsed -= count;
+
+	// Merge with the gap that follows and/or the one that precedes the range.
+	bool mergeNext = next != mFreeRanges.end() && first + count == next->First;
+	bool mergePrev = next != mFreeRanges.begin() && std::prev(next)->First + std::prev(next)->Count == first;
+
+	if (mergePrev && mergeNext)
+	{
+		std::prev(next)->Count += count + next->Count;
+		mFreeRanges.erase(next);
+	}
+	else if (mergePrev)
+	{
+		std::prev(next)->Count += count;
+	}
+	else if (mergeNext)
+	{
+		next->First = first;
+		next->Count += count;
+	}
+	else
+	{
+		mFreeRanges.insert(next, { first, count });
+	}
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::AllocateTransient(uint32 count)
+{
+	if (count == 0 || count > mTransientCapacity)
+		return InvalidIndex;
+
+	// Ranges must be contiguous, so a request that would straddle the end of the
+	// ring skips the remaining slots and starts over at the beginning.
+	uint64 offset = mRingHead % mTransientCapacity;
+	uint64 padding = offset + count > mTransientCapacity ? mTransientCapacity - offset : 0;
+
+	if (mRingHead + padding + count - mRingTail > mTransientCapacity)
+		return InvalidIndex;
+
+	mRingHead += padding;
+	uint32 first = mPersistentCapacity + (uint32)(mRingHead % mTransientCapacity);
+	mRingHead += count;
+	return first;
+}
+
+void DescriptorAllocator::FinishFrame(uint64 fence)
+{
+	if (!mFrames.empty() && mFrames.back().RingHead == mRingHead)
+	{
+		// Nothing was allocated this frame; just move the fence forward.
+		mFrames.back().Fence = fence;
+		return;
+	}
+
+	mFrames.push_back({ fence, mRingHead });
+}
+
+void DescriptorAllocator::ReleaseCompletedFrames(uint64 completedFence)
+{
+	while (!mFrames.empty() && mFrames.front().Fence <= completedFence)
+	{
+		mRingTail = mFrames.front().RingHead;
+		mFrames.pop_front();
+	}
+}
@@ -0,0 +1,125 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Hands out slots of a descriptor heap.  The heap is split in two regions:
+//
+//   [0, persistentCapacity)            free-list ranges for long-lived descriptors
+//                                      (textures), returned explicitly with Free().
+//   [persistentCapacity, capacity)     a ring of per-frame descriptors that are
+//                                      recycled once the GPU passes the fence value
+//                                      of the frame that used them.
+//
+// The allocator only deals in slot indices, so it has no Direct3D dependency; the
+// caller turns an index into CPU/GPU handles with the heap's increment size.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class DescriptorAllocator
+{
+public:
+
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	/// Returned when a request cannot be satisfied.
+	static const uint32 InvalidIndex = 0xFFFFFFFF;
+
+	/**
+	 * @brief Constructs an allocator for a heap of persistentCapacity + transientCapacity slots
+	 * @param persistentCapacity Slots managed by the free list
+	 * @param transientCapacity Slots managed by the per-frame ring
+	 */
+	DescriptorAllocator(uint32 persistentCapacity = 0, uint32 transientCapacity = 0);
+
+	/**
+	 * @brief Resets the allocator, forgetting every allocation
+	 */
+	void Reset(uint32 persistentCapacity, uint32 transientCapacity);
+
+	//-------------------------------------------------------------------------
+	// Persistent (free-list) region
+	//-------------------------------------------------------------------------
+
+	/**
+	 * @brief Allocates a contiguous range of persistent slots (first fit)
+	 * @param count Number of slots
+	 * @return First slot of the range, or InvalidIndex if no gap is large enough
+	 */
+	uint32 Allocate(uint32 count = 1);
+
+	/**
+	 * @brief Returns a range obtained from Allocate()
+	 *
+	 * The caller must make sure the GPU no longer reads the descriptors, since
+	 * the slots can be handed out and overwritten immediately.
+	 */
+	void Free(uint32 first, uint32 count = 1);
+
+	//-------------------------------------------------------------------------
+	// Transient (ring) region
+	//-------------------------------------------------------------------------
+
+	/**
+	 * @brief Allocates a contiguous range of slots valid for the current frame only
+	 * @param count Number of slots
+	 * @return First slot of the range (a heap index), or InvalidIndex if the ring is full
+	 */
+	uint32 AllocateTransient(uint32 count = 1);
+
+	/**
+	 * @brief Closes the current frame's transient allocations
+	 * @param fence Fence value signalled once the GPU has finished the frame
+	 */
+	void FinishFrame(uint64 fence);
+
+	/**
+	 * @brief Recycles the transient ranges of every frame the GPU has finished
+	 * @param completedFence Last fence value reached by the GPU
+	 */
+	void ReleaseCompletedFrames(uint64 completedFence);
+
+	//-------------------------------------------------------------------------
+	// Queries
+	//-------------------------------------------------------------------------
+
+	uint32 GetCapacity() const { return mPersistentCapacity + mTransientCapacity; }  ///< Total heap slots
+	uint32 GetPersistentCapacity() const { return mPersistentCapacity; }
+	uint32 GetTransientCapacity() const { return mTransientCapacity; }
+	uint32 GetPersistentUsed() const { return mPersistentUsed; }  ///< Slots currently allocated with Allocate()
+	uint32 GetTransientUsed() const { return (uint32)(mRingHead - mRingTail); }  ///< Ring slots not yet recycled
+
+private:
+	/**
+	 * @brief A gap in the persistent region
+	 */
+	struct Range
+	{
+		uint32 First;
+		uint32 Count;
+	};
+
+	/**
+	 * @brief Ring position reached by the end of a submitted frame
+	 */
+	struct FrameMark
+	{
+		uint64 Fence;
+		uint64 RingHead;
+	};
+
+	uint32 mPersistentCapacity = 0;
+	uint32 mTransientCapacity = 0;
+	uint32 mPersistentUsed = 0;
+
+	std::vector<Range> mFreeRanges;  ///< Sorted by First, never adjacent
+
+	// Monotonic ring counters; the slot is counter % mTransientCapacity.
+	uint64 mRingHead = 0;
+	uint64 mRingTail = 0;
+	std::deque<FrameMark> mFrames;
+};
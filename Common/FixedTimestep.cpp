@@ -0,0 +1,58 @@
+//***************************************************************************************
+// FixedTimestep.cpp
+//***************************************************************************************
+
+#include "FixedTimestep.h"
+#include <algorithm>
+#include <cmath>
+
+FixedTimestep::FixedTimestep(double ticksPerSecond, unsigned maxTicksPerFrame)
+	: mTickSeconds(1.0 / ticksPerSecond)
+	, mMaxTicksPerFrame(std::max(1u, maxTicksPerFrame))
+{
+	mClock.Reset();
+}
+
+void FixedTimestep::SetTickRate(double ticksPerSecond)
+{
+	// Keeps the same fraction of a tick so the interpolation does not jump.
+	double alpha = mAccumulator / mTickSeconds;
+	mTickSeconds = 1.0 / ticksPerSecond;
+	mAccumulator = alpha * mTickSeconds;
+}
+
+void FixedTimestep::SetMaxTicksPerFrame(unsigned maxTicksPerFrame)
+{
+	mMaxTicksPerFrame = std::max(1u, maxTicksPerFrame);
+}
+
+void FixedTimestep::Reset()
+{
+	mClock.Reset();
+	mAccumulator = 0.0;
+	mTickCount = 0;
+	mDroppedSeconds = 0.0;
+}
+
+unsigned FixedTimestep::Update(double frameSeconds, const std::function<void(const GameTimer&)>& tick)
+{
+	mAccumulator += std::max(frameSeconds, 0.0);
+
+	unsigned ticks = 0;
+	while (mAccumulator >= mTickSeconds && ticks < mMaxTicksPerFrame)
+	{
+		mAccumulator -= mTickSeconds;
+		mClock.Advance(mTickSeconds);
+		++mTickCount;
+		++ticks;
+		tick(mClock);
+	}
+
+	if (mAccumulator >= mTickSeconds)
+	{
+		double kept = std::fmod(mAccumulator, mTickSeconds);
+		mDroppedSeconds += mAccumulator - kept;
+		mAccumulator = kept;
+	}
+	return ticks;
+}
@@ -0,0 +1,69 @@
+//***************************************************************************************
+// FixedTimestep.h
+//
+// Runs the simulation at a fixed tick rate whatever the frame rate.  Each frame's
+// elapsed time is added to an accumulator and as many whole ticks as it holds are run,
+// each seeing the same DeltaTime, so simulation cost and behaviour do not jitter with
+// the frame rate.  The remainder is carried to the next frame; GetAlpha() says how far
+// the render time has moved past the last tick, for interpolating between the last
+// two simulated states.
+//***************************************************************************************
+
+#pragma once
+
+#include "GameTimer.h"
+#include <cstdint>
+#include <functional>
+
+class FixedTimestep
+{
+public:
+
+	/**
+	 * @param ticksPerSecond Simulation rate
+	 * @param maxTicksPerFrame Ticks run at most per frame; time owed beyond that is dropped
+	 */
+	explicit FixedTimestep(double ticksPerSecond = 60.0, unsigned maxTicksPerFrame = 4);
+
+	void SetTickRate(double ticksPerSecond);
+	void SetMaxTicksPerFrame(unsigned maxTicksPerFrame);
+
+	double GetTickSeconds() const { return mTickSeconds; }
+	unsigned GetMaxTicksPerFrame() const { return mMaxTicksPerFrame; }
+
+	/**
+	 * @brief Empties the accumulator and restarts the simulation clock at zero
+	 */
+	void Reset();
+
+	/**
+	 * @brief Runs the ticks a frame owes
+	 * @param frameSeconds Real time elapsed since the previous frame
+	 * @param tick Called once per tick with the simulation clock, whose DeltaTime() is
+	 * the tick length and TotalTime() the simulated time
+	 * @return Ticks run this frame, possibly none
+	 *
+	 * When the frame owes more than GetMaxTicksPerFrame() ticks, as after a hitch, the
+	 * surplus whole ticks are dropped so a slow simulation cannot fall ever further behind.
+	 */
+	unsigned Update(double frameSeconds, const std::function<void(const GameTimer&)>& tick);
+
+	/**
+	 * @brief Fraction of a tick the frame is ahead of the simulation, in [0, 1)
+	 */
+	float GetAlpha() const { return (float)(mAccumulator / mTickSeconds); }
+
+	const GameTimer& GetClock() const { return mClock; }
+
+	std::uint64_t GetTickCount() const { return mTickCount; }
+	double GetDroppedSeconds() const { return mDroppedSeconds; }  ///< Time discarded by the tick cap
+
+private:
+
+	GameTimer mClock;
+	double mTickSeconds;
+	unsigned mMaxTicksPerFrame;
+	double mAccumulator = 0.0;
+	std::uint64_t mTickCount = 0;
+	double mDroppedSeconds = 0.0;
+};
@@ -0,0 +1,69 @@
+//***************************************************************************************
+// FrameScheduler.cpp
+//***************************************************************************************
+
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+const unsigned FrameScheduler::MaxFramesInFlight;
+
+FrameScheduler::FrameScheduler(unsigned framesInFlight)
+{
+	unsigned count = std::min(std::max(framesInFlight, 1u), MaxFramesInFlight);
+	mSlotFences.assign(count, 0);
+	mCurrentSlot = count - 1;  // The first frame gets slot 0
+}
+
+void FrameScheduler::SetFramesInFlight(unsigned count)
+{
+	WaitForIdle();
+
+	count = std::min(std::max(count, 1u), MaxFramesInFlight);
+	mSlotFences.assign(count, 0);
+	mCurrentSlot = count - 1;
+}
+
+unsigned FrameScheduler::BeginFrame()
+{
+	mCurrentSlot = (mCurrentSlot + 1) % (unsigned)mSlotFences.size();
+
+	mLastStall = 0.0;
+	std::uint64_t retire = mSlotFences[mCurrentSlot];
+	if (retire != 0 && mFence->GetCompletedValue() < retire)
+	{
+		PROFILE_SCOPE("FrameScheduler::WaitForSlot");
+		auto start = std::chrono::steady_clock::now();
+		mFence->Wait(retire);
+		mLastStall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	mStalls.Record(mLastStall);
+
+	return mCurrentSlot;
+}
+
+std::uint64_t FrameScheduler::EndFrame()
+{
+	mSlotFences[mCurrentSlot] = mFence->Signal();
+	return mSlotFences[mCurrentSlot];
+}
+
+void FrameScheduler::WaitForIdle()
+{
+	if (mFence == nullptr)
+		return;
+
+	std::uint64_t last = mFence->GetLastSignaledValue();
+	if (mFence->GetCompletedValue() < last)
+	{
+		PROFILE_SCOPE("FrameScheduler::WaitForIdle");
+		mFence->Wait(last);
+	}
+}
+
+void FrameScheduler::ResetStatistics()
+{
+	mStalls.Reset();
+	mLastStall = 0.0;
+}
@@ -0,0 +1,99 @@
+//***************************************************************************************
+// FrameScheduler.h
+//
+// Paces the CPU against the GPU.  Each frame in flight owns a slot of the frame
+// resource ring; the scheduler remembers the fence value that retires each slot,
+// and BeginFrame() only blocks when the GPU still holds the slot the CPU wants next.
+// More frames in flight hide GPU stalls at the cost of latency; the count can be
+// changed while running.  The time spent blocked is recorded for every frame.
+//
+// The scheduler only sees fence values through FrameFence, so the same pacing runs
+// against a Direct3D 12 fence in the game and a simulated GPU headless.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrameStatistics.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Fence of a GPU queue, whose values increase with every signal
+ */
+class FrameFence
+{
+public:
+
+	virtual ~FrameFence() = default;
+
+	/**
+	 * @brief Queues a signal behind the work submitted so far
+	 * @return The value the fence reaches once that work has completed
+	 */
+	virtual std::uint64_t Signal() = 0;
+
+	virtual std::uint64_t GetCompletedValue() const = 0;
+	virtual std::uint64_t GetLastSignaledValue() const = 0;
+
+	/**
+	 * @brief Blocks the calling thread until the fence reaches a value
+	 */
+	virtual void Wait(std::uint64_t value) = 0;
+};
+
+class FrameScheduler
+{
+public:
+
+	static const unsigned MaxFramesInFlight = 4;
+
+	/**
+	 * @param framesInFlight Frame resources in the ring, 1 to MaxFramesInFlight
+	 */
+	explicit FrameScheduler(unsigned framesInFlight = 3);
+
+	/**
+	 * @brief Sets the fence the frames are signalled on; must be set before the first frame
+	 */
+	void SetFence(FrameFence* fence) { mFence = fence; }
+
+	/**
+	 * @brief Changes the number of frame resources in the ring
+	 *
+	 * Waits for every frame in flight, since the caller rebuilds the resources.
+	 * @param count Clamped to 1 to MaxFramesInFlight
+	 */
+	void SetFramesInFlight(unsigned count);
+	unsigned GetFramesInFlight() const { return (unsigned)mSlotFences.size(); }
+
+	/**
+	 * @brief Moves to the next slot, waiting for the GPU to retire it if needed
+	 * @return The slot the frame is recorded into
+	 */
+	unsigned BeginFrame();
+
+	/**
+	 * @brief Signals the end of the frame's commands
+	 * @return The fence value that retires the frame's slot
+	 */
+	std::uint64_t EndFrame();
+
+	/**
+	 * @brief Waits for the GPU to reach the last value signalled on the fence
+	 */
+	void WaitForIdle();
+
+	unsigned GetCurrentSlot() const { return mCurrentSlot; }
+
+	double GetLastStallMilliseconds() const { return mLastStall; }  ///< Wait in the last BeginFrame()
+	const LatencyHistogram& GetStallHistogram() const { return mStalls; }  ///< Wait of every BeginFrame()
+	void ResetStatistics();
+
+private:
+
+	FrameFence* mFence = nullptr;
+	std::vector<std::uint64_t> mSlotFences;  // Value that retires each slot, 0 if never used
+	unsigned mCurrentSlot = 0;
+	double mLastStall = 0.0;
+	LatencyHistogram mStalls;
+};
@@ -0,0 +1,204 @@
+//***************************************************************************************
+// FrameStatistics.cpp
+//***************************************************************************************
+
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+const int LatencyHistogram::SubBucketBits;
+const std::uint32_t LatencyHistogram::SubBucketCount;
+const int LatencyHistogram::BucketCount;
+const std::size_t FrameStatistics::HistoryCapacity;
+
+namespace
+{
+	int HighestBit(std::uint64_t value)
+	{
+		int bit = 0;
+		while (value >>= 1)
+			++bit;
+		return bit;
+	}
+}
+
+LatencyHistogram::LatencyHistogram()
+	: mCounts(SubBucketCount + BucketCount * (SubBucketCount / 2), 0)
+{
+}
+
+/**
+ * @brief Values below SubBucketCount get a counter each; above that, every power of
+ * two is split into SubBucketCount / 2 equal steps.
+ */
+std::size_t LatencyHistogram::BucketIndex(std::uint64_t microseconds)
+{
+	if (microseconds < SubBucketCount)
+		return (std::size_t)microseconds;
+
+	const std::size_t half = SubBucketCount / 2;
+	int shift = HighestBit(microseconds) - SubBucketBits + 1;
+	if (shift > BucketCount)
+		return SubBucketCount + BucketCount * half - 1;
+	std::size_t subBucket = (std::size_t)(microseconds >> shift);  // In [half, SubBucketCount)
+	return (std::size_t)shift * half + subBucket;
+}
+
+std::uint64_t LatencyHistogram::BucketUpperBound(std::size_t index)
+{
+	if (index < SubBucketCount)
+		return index;
+
+	const std::size_t half = SubBucketCount / 2;
+	std::size_t shift = index / half - 1;
+	std::uint64_t subBucket = index - shift * half;
+	return ((subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(double milliseconds)
+{
+	std::uint64_t microseconds = milliseconds > 0.0 ? (std::uint64_t)std::llround(milliseconds * 1000.0) : 0;
+
+	++mCounts[BucketIndex(microseconds)];
+	mMinMicroseconds = mCount == 0 ? microseconds : std::min(mMinMicroseconds, microseconds);
+	mMaxMicroseconds = std::max(mMaxMicroseconds, microseconds);
+	mTotal += std::max(milliseconds, 0.0);
+	++mCount;
+}
+
+void LatencyHistogram::Reset()
+{
+	std::fill(mCounts.begin(), mCounts.end(), 0);
+	mCount = 0;
+	mMinMicroseconds = 0;
+	mMaxMicroseconds = 0;
+	mTotal = 0.0;
+}
+
+double LatencyHistogram::GetMean() const
+{
+	return mCount > 0 ? mTotal / mCount : 0.0;
+}
+
+double LatencyHistogram::GetMin() const
+{
+	return mMinMicroseconds / 1000.0;
+}
+
+double LatencyHistogram::GetMax() const
+{
+	return mMaxMicroseconds / 1000.0;
+}
+
+double LatencyHistogram::GetPercentile(double percentile) const
+{
+	if (mCount == 0)
+		return 0.0;
+
+	double clamped = std::min(std::max(percentile, 0.0), 100.0);
+	std::uint64_t rank = std::max<std::uint64_t>(1, (std::uint64_t)std::ceil(clamped / 100.0 * mCount));
+
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < mCounts.size(); ++i)
+	{
+		seen += mCounts[i];
+		if (seen >= rank)
+			return std::min(BucketUpperBound(i), mMaxMicroseconds) / 1000.0;
+	}
+	return GetMax();
+}
+
+void FrameStatistics::AddFrame(const FrameSample& sample)
+{
+	mHistograms[Frame].Record(sample.Frame);
+	mHistograms[Update].Record(sample.Update);
+	mHistograms[Draw].Record(sample.Draw);
+	mHistograms[FenceWait].Record(sample.FenceWait);
+
+	if (sample.Frame > mStutterThreshold)
+		++mStutters;
+
+	if (mHistory.size() < HistoryCapacity)
+		mHistory.push_back(sample);
+	else
+		mHistory[mHistoryHead % HistoryCapacity] = sample;
+	++mHistoryHead;
+}
+
+void FrameStatistics::Reset()
+{
+	for (LatencyHistogram& histogram : mHistograms)
+		histogram.Reset();
+	mHistory.clear();
+	mHistoryHead = 0;
+	mStutters = 0;
+}
+
+PhaseSummary FrameStatistics::Summarize(Phase phase) const
+{
+	const LatencyHistogram& histogram = mHistograms[phase];
+
+	PhaseSummary summary;
+	summary.P50 = histogram.GetPercentile(50.0);
+	summary.P90 = histogram.GetPercentile(90.0);
+	summary.P99 = histogram.GetPercentile(99.0);
+	summary.Max = histogram.GetMax();
+	summary.Mean = histogram.GetMean();
+	return summary;
+}
+
+const char* FrameStatistics::GetPhaseName(Phase phase)
+{
+	switch (phase)
+	{
+	case Frame:     return "frame";
+	case Update:    return "update";
+	case Draw:      return "draw";
+	case FenceWait: return "fence wait";
+	default:        return "";
+	}
+}
+
+void FrameStatistics::WriteCsv(std::ostream& out) const
+{
+	out << "frame,frame_ms,update_ms,draw_ms,fence_wait_ms,stutter\n";
+
+	// Once the ring has wrapped, the oldest frame is the next one to be overwritten.
+	std::uint64_t first = mHistoryHead - mHistory.size();
+	char row[160];
+	for (std::uint64_t frame = first; frame < mHistoryHead; ++frame)
+	{
+		const FrameSample& sample = mHistory[frame % HistoryCapacity];
+		std::snprintf(row, sizeof(row), "%llu,%.4f,%.4f,%.4f,%.4f,%d\n",
+			(unsigned long long)frame, sample.Frame, sample.Update, sample.Draw, sample.FenceWait,
+			sample.Frame > mStutterThreshold ? 1 : 0);
+		out << row;
+	}
+}
+
+bool FrameStatistics::SaveCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	WriteCsv(file);
+	return (bool)file;
+}
+
+void FrameStatistics::WriteSummary(std::ostream& out) const
+{
+	char line[200];
+	for (int phase = 0; phase < PhaseCount; ++phase)
+	{
+		PhaseSummary summary = Summarize((Phase)phase);
+		std::snprintf(line, sizeof(line),
+			"  %-12s p50 %8.3f ms   p90 %8.3f ms   p99 %8.3f ms   max %8.3f ms   mean %8.3f ms\n",
+			GetPhaseName((Phase)phase), summary.P50, summary.P90, summary.P99, summary.Max, summary.Mean);
+		out << line;
+	}
+	std::snprintf(line, sizeof(line), "  %llu of %llu frames over %.2f ms\n",
+		(unsigned long long)mStutters, (unsigned long long)GetFrameCount(), mStutterThreshold);
+	out << line;
+}
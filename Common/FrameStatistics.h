@@ -0,0 +1,145 @@
+//***************************************************************************************
+// FrameStatistics.h
+//
+// Per-frame timings kept as latency histograms.  A mean over a second hides the odd
+// long frame, so every frame's total, update, draw-record and fence-wait times are
+// recorded and reported as percentiles.  The histograms bucket on a log scale with
+// linear sub-buckets, like HdrHistogram: any value from a microsecond to hours is
+// kept to within about 3% using under 8 KB of counters per phase.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Counts of durations, bucketed to a fixed relative precision
+ */
+class LatencyHistogram
+{
+public:
+
+	static const int SubBucketBits = 6;                              ///< Values below 2^6 us are exact
+	static const std::uint32_t SubBucketCount = 1u << SubBucketBits;
+	static const int BucketCount = 28;                               ///< Powers of two above that, up to about 2.4 hours
+
+	LatencyHistogram();
+
+	/**
+	 * @brief Counts one duration
+	 * @param milliseconds Negative durations are counted as zero
+	 */
+	void Record(double milliseconds);
+
+	void Reset();
+
+	std::uint64_t GetCount() const { return mCount; }
+	double GetMean() const;
+	double GetMin() const;
+	double GetMax() const;
+
+	/**
+	 * @brief Smallest duration that percentile of the samples do not exceed
+	 * @param percentile 0 to 100
+	 * @return Upper end of the bucket holding the sample, in milliseconds, or 0 when empty
+	 */
+	double GetPercentile(double percentile) const;
+
+private:
+
+	static std::size_t BucketIndex(std::uint64_t microseconds);
+	static std::uint64_t BucketUpperBound(std::size_t index);
+
+	std::vector<std::uint64_t> mCounts;
+	std::uint64_t mCount = 0;
+	std::uint64_t mMinMicroseconds = 0;
+	std::uint64_t mMaxMicroseconds = 0;
+	double mTotal = 0.0;                 // Milliseconds, exact, for the mean
+};
+
+/**
+ * @brief Timings of one frame, in milliseconds
+ */
+struct FrameSample
+{
+	double Frame = 0.0;      ///< Time since the previous frame started
+	double Update = 0.0;     ///< CPU time in Update(), not counting the fence wait
+	double Draw = 0.0;       ///< CPU time recording and submitting commands, or handing them to a render thread
+	double FenceWait = 0.0;  ///< Time blocked waiting for the GPU, directly or through a render thread, to free a frame resource
+};
+
+/**
+ * @brief Percentiles of one phase
+ */
+struct PhaseSummary
+{
+	double P50 = 0.0;
+	double P90 = 0.0;
+	double P99 = 0.0;
+	double Max = 0.0;
+	double Mean = 0.0;
+};
+
+class FrameStatistics
+{
+public:
+
+	enum Phase
+	{
+		Frame,
+		Update,
+		Draw,
+		FenceWait,
+		PhaseCount
+	};
+
+	static const std::size_t HistoryCapacity = 1 << 16;  ///< Most recent frames kept for CSV
+
+	/**
+	 * @brief Frames longer than the threshold count as stutters
+	 */
+	void SetStutterThreshold(double milliseconds) { mStutterThreshold = milliseconds; }
+	double GetStutterThreshold() const { return mStutterThreshold; }
+
+	void AddFrame(const FrameSample& sample);
+
+	/**
+	 * @brief Forgets every frame recorded so far
+	 */
+	void Reset();
+
+	std::uint64_t GetFrameCount() const { return mHistograms[Frame].GetCount(); }
+	std::uint64_t GetStutterCount() const { return mStutters; }
+	const LatencyHistogram& GetHistogram(Phase phase) const { return mHistograms[phase]; }
+	PhaseSummary Summarize(Phase phase) const;
+
+	static const char* GetPhaseName(Phase phase);
+
+	/**
+	 * @brief Writes the kept frames, oldest first, one CSV row each
+	 */
+	void WriteCsv(std::ostream& out) const;
+
+	/**
+	 * @brief Writes the kept frames to a file
+	 * @return False if the file could not be written
+	 */
+	bool SaveCsv(const std::string& path) const;
+
+	/**
+	 * @brief Writes the percentiles of every phase and the stutter count as text lines
+	 */
+	void WriteSummary(std::ostream& out) const;
+
+private:
+
+	LatencyHistogram mHistograms[PhaseCount];
+	std::vector<FrameSample> mHistory;     // Ring of the most recent HistoryCapacity frames
+	std::uint64_t mHistoryHead = 0;        // Frames ever added to the ring
+	std::uint64_t mStutters = 0;
+	double mStutterThreshold = 1000.0 / 30.0;
+};
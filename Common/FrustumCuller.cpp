@@ -0,0 +1,180 @@
+//***************************************************************************************
+// FrustumCuller.cpp
+//***************************************************************************************
+
+#include "FrustumCuller.h"
+#include <cmath>
+
+#if defined(__AVX__)
+#define FRUSTUM_CULLER_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE 1
+#include <emmintrin.h>
+#endif
+
+const std::size_t BoundsBatch::Alignment;
+
+void BoundsBatch::Resize(std::size_t count)
+{
+	std::size_t capacity = (count + Alignment - 1) / Alignment * Alignment;
+	if (capacity != mCapacity)
+	{
+		// Padding boxes are zero sized at the origin; their results are never read.
+		mData.assign(capacity * 6, 0.0f);
+		mCapacity = capacity;
+	}
+	mCount = count;
+}
+
+void BoundsBatch::Set(std::size_t index, const float center[3], const float extents[3])
+{
+	float* data = mData.data();
+	for (int k = 0; k < 3; ++k)
+	{
+		data[k * mCapacity + index] = center[k];
+		data[(3 + k) * mCapacity + index] = extents[k];
+	}
+}
+
+void FrustumCuller::ExtractPlanes(const float viewProjection[16], FrustumPlanes& planes)
+{
+	// Column j of the matrix gives clip coordinate j of a point: x, y, z, w.
+	auto column = [&](int j, float sign, float* plane)
+	{
+		for (int i = 0; i < 4; ++i)
+			plane[i] += sign * viewProjection[i * 4 + j];
+	};
+
+	for (auto& plane : planes.Planes)
+		column(3, 1.0f, plane);
+
+	column(0, 1.0f, planes.Planes[FrustumPlanes::Left]);     // -w <= x
+	column(0, -1.0f, planes.Planes[FrustumPlanes::Right]);   //  x <= w
+	column(1, 1.0f, planes.Planes[FrustumPlanes::Bottom]);   // -w <= y
+	column(1, -1.0f, planes.Planes[FrustumPlanes::Top]);     //  y <= w
+	column(2, -1.0f, planes.Planes[FrustumPlanes::Far]);     //  z <= w
+
+	// 0 <= z: the near plane is column 2 alone.
+	for (int i = 0; i < 4; ++i)
+		planes.Planes[FrustumPlanes::Near][i] = viewProjection[i * 4 + 2];
+
+	for (auto& plane : planes.Planes)
+	{
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; ++i)
+				plane[i] /= length;
+		}
+	}
+}
+
+int FrustumCuller::GetSimdWidth()
+{
+#if FRUSTUM_CULLER_AVX
+	return 8;
+#elif FRUSTUM_CULLER_SSE
+	return 4;
+#else
+	return 1;
+#endif
+}
+
+bool FrustumCuller::TestBox(const FrustumPlanes& planes, const float center[3], const float extents[3])
+{
+	for (const auto& plane : planes.Planes)
+	{
+		// Distance of the centre against the projected radius of the box.
+		float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		float radius = std::fabs(plane[0]) * extents[0] + std::fabs(plane[1]) * extents[1] + std::fabs(plane[2]) * extents[2];
+		if (distance + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+std::size_t FrustumCuller::CullBoxesScalar(const FrustumPlanes& planes, const BoundsBatch& boxes, std::uint8_t* visible)
+{
+	std::size_t visibleCount = 0;
+	for (std::size_t i = 0; i < boxes.Size(); ++i)
+	{
+		const float center[3] = { boxes.CenterX()[i], boxes.CenterY()[i], boxes.CenterZ()[i] };
+		const float extents[3] = { boxes.ExtentX()[i], boxes.ExtentY()[i], boxes.ExtentZ()[i] };
+		visible[i] = TestBox(planes, center, extents) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+std::size_t FrustumCuller::CullBoxes(const FrustumPlanes& planes, const BoundsBatch& boxes, std::uint8_t* visible)
+{
+#if FRUSTUM_CULLER_AVX
+	const int width = 8;
+	using Vector = __m256;
+	auto broadcast = [](float value) { return _mm256_set1_ps(value); };
+	auto load = [](const float* p) { return _mm256_loadu_ps(p); };
+	auto add = [](Vector a, Vector b) { return _mm256_add_ps(a, b); };
+	auto mul = [](Vector a, Vector b) { return _mm256_mul_ps(a, b); };
+	auto outside = [](Vector a, Vector zero) { return _mm256_cmp_ps(a, zero, _CMP_LT_OQ); };
+	auto bitOr = [](Vector a, Vector b) { return _mm256_or_ps(a, b); };
+	auto mask = [](Vector a) { return _mm256_movemask_ps(a); };
+	const Vector zero = _mm256_setzero_ps();
+#elif FRUSTUM_CULLER_SSE
+	const int width = 4;
+	using Vector = __m128;
+	auto broadcast = [](float value) { return _mm_set1_ps(value); };
+	auto load = [](const float* p) { return _mm_loadu_ps(p); };
+	auto add = [](Vector a, Vector b) { return _mm_add_ps(a, b); };
+	auto mul = [](Vector a, Vector b) { return _mm_mul_ps(a, b); };
+	auto outside = [](Vector a, Vector zero) { return _mm_cmplt_ps(a, zero); };
+	auto bitOr = [](Vector a, Vector b) { return _mm_or_ps(a, b); };
+	auto mask = [](Vector a) { return _mm_movemask_ps(a); };
+	const Vector zero = _mm_setzero_ps();
+#endif
+
+#if FRUSTUM_CULLER_AVX || FRUSTUM_CULLER_SSE
+	Vector planeVectors[FrustumPlanes::Count][4];
+	Vector absNormals[FrustumPlanes::Count][3];
+	for (int p = 0; p < FrustumPlanes::Count; ++p)
+	{
+		for (int i = 0; i < 4; ++i)
+			planeVectors[p][i] = broadcast(planes.Planes[p][i]);
+		for (int i = 0; i < 3; ++i)
+			absNormals[p][i] = broadcast(std::fabs(planes.Planes[p][i]));
+	}
+
+	// The arrays are padded to a multiple of eight, so whole vectors can always be read.
+	std::size_t visibleCount = 0;
+	for (std::size_t first = 0; first < boxes.Size(); first += width)
+	{
+		Vector cx = load(boxes.CenterX() + first);
+		Vector cy = load(boxes.CenterY() + first);
+		Vector cz = load(boxes.CenterZ() + first);
+		Vector ex = load(boxes.ExtentX() + first);
+		Vector ey = load(boxes.ExtentY() + first);
+		Vector ez = load(boxes.ExtentZ() + first);
+
+		Vector culled = zero;
+		for (int p = 0; p < FrustumPlanes::Count; ++p)
+		{
+			// Same operation order as TestBox() so every path rounds alike.
+			Vector distance = add(add(add(mul(planeVectors[p][0], cx), mul(planeVectors[p][1], cy)),
+				mul(planeVectors[p][2], cz)), planeVectors[p][3]);
+			Vector radius = add(add(mul(absNormals[p][0], ex), mul(absNormals[p][1], ey)), mul(absNormals[p][2], ez));
+			culled = bitOr(culled, outside(add(distance, radius), zero));
+		}
+
+		int bits = mask(culled);
+		std::size_t count = boxes.Size() - first < (std::size_t)width ? boxes.Size() - first : (std::size_t)width;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			visible[first + i] = (bits >> i) & 1 ? 0 : 1;
+			visibleCount += visible[first + i];
+		}
+	}
+	return visibleCount;
+#else
+	return CullBoxesScalar(planes, boxes, visible);
+#endif
+}
@@ -0,0 +1,99 @@
+//***************************************************************************************
+// FrustumCuller.h
+//
+// Tests batches of axis-aligned boxes against the six planes of a view frustum.
+//
+// The planes are extracted from a view-projection matrix (Gribb & Hartmann) in the
+// DirectXMath convention: row vectors, clip space depth in [0, w].  Boxes are kept
+// as centre / extents in structure-of-arrays form, so each plane is tested against
+// eight boxes per instruction with AVX, four with SSE2, or one at a time otherwise;
+// every path gives the same answer.  A box is culled only when it lies entirely on
+// the outer side of one plane, so large boxes crossing a frustum corner may be kept.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Inward facing planes a*x + b*y + c*z + d >= 0, with unit (a, b, c)
+ */
+struct FrustumPlanes
+{
+	enum Side { Left, Right, Bottom, Top, Near, Far, Count };
+
+	float Planes[Count][4] = {};
+};
+
+/**
+ * @brief Boxes kept and culled by one or more culling passes
+ */
+struct CullingStats
+{
+	std::size_t Visible = 0;
+	std::size_t Culled = 0;     ///< Outside the frustum
+	std::size_t Occluded = 0;   ///< Inside the frustum but hidden, see OcclusionCuller
+};
+
+/**
+ * @brief Boxes in structure-of-arrays form, padded to a multiple of eight
+ */
+class BoundsBatch
+{
+public:
+
+	static const std::size_t Alignment = 8;
+
+	void Resize(std::size_t count);
+	void Set(std::size_t index, const float center[3], const float extents[3]);
+	std::size_t Size() const { return mCount; }
+
+	const float* CenterX() const { return mData.data(); }
+	const float* CenterY() const { return CenterX() + mCapacity; }
+	const float* CenterZ() const { return CenterY() + mCapacity; }
+	const float* ExtentX() const { return CenterZ() + mCapacity; }
+	const float* ExtentY() const { return ExtentX() + mCapacity; }
+	const float* ExtentZ() const { return ExtentY() + mCapacity; }
+
+private:
+
+	std::size_t mCount = 0;
+	std::size_t mCapacity = 0;  // Per array, a multiple of Alignment
+	std::vector<float> mData;   // Six arrays of mCapacity floats
+};
+
+class FrustumCuller
+{
+public:
+
+	/**
+	 * @brief Extracts the planes of a frustum
+	 * @param viewProjection 4x4 row-major matrix mapping world points (row vectors) to clip space
+	 */
+	static void ExtractPlanes(const float viewProjection[16], FrustumPlanes& planes);
+
+	/**
+	 * @brief Boxes tested per instruction by CullBoxes(): 8, 4 or 1
+	 */
+	static int GetSimdWidth();
+
+	/**
+	 * @brief Tests one box
+	 * @return False if the box is entirely outside one plane
+	 */
+	static bool TestBox(const FrustumPlanes& planes, const float center[3], const float extents[3]);
+
+	/**
+	 * @brief Tests every box of a batch
+	 * @param visible Receives 1 for each box that may be visible and 0 for each culled one
+	 * @return Number of boxes that may be visible
+	 */
+	static std::size_t CullBoxes(const FrustumPlanes& planes, const BoundsBatch& boxes, std::uint8_t* visible);
+
+	/**
+	 * @brief CullBoxes() one box at a time, the reference for the SIMD paths
+	 */
+	static std::size_t CullBoxesScalar(const FrustumPlanes& planes, const BoundsBatch& boxes, std::uint8_t* visible);
+};
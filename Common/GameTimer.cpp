@@ -2,16 +2,46 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+namespace
+{
+	// Reads the monotonic high resolution counter: QueryPerformanceCounter on
+	// Windows, steady_clock elsewhere.
+	std::int64_t ReadCounter()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER count;
+		QueryPerformanceCounter(&count);
+		return count.QuadPart;
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	std::int64_t CountsPerSecond()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return frequency.QuadPart;
+#else
+		return std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+#endif
+	}
+}
+
 GameTimer::GameTimer()
 : mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
   mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
+	mSecondsPerCount = 1.0 / (double)CountsPerSecond();
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -55,19 +85,22 @@ float GameTimer::DeltaTime()const
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = ReadCounter();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
+	mCurrTime = currTime;
+	mPausedTime = 0;
 	mStopTime = 0;
 	mStopped  = false;
+
+	// No frame has elapsed yet; an update run before the first Tick() sees no time pass.
+	mDeltaTime = 0.0;
 }
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = ReadCounter();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -90,8 +123,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		std::int64_t currTime = ReadCounter();
 
 		mStopTime = currTime;
 		mStopped  = true;
@@ -106,8 +138,7 @@ void GameTimer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = ReadCounter();
 	mCurrTime = currTime;
 
 	// Time difference between this frame and the previous.
@@ -125,8 +156,16 @@ void GameTimer::Tick()
 	}
 }
 
+void GameTimer::Advance(double seconds)
+{
+	if( mStopped )
+	{
+		mDeltaTime = 0.0;
+		return;
+	}
 
-
-
-
-
+	// Keep the counters consistent so TotalTime() adds up the steps.
+	mCurrTime = mPrevTime + (std::int64_t)(seconds / mSecondsPerCount);
+	mDeltaTime = seconds;
+	mPrevTime = mCurrTime;
+}
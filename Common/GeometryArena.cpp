@@ -0,0 +1,81 @@
+//***************************************************************************************
+// GeometryArena.cpp
+//***************************************************************************************
+
+#include "GeometryArena.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	ComPtr<ID3D12Resource> CreateArenaBuffer(ID3D12Device* device, UINT64 byteSize)
+	{
+		ComPtr<ID3D12Resource> buffer;
+		auto properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		auto desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&properties,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&buffer)));
+		return buffer;
+	}
+}
+
+GeometryArena::GeometryArena(ID3D12Device* device, UINT vertexByteStride, UINT vertexCapacity,
+	UINT index16Capacity, UINT index32Capacity)
+	: mVertexByteStride(vertexByteStride)
+	, mVertexCapacity(vertexCapacity)
+{
+	mVertexBuffer = CreateArenaBuffer(device, (UINT64)vertexByteStride * vertexCapacity);
+
+	mIndices16.Format = DXGI_FORMAT_R16_UINT;
+	mIndices16.ByteSize = 2;
+	mIndices16.Capacity = index16Capacity;
+	mIndices16.Buffer = CreateArenaBuffer(device, 2ull * index16Capacity);
+
+	mIndices32.Format = DXGI_FORMAT_R32_UINT;
+	mIndices32.ByteSize = 4;
+	mIndices32.Capacity = index32Capacity;
+	mIndices32.Buffer = CreateArenaBuffer(device, 4ull * index32Capacity);
+}
+
+bool GeometryArena::Allocate(UINT vertexCount, UINT indexCount, DXGI_FORMAT indexFormat, SubmeshGeometry& submesh)
+{
+	IndexPool& pool = GetIndexPool(indexFormat);
+	if (vertexCount > mVertexCapacity - mVertexCount || indexCount > pool.Capacity - pool.Count)
+		return false;
+
+	submesh.IndexCount = indexCount;
+	submesh.StartIndexLocation = pool.Count;
+	submesh.BaseVertexLocation = (INT)mVertexCount;
+	submesh.IndexFormat = pool.Format;
+
+	mVertexCount += vertexCount;
+	pool.Count += indexCount;
+	return true;
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryArena::VertexBufferView() const
+{
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
+	vbv.StrideInBytes = mVertexByteStride;
+	vbv.SizeInBytes = mVertexByteStride * mVertexCapacity;
+
+	return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryArena::IndexBufferView(DXGI_FORMAT indexFormat) const
+{
+	const IndexPool& pool = GetIndexPool(indexFormat);
+
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = pool.Buffer->GetGPUVirtualAddress();
+	ibv.Format = pool.Format;
+	ibv.SizeInBytes = pool.ByteSize * pool.Capacity;
+
+	return ibv;
+}
@@ -0,0 +1,87 @@
+//***************************************************************************************
+// GeometryArena.h
+//
+// One vertex buffer and two index buffers (16 and 32-bit) shared by every mesh.
+// Meshes are appended; each gets a SubmeshGeometry whose BaseVertexLocation and
+// StartIndexLocation point at its slice, so all of them draw with the same vertex
+// buffer view and the index buffer view of their IndexFormat.
+//
+// The arena only reserves space.  The caller stages the data into the returned
+// offsets and transitions the buffers back to GENERIC_READ after copying.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class GeometryArena
+{
+public:
+	/**
+	 * @brief Creates the shared buffers in the COMMON state
+	 * @param device Direct3D 12 device
+	 * @param vertexByteStride Size of one vertex, the same for every mesh
+	 * @param vertexCapacity Vertices the arena can hold
+	 * @param index16Capacity 16-bit indices the arena can hold
+	 * @param index32Capacity 32-bit indices the arena can hold
+	 */
+	GeometryArena(ID3D12Device* device, UINT vertexByteStride, UINT vertexCapacity,
+		UINT index16Capacity, UINT index32Capacity);
+	GeometryArena(const GeometryArena& rhs) = delete;
+	GeometryArena& operator=(const GeometryArena& rhs) = delete;
+
+	/**
+	 * @brief Reserves room for a mesh
+	 * @param vertexCount Vertices in the mesh
+	 * @param indexCount Indices in the mesh, relative to its first vertex
+	 * @param indexFormat DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+	 * @param[out] submesh Draw arguments of the mesh inside the arena
+	 * @return False if the arena is full
+	 */
+	bool Allocate(UINT vertexCount, UINT indexCount, DXGI_FORMAT indexFormat, SubmeshGeometry& submesh);
+
+	/**
+	 * @brief Narrowest index format that can address a mesh's vertices
+	 */
+	static DXGI_FORMAT ChooseIndexFormat(UINT vertexCount)
+	{
+		return vertexCount <= 0x10000 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	}
+
+	UINT64 GetVertexByteOffset(const SubmeshGeometry& submesh) const { return (UINT64)submesh.BaseVertexLocation * mVertexByteStride; }
+	UINT64 GetIndexByteOffset(const SubmeshGeometry& submesh) const { return (UINT64)submesh.StartIndexLocation * GetIndexPool(submesh.IndexFormat).ByteSize; }
+
+	ID3D12Resource* GetVertexBuffer() const { return mVertexBuffer.Get(); }
+	ID3D12Resource* GetIndexBuffer(DXGI_FORMAT indexFormat) const { return GetIndexPool(indexFormat).Buffer.Get(); }
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const;  ///< View of the whole vertex buffer
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView(DXGI_FORMAT indexFormat) const;  ///< View of a whole index buffer
+
+	UINT GetVertexByteStride() const { return mVertexByteStride; }
+	UINT GetVertexCount() const { return mVertexCount; }  ///< Vertices allocated so far
+	UINT GetIndexCount(DXGI_FORMAT indexFormat) const { return GetIndexPool(indexFormat).Count; }  ///< Indices allocated so far
+	UINT GetVertexCapacity() const { return mVertexCapacity; }
+	UINT GetIndexCapacity(DXGI_FORMAT indexFormat) const { return GetIndexPool(indexFormat).Capacity; }
+
+private:
+	struct IndexPool
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+		DXGI_FORMAT Format = DXGI_FORMAT_R16_UINT;
+		UINT ByteSize = 0;
+		UINT Capacity = 0;
+		UINT Count = 0;
+	};
+
+	const IndexPool& GetIndexPool(DXGI_FORMAT indexFormat) const { return indexFormat == DXGI_FORMAT_R32_UINT ? mIndices32 : mIndices16; }
+	IndexPool& GetIndexPool(DXGI_FORMAT indexFormat) { return indexFormat == DXGI_FORMAT_R32_UINT ? mIndices32 : mIndices16; }
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mVertexBuffer;
+
+	UINT mVertexByteStride = 0;
+	UINT mVertexCapacity = 0;
+	UINT mVertexCount = 0;
+
+	IndexPool mIndices16;
+	IndexPool mIndices32;
+};
@@ -4,6 +4,9 @@
 
 #include "GeometryGenerator.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
 
 using namespace DirectX;
 
@@ -213,12 +216,12 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
+	// The input vertices are kept where they are; midpoints are appended after them.
+	// A midpoint is created once per edge and shared by the triangles on both sides,
+	// so a closed mesh grows by one vertex per edge rather than by six per triangle.
+	std::vector<uint32> inputIndices;
+	inputIndices.swap(meshData.Indices32);
+	meshData.mIndices16.clear();
 
 	//       v1
 	//       *
@@ -230,50 +233,190 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
+	uint32 numTris = (uint32)inputIndices.size()/3;
+
+	// Euler: a closed triangle mesh has 3/2 edges per triangle.
+	std::unordered_map<uint64, uint32> midpoints;
+	midpoints.reserve(numTris * 3 / 2 + 1);
+	meshData.Vertices.reserve(meshData.Vertices.size() + numTris * 3 / 2 + 1);
+	meshData.Indices32.reserve(inputIndices.size() * 4);
+
+	auto midpoint = [&](uint32 a, uint32 b)
+	{
+		uint64 key = a < b ? ((uint64)a << 32) | b : ((uint64)b << 32) | a;
+		auto inserted = midpoints.emplace(key, (uint32)meshData.Vertices.size());
+		if(inserted.second)
+		{
+			Vertex m = MidPoint(meshData.Vertices[a], meshData.Vertices[b]);
+			meshData.Vertices.push_back(m);
+		}
+		return inserted.first->second;
+	};
+
 	for(uint32 i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
+		uint32 v0 = inputIndices[i*3+0];
+		uint32 v1 = inputIndices[i*3+1];
+		uint32 v2 = inputIndices[i*3+2];
 
 		//
 		// Generate the midpoints.
 		//
 
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
+		uint32 m0 = midpoint(v0, v1);
+		uint32 m1 = midpoint(v1, v2);
+		uint32 m2 = midpoint(v0, v2);
 
 		//
 		// Add new geometry.
 		//
 
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
+		meshData.Indices32.push_back(v0);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(m2);
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(m1);
+		meshData.Indices32.push_back(m2);
 
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
+		meshData.Indices32.push_back(m2);
+		meshData.Indices32.push_back(m1);
+		meshData.Indices32.push_back(v2);
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(v1);
+		meshData.Indices32.push_back(m1);
 	}
 }
 
+namespace
+{
+	struct WeldCell
+	{
+		std::int64_t x, y, z;
+
+		bool operator==(const WeldCell& rhs) const { return x == rhs.x && y == rhs.y && z == rhs.z; }
+	};
+
+	struct WeldCellHash
+	{
+		size_t operator()(const WeldCell& cell) const
+		{
+			std::uint64_t h = (std::uint64_t)cell.x * 73856093u;
+			h ^= (std::uint64_t)cell.y * 19349663u;
+			h ^= (std::uint64_t)cell.z * 83492791u;
+			return (size_t)(h ^ (h >> 32));
+		}
+	};
+
+	bool Within(const XMFLOAT3& a, const XMFLOAT3& b, float tolerance)
+	{
+		return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance && std::fabs(a.z - b.z) <= tolerance;
+	}
+
+	bool Within(const XMFLOAT2& a, const XMFLOAT2& b, float tolerance)
+	{
+		return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance;
+	}
+}
+
+size_t GeometryGenerator::Weld(MeshData& meshData, float positionTolerance, float attributeTolerance)
+{
+	const uint32 NoVertex = 0xFFFFFFFF;
+	const size_t vertexCount = meshData.Vertices.size();
+
+	// Kept vertices are bucketed by position on a grid of tolerance sized cells, so a
+	// match can only be in the same or a neighbouring cell.  Without a tolerance the
+	// cell is the exact position.
+	auto cellOf = [positionTolerance](const XMFLOAT3& p)
+	{
+		if(positionTolerance <= 0.0f)
+		{
+			std::int64_t x = 0, y = 0, z = 0;
+			float px = p.x + 0.0f, py = p.y + 0.0f, pz = p.z + 0.0f;  // -0 and +0 weld
+			std::memcpy(&x, &px, sizeof(float));
+			std::memcpy(&y, &py, sizeof(float));
+			std::memcpy(&z, &pz, sizeof(float));
+			return WeldCell{ x, y, z };
+		}
+		return WeldCell{
+			(std::int64_t)std::floor(p.x / positionTolerance),
+			(std::int64_t)std::floor(p.y / positionTolerance),
+			(std::int64_t)std::floor(p.z / positionTolerance) };
+	};
+	const int reach = positionTolerance > 0.0f ? 1 : 0;
+
+	std::unordered_map<WeldCell, uint32, WeldCellHash> cellHeads;
+	cellHeads.reserve(vertexCount);
+	std::vector<uint32> nextInCell(vertexCount, NoVertex);
+
+	std::vector<uint32> remap(vertexCount);
+	std::vector<Vertex> welded;
+	welded.reserve(vertexCount);
+
+	for(size_t i = 0; i < vertexCount; ++i)
+	{
+		const Vertex& v = meshData.Vertices[i];
+		WeldCell cell = cellOf(v.Position);
+
+		uint32 match = NoVertex;
+		for(int dx = -reach; dx <= reach && match == NoVertex; ++dx)
+		for(int dy = -reach; dy <= reach && match == NoVertex; ++dy)
+		for(int dz = -reach; dz <= reach && match == NoVertex; ++dz)
+		{
+			auto head = cellHeads.find(WeldCell{ cell.x + dx, cell.y + dy, cell.z + dz });
+			if(head == cellHeads.end())
+				continue;
+
+			for(uint32 k = head->second; k != NoVertex; k = nextInCell[k])
+			{
+				const Vertex& w = welded[k];
+				if(Within(v.Position, w.Position, positionTolerance) &&
+					Within(v.Normal, w.Normal, attributeTolerance) &&
+					Within(v.TangentU, w.TangentU, attributeTolerance) &&
+					Within(v.TexC, w.TexC, attributeTolerance))
+				{
+					match = k;
+					break;
+				}
+			}
+		}
+
+		if(match == NoVertex)
+		{
+			match = (uint32)welded.size();
+			welded.push_back(v);
+
+			auto head = cellHeads.emplace(cell, NoVertex).first;
+			nextInCell[match] = head->second;
+			head->second = match;
+		}
+
+		remap[i] = match;
+	}
+
+	// A positive tolerance can weld two corners of a thin triangle together; such
+	// triangles cover nothing and are dropped.
+	size_t kept = 0;
+	std::vector<uint32>& indices = meshData.Indices32;
+	for(size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		uint32 a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+		if(a == b || b == c || a == c)
+			continue;
+
+		indices[kept++] = a;
+		indices[kept++] = b;
+		indices[kept++] = c;
+	}
+	indices.resize(kept);
+
+	size_t removed = vertexCount - welded.size();
+	meshData.Vertices.swap(welded);
+	meshData.mIndices16.clear();
+	return removed;
+}
+
 GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
 {
     XMVECTOR p0 = XMLoadFloat3(&v0.Position);
@@ -662,3 +805,77 @@ GeometryGenerator::MeshData GeometryGenerator::CreateTriangularPrism(float botto
 	return CreateCylinder(bottomRad, 2, height, 3, stackCount); //by taking from the cylinder function i can make shapes like the tri prism and change the slice count accordinly hehehe
 }
 
+
+MeshOptimizationReport GeometryGenerator::Optimize(MeshData& meshData, bool optimizeOverdraw)
+{
+	MeshOptimizationReport report;
+
+	const size_t vertexCount = meshData.Vertices.size();
+	const size_t indexCount = meshData.Indices32.size();
+	report.VertexCountBefore = vertexCount;
+	report.VertexCountAfter = vertexCount;
+	if (vertexCount == 0 || indexCount < 3)
+		return report;
+
+	report.Before = MeshOptimizer::AnalyzeVertexCache(meshData.Indices32.data(), indexCount, vertexCount);
+
+	std::vector<uint32> indices(indexCount);
+	MeshOptimizer::OptimizeVertexCache(indices.data(), meshData.Indices32.data(), indexCount, vertexCount);
+
+	if (optimizeOverdraw)
+	{
+		MeshOptimizer::OptimizeOverdraw(indices.data(), indices.data(), indexCount,
+			&meshData.Vertices[0].Position.x, vertexCount, sizeof(Vertex));
+	}
+
+	std::vector<uint32> remap(vertexCount);
+	size_t uniqueCount = MeshOptimizer::OptimizeVertexFetchRemap(remap.data(), indices.data(), indexCount, vertexCount);
+	MeshOptimizer::RemapIndices(meshData.Indices32.data(), indices.data(), indexCount, remap.data());
+	meshData.Vertices = MeshOptimizer::RemapVertices(meshData.Vertices, remap.data(), uniqueCount);
+
+	// The cached 16-bit copy holds the old order.
+	meshData.mIndices16.clear();
+
+	report.VertexCountAfter = uniqueCount;
+	report.After = MeshOptimizer::AnalyzeVertexCache(meshData.Indices32.data(), indexCount, uniqueCount);
+	return report;
+}
+
+std::vector<GeometryGenerator::MeshLod> GeometryGenerator::BuildLodChain(const MeshData& meshData, uint32 maxLevels,
+	float reduction, float maxError)
+{
+	std::vector<MeshLod> lods;
+	if (maxLevels == 0)
+		return lods;
+
+	lods.push_back({ meshData.Indices32, 0.0f });
+	if (meshData.Vertices.empty())
+		return lods;
+
+	const size_t vertexCount = meshData.Vertices.size();
+	while (lods.size() < maxLevels)
+	{
+		const MeshLod& previous = lods.back();
+		size_t targetIndexCount = (size_t)(previous.Indices32.size() / 3 * reduction) * 3;
+
+		// Simplifying the previous level rather than the original keeps the chain
+		// nested and cheap; the errors add up, so the sum bounds the real deviation.
+		MeshLod lod;
+		lod.Indices32.resize(previous.Indices32.size());
+		float error = 0.0f;
+		size_t indexCount = MeshSimplifier::Simplify(lod.Indices32.data(), previous.Indices32.data(),
+			previous.Indices32.size(), &meshData.Vertices[0].Position.x, vertexCount, sizeof(Vertex),
+			targetIndexCount, maxError - previous.Error, &error);
+
+		// Not worth a level if it saves less than a tenth of the triangles.
+		if (indexCount == 0 || indexCount * 10 > previous.Indices32.size() * 9)
+			break;
+
+		lod.Indices32.resize(indexCount);
+		MeshOptimizer::OptimizeVertexCache(lod.Indices32.data(), lod.Indices32.data(), indexCount, vertexCount);
+		lod.Error = previous.Error + error;
+		lods.push_back(std::move(lod));
+	}
+
+	return lods;
+}
@@ -14,9 +14,12 @@
 
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <DirectXMath.h>
 #include <vector>
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
 class GeometryGenerator
 {
@@ -24,6 +27,7 @@ public:
 
     using uint16 = std::uint16_t;
     using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
 
 	struct Vertex
 	{
@@ -58,8 +62,23 @@ public:
 		std::vector<Vertex> Vertices;
         std::vector<uint32> Indices32;
 
+		// True if every index fits in 16 bits.
+		bool FitsIndices16() const
+		{
+			for(uint32 index : Indices32)
+			{
+				if(index > 0xFFFF)
+					return false;
+			}
+			return true;
+		}
+
+		// 16-bit copy of Indices32.  Only valid when FitsIndices16(); prefer letting
+		// the loader pick the index width from the vertex count.
         std::vector<uint16>& GetIndices16()
         {
+			assert(FitsIndices16() && "Indices32 does not fit in 16 bits");
+
 			if(mIndices16.empty())
 			{
 				mIndices16.resize(Indices32.size());
@@ -71,9 +90,19 @@ public:
         }
 
 	private:
+		friend class GeometryGenerator;
 		std::vector<uint16> mIndices16;
 	};
 
+	/**
+	 * @brief One level of detail of a MeshData, drawn with the vertices of the full mesh
+	 */
+	struct MeshLod
+	{
+		std::vector<uint32> Indices32;
+		float Error = 0.0f;  ///< Largest object space distance from the full detail surface
+	};
+
 	///<summary>
 	/// Creates a box centered at the origin with the given dimensions, where each
     /// face has m rows and n columns of vertices.
@@ -112,7 +141,35 @@ public:
 
 	MeshData CreateTriangularPrism(float bottomRad, float height, uint32 stackCount);
 
+	///<summary>
+	/// Splits every triangle into four.  Triangles that share an edge (the same two
+	/// vertex indices) share its midpoint vertex.
+	///</summary>
 	void Subdivide(MeshData& meshData);
+
+	///<summary>
+	/// Merges vertices whose positions differ by at most positionTolerance and whose
+	/// normal, tangent and texture coordinate components differ by at most
+	/// attributeTolerance, then drops the duplicates.  Triangles left with two
+	/// corners on the same vertex are dropped as well; a vertex only they used stays
+	/// in Vertices, unreferenced.  Returns the vertices removed.
+	///</summary>
+	size_t Weld(MeshData& meshData, float positionTolerance = 0.0f, float attributeTolerance = 1e-4f);
+
+	///<summary>
+	/// Reorders the triangles for vertex cache reuse (and optionally overdraw), then
+	/// renumbers the vertices in order of first use.  Returns ACMR/ATVR before and after.
+	///</summary>
+	MeshOptimizationReport Optimize(MeshData& meshData, bool optimizeOverdraw = true);
+
+	///<summary>
+	/// Builds a level of detail chain with quadric error simplification.  Level 0 is the
+	/// mesh itself; each further level aims for reduction times the triangles of the one
+	/// before and indexes the same vertices.  The chain ends early once a level stops
+	/// shrinking or would deviate from the surface by more than maxError.
+	///</summary>
+	std::vector<MeshLod> BuildLodChain(const MeshData& meshData, uint32 maxLevels,
+		float reduction = 0.5f, float maxError = 1e30f);
 private:
 	
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
@@ -0,0 +1,354 @@
+//***************************************************************************************
+// MeshOptimizer.cpp
+//***************************************************************************************
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+using uint32 = MeshOptimizer::uint32;
+
+const uint32 MeshOptimizer::DefaultCacheSize;
+const uint32 MeshOptimizer::Unused;
+
+namespace
+{
+	//
+	// Scoring from Tom Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006).
+	//
+
+	const int ModeledCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	const uint32 NoTriangle = 0xFFFFFFFF;
+
+	float VertexScore(int cachePosition, uint32 remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The vertices of the last triangle get a fixed score so that the next
+			// triangle does not simply reuse the same edge forever.
+			if (cachePosition < 3)
+			{
+				score = LastTriangleScore;
+			}
+			else
+			{
+				float scaler = 1.0f / (ModeledCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		// Favour vertices with few triangles left so they are finished off and stop
+		// occupying the cache.
+		score += ValenceBoostScale * std::pow((float)remainingTriangles, -ValenceBoostPower);
+		return score;
+	}
+
+	/**
+	 * @brief Returns how many of a triangle's vertices miss a FIFO cache, updating it
+	 */
+	uint32 SimulateTriangle(const uint32* triangle, std::vector<uint32>& timestamps, uint32& time, uint32 cacheSize)
+	{
+		uint32 misses = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32 v = triangle[k];
+			if (time - timestamps[v] > cacheSize)
+			{
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32* indices, std::size_t indexCount,
+	std::size_t vertexCount, uint32 cacheSize)
+{
+	VertexCacheStatistics stats;
+	if (indexCount < 3 || vertexCount == 0)
+		return stats;
+
+	// A vertex is in the cache if fewer than cacheSize vertices were loaded since it was.
+	std::vector<uint32> timestamps(vertexCount, 0);
+	uint32 time = cacheSize + 1;
+
+	std::vector<bool> referenced(vertexCount, false);
+	std::size_t uniqueCount = 0;
+
+	for (std::size_t t = 0; t + 2 < indexCount; t += 3)
+	{
+		stats.VerticesTransformed += SimulateTriangle(indices + t, timestamps, time, cacheSize);
+
+		for (int k = 0; k < 3; ++k)
+		{
+			if (!referenced[indices[t + k]])
+			{
+				referenced[indices[t + k]] = true;
+				uniqueCount++;
+			}
+		}
+	}
+
+	stats.ACMR = (float)stats.VerticesTransformed / (float)(indexCount / 3);
+	stats.ATVR = (float)stats.VerticesTransformed / (float)uniqueCount;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32* destination, const uint32* indices, std::size_t indexCount,
+	std::size_t vertexCount)
+{
+	const std::vector<uint32> input(indices, indices + indexCount);
+	const std::size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles adjacent to each vertex; the first remaining[v] entries of a
+	// vertex's list are the triangles not emitted yet.
+	std::vector<uint32> remaining(vertexCount, 0);
+	for (std::size_t i = 0; i < triangleCount * 3; ++i)
+		remaining[input[i]]++;
+
+	std::vector<uint32> offsets(vertexCount + 1, 0);
+	for (std::size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<uint32> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32> fill(offsets.begin(), offsets.end() - 1);
+		for (std::size_t i = 0; i < triangleCount * 3; ++i)
+			adjacency[fill[input[i]]++] = (uint32)(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	uint32 best = 0;
+	for (std::size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[input[t * 3]] + vertexScore[input[t * 3 + 1]] + vertexScore[input[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[best])
+			best = (uint32)t;
+	}
+
+	std::vector<uint32> cache;
+	std::vector<uint32> newCache;
+	cache.reserve(ModeledCacheSize + 3);
+	newCache.reserve(ModeledCacheSize + 3);
+
+	std::size_t inputCursor = 0;
+	for (std::size_t out = 0; out < triangleCount; ++out)
+	{
+		if (best == NoTriangle)
+		{
+			// Nothing in the cache touches a pending triangle: continue with the
+			// next one in input order, which keeps the whole pass linear.
+			while (emitted[inputCursor])
+				inputCursor++;
+			best = (uint32)inputCursor;
+		}
+
+		const uint32* triangle = &input[best * 3];
+		destination[out * 3 + 0] = triangle[0];
+		destination[out * 3 + 1] = triangle[1];
+		destination[out * 3 + 2] = triangle[2];
+		emitted[best] = true;
+
+		// Drop the triangle from its vertices' pending lists.
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32 v = triangle[k];
+			uint32* list = &adjacency[offsets[v]];
+			for (uint32 i = 0; i < remaining[v]; ++i)
+			{
+				if (list[i] == best)
+				{
+					std::swap(list[i], list[remaining[v] - 1]);
+					remaining[v]--;
+					break;
+				}
+			}
+		}
+
+		// The triangle's vertices move to the front of the LRU cache.
+		newCache.clear();
+		for (int k = 0; k < 3; ++k)
+		{
+			if (std::find(newCache.begin(), newCache.end(), triangle[k]) == newCache.end())
+				newCache.push_back(triangle[k]);
+		}
+		for (uint32 v : cache)
+		{
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+		}
+
+		// Rescore every vertex whose cache position changed, including the ones
+		// that just fell out, then the pending triangles around them.
+		for (std::size_t i = 0; i < newCache.size(); ++i)
+		{
+			uint32 v = newCache[i];
+			cachePosition[v] = i < ModeledCacheSize ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		best = NoTriangle;
+		float bestScore = -1.0f;
+		for (uint32 v : newCache)
+		{
+			const uint32* list = &adjacency[offsets[v]];
+			for (uint32 i = 0; i < remaining[v]; ++i)
+			{
+				uint32 t = list[i];
+				triangleScore[t] = vertexScore[input[t * 3]] + vertexScore[input[t * 3 + 1]] + vertexScore[input[t * 3 + 2]];
+
+				// Only triangles touching a cached vertex are candidates.
+				if (cachePosition[v] >= 0 && triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		if (newCache.size() > ModeledCacheSize)
+			newCache.resize(ModeledCacheSize);
+		cache.swap(newCache);
+	}
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32* destination, const uint32* indices, std::size_t indexCount,
+	const float* positions, std::size_t vertexCount, std::size_t positionStride, uint32 cacheSize)
+{
+	const std::vector<uint32> input(indices, indices + indexCount);
+	const std::size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	auto position = [&](uint32 v) { return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * positionStride); };
+
+	// Split where the cache restarts, so reordering clusters keeps the cache hit rate.
+	std::vector<std::size_t> clusterStarts;
+	{
+		std::vector<uint32> timestamps(vertexCount, 0);
+		uint32 time = cacheSize + 1;
+		for (std::size_t t = 0; t < triangleCount; ++t)
+		{
+			if (SimulateTriangle(&input[t * 3], timestamps, time, cacheSize) == 3 || t == 0)
+				clusterStarts.push_back(t);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	struct Cluster
+	{
+		std::size_t First;
+		std::size_t Count;
+		float Centroid[3];
+		float Normal[3];
+		float Area;
+		float SortKey;
+	};
+
+	std::vector<Cluster> clusters(clusterStarts.size() - 1);
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	for (std::size_t c = 0; c < clusters.size(); ++c)
+	{
+		Cluster& cluster = clusters[c];
+		cluster = Cluster{ clusterStarts[c], clusterStarts[c + 1] - clusterStarts[c], { 0, 0, 0 }, { 0, 0, 0 }, 0.0f, 0.0f };
+
+		for (std::size_t t = cluster.First; t < cluster.First + cluster.Count; ++t)
+		{
+			const float* p0 = position(input[t * 3 + 0]);
+			const float* p1 = position(input[t * 3 + 1]);
+			const float* p2 = position(input[t * 3 + 2]);
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			// Area weighted, so slivers do not skew the cluster.
+			for (int k = 0; k < 3; ++k)
+			{
+				cluster.Centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+				cluster.Normal[k] += n[k];
+			}
+			cluster.Area += area;
+		}
+
+		for (int k = 0; k < 3; ++k)
+			meshCentroid[k] += cluster.Centroid[k];
+		meshArea += cluster.Area;
+
+		if (cluster.Area > 0.0f)
+		{
+			for (int k = 0; k < 3; ++k)
+				cluster.Centroid[k] /= cluster.Area;
+		}
+	}
+
+	if (meshArea > 0.0f)
+	{
+		for (int k = 0; k < 3; ++k)
+			meshCentroid[k] /= meshArea;
+	}
+
+	for (Cluster& cluster : clusters)
+	{
+		float length = std::sqrt(cluster.Normal[0] * cluster.Normal[0] + cluster.Normal[1] * cluster.Normal[1] + cluster.Normal[2] * cluster.Normal[2]);
+		cluster.SortKey = 0.0f;
+		if (length > 0.0f)
+		{
+			for (int k = 0; k < 3; ++k)
+				cluster.SortKey += (cluster.Centroid[k] - meshCentroid[k]) * cluster.Normal[k] / length;
+		}
+	}
+
+	// Stable, so flat meshes (every key equal) keep their cache optimized order.
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const Cluster& a, const Cluster& b) { return a.SortKey > b.SortKey; });
+
+	std::size_t out = 0;
+	for (const Cluster& cluster : clusters)
+	{
+		for (std::size_t i = cluster.First * 3; i < (cluster.First + cluster.Count) * 3; ++i)
+			destination[out++] = input[i];
+	}
+}
+
+std::size_t MeshOptimizer::OptimizeVertexFetchRemap(uint32* remap, const uint32* indices, std::size_t indexCount,
+	std::size_t vertexCount)
+{
+	std::fill(remap, remap + vertexCount, Unused);
+
+	uint32 next = 0;
+	for (std::size_t i = 0; i < indexCount; ++i)
+	{
+		if (remap[indices[i]] == Unused)
+			remap[indices[i]] = next++;
+	}
+
+	return next;
+}
+
+void MeshOptimizer::RemapIndices(uint32* destination, const uint32* indices, std::size_t indexCount, const uint32* remap)
+{
+	for (std::size_t i = 0; i < indexCount; ++i)
+		destination[i] = remap[indices[i]];
+}
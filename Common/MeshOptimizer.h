@@ -0,0 +1,118 @@
+//***************************************************************************************
+// MeshOptimizer.h
+//
+// Reorders indexed triangle lists for the GPU:
+//
+//   OptimizeVertexCache      Forsyth's linear-speed triangle order, so vertices are
+//                            reused while still in the post-transform cache.
+//   OptimizeOverdraw         Splits that order into clusters at cache restarts and
+//                            draws the most outward facing clusters first.
+//   OptimizeVertexFetchRemap Renumbers vertices in order of first use so fetches
+//                            walk the vertex buffer linearly.
+//
+// AnalyzeVertexCache simulates a FIFO cache to report the average cache miss ratio
+// (transformed vertices per triangle, ACMR) and the average transform to vertex ratio
+// (ATVR, 1.0 is ideal).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Result of a vertex cache simulation
+ */
+struct VertexCacheStatistics
+{
+	std::uint32_t VerticesTransformed = 0;  ///< Cache misses
+	float ACMR = 0.0f;  ///< Transformed vertices per triangle, 0.5 is the best a regular grid can reach
+	float ATVR = 0.0f;  ///< Transformed vertices per referenced vertex, 1.0 is ideal
+};
+
+/**
+ * @brief Cache statistics of a mesh before and after optimization
+ */
+struct MeshOptimizationReport
+{
+	VertexCacheStatistics Before;
+	VertexCacheStatistics After;
+	std::size_t VertexCountBefore = 0;
+	std::size_t VertexCountAfter = 0;  ///< Lower if some vertices were not referenced
+};
+
+class MeshOptimizer
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	/// FIFO size used by AnalyzeVertexCache() unless told otherwise.
+	static const uint32 DefaultCacheSize = 16;
+
+	/// Written by OptimizeVertexFetchRemap() for vertices no triangle references.
+	static const uint32 Unused = 0xFFFFFFFF;
+
+	/**
+	 * @brief Simulates a FIFO post-transform cache
+	 * @param indices Triangle list
+	 * @param indexCount Number of indices, a multiple of 3
+	 * @param vertexCount Number of vertices the indices refer to
+	 * @param cacheSize Cache entries
+	 */
+	static VertexCacheStatistics AnalyzeVertexCache(const uint32* indices, std::size_t indexCount,
+		std::size_t vertexCount, uint32 cacheSize = DefaultCacheSize);
+
+	/**
+	 * @brief Reorders triangles for post-transform cache reuse
+	 * @param destination Receives indexCount indices, may be the same array as indices
+	 */
+	static void OptimizeVertexCache(uint32* destination, const uint32* indices, std::size_t indexCount,
+		std::size_t vertexCount);
+
+	/**
+	 * @brief Reorders clusters of a cache optimized triangle list to reduce overdraw
+	 *
+	 * A cluster ends where the cache simulation restarts (a triangle with three
+	 * misses), so the cache efficiency inside each cluster is kept.  Clusters facing
+	 * away from the mesh centre are drawn first since they are the likeliest to
+	 * occlude the rest.
+	 * @param destination Receives indexCount indices, may be the same array as indices
+	 * @param positions First vertex position (three floats)
+	 * @param positionStride Distance in bytes between consecutive positions
+	 */
+	static void OptimizeOverdraw(uint32* destination, const uint32* indices, std::size_t indexCount,
+		const float* positions, std::size_t vertexCount, std::size_t positionStride,
+		uint32 cacheSize = DefaultCacheSize);
+
+	/**
+	 * @brief Builds a remap table that numbers vertices in order of first use
+	 * @param remap Receives vertexCount entries, Unused for unreferenced vertices
+	 * @return Number of referenced vertices
+	 */
+	static std::size_t OptimizeVertexFetchRemap(uint32* remap, const uint32* indices, std::size_t indexCount,
+		std::size_t vertexCount);
+
+	/**
+	 * @brief Applies a remap table to indices
+	 * @param destination Receives indexCount indices, may be the same array as indices
+	 */
+	static void RemapIndices(uint32* destination, const uint32* indices, std::size_t indexCount, const uint32* remap);
+
+	/**
+	 * @brief Applies a remap table to vertices, dropping unreferenced ones
+	 * @param uniqueCount Value returned by OptimizeVertexFetchRemap()
+	 */
+	template<typename T>
+	static std::vector<T> RemapVertices(const std::vector<T>& vertices, const uint32* remap, std::size_t uniqueCount)
+	{
+		std::vector<T> result(uniqueCount);
+		for (std::size_t i = 0; i < vertices.size(); ++i)
+		{
+			if (remap[i] != Unused)
+				result[remap[i]] = vertices[i];
+		}
+		return result;
+	}
+};
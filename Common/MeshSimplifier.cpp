@@ -0,0 +1,340 @@
+//***************************************************************************************
+// MeshSimplifier.cpp
+//***************************************************************************************
+
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using uint32 = MeshSimplifier::uint32;
+
+namespace
+{
+	struct Vector3
+	{
+		float x, y, z;
+	};
+
+	Vector3 Subtract(const Vector3& a, const Vector3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	Vector3 Cross(const Vector3& a, const Vector3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	float Dot(const Vector3& a, const Vector3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	/**
+	 * @brief Sum of squared distances to a set of planes, weighted by triangle area
+	 *
+	 * Stored as the symmetric 3x3 matrix A, the vector b and the scalar c of
+	 * p^T A p + 2 b.p + c.
+	 */
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0;
+
+		void AddPlane(const Vector3& n, double d, double w)
+		{
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+			b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		/// Mean squared distance of p to the planes.
+		double Error(const Vector3& p) const
+		{
+			double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+				+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+				+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z)
+				+ c;
+			return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32 from;
+		uint32 to;
+		float cost;  ///< Mean squared distance
+	};
+
+	/**
+	 * @brief Maps every vertex to the first vertex sharing its exact position
+	 */
+	std::vector<uint32> BuildPositionRemap(const std::vector<Vector3>& positions)
+	{
+		std::vector<uint32> order(positions.size());
+		for (uint32 i = 0; i < (uint32)order.size(); ++i)
+			order[i] = i;
+
+		auto less = [&](uint32 a, uint32 b)
+		{
+			const Vector3& pa = positions[a];
+			const Vector3& pb = positions[b];
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<uint32> remap(positions.size());
+		for (std::size_t i = 0; i < order.size(); )
+		{
+			std::size_t j = i;
+			const Vector3& p = positions[order[i]];
+			while (j < order.size() && std::memcmp(&positions[order[j]], &p, sizeof(Vector3)) == 0)
+				remap[order[j++]] = order[i];
+			i = j;
+		}
+		return remap;
+	}
+
+	/**
+	 * @brief Flags vertices that must stay: seams (shared positions) and open borders
+	 */
+	std::vector<bool> FindLockedVertices(const std::vector<uint32>& indices, const std::vector<uint32>& positionRemap)
+	{
+		std::vector<bool> locked(positionRemap.size(), false);
+
+		std::vector<bool> referenced(positionRemap.size(), false);
+		for (uint32 index : indices)
+			referenced[index] = true;
+
+		// Two referenced vertices at one position make a seam.
+		std::vector<uint32> firstAtPosition(positionRemap.size(), 0xFFFFFFFF);
+		for (uint32 v = 0; v < (uint32)positionRemap.size(); ++v)
+		{
+			if (!referenced[v])
+				continue;
+			uint32& first = firstAtPosition[positionRemap[v]];
+			if (first == 0xFFFFFFFF)
+				first = v;
+			else
+				locked[v] = locked[first] = true;
+		}
+
+		// An edge used by a single triangle lies on a border.  Edges are compared by
+		// position so that seams do not count as borders.
+		std::vector<std::uint64_t> edges;
+		edges.reserve(indices.size());
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32 a = positionRemap[indices[i + e]];
+				uint32 b = positionRemap[indices[i + (e + 1) % 3]];
+				if (a > b)
+					std::swap(a, b);
+				edges.push_back(((std::uint64_t)a << 32) | b);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		std::vector<bool> borderPosition(positionRemap.size(), false);
+		for (std::size_t i = 0; i < edges.size(); )
+		{
+			std::size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i])
+				++j;
+			if (j - i == 1)
+			{
+				borderPosition[(uint32)(edges[i] >> 32)] = true;
+				borderPosition[(uint32)(edges[i] & 0xFFFFFFFF)] = true;
+			}
+			i = j;
+		}
+		for (uint32 v = 0; v < (uint32)positionRemap.size(); ++v)
+		{
+			if (borderPosition[positionRemap[v]])
+				locked[v] = true;
+		}
+
+		return locked;
+	}
+
+	/**
+	 * @brief Returns true if moving vertex from onto to would turn a triangle over
+	 */
+	bool CollapseFlipsTriangle(uint32 from, uint32 to, const std::vector<uint32>& indices,
+		const std::vector<uint32>& adjacencyOffsets, const std::vector<uint32>& adjacency,
+		const std::vector<Vector3>& positions)
+	{
+		for (uint32 k = adjacencyOffsets[from]; k < adjacencyOffsets[from + 1]; ++k)
+		{
+			const uint32* triangle = &indices[adjacency[k] * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				continue;  // Removed by the collapse
+
+			Vector3 before[3];
+			Vector3 after[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				before[i] = positions[triangle[i]];
+				after[i] = triangle[i] == from ? positions[to] : before[i];
+			}
+
+			Vector3 n0 = Cross(Subtract(before[1], before[0]), Subtract(before[2], before[0]));
+			Vector3 n1 = Cross(Subtract(after[1], after[0]), Subtract(after[2], after[0]));
+			if (Dot(n0, n1) <= 0.0f)
+				return true;
+		}
+		return false;
+	}
+}
+
+std::size_t MeshSimplifier::Simplify(uint32* destination, const uint32* indices, std::size_t indexCount,
+	const float* positions, std::size_t vertexCount, std::size_t positionStride,
+	std::size_t targetIndexCount, float targetError, float* resultError)
+{
+	std::vector<uint32> result(indices, indices + indexCount);
+
+	std::vector<Vector3> vertexPositions(vertexCount);
+	const unsigned char* positionBytes = reinterpret_cast<const unsigned char*>(positions);
+	for (std::size_t v = 0; v < vertexCount; ++v)
+		std::memcpy(&vertexPositions[v], positionBytes + v * positionStride, sizeof(Vector3));
+
+	const std::vector<uint32> positionRemap = BuildPositionRemap(vertexPositions);
+	const std::vector<bool> locked = FindLockedVertices(result, positionRemap);
+
+	// Quadrics are kept per position so that all vertices of a seam agree.
+	std::vector<Quadric> quadrics(vertexCount);
+	for (std::size_t i = 0; i < result.size(); i += 3)
+	{
+		const Vector3& p0 = vertexPositions[result[i + 0]];
+		const Vector3& p1 = vertexPositions[result[i + 1]];
+		const Vector3& p2 = vertexPositions[result[i + 2]];
+
+		Vector3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+		float length = std::sqrt(Dot(normal, normal));
+		if (length == 0.0f)
+			continue;
+		normal = { normal.x / length, normal.y / length, normal.z / length };
+
+		double area = 0.5 * length;
+		double d = -Dot(normal, p0);
+		for (int k = 0; k < 3; ++k)
+			quadrics[positionRemap[result[i + k]]].AddPlane(normal, d, area);
+	}
+
+	const double maxCost = (double)targetError * targetError;
+	double worstCost = 0.0;
+
+	std::vector<uint32> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<uint32> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+
+	// Each pass collapses the cheapest edges that do not share a neighbourhood, so the
+	// costs of the edges it uses stay valid for the whole pass.
+	while (result.size() > targetIndexCount)
+	{
+		std::size_t triangleCount = result.size() / 3;
+
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32 index : result)
+			++adjacencyOffsets[index + 1];
+		for (std::size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(result.size());
+		{
+			std::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (std::size_t i = 0; i < result.size(); ++i)
+				adjacency[fill[result[i]]++] = (uint32)(i / 3);
+		}
+
+		collapses.clear();
+		for (std::size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32 a = result[i + e];
+				uint32 b = result[i + (e + 1) % 3];
+				for (int direction = 0; direction < 2; ++direction, std::swap(a, b))
+				{
+					if (locked[a])
+						continue;
+
+					Quadric q = quadrics[positionRemap[a]];
+					q.Add(quadrics[positionRemap[b]]);
+					collapses.push_back({ a, b, (float)q.Error(vertexPositions[b]) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		for (std::size_t v = 0; v < vertexCount; ++v)
+			remap[v] = (uint32)v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		std::size_t targetTriangleCount = targetIndexCount / 3;
+		std::size_t removedTriangles = 0;
+		std::size_t collapseCount = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.cost > maxCost || triangleCount - removedTriangles <= targetTriangleCount)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+			if (CollapseFlipsTriangle(collapse.from, collapse.to, result, adjacencyOffsets, adjacency, vertexPositions))
+				continue;
+
+			// Everything around the collapsed vertex changes shape, so freeze it for
+			// the rest of the pass.
+			for (uint32 k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; ++k)
+			{
+				const uint32* triangle = &result[adjacency[k] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					++removedTriangles;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[positionRemap[collapse.to]].Add(quadrics[positionRemap[collapse.from]]);
+			worstCost = std::max(worstCost, (double)collapse.cost);
+			++collapseCount;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// Rewrite the triangles and drop the ones that collapsed to a line.
+		std::size_t write = 0;
+		for (std::size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32 a = remap[result[i + 0]];
+			uint32 b = remap[result[i + 1]];
+			uint32 c = remap[result[i + 2]];
+
+			uint32 pa = positionRemap[a];
+			uint32 pb = positionRemap[b];
+			uint32 pc = positionRemap[c];
+			if (pa == pb || pb == pc || pc == pa)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+	if (resultError)
+		*resultError = (float)std::sqrt(worstCost);
+	return result.size();
+}
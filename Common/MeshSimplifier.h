@@ -0,0 +1,41 @@
+//***************************************************************************************
+// MeshSimplifier.h
+//
+// Quadric error metric simplification (Garland & Heckbert, 1997) of indexed triangle
+// lists.  Edges are collapsed onto one of their existing end points, so a simplified
+// index list still refers to the original vertex buffer and every level of detail of
+// a mesh can share the same vertices.
+//
+// Vertices on open borders and on attribute seams (several vertices at the same
+// position, for example where UVs or normals split) are never removed, which keeps
+// outlines, texture mapping and the edges shared with neighbouring meshes intact.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class MeshSimplifier
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	/**
+	 * @brief Simplifies a triangle list
+	 * @param destination Receives at most indexCount indices, may be the same array as indices
+	 * @param indices Triangle list
+	 * @param indexCount Number of indices, a multiple of 3
+	 * @param positions First vertex position (three floats)
+	 * @param vertexCount Number of vertices
+	 * @param positionStride Distance in bytes between consecutive positions
+	 * @param targetIndexCount Stop once the list is this short
+	 * @param targetError Largest allowed deviation from the input surface, in position units
+	 * @param[out] resultError Deviation actually introduced, optional
+	 * @return Number of indices written to destination
+	 */
+	static std::size_t Simplify(uint32* destination, const uint32* indices, std::size_t indexCount,
+		const float* positions, std::size_t vertexCount, std::size_t positionStride,
+		std::size_t targetIndexCount, float targetError, float* resultError = nullptr);
+};
@@ -0,0 +1,650 @@
+//***************************************************************************************
+// OcclusionCuller.cpp
+//***************************************************************************************
+
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#if defined(__AVX2__)
+#define OCCLUSION_CULLER_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_CULLER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Triangles are clipped against x, y = +-GuardBand * w rather than the screen edges,
+	// which keeps screen coordinates small enough for float edge functions.
+	const float GuardBand = 4.0f;
+	const int MaxClipVertices = 16;
+
+	void MultiplyMatrices(const float* a, const float* b, float* result)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				result[i * 4 + j] = a[i * 4 + 0] * b[0 * 4 + j] + a[i * 4 + 1] * b[1 * 4 + j] +
+					a[i * 4 + 2] * b[2 * 4 + j] + a[i * 4 + 3] * b[3 * 4 + j];
+			}
+		}
+	}
+
+	void TransformPoint(const float point[3], const float* matrix, float* clip)
+	{
+		for (int j = 0; j < 4; ++j)
+			clip[j] = point[0] * matrix[j] + point[1] * matrix[4 + j] + point[2] * matrix[8 + j] + matrix[12 + j];
+	}
+
+	bool IsMirroring(const float* world)
+	{
+		float determinant =
+			world[0] * (world[5] * world[10] - world[6] * world[9]) -
+			world[1] * (world[4] * world[10] - world[6] * world[8]) +
+			world[2] * (world[4] * world[9] - world[5] * world[8]);
+		return determinant < 0.0f;
+	}
+
+	// Signed distance of a clip space vertex to the near plane and the guard band planes.
+	float ClipDistance(const float* v, int plane)
+	{
+		switch (plane)
+		{
+		case 0: return v[2];
+		case 1: return GuardBand * v[3] - v[0];
+		case 2: return GuardBand * v[3] + v[0];
+		case 3: return GuardBand * v[3] - v[1];
+		default: return GuardBand * v[3] + v[1];
+		}
+	}
+
+	// Lane operations shared by the rasterizer loop; Width pixels per step.
+#if OCCLUSION_CULLER_AVX2
+	struct Lanes
+	{
+		static const int Width = 8;
+		using Vector = __m256;
+		using Mask = __m256;
+		static Vector Broadcast(float value) { return _mm256_set1_ps(value); }
+		static Vector Offsets() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+		static Vector Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, Vector v) { _mm256_storeu_ps(p, v); }
+		static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+		static Vector Min(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+		static Mask GreaterEqual(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+		static bool Any(Mask m) { return _mm256_movemask_ps(m) != 0; }
+		static Vector Select(Mask m, Vector a, Vector b) { return _mm256_blendv_ps(b, a, m); }
+	};
+#elif OCCLUSION_CULLER_SSE
+	struct Lanes
+	{
+		static const int Width = 4;
+		using Vector = __m128;
+		using Mask = __m128;
+		static Vector Broadcast(float value) { return _mm_set1_ps(value); }
+		static Vector Offsets() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+		static Vector Load(const float* p) { return _mm_loadu_ps(p); }
+		static void Store(float* p, Vector v) { _mm_storeu_ps(p, v); }
+		static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+		static Vector Min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+		static Mask GreaterEqual(Vector a, Vector b) { return _mm_cmpge_ps(a, b); }
+		static Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+		static bool Any(Mask m) { return _mm_movemask_ps(m) != 0; }
+		static Vector Select(Mask m, Vector a, Vector b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+	};
+#else
+	struct Lanes
+	{
+		static const int Width = 1;
+		using Vector = float;
+		using Mask = bool;
+		static Vector Broadcast(float value) { return value; }
+		static Vector Offsets() { return 0.0f; }
+		static Vector Load(const float* p) { return *p; }
+		static void Store(float* p, Vector v) { *p = v; }
+		static Vector Add(Vector a, Vector b) { return a + b; }
+		static Vector Mul(Vector a, Vector b) { return a * b; }
+		static Vector Min(Vector a, Vector b) { return a < b ? a : b; }
+		static Mask GreaterEqual(Vector a, Vector b) { return a >= b; }
+		static Mask And(Mask a, Mask b) { return a && b; }
+		static bool Any(Mask m) { return m; }
+		static Vector Select(Mask m, Vector a, Vector b) { return m ? a : b; }
+	};
+#endif
+}
+
+OcclusionCuller::OcclusionCuller(const OcclusionCullerDesc& desc)
+	: mDesc(desc)
+{
+	// Tiles hold whole SIMD steps, and the buffer holds whole tiles.
+	mDesc.TileSize = std::max<uint32>(8, (mDesc.TileSize + 7) / 8 * 8);
+	mTilesX = std::max<uint32>(1, (mDesc.Width + mDesc.TileSize - 1) / mDesc.TileSize);
+	mTilesY = std::max<uint32>(1, (mDesc.Height + mDesc.TileSize - 1) / mDesc.TileSize);
+	mDesc.Width = mTilesX * mDesc.TileSize;
+	mDesc.Height = mTilesY * mDesc.TileSize;
+	mTileBins.resize((std::size_t)mTilesX * mTilesY);
+
+	uint32 width = mDesc.Width;
+	uint32 height = mDesc.Height;
+	for (;;)
+	{
+		Level level;
+		level.Width = width;
+		level.Height = height;
+		level.Depth.assign((std::size_t)width * height, 1.0f);
+		mLevels.push_back(std::move(level));
+		if (width == 1 && height == 1)
+			break;
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+
+	unsigned workerCount = mDesc.WorkerCount;
+	if (workerCount == 0)
+		workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	workerCount = std::min<unsigned>(workerCount, (unsigned)mTileBins.size() - 1);
+
+	mWorkers.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back(&OcclusionCuller::WorkerMain, this);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWorkAvailable.notify_all();
+
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+int OcclusionCuller::GetSimdWidth()
+{
+	return Lanes::Width;
+}
+
+void OcclusionCuller::BeginFrame(const float viewProjection[16])
+{
+	std::copy(viewProjection, viewProjection + 16, mViewProjection);
+	mTriangles.clear();
+	for (auto& bin : mTileBins)
+		bin.clear();
+	mRasterized = false;
+}
+
+void OcclusionCuller::AddOccluder(const float* positions, uint32 vertexCount, const uint32* indices, uint32 indexCount, const float world[16])
+{
+	float worldViewProjection[16];
+	MultiplyMatrices(world, mViewProjection, worldViewProjection);
+
+	mClipVertices.resize((std::size_t)vertexCount * 4);
+	for (uint32 i = 0; i < vertexCount; ++i)
+		TransformPoint(positions + i * 3, worldViewProjection, &mClipVertices[i * 4]);
+
+	// A mirroring transform turns clockwise faces counter-clockwise.
+	bool mirrored = IsMirroring(world);
+	for (uint32 i = 0; i + 2 < indexCount; i += 3)
+	{
+		const float* a = &mClipVertices[indices[i] * 4];
+		const float* b = &mClipVertices[indices[i + 1] * 4];
+		const float* c = &mClipVertices[indices[i + 2] * 4];
+		if (mirrored)
+			std::swap(b, c);
+		AddTriangle(a, b, c);
+	}
+}
+
+void OcclusionCuller::AddOccluderBox(const float center[3], const float extents[3], const float world[16])
+{
+	// Corner i has bit 0 set for +x, bit 1 for +y and bit 2 for +z.  Each face is
+	// listed clockwise as seen from outside the box.
+	static const uint32 faces[36] =
+	{
+		0, 2, 3, 0, 3, 1,   // -z
+		5, 7, 6, 5, 6, 4,   // +z
+		4, 6, 2, 4, 2, 0,   // -x
+		1, 3, 7, 1, 7, 5,   // +x
+		1, 5, 4, 1, 4, 0,   // -y
+		2, 6, 7, 2, 7, 3,   // +y
+	};
+
+	float corners[8 * 3];
+	for (int i = 0; i < 8; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+			corners[i * 3 + k] = center[k] + ((i >> k) & 1 ? extents[k] : -extents[k]);
+	}
+
+	AddOccluder(corners, 8, faces, 36, world);
+}
+
+void OcclusionCuller::AddTriangle(const float* a, const float* b, const float* c)
+{
+	auto outcode = [](const float* v)
+	{
+		int code = 0;
+		if (v[0] < -v[3]) code |= 1;
+		if (v[0] > v[3]) code |= 2;
+		if (v[1] < -v[3]) code |= 4;
+		if (v[1] > v[3]) code |= 8;
+		if (v[2] < 0.0f) code |= 16;
+		return code;
+	};
+
+	// Entirely outside one side of the frustum.
+	if (outcode(a) & outcode(b) & outcode(c))
+		return;
+
+	bool inside = true;
+	for (int plane = 0; plane < 5 && inside; ++plane)
+		inside = ClipDistance(a, plane) >= 0.0f && ClipDistance(b, plane) >= 0.0f && ClipDistance(c, plane) >= 0.0f;
+	if (inside)
+	{
+		SetupTriangle(a, b, c);
+		return;
+	}
+
+	// Sutherland-Hodgman in clip space; the polygon stays convex and is drawn as a fan.
+	float buffers[2][MaxClipVertices][4];
+	int count = 3;
+	std::copy(a, a + 4, buffers[0][0]);
+	std::copy(b, b + 4, buffers[0][1]);
+	std::copy(c, c + 4, buffers[0][2]);
+
+	int source = 0;
+	for (int plane = 0; plane < 5 && count >= 3; ++plane)
+	{
+		float (*in)[4] = buffers[source];
+		float (*out)[4] = buffers[source ^ 1];
+		int outCount = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const float* current = in[i];
+			const float* next = in[(i + 1) % count];
+			float currentDistance = ClipDistance(current, plane);
+			float nextDistance = ClipDistance(next, plane);
+
+			if (currentDistance >= 0.0f)
+				std::copy(current, current + 4, out[outCount++]);
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				float t = currentDistance / (currentDistance - nextDistance);
+				for (int k = 0; k < 4; ++k)
+					out[outCount][k] = current[k] + t * (next[k] - current[k]);
+				++outCount;
+			}
+		}
+		count = outCount;
+		source ^= 1;
+	}
+
+	for (int i = 1; i + 1 < count; ++i)
+		SetupTriangle(buffers[source][0], buffers[source][i], buffers[source][i + 1]);
+}
+
+void OcclusionCuller::SetupTriangle(const float* a, const float* b, const float* c)
+{
+	const float* vertices[3] = { a, b, c };
+	float x[3], y[3], z[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		float inverseW = 1.0f / vertices[i][3];
+		x[i] = (vertices[i][0] * inverseW * 0.5f + 0.5f) * (float)mDesc.Width;
+		y[i] = (0.5f - vertices[i][1] * inverseW * 0.5f) * (float)mDesc.Height;
+		z[i] = vertices[i][2] * inverseW;
+	}
+
+	// Positive for clockwise triangles with y pointing down; the rest face away.
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0.0f))
+		return;
+
+	Triangle triangle;
+	triangle.MinX = std::max(0, (int)std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f));
+	triangle.MaxX = std::min((int)mDesc.Width - 1, (int)std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f));
+	triangle.MinY = std::max(0, (int)std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f));
+	triangle.MaxY = std::min((int)mDesc.Height - 1, (int)std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f));
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+		return;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		int j = (i + 1) % 3;
+		triangle.EdgeA[i] = y[i] - y[j];
+		triangle.EdgeB[i] = x[j] - x[i];
+		triangle.EdgeC[i] = x[i] * y[j] - x[j] * y[i];
+	}
+
+	// Depth is affine in screen space.  Raising the plane by its largest change over
+	// half a pixel stores the farthest depth the triangle reaches inside the pixel.
+	triangle.ZX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	triangle.ZY = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+	triangle.Z0 = z[0] - triangle.ZX * x[0] - triangle.ZY * y[0] +
+		0.5f * (std::fabs(triangle.ZX) + std::fabs(triangle.ZY));
+	triangle.ZMax = std::max({ z[0], z[1], z[2] });
+
+	uint32 index = (uint32)mTriangles.size();
+	mTriangles.push_back(triangle);
+
+	uint32 tileSize = mDesc.TileSize;
+	for (uint32 ty = triangle.MinY / tileSize; ty <= triangle.MaxY / tileSize; ++ty)
+	{
+		for (uint32 tx = triangle.MinX / tileSize; tx <= triangle.MaxX / tileSize; ++tx)
+			mTileBins[ty * mTilesX + tx].push_back(index);
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	if (mWorkers.empty())
+	{
+		for (uint32 tile = 0; tile < (uint32)mTileBins.size(); ++tile)
+			RasterizeTile(tile);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mNextTile = 0;
+			mBusyWorkers = (unsigned)mWorkers.size();
+			++mGeneration;
+		}
+		mWorkAvailable.notify_all();
+
+		// The calling thread takes tiles too.
+		RunTiles();
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mWorkDone.wait(lock, [this]() { return mBusyWorkers == 0; });
+	}
+
+	BuildPyramid();
+	mRasterized = true;
+}
+
+void OcclusionCuller::RunTiles()
+{
+	for (;;)
+	{
+		uint32 tile = mNextTile.fetch_add(1);
+		if (tile >= (uint32)mTileBins.size())
+			return;
+		RasterizeTile(tile);
+	}
+}
+
+void OcclusionCuller::WorkerMain()
+{
+	std::uint64_t generation = 0;
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWorkAvailable.wait(lock, [&]() { return mStopping || mGeneration != generation; });
+		if (mStopping)
+			return;
+		generation = mGeneration;
+
+		lock.unlock();
+		RunTiles();
+		lock.lock();
+
+		if (--mBusyWorkers == 0)
+			mWorkDone.notify_one();
+	}
+}
+
+void OcclusionCuller::RasterizeTile(uint32 tile)
+{
+	const int tileSize = (int)mDesc.TileSize;
+	const int stride = (int)mDesc.Width;
+	const int tileX = (int)(tile % mTilesX) * tileSize;
+	const int tileY = (int)(tile / mTilesX) * tileSize;
+	float* depth = mLevels[0].Depth.data();
+
+	for (int y = tileY; y < tileY + tileSize; ++y)
+		std::fill(depth + (std::size_t)y * stride + tileX, depth + (std::size_t)y * stride + tileX + tileSize, 1.0f);
+
+	using Vector = Lanes::Vector;
+	const Vector offsets = Lanes::Offsets();
+	const Vector zero = Lanes::Broadcast(0.0f);
+	const Vector step = Lanes::Broadcast((float)Lanes::Width);
+
+	for (uint32 index : mTileBins[tile])
+	{
+		const Triangle& triangle = mTriangles[index];
+		int x0 = std::max(triangle.MinX, tileX);
+		int x1 = std::min(triangle.MaxX, tileX + tileSize - 1);
+		int y0 = std::max(triangle.MinY, tileY);
+		int y1 = std::min(triangle.MaxY, tileY + tileSize - 1);
+
+		// Steps start on a multiple of the width, so they never leave the tile.
+		int xStart = x0 - (x0 - tileX) % Lanes::Width;
+		const Vector first = Lanes::Broadcast((float)x0);
+		const Vector last = Lanes::Broadcast((float)x1);
+
+		Vector edgeA[3], edgeStep[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			edgeA[i] = Lanes::Broadcast(triangle.EdgeA[i]);
+			edgeStep[i] = Lanes::Mul(edgeA[i], step);
+		}
+		const Vector zx = Lanes::Broadcast(triangle.ZX);
+		const Vector zStep = Lanes::Mul(zx, step);
+		const Vector zMax = Lanes::Broadcast(triangle.ZMax);
+
+		for (int y = y0; y <= y1; ++y)
+		{
+			float centerY = (float)y + 0.5f;
+			Vector x = Lanes::Add(Lanes::Broadcast((float)xStart), offsets);
+			Vector centerX = Lanes::Add(x, Lanes::Broadcast(0.5f));
+
+			Vector edges[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				edges[i] = Lanes::Add(Lanes::Mul(edgeA[i], centerX),
+					Lanes::Broadcast(triangle.EdgeB[i] * centerY + triangle.EdgeC[i]));
+			}
+			Vector z = Lanes::Add(Lanes::Mul(zx, centerX), Lanes::Broadcast(triangle.ZY * centerY + triangle.Z0));
+
+			float* row = depth + (std::size_t)y * stride;
+			for (int px = xStart; px <= x1; px += Lanes::Width)
+			{
+				Lanes::Mask covered = Lanes::And(Lanes::And(Lanes::GreaterEqual(edges[0], zero), Lanes::GreaterEqual(edges[1], zero)),
+					Lanes::GreaterEqual(edges[2], zero));
+				covered = Lanes::And(covered, Lanes::And(Lanes::GreaterEqual(x, first), Lanes::GreaterEqual(last, x)));
+
+				if (Lanes::Any(covered))
+				{
+					Vector stored = Lanes::Load(row + px);
+					Vector nearest = Lanes::Min(stored, Lanes::Min(z, zMax));
+					Lanes::Store(row + px, Lanes::Select(covered, nearest, stored));
+				}
+
+				for (int i = 0; i < 3; ++i)
+					edges[i] = Lanes::Add(edges[i], edgeStep[i]);
+				z = Lanes::Add(z, zStep);
+				x = Lanes::Add(x, step);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+	for (std::size_t l = 1; l < mLevels.size(); ++l)
+	{
+		const Level& source = mLevels[l - 1];
+		Level& target = mLevels[l];
+		for (uint32 y = 0; y < target.Height; ++y)
+		{
+			uint32 sy0 = y * 2;
+			uint32 sy1 = std::min(sy0 + 1, source.Height - 1);
+			for (uint32 x = 0; x < target.Width; ++x)
+			{
+				uint32 sx0 = x * 2;
+				uint32 sx1 = std::min(sx0 + 1, source.Width - 1);
+				float farthest = std::max(
+					std::max(source.Depth[sy0 * source.Width + sx0], source.Depth[sy0 * source.Width + sx1]),
+					std::max(source.Depth[sy1 * source.Width + sx0], source.Depth[sy1 * source.Width + sx1]));
+				target.Depth[y * target.Width + x] = farthest;
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::TestBox(const float center[3], const float extents[3]) const
+{
+	if (!mRasterized)
+		return true;
+
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1.0f;
+	for (int i = 0; i < 8; ++i)
+	{
+		float corner[3], clip[4];
+		for (int k = 0; k < 3; ++k)
+			corner[k] = center[k] + ((i >> k) & 1 ? extents[k] : -extents[k]);
+		TransformPoint(corner, mViewProjection, clip);
+
+		// Boxes reaching the near plane are kept.
+		if (clip[2] < 0.0f || clip[3] <= 0.0f)
+			return true;
+
+		float inverseW = 1.0f / clip[3];
+		float x = (clip[0] * inverseW * 0.5f + 0.5f) * (float)mDesc.Width;
+		float y = (0.5f - clip[1] * inverseW * 0.5f) * (float)mDesc.Height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip[2] * inverseW);
+	}
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)mDesc.Width || minY >= (float)mDesc.Height)
+		return false;
+
+	uint32 x0 = (uint32)std::max(0.0f, std::floor(minX));
+	uint32 y0 = (uint32)std::max(0.0f, std::floor(minY));
+	uint32 x1 = (uint32)std::min((float)mDesc.Width - 1.0f, std::floor(maxX));
+	uint32 y1 = (uint32)std::min((float)mDesc.Height - 1.0f, std::floor(maxY));
+
+	// The coarsest level where the rectangle spans at most 2x2 texels.
+	uint32 level = 0;
+	while (level + 1 < (uint32)mLevels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		++level;
+
+	const Level& texels = mLevels[level];
+	for (uint32 y = y0 >> level; y <= y1 >> level; ++y)
+	{
+		for (uint32 x = x0 >> level; x <= x1 >> level; ++x)
+		{
+			if (minZ <= texels.Depth[y * texels.Width + x])
+				return true;
+		}
+	}
+	return false;
+}
+
+std::size_t OcclusionCuller::TestBoxes(const BoundsBatch& boxes, std::uint8_t* visible) const
+{
+	std::size_t visibleCount = 0;
+	for (std::size_t i = 0; i < boxes.Size(); ++i)
+	{
+		if (!visible[i])
+			continue;
+
+		const float center[3] = { boxes.CenterX()[i], boxes.CenterY()[i], boxes.CenterZ()[i] };
+		const float extents[3] = { boxes.ExtentX()[i], boxes.ExtentY()[i], boxes.ExtentZ()[i] };
+		visible[i] = TestBox(center, extents) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+const float* OcclusionCuller::GetLevel(uint32 level, uint32& width, uint32& height) const
+{
+	width = mLevels[level].Width;
+	height = mLevels[level].Height;
+	return mLevels[level].Depth.data();
+}
+
+OcclusionBenchmark OcclusionCuller::Measure(const OcclusionCullerDesc& desc, uint32 occluderCount, uint32 testCount, uint32 iterations)
+{
+	OcclusionCuller culler(desc);
+
+	// Camera at the origin looking down +z, 60 degree vertical field of view.
+	float aspect = (float)culler.GetWidth() / (float)culler.GetHeight();
+	float nearZ = 0.5f, farZ = 200.0f;
+	float yScale = 1.0f / std::tan(0.5f * 1.04719755f);
+	float projection[16] =
+	{
+		yScale / aspect, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, farZ / (farZ - nearZ), 1.0f,
+		0.0f, 0.0f, -nearZ * farZ / (farZ - nearZ), 0.0f,
+	};
+	const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	// Wall-like occluders in front of a field of small boxes.
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<float> occluders((std::size_t)occluderCount * 6);
+	for (uint32 i = 0; i < occluderCount; ++i)
+	{
+		float* box = &occluders[i * 6];
+		box[2] = 10.0f + 20.0f * unit(random);
+		box[0] = (unit(random) * 2.0f - 1.0f) * box[2] * 0.8f;
+		box[1] = (unit(random) * 2.0f - 1.0f) * box[2] * 0.5f;
+		box[3] = 1.0f + 3.0f * unit(random);
+		box[4] = 1.0f + 3.0f * unit(random);
+		box[5] = 0.25f;
+	}
+
+	BoundsBatch tests;
+	tests.Resize(testCount);
+	for (uint32 i = 0; i < testCount; ++i)
+	{
+		float z = 30.0f + 100.0f * unit(random);
+		const float center[3] = { (unit(random) * 2.0f - 1.0f) * z * 0.8f, (unit(random) * 2.0f - 1.0f) * z * 0.5f, z };
+		const float extents[3] = { 0.5f, 0.5f, 0.5f };
+		tests.Set(i, center, extents);
+	}
+	std::vector<std::uint8_t> visible(testCount);
+
+	using Clock = std::chrono::steady_clock;
+	OcclusionBenchmark result;
+	result.RasterMilliseconds = 1e30;
+	result.TestMilliseconds = 1e30;
+	for (uint32 iteration = 0; iteration < std::max<uint32>(1, iterations); ++iteration)
+	{
+		auto start = Clock::now();
+		culler.BeginFrame(projection);
+		for (uint32 i = 0; i < occluderCount; ++i)
+			culler.AddOccluderBox(&occluders[i * 6], &occluders[i * 6 + 3], identity);
+		culler.Rasterize();
+		auto rasterized = Clock::now();
+
+		std::fill(visible.begin(), visible.end(), (std::uint8_t)1);
+		std::size_t visibleCount = culler.TestBoxes(tests, visible.data());
+		auto tested = Clock::now();
+
+		result.RasterMilliseconds = std::min(result.RasterMilliseconds,
+			std::chrono::duration<double, std::milli>(rasterized - start).count());
+		result.TestMilliseconds = std::min(result.TestMilliseconds,
+			std::chrono::duration<double, std::milli>(tested - rasterized).count());
+		result.Triangles = culler.GetTriangleCount();
+		result.Tested = testCount;
+		result.Occluded = testCount - visibleCount;
+	}
+	return result;
+}
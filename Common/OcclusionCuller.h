@@ -0,0 +1,171 @@
+//***************************************************************************************
+// OcclusionCuller.h
+//
+// Software occlusion culling against a small CPU depth buffer.
+//
+// Large occluders are transformed, clipped against the near plane and binned into
+// square screen tiles; Rasterize() then hands the tiles to a pool of threads, each
+// rasterizing its triangles eight pixels at a time with AVX2 (four with SSE2) into
+// its own region of the depth buffer, so no locking is needed while drawing.  A
+// hierarchical Z pyramid of the farthest depth per 2x2 block is built on top, and a
+// box is reported hidden when the nearest point of its screen rectangle lies behind
+// every texel of the coarsest level that covers the rectangle with at most 2x2 texels.
+//
+// Depth follows Direct3D: z / w in [0, 1] with 0 at the near plane, and occluder
+// faces are clockwise on screen.  Each covered pixel stores the farthest depth of its
+// triangle over the pixel, so the buffer never claims more occlusion than the
+// occluders give.  Measure() times the rasterization and the tests on a generated
+// scene, which is what HeadlessRunner --bench reports.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrustumCuller.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct OcclusionCullerDesc
+{
+	std::uint32_t Width = 256;      ///< Depth buffer size in pixels, multiples of TileSize
+	std::uint32_t Height = 128;
+	std::uint32_t TileSize = 32;    ///< Side of the tiles handed to the threads, a multiple of 8
+	unsigned WorkerCount = 0;       ///< Threads helping the caller rasterize, 0 for one per extra hardware thread
+};
+
+/**
+ * @brief Timings of Measure() on a generated scene
+ */
+struct OcclusionBenchmark
+{
+	double RasterMilliseconds = 0.0;  ///< BeginFrame(), every AddOccluderBox() and Rasterize()
+	double TestMilliseconds = 0.0;    ///< TestBoxes() over every test box
+	std::size_t Triangles = 0;        ///< Occluder triangles binned
+	std::size_t Tested = 0;           ///< Boxes tested
+	std::size_t Occluded = 0;         ///< Boxes reported hidden
+};
+
+class OcclusionCuller
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	explicit OcclusionCuller(const OcclusionCullerDesc& desc);
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	/**
+	 * @brief Pixels rasterized per instruction: 8, 4 or 1
+	 */
+	static int GetSimdWidth();
+
+	/**
+	 * @brief Drops the occluders of the last frame
+	 * @param viewProjection 4x4 row-major matrix mapping world points (row vectors) to clip space
+	 */
+	void BeginFrame(const float viewProjection[16]);
+
+	/**
+	 * @brief Bins the front faces of a triangle mesh
+	 * @param positions Three floats per vertex, in object space
+	 * @param world 4x4 row-major object to world matrix
+	 */
+	void AddOccluder(const float* positions, uint32 vertexCount, const uint32* indices, uint32 indexCount, const float world[16]);
+
+	/**
+	 * @brief Bins the front faces of a solid box
+	 * @param center Object space centre of the box
+	 * @param extents Object space half size of the box
+	 * @param world 4x4 row-major object to world matrix
+	 */
+	void AddOccluderBox(const float center[3], const float extents[3], const float world[16]);
+
+	/**
+	 * @brief Draws the binned occluders and builds the depth pyramid
+	 */
+	void Rasterize();
+
+	/**
+	 * @brief Tests a world space box against the depth pyramid
+	 * @return False if the box is hidden or off screen
+	 */
+	bool TestBox(const float center[3], const float extents[3]) const;
+
+	/**
+	 * @brief Tests the boxes of a batch that are still flagged visible
+	 * @param visible In: 1 for each box to test.  Out: cleared for each hidden box
+	 * @return Number of boxes left visible
+	 */
+	std::size_t TestBoxes(const BoundsBatch& boxes, std::uint8_t* visible) const;
+
+	uint32 GetWidth() const { return mDesc.Width; }
+	uint32 GetHeight() const { return mDesc.Height; }
+	std::size_t GetTriangleCount() const { return mTriangles.size(); }  ///< Triangles binned this frame
+
+	uint32 GetLevelCount() const { return (uint32)mLevels.size(); }
+
+	/**
+	 * @brief Depth pyramid level, 0 being the depth buffer itself
+	 */
+	const float* GetLevel(uint32 level, uint32& width, uint32& height) const;
+
+	/**
+	 * @brief Rasterizes randomly placed occluder boxes and tests smaller boxes behind them
+	 * @param iterations Runs; the fastest run is reported
+	 */
+	static OcclusionBenchmark Measure(const OcclusionCullerDesc& desc, uint32 occluderCount, uint32 testCount, uint32 iterations);
+
+private:
+
+	/**
+	 * @brief Screen space triangle with its depth plane z = ZX * x + ZY * y + Z0
+	 */
+	struct Triangle
+	{
+		float EdgeA[3], EdgeB[3], EdgeC[3];  // Edge functions, positive inside
+		float ZX, ZY, Z0, ZMax;
+		int MinX, MinY, MaxX, MaxY;          // Inclusive pixel bounds
+	};
+
+	struct Level
+	{
+		uint32 Width = 0;
+		uint32 Height = 0;
+		std::vector<float> Depth;
+	};
+
+	void AddTriangle(const float* a, const float* b, const float* c);
+	void SetupTriangle(const float* a, const float* b, const float* c);
+	void RasterizeTile(uint32 tile);
+	void RunTiles();
+	void BuildPyramid();
+	void WorkerMain();
+
+	OcclusionCullerDesc mDesc;
+	uint32 mTilesX = 0;
+	uint32 mTilesY = 0;
+	float mViewProjection[16] = {};
+
+	bool mRasterized = false;                    // Rasterize() ran since BeginFrame()
+
+	std::vector<float> mClipVertices;            // Scratch of AddOccluder()
+	std::vector<Triangle> mTriangles;
+	std::vector<std::vector<uint32>> mTileBins;  // Triangles overlapping each tile
+	std::vector<Level> mLevels;                  // mLevels[0].Depth is the depth buffer
+
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::condition_variable mWorkDone;
+	std::uint64_t mGeneration = 0;               // Bumped by every Rasterize()
+	unsigned mBusyWorkers = 0;
+	bool mStopping = false;
+	std::atomic<uint32> mNextTile{ 0 };
+	std::vector<std::thread> mWorkers;
+};
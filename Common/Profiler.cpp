@@ -0,0 +1,232 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+const std::size_t Profiler::RingCapacity;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Zones of one thread; only that thread writes, any thread may copy
+	 */
+	struct Ring
+	{
+		std::unique_ptr<ProfileEvent[]> Events{ new ProfileEvent[Profiler::RingCapacity] };
+		std::atomic<std::uint64_t> Head{ 0 };  // Zones ever written, the next goes to Head % RingCapacity
+		std::string Name;                      // Guarded by Registry::Mutex
+		std::uint32_t Index = 0;
+	};
+
+	struct Registry
+	{
+		std::mutex Mutex;                          // Taken when a thread registers, never while recording
+		std::vector<std::unique_ptr<Ring>> Rings;  // Kept after their thread exits
+		std::atomic<bool> Enabled{ false };
+		std::atomic<std::uint64_t> ClearTime{ 0 }; // Zones starting earlier are left out of captures
+		Clock::time_point Epoch = Clock::now();
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local Ring* tRing = nullptr;
+	thread_local std::uint32_t tDepth = 0;
+
+	Ring& GetThreadRing()
+	{
+		if (tRing == nullptr)
+		{
+			Registry& registry = GetRegistry();
+			auto ring = std::make_unique<Ring>();
+
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+			ring->Index = (std::uint32_t)registry.Rings.size();
+			ring->Name = "Thread " + std::to_string(ring->Index);
+			tRing = ring.get();
+			registry.Rings.push_back(std::move(ring));
+		}
+		return *tRing;
+	}
+
+	void WriteJsonString(std::ostream& out, const std::string& text)
+	{
+		out << '"';
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				out << '\\' << c;
+			else if ((unsigned char)c < 0x20)
+				out << ' ';
+			else
+				out << c;
+		}
+		out << '"';
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	GetRegistry().Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+	return GetRegistry().Enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	Ring& ring = GetThreadRing();
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	ring.Name = name;
+}
+
+std::uint64_t Profiler::Now()
+{
+	return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - GetRegistry().Epoch).count();
+}
+
+void Profiler::Record(const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth)
+{
+	Ring& ring = GetThreadRing();
+	std::uint64_t head = ring.Head.load(std::memory_order_relaxed);
+
+	ProfileEvent& event = ring.Events[head & (RingCapacity - 1)];
+	event.Name = name;
+	event.Start = start;
+	event.End = end;
+	event.Depth = depth;
+	event.Thread = ring.Index;
+
+	// Publishes the slot to Capture().
+	ring.Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Clear()
+{
+	GetRegistry().ClearTime.store(Now(), std::memory_order_relaxed);
+}
+
+void Profiler::Capture(std::vector<ProfileEvent>& events)
+{
+	Registry& registry = GetRegistry();
+	std::uint64_t clearTime = registry.ClearTime.load(std::memory_order_relaxed);
+	events.clear();
+
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	for (const auto& ring : registry.Rings)
+	{
+		std::uint64_t head = ring->Head.load(std::memory_order_acquire);
+		std::uint64_t first = head > RingCapacity ? head - RingCapacity : 0;
+
+		std::size_t begin = events.size();
+		for (std::uint64_t i = first; i < head; ++i)
+			events.push_back(ring->Events[i & (RingCapacity - 1)]);
+
+		// The owner kept recording during the copy; slots it wrapped around to may
+		// have been overwritten half way, so they are dropped.  Record() fills slot
+		// Head before publishing Head + 1, so the slot of event after - RingCapacity
+		// may be mid-write as well.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		std::uint64_t after = ring->Head.load(std::memory_order_relaxed);
+		std::uint64_t reused = after + 1 > RingCapacity ? after + 1 - RingCapacity : 0;
+		if (reused > first)
+		{
+			std::uint64_t torn = std::min(reused, head) - first;
+			events.erase(events.begin() + begin, events.begin() + begin + (std::size_t)torn);
+		}
+
+		auto stale = std::remove_if(events.begin() + begin, events.end(),
+			[clearTime](const ProfileEvent& event) { return event.Start < clearTime; });
+		events.erase(stale, events.end());
+
+		// Zones are written as they close, so nested zones come before their parent.
+		std::stable_sort(events.begin() + begin, events.end(),
+			[](const ProfileEvent& a, const ProfileEvent& b) { return a.Start < b.Start; });
+	}
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out)
+{
+	std::vector<ProfileEvent> events;
+	Capture(events);
+
+	std::vector<std::string> threadNames;
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		for (const auto& ring : registry.Rings)
+			threadNames.push_back(ring->Name);
+	}
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (std::size_t thread = 0; thread < threadNames.size(); ++thread)
+	{
+		out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+			<< ",\"args\":{\"name\":";
+		WriteJsonString(out, threadNames[thread]);
+		out << "}}";
+		first = false;
+	}
+
+	// Complete events, times in microseconds.
+	char times[64];
+	for (const ProfileEvent& event : events)
+	{
+		std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+			event.Start / 1000.0, (event.End - event.Start) / 1000.0);
+		out << (first ? "\n" : ",\n") << "{\"name\":";
+		WriteJsonString(out, event.Name);
+		out << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.Thread << ',' << times
+			<< ",\"args\":{\"depth\":" << event.Depth << "}}";
+		first = false;
+	}
+	out << "\n]}\n";
+}
+
+bool Profiler::SaveChromeTrace(const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	WriteChromeTrace(file);
+	return (bool)file;
+}
+
+ProfileScope::ProfileScope(const char* name)
+	: mName(name)
+	, mStart(0)
+	, mDepth(0)
+	, mActive(Profiler::IsEnabled())
+{
+	if (mActive)
+	{
+		mDepth = tDepth++;
+		mStart = Profiler::Now();
+	}
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (mActive)
+	{
+		std::uint64_t end = Profiler::Now();
+		--tDepth;
+		Profiler::Record(mName, mStart, end, mDepth);
+	}
+}
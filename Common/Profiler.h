@@ -0,0 +1,114 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Hierarchical CPU profiler.  PROFILE_SCOPE("Name") times the enclosing block; when
+// the block ends the zone is written to a ring buffer owned by the calling thread,
+// so recording takes no lock and threads never contend.  Rings keep the most recent
+// RingCapacity zones of their thread and are registered once, the first time the
+// thread records.  Zones nest: each remembers how many zones were open on its thread
+// when it began.
+//
+// Capture() copies the rings while threads keep recording, and WriteChromeTrace()
+// writes them as Chrome trace event JSON for chrome://tracing or ui.perfetto.dev.
+// Zone names must outlive the profiler; string literals are the intended use.
+// Defining PROFILER_DISABLED compiles the scopes out.  The code has no Windows or
+// Direct3D dependency.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One timed zone
+ */
+struct ProfileEvent
+{
+	const char* Name = nullptr;   ///< Name given to the scope
+	std::uint64_t Start = 0;      ///< Nanoseconds since the profiler started
+	std::uint64_t End = 0;
+	std::uint32_t Depth = 0;      ///< Zones already open on the thread when this one began
+	std::uint32_t Thread = 0;     ///< Index of the recording thread, in registration order
+};
+
+class Profiler
+{
+public:
+
+	static const std::size_t RingCapacity = 1 << 17;  ///< Zones kept per thread, a power of two
+
+	/**
+	 * @brief Starts or stops recording; scopes opened while disabled are not recorded
+	 */
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	/**
+	 * @brief Names the calling thread in captures
+	 */
+	static void SetThreadName(const char* name);
+
+	/**
+	 * @brief Nanoseconds since the profiler started, on a monotonic clock
+	 */
+	static std::uint64_t Now();
+
+	/**
+	 * @brief Writes a zone to the ring of the calling thread
+	 */
+	static void Record(const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth);
+
+	/**
+	 * @brief Drops every zone recorded so far from later captures
+	 */
+	static void Clear();
+
+	/**
+	 * @brief Copies the zones held by every ring
+	 * @param[out] events Zones ordered by thread, then start time
+	 */
+	static void Capture(std::vector<ProfileEvent>& events);
+
+	/**
+	 * @brief Writes a capture as Chrome trace event JSON
+	 */
+	static void WriteChromeTrace(std::ostream& out);
+
+	/**
+	 * @brief Writes a capture to a file
+	 * @return False if the file could not be written
+	 */
+	static bool SaveChromeTrace(const std::string& path);
+};
+
+/**
+ * @brief Records the time between its construction and destruction
+ */
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* mName;
+	std::uint64_t mStart;
+	std::uint32_t mDepth;
+	bool mActive;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if defined(PROFILER_DISABLED)
+#define PROFILE_SCOPE(name) ((void)0)
+#else
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
@@ -0,0 +1,166 @@
+//***************************************************************************************
+// RenderThread.cpp
+//***************************************************************************************
+
+#include "RenderThread.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+}
+
+RenderThread::RenderThread(unsigned bufferCount)
+	: mFree(std::max(2u, bufferCount), true)
+{
+}
+
+RenderThread::~RenderThread()
+{
+	Stop();
+}
+
+void RenderThread::Start(std::function<void(unsigned buffer)> render, bool threaded)
+{
+	Stop();
+	mRender = std::move(render);
+	mStopping = false;
+	mRenderError = nullptr;
+	if (threaded)
+		mThread = std::thread(&RenderThread::Run, this);
+}
+
+void RenderThread::Stop()
+{
+	if (!mThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWorkReady.notify_one();
+	mThread.join();
+}
+
+unsigned RenderThread::BeginFrame()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	RethrowRenderError();
+
+	auto firstFree = [this]() { return std::find(mFree.begin(), mFree.end(), true); };
+	if (firstFree() == mFree.end())
+	{
+		PROFILE_SCOPE("RenderThread::BeginFrame wait");
+		Clock::time_point start = Clock::now();
+		mWorkDone.wait(lock, [&]() { return firstFree() != mFree.end() || mRenderError != nullptr; });
+		mStallSeconds += SecondsSince(start);
+		RethrowRenderError();
+	}
+
+	auto buffer = firstFree();
+	*buffer = false;
+	return (unsigned)(buffer - mFree.begin());
+}
+
+void RenderThread::EndFrame(unsigned buffer)
+{
+	if (!mThread.joinable())
+	{
+		try
+		{
+			mRender(buffer);
+		}
+		catch (...)
+		{
+			mFree[buffer] = true;
+			throw;
+		}
+		mFree[buffer] = true;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mRenderError != nullptr)
+		{
+			// The worker has stopped; the frame is dropped and BeginFrame() reports why.
+			mFree[buffer] = true;
+			return;
+		}
+		mQueue.push_back(buffer);
+	}
+	mWorkReady.notify_one();
+}
+
+void RenderThread::Flush()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!mQueue.empty() || mRendering)
+	{
+		PROFILE_SCOPE("RenderThread::Flush");
+		Clock::time_point start = Clock::now();
+		mWorkDone.wait(lock, [this]() { return (mQueue.empty() && !mRendering) || mRenderError != nullptr; });
+		mStallSeconds += SecondsSince(start);
+	}
+	RethrowRenderError();
+}
+
+double RenderThread::GetStallSeconds() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStallSeconds;
+}
+
+void RenderThread::Run()
+{
+	Profiler::SetThreadName("Render");
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWorkReady.wait(lock, [this]() { return !mQueue.empty() || mStopping; });
+		if (mQueue.empty())
+			return;
+
+		unsigned buffer = mQueue.front();
+		mQueue.pop_front();
+		mRendering = true;
+
+		lock.unlock();
+		try
+		{
+			mRender(buffer);
+		}
+		catch (...)
+		{
+			// The frames still queued are dropped.  The error stays set, so every later
+			// BeginFrame() and Flush() throws it until the thread is started again.
+			lock.lock();
+			mRenderError = std::current_exception();
+			mQueue.clear();
+			std::fill(mFree.begin(), mFree.end(), true);
+			mRendering = false;
+			mWorkDone.notify_all();
+			return;
+		}
+		lock.lock();
+
+		mFree[buffer] = true;
+		mRendering = false;
+		mWorkDone.notify_all();
+	}
+}
+
+void RenderThread::RethrowRenderError()
+{
+	if (mRenderError != nullptr)
+		std::rethrow_exception(mRenderError);
+}
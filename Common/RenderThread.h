@@ -0,0 +1,96 @@
+//***************************************************************************************
+// RenderThread.h
+//
+// Pipelines rendering behind the simulation.  The simulation fills one of a small
+// ring of snapshot buffers with everything a frame needs to be drawn and hands it
+// over; a worker thread records and submits that frame while the simulation moves
+// on to the next one.  With two buffers the simulation of frame N + 1 overlaps the
+// recording of frame N; a third lets the simulation run one more frame ahead.
+//
+// The class only hands out buffer indices; the caller owns the snapshots, indexed
+// by them.  Started without a worker, it renders each frame on the calling thread as
+// it is handed over, the same order of work without the overlap.  An exception
+// thrown while rendering stops the worker and is rethrown on the simulation thread
+// by every later BeginFrame() and Flush().
+//***************************************************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RenderThread
+{
+public:
+
+	/**
+	 * @param bufferCount Snapshot buffers in the ring, at least 2
+	 */
+	explicit RenderThread(unsigned bufferCount = 2);
+	~RenderThread();
+
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+
+	/**
+	 * @brief Sets the function that renders a frame and starts the worker
+	 * @param render Called with the index of each buffer handed over
+	 * @param threaded False renders on the thread calling EndFrame() instead
+	 */
+	void Start(std::function<void(unsigned buffer)> render, bool threaded = true);
+
+	/**
+	 * @brief Renders the frames already handed over, then joins the worker
+	 */
+	void Stop();
+
+	bool IsThreaded() const { return mThread.joinable(); }
+	unsigned GetBufferCount() const { return (unsigned)mFree.size(); }
+
+	/**
+	 * @brief Gets a buffer the worker is not reading, waiting for one if needed
+	 * @return Index of the buffer to fill for the next frame
+	 */
+	unsigned BeginFrame();
+
+	/**
+	 * @brief Hands a filled buffer to the worker
+	 */
+	void EndFrame(unsigned buffer);
+
+	/**
+	 * @brief Waits until every frame handed over has been rendered
+	 *
+	 * Call before the simulation changes anything the worker reads outside the
+	 * snapshots, such as the frame resources or the swap chain.
+	 */
+	void Flush();
+
+	/**
+	 * @brief Seconds BeginFrame() and Flush() spent waiting on the worker
+	 */
+	double GetStallSeconds() const;
+
+private:
+
+	void Run();
+	void RethrowRenderError();
+
+	std::function<void(unsigned)> mRender;
+	std::thread mThread;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mWorkReady;   // Signalled when a buffer is queued or the worker must stop
+	std::condition_variable mWorkDone;    // Signalled when a buffer is freed
+	std::deque<unsigned> mQueue;          // Handed over, oldest first
+	std::vector<bool> mFree;              // Neither queued, being rendered nor being filled
+	bool mRendering = false;
+	bool mStopping = false;
+	std::exception_ptr mRenderError;
+	double mStallSeconds = 0.0;
+};
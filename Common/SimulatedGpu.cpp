@@ -0,0 +1,108 @@
+//***************************************************************************************
+// SimulatedGpu.cpp
+//***************************************************************************************
+
+#include "SimulatedGpu.h"
+#include "Profiler.h"
+#include <algorithm>
+
+SimulatedGpu::SimulatedGpu()
+	: mThread(&SimulatedGpu::Run, this)
+{
+}
+
+SimulatedGpu::~SimulatedGpu()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mQueued.notify_one();
+	mThread.join();
+}
+
+void SimulatedGpu::Execute(double milliseconds)
+{
+	if (milliseconds <= 0.0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mCommands.push_back({ milliseconds, 0 });
+	}
+	mQueued.notify_one();
+}
+
+std::uint64_t SimulatedGpu::Signal()
+{
+	std::uint64_t value;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		value = ++mLastSignaled;
+		mCommands.push_back({ 0.0, value });
+	}
+	mQueued.notify_one();
+	return value;
+}
+
+std::uint64_t SimulatedGpu::GetCompletedValue() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCompletedValue;
+}
+
+std::uint64_t SimulatedGpu::GetLastSignaledValue() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mLastSignaled;
+}
+
+void SimulatedGpu::Wait(std::uint64_t value)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mCompleted.wait(lock, [&]() { return mCompletedValue >= value; });
+}
+
+double SimulatedGpu::GetBusySeconds() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mBusySeconds;
+}
+
+void SimulatedGpu::Run()
+{
+	Profiler::SetThreadName("Simulated GPU");
+
+	// Work is scheduled on the queue's own timeline, so sleeping late on one batch
+	// does not delay the ones behind it.
+	Clock::time_point busyUntil = Clock::now();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mQueued.wait(lock, [this]() { return !mCommands.empty() || mStopping; });
+		if (mCommands.empty())
+			return;
+
+		Command command = mCommands.front();
+		mCommands.pop_front();
+
+		if (command.Value != 0)
+		{
+			mCompletedValue = command.Value;
+			mCompleted.notify_all();
+			continue;
+		}
+
+		lock.unlock();
+		{
+			PROFILE_SCOPE("SimulatedGpu::Execute");
+			Clock::duration work = std::chrono::duration_cast<Clock::duration>(
+				std::chrono::duration<double, std::milli>(command.Milliseconds));
+			busyUntil = std::max(busyUntil, Clock::now()) + work;
+			std::this_thread::sleep_until(busyUntil);
+		}
+		lock.lock();
+		mBusySeconds += command.Milliseconds / 1000.0;
+	}
+}
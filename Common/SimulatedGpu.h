@@ -0,0 +1,65 @@
+//***************************************************************************************
+// SimulatedGpu.h
+//
+// A GPU queue without a GPU, for pacing code run headless.  Work is queued as a
+// duration and executed in submission order on a thread of its own, so the queue
+// runs behind the CPU the way a real one does; signals complete once the work queued
+// before them has run.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrameScheduler.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class SimulatedGpu : public FrameFence
+{
+public:
+
+	SimulatedGpu();
+	~SimulatedGpu();
+
+	SimulatedGpu(const SimulatedGpu&) = delete;
+	SimulatedGpu& operator=(const SimulatedGpu&) = delete;
+
+	/**
+	 * @brief Queues work that keeps the GPU busy for a while
+	 */
+	void Execute(double milliseconds);
+
+	std::uint64_t Signal() override;
+	std::uint64_t GetCompletedValue() const override;
+	std::uint64_t GetLastSignaledValue() const override;
+	void Wait(std::uint64_t value) override;
+
+	/**
+	 * @brief Seconds of work executed so far
+	 */
+	double GetBusySeconds() const;
+
+private:
+
+	using Clock = std::chrono::steady_clock;
+
+	struct Command
+	{
+		double Milliseconds;   // Work, or 0 for a signal
+		std::uint64_t Value;   // Fence value to signal, or 0 for work
+	};
+
+	void Run();
+
+	mutable std::mutex mMutex;
+	std::condition_variable mQueued;      // Signalled when a command is queued or the thread must stop
+	std::condition_variable mCompleted;   // Signalled when the fence advances
+	std::deque<Command> mCommands;
+	std::uint64_t mLastSignaled = 0;
+	std::uint64_t mCompletedValue = 0;
+	double mBusySeconds = 0.0;
+	bool mStopping = false;
+	std::thread mThread;
+};
@@ -0,0 +1,157 @@
+//***************************************************************************************
+// StagingUploader.cpp
+//***************************************************************************************
+
+#include "StagingUploader.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+StagingUploader::StagingUploader(ID3D12Device* device, UINT64 capacity)
+	: mDevice(device)
+	, mCapacity(AlignUp(capacity, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT))
+{
+	auto upload = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto buffer = CD3DX12_RESOURCE_DESC::Buffer(mCapacity);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&upload,
+		D3D12_HEAP_FLAG_NONE,
+		&buffer,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mRing)));
+	mUploadResourceCount++;
+
+	// The ring stays mapped; Allocate() never hands out memory the GPU may still read.
+	ThrowIfFailed(mRing->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+}
+
+StagingUploader::~StagingUploader()
+{
+	if (mRing != nullptr)
+		mRing->Unmap(0, nullptr);
+
+	mMappedData = nullptr;
+}
+
+bool StagingUploader::CopyBuffer(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dest, UINT64 destOffset,
+	const void* data, UINT64 byteSize, bool dedicatedIfFull)
+{
+	ID3D12Resource* staging = nullptr;
+	UINT64 offset = 0;
+	if (!Allocate(byteSize, 16, dedicatedIfFull, staging, offset))
+		return false;
+
+	if (staging == mRing.Get())
+	{
+		memcpy(mMappedData + offset, data, (size_t)byteSize);
+	}
+	else
+	{
+		BYTE* mapped = nullptr;
+		ThrowIfFailed(staging->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+		memcpy(mapped + offset, data, (size_t)byteSize);
+		staging->Unmap(0, nullptr);
+	}
+
+	cmdList->CopyBufferRegion(dest, destOffset, staging, offset, byteSize);
+	mBytesStaged += byteSize;
+	return true;
+}
+
+bool StagingUploader::CopyTexture(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dest,
+	UINT firstSubresource, UINT numSubresources, D3D12_SUBRESOURCE_DATA* data, bool dedicatedIfFull)
+{
+	D3D12_RESOURCE_DESC desc = dest->GetDesc();
+	UINT64 requiredSize = 0;
+	mDevice->GetCopyableFootprints(&desc, firstSubresource, numSubresources, 0, nullptr, nullptr, nullptr, &requiredSize);
+
+	ID3D12Resource* staging = nullptr;
+	UINT64 offset = 0;
+	if (!Allocate(requiredSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, dedicatedIfFull, staging, offset))
+		return false;
+
+	// Lays the rows out with the pitch the copy engine needs and records one copy per subresource.
+	if (UpdateSubresources(cmdList, dest, staging, offset, firstSubresource, numSubresources, data) == 0)
+		throw DxException(E_FAIL, L"UpdateSubresources", AnsiToWString(__FILE__), __LINE__);
+
+	mBytesStaged += requiredSize;
+	return true;
+}
+
+void StagingUploader::FinishBatch(UINT64 fence)
+{
+	if (mRingHead == mBatchStart && mDedicated.empty())
+		return;
+
+	mBatches.push_back({ fence, mRingHead, std::move(mDedicated) });
+	mDedicated.clear();
+	mBatchStart = mRingHead;
+}
+
+void StagingUploader::ReleaseCompletedBatches(UINT64 completedFence)
+{
+	while (!mBatches.empty() && mBatches.front().Fence <= completedFence)
+	{
+		mRingTail = mBatches.front().RingHead;
+		mBatches.pop_front();
+	}
+}
+
+bool StagingUploader::Allocate(UINT64 byteSize, UINT64 alignment, bool dedicatedIfFull, ID3D12Resource*& resource, UINT64& offset)
+{
+	if (byteSize > mCapacity)
+	{
+		AllocateDedicated(byteSize, resource, offset);
+		return true;
+	}
+
+	// Copies read a contiguous range, so a request that would straddle the end of
+	// the ring starts over at the beginning. The capacity is a multiple of every
+	// alignment used here, so the wrapped position stays aligned.
+	UINT64 start = AlignUp(mRingHead, alignment);
+	if (start % mCapacity + byteSize > mCapacity)
+		start = AlignUp(start, mCapacity);
+
+	if (start + byteSize - mRingTail > mCapacity)
+	{
+		if (!dedicatedIfFull)
+			return false;
+
+		AllocateDedicated(byteSize, resource, offset);
+		return true;
+	}
+
+	mRingHead = start + byteSize;
+	mHighWaterMark = MathHelper::Max(mHighWaterMark, mRingHead - mRingTail);
+
+	resource = mRing.Get();
+	offset = start % mCapacity;
+	return true;
+}
+
+void StagingUploader::AllocateDedicated(UINT64 byteSize, ID3D12Resource*& resource, UINT64& offset)
+{
+	ComPtr<ID3D12Resource> dedicated;
+	auto upload = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto buffer = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&upload,
+		D3D12_HEAP_FLAG_NONE,
+		&buffer,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&dedicated)));
+	mUploadResourceCount++;
+
+	resource = dedicated.Get();
+	offset = 0;
+	mDedicated.push_back(dedicated);
+}
@@ -0,0 +1,115 @@
+//***************************************************************************************
+// StagingUploader.h
+//
+// One persistently mapped upload heap used as a ring by every initial upload.  Buffer
+// and texture copies are recorded on the caller's command list; the caller submits them
+// as a single batch and passes the batch's fence value to FinishBatch().  The staging
+// memory of a batch is reused once ReleaseCompletedBatches() sees that fence complete.
+//
+// Requests larger than the whole ring get a dedicated upload buffer that is released
+// with the batch, so the ring itself never grows.  So do requests that find the ring
+// full when the caller asks for it, because it cannot submit and wait right away.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <deque>
+
+class StagingUploader
+{
+public:
+	/**
+	 * @brief Creates and maps the staging ring
+	 * @param device Direct3D 12 device
+	 * @param capacity Size of the ring in bytes, rounded up to the texture placement alignment
+	 */
+	StagingUploader(ID3D12Device* device, UINT64 capacity);
+	StagingUploader(const StagingUploader& rhs) = delete;
+	StagingUploader& operator=(const StagingUploader& rhs) = delete;
+	~StagingUploader();
+
+	/**
+	 * @brief Stages data and records a copy into a buffer
+	 *
+	 * The destination must be in the COPY_DEST state when the copy executes.
+	 * @param dedicatedIfFull Stage into a dedicated upload buffer rather than fail when the ring is full
+	 * @return False if the ring is full; submit and wait for pending batches, then retry
+	 */
+	bool CopyBuffer(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dest, UINT64 destOffset,
+		const void* data, UINT64 byteSize, bool dedicatedIfFull = false);
+
+	/**
+	 * @brief Stages subresources and records the copies into a texture
+	 *
+	 * The destination must be in the COPY_DEST state when the copies execute.
+	 * @param dedicatedIfFull Stage into a dedicated upload buffer rather than fail when the ring is full
+	 * @return False if the ring is full; submit and wait for pending batches, then retry
+	 */
+	bool CopyTexture(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dest,
+		UINT firstSubresource, UINT numSubresources, D3D12_SUBRESOURCE_DATA* data, bool dedicatedIfFull = false);
+
+	/**
+	 * @brief Closes the batch of copies recorded since the previous call
+	 * @param fence Fence value signalled after the batch's command list
+	 */
+	void FinishBatch(UINT64 fence);
+
+	/**
+	 * @brief Reclaims the staging memory of every batch the GPU has finished
+	 * @param completedFence Last fence value reached by the GPU
+	 */
+	void ReleaseCompletedBatches(UINT64 completedFence);
+
+	bool HasPendingBatches() const { return !mBatches.empty() || mRingHead != mBatchStart; }
+
+	UINT64 GetCapacity() const { return mCapacity; }
+	UINT64 GetUsed() const { return mRingHead - mRingTail; }  ///< Staged bytes not yet reclaimed
+	UINT64 GetHighWaterMark() const { return mHighWaterMark; }  ///< Most ring bytes in use at once
+	UINT64 GetBytesStaged() const { return mBytesStaged; }  ///< Total bytes copied through the uploader
+	UINT GetUploadResourceCount() const { return mUploadResourceCount; }  ///< Upload heaps created, ring included
+
+private:
+	/**
+	 * @brief Reserves staging memory
+	 * @param byteSize Bytes needed
+	 * @param alignment Power of two no larger than the texture placement alignment
+	 * @param dedicatedIfFull Create a dedicated upload buffer if the ring is full
+	 * @param[out] resource Upload resource holding the memory
+	 * @param[out] offset Offset of the memory inside the resource
+	 * @return False if the ring is full
+	 */
+	bool Allocate(UINT64 byteSize, UINT64 alignment, bool dedicatedIfFull, ID3D12Resource*& resource, UINT64& offset);
+
+	/**
+	 * @brief Creates an upload buffer released with the open batch
+	 */
+	void AllocateDedicated(UINT64 byteSize, ID3D12Resource*& resource, UINT64& offset);
+
+	/**
+	 * @brief Ring position reached by a submitted batch
+	 */
+	struct Batch
+	{
+		UINT64 Fence;
+		UINT64 RingHead;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> Dedicated;
+	};
+
+	ID3D12Device* mDevice = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Resource> mRing;
+	BYTE* mMappedData = nullptr;
+	UINT64 mCapacity = 0;
+
+	// Monotonic byte counters; the ring offset is counter % mCapacity.
+	UINT64 mRingHead = 0;
+	UINT64 mRingTail = 0;
+	UINT64 mBatchStart = 0;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mDedicated;  ///< Oversized uploads of the open batch
+	std::deque<Batch> mBatches;
+
+	UINT64 mHighWaterMark = 0;
+	UINT64 mBytesStaged = 0;
+	UINT mUploadResourceCount = 0;
+};
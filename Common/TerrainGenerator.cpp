@@ -0,0 +1,442 @@
+//***************************************************************************************
+// TerrainGenerator.cpp
+//***************************************************************************************
+
+#include "TerrainGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN_GENERATOR_SSE 1
+#include <emmintrin.h>
+#endif
+
+using uint32 = TerrainGenerator::uint32;
+
+namespace
+{
+	// Grid rows handed to a worker at a time.
+	const uint32 TileRows = 16;
+
+	// pi / 2 split so that j * PiOver2A and j * PiOver2B are exact (Cody-Waite).
+	const float PiOver2A = 1.5703125f;
+	const float PiOver2B = 4.837512969970703125e-4f;
+	const float PiOver2C = 7.54978995489188216e-8f;
+	const float TwoOverPi = 0.636619772367581343f;
+
+	// Minimax polynomials on [-pi/4, pi/4] (Cephes sinf / cosf).
+	const float SinC1 = -1.6666654611e-1f;
+	const float SinC2 = 8.3321608736e-3f;
+	const float SinC3 = -1.9515295891e-4f;
+	const float CosC1 = 4.166664568298827e-2f;
+	const float CosC2 = -1.388731625493765e-3f;
+	const float CosC3 = 2.443315711809948e-5f;
+
+	void SinCosScalar(float angle, float& sine, float& cosine)
+	{
+		// Rounds to nearest even like _mm_cvtps_epi32.
+		int quadrant = (int)std::nearbyint(angle * TwoOverPi);
+		float j = (float)quadrant;
+		float r = ((angle - j * PiOver2A) - j * PiOver2B) - j * PiOver2C;
+		float z = r * r;
+
+		float s = r + r * z * (SinC1 + z * (SinC2 + z * SinC3));
+		float c = (1.0f - 0.5f * z) + z * z * (CosC1 + z * (CosC2 + z * CosC3));
+
+		if (quadrant & 1)
+			std::swap(s, c);
+		sine = (quadrant & 2) ? -s : s;
+		cosine = ((quadrant + 1) & 2) ? -c : c;
+	}
+
+#if TERRAIN_GENERATOR_SSE
+	void SinCos4(__m128 angle, __m128& sine, __m128& cosine)
+	{
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(TwoOverPi)));
+		__m128 j = _mm_cvtepi32_ps(quadrant);
+		__m128 r = _mm_sub_ps(angle, _mm_mul_ps(j, _mm_set1_ps(PiOver2A)));
+		r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PiOver2B)));
+		r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PiOver2C)));
+		__m128 z = _mm_mul_ps(r, r);
+
+		__m128 s = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(SinC3)), _mm_set1_ps(SinC2));
+		s = _mm_add_ps(_mm_mul_ps(z, s), _mm_set1_ps(SinC1));
+		s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), s));
+
+		__m128 c = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(CosC3)), _mm_set1_ps(CosC2));
+		c = _mm_add_ps(_mm_mul_ps(z, c), _mm_set1_ps(CosC1));
+		c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_mul_ps(_mm_mul_ps(z, z), c));
+
+		// Odd quadrants swap sine and cosine; bit 1 of the quadrant flips the sign.
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+		sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+		cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+	}
+#endif
+
+	/**
+	 * @brief Runs fn(first, last) over [0, count) in tiles on several threads
+	 */
+	template<typename Function>
+	void ForEachTile(uint32 count, uint32 tileSize, unsigned threadCount, const Function& fn)
+	{
+		uint32 tileCount = (count + tileSize - 1) / tileSize;
+
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		threadCount = std::min<unsigned>(threadCount, tileCount);
+
+		if (threadCount <= 1)
+		{
+			fn(0u, count);
+			return;
+		}
+
+		std::atomic<uint32> nextTile(0);
+		auto worker = [&]()
+		{
+			for (uint32 tile = nextTile++; tile < tileCount; tile = nextTile++)
+			{
+				uint32 first = tile * tileSize;
+				fn(first, std::min(first + tileSize, count));
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (unsigned i = 1; i < threadCount; ++i)
+			threads.emplace_back(worker);
+
+		worker();
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	float* Attribute(float* base, std::size_t stride, std::size_t vertex)
+	{
+		return reinterpret_cast<float*>(reinterpret_cast<unsigned char*>(base) + stride * vertex);
+	}
+
+	/**
+	 * @brief Per column and per row terms of the separable hills function
+	 */
+	struct HillTables
+	{
+		std::vector<float> X, SinX, CosX, U;  // Padded to a multiple of 4 columns
+		std::vector<float> Z, SinZ, CosZ, V;
+	};
+
+	HillTables BuildHillTables(const HillTerrainDesc& desc)
+	{
+		HillTables tables;
+
+		const uint32 n = desc.Columns;
+		const uint32 m = desc.Rows;
+		const float dx = n > 1 ? desc.Width / (n - 1) : 0.0f;
+		const float dz = m > 1 ? desc.Depth / (m - 1) : 0.0f;
+		const float du = n > 1 ? 1.0f / (n - 1) : 0.0f;
+		const float dv = m > 1 ? 1.0f / (m - 1) : 0.0f;
+
+		const std::size_t paddedColumns = (n + 3) & ~3u;
+		tables.X.resize(paddedColumns);
+		tables.U.resize(paddedColumns);
+		tables.SinX.resize(paddedColumns);
+		tables.CosX.resize(paddedColumns);
+		std::vector<float> angles(std::max<std::size_t>(paddedColumns, m));
+		for (uint32 j = 0; j < paddedColumns; ++j)
+		{
+			float column = (float)((std::int64_t)desc.ColumnOffset + j);
+			tables.X[j] = -0.5f * desc.Width + column * dx;
+			tables.U[j] = column * du;
+			angles[j] = desc.Frequency * tables.X[j];
+		}
+		TerrainGenerator::SinCos(angles.data(), tables.SinX.data(), tables.CosX.data(), paddedColumns);
+
+		tables.Z.resize(m);
+		tables.V.resize(m);
+		tables.SinZ.resize(m);
+		tables.CosZ.resize(m);
+		for (uint32 i = 0; i < m; ++i)
+		{
+			float row = (float)((std::int64_t)desc.RowOffset + i);
+			tables.Z[i] = 0.5f * desc.Depth - row * dz;
+			tables.V[i] = row * dv;
+			angles[i] = desc.Frequency * tables.Z[i];
+		}
+		TerrainGenerator::SinCos(angles.data(), tables.SinZ.data(), tables.CosZ.data(), m);
+
+		return tables;
+	}
+
+	/**
+	 * @brief Height and unnormalized normal (nx, 1, nz) of one vertex
+	 *
+	 * h = A (z sin(fx) + x cos(fz)), so dh/dx = A (f z cos(fx) + cos(fz)) and
+	 * dh/dz = A (sin(fx) - f x sin(fz)).  The SSE path performs the same operations
+	 * in the same order.
+	 */
+	void EvaluateHill(float a, float f, float x, float sinX, float cosX, float z, float sinZ, float cosZ,
+		float& height, float& nx, float& nz, float& inverseLength)
+	{
+		height = a * (z * sinX + x * cosZ);
+		nx = -(a * (f * z * cosX + cosZ));
+		nz = -(a * (sinX - f * x * sinZ));
+		inverseLength = 1.0f / std::sqrt(nx * nx + 1.0f + nz * nz);
+	}
+
+	void WriteVertex(const TerrainVertexLayout& layout, std::size_t vertex,
+		float x, float height, float z, float nx, float nz, float inverseLength, float u, float v)
+	{
+		if (layout.Positions)
+		{
+			float* p = Attribute(layout.Positions, layout.Stride, vertex);
+			p[0] = x; p[1] = height; p[2] = z;
+		}
+		if (layout.Normals)
+		{
+			float* n = Attribute(layout.Normals, layout.Stride, vertex);
+			n[0] = nx * inverseLength; n[1] = inverseLength; n[2] = nz * inverseLength;
+		}
+		if (layout.TexCoords)
+		{
+			float* t = Attribute(layout.TexCoords, layout.Stride, vertex);
+			t[0] = u; t[1] = v;
+		}
+	}
+
+	void GenerateHillRows(const HillTerrainDesc& desc, const HillTables& tables, const TerrainVertexLayout& layout,
+		uint32 firstRow, uint32 lastRow)
+	{
+		const uint32 n = desc.Columns;
+		const float a = desc.Amplitude;
+		const float f = desc.Frequency;
+
+		for (uint32 i = firstRow; i < lastRow; ++i)
+		{
+			const float z = tables.Z[i];
+			const float sinZ = tables.SinZ[i];
+			const float cosZ = tables.CosZ[i];
+			const float v = tables.V[i];
+			const std::size_t rowStart = (std::size_t)i * n;
+
+			uint32 j = 0;
+#if TERRAIN_GENERATOR_SSE
+			const __m128 va = _mm_set1_ps(a);
+			const __m128 vf = _mm_set1_ps(f);
+			const __m128 vz = _mm_set1_ps(z);
+			const __m128 vSinZ = _mm_set1_ps(sinZ);
+			const __m128 vCosZ = _mm_set1_ps(cosZ);
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 signBit = _mm_set1_ps(-0.0f);
+
+			for (; j + 4 <= n; j += 4)
+			{
+				__m128 x = _mm_loadu_ps(&tables.X[j]);
+				__m128 sinX = _mm_loadu_ps(&tables.SinX[j]);
+				__m128 cosX = _mm_loadu_ps(&tables.CosX[j]);
+
+				__m128 height = _mm_mul_ps(va, _mm_add_ps(_mm_mul_ps(vz, sinX), _mm_mul_ps(x, vCosZ)));
+				__m128 ddx = _mm_mul_ps(va, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(vf, vz), cosX), vCosZ));
+				__m128 ddz = _mm_mul_ps(va, _mm_sub_ps(sinX, _mm_mul_ps(_mm_mul_ps(vf, x), vSinZ)));
+				__m128 nx = _mm_xor_ps(ddx, signBit);
+				__m128 nz = _mm_xor_ps(ddz, signBit);
+				__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), one), _mm_mul_ps(nz, nz));
+				__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+
+				alignas(16) float lanes[4][4];
+				_mm_store_ps(lanes[0], height);
+				_mm_store_ps(lanes[1], nx);
+				_mm_store_ps(lanes[2], nz);
+				_mm_store_ps(lanes[3], inverseLength);
+
+				for (int k = 0; k < 4; ++k)
+				{
+					WriteVertex(layout, rowStart + j + k, tables.X[j + k], lanes[0][k], z,
+						lanes[1][k], lanes[2][k], lanes[3][k], tables.U[j + k], v);
+				}
+			}
+#endif
+			for (; j < n; ++j)
+			{
+				float height, nx, nz, inverseLength;
+				EvaluateHill(a, f, tables.X[j], tables.SinX[j], tables.CosX[j], z, sinZ, cosZ, height, nx, nz, inverseLength);
+				WriteVertex(layout, rowStart + j, tables.X[j], height, z, nx, nz, inverseLength, tables.U[j], v);
+			}
+		}
+	}
+}
+
+float TerrainGenerator::HillHeight(float x, float z, float amplitude, float frequency)
+{
+	return amplitude * (z * sinf(frequency * x) + x * cosf(frequency * z));
+}
+
+void TerrainGenerator::HillNormal(float x, float z, float amplitude, float frequency, float normal[3])
+{
+	float nx = -amplitude * (frequency * z * cosf(frequency * x) + cosf(frequency * z));
+	float nz = -amplitude * (sinf(frequency * x) - frequency * x * sinf(frequency * z));
+	float inverseLength = 1.0f / sqrtf(nx * nx + 1.0f + nz * nz);
+
+	normal[0] = nx * inverseLength;
+	normal[1] = inverseLength;
+	normal[2] = nz * inverseLength;
+}
+
+bool TerrainGenerator::IsSimdEnabled()
+{
+#if TERRAIN_GENERATOR_SSE
+	return true;
+#else
+	return false;
+#endif
+}
+
+void TerrainGenerator::SinCos(const float* angles, float* sines, float* cosines, std::size_t count)
+{
+	std::size_t i = 0;
+#if TERRAIN_GENERATOR_SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 s, c;
+		SinCos4(_mm_loadu_ps(angles + i), s, c);
+		_mm_storeu_ps(sines + i, s);
+		_mm_storeu_ps(cosines + i, c);
+	}
+#endif
+	for (; i < count; ++i)
+		SinCosScalar(angles[i], sines[i], cosines[i]);
+}
+
+void TerrainGenerator::GenerateHills(const HillTerrainDesc& desc, const TerrainVertexLayout& layout, unsigned threadCount)
+{
+	if (desc.Rows == 0 || desc.Columns == 0)
+		return;
+
+	HillTables tables = BuildHillTables(desc);
+	ForEachTile(desc.Rows, TileRows, threadCount, [&](uint32 first, uint32 last)
+	{
+		GenerateHillRows(desc, tables, layout, first, last);
+	});
+}
+
+void TerrainGenerator::GenerateHillsScalar(const HillTerrainDesc& desc, const TerrainVertexLayout& layout)
+{
+	const uint32 m = desc.Rows;
+	const uint32 n = desc.Columns;
+	const float dx = n > 1 ? desc.Width / (n - 1) : 0.0f;
+	const float dz = m > 1 ? desc.Depth / (m - 1) : 0.0f;
+	const float du = n > 1 ? 1.0f / (n - 1) : 0.0f;
+	const float dv = m > 1 ? 1.0f / (m - 1) : 0.0f;
+
+	for (uint32 i = 0; i < m; ++i)
+	{
+		float row = (float)((std::int64_t)desc.RowOffset + i);
+		float z = 0.5f * desc.Depth - row * dz;
+		for (uint32 j = 0; j < n; ++j)
+		{
+			float column = (float)((std::int64_t)desc.ColumnOffset + j);
+			float x = -0.5f * desc.Width + column * dx;
+			float normal[3];
+			HillNormal(x, z, desc.Amplitude, desc.Frequency, normal);
+
+			std::size_t vertex = (std::size_t)i * n + j;
+			if (layout.Positions)
+			{
+				float* p = Attribute(layout.Positions, layout.Stride, vertex);
+				p[0] = x; p[1] = HillHeight(x, z, desc.Amplitude, desc.Frequency); p[2] = z;
+			}
+			if (layout.Normals)
+				std::memcpy(Attribute(layout.Normals, layout.Stride, vertex), normal, sizeof(normal));
+			if (layout.TexCoords)
+			{
+				float* t = Attribute(layout.TexCoords, layout.Stride, vertex);
+				t[0] = column * du; t[1] = row * dv;
+			}
+		}
+	}
+}
+
+void TerrainGenerator::GenerateGridIndices(uint32 rows, uint32 columns, uint32* indices, unsigned threadCount)
+{
+	if (rows < 2 || columns < 2)
+		return;
+
+	ForEachTile(rows - 1, TileRows, threadCount, [&](uint32 first, uint32 last)
+	{
+		uint32* out = indices + (std::size_t)first * (columns - 1) * 6;
+		for (uint32 i = first; i < last; ++i)
+		{
+			for (uint32 j = 0; j + 1 < columns; ++j)
+			{
+				*out++ = i * columns + j;
+				*out++ = i * columns + j + 1;
+				*out++ = (i + 1) * columns + j;
+
+				*out++ = (i + 1) * columns + j;
+				*out++ = i * columns + j + 1;
+				*out++ = (i + 1) * columns + j + 1;
+			}
+		}
+	});
+}
+
+TerrainBenchmark TerrainGenerator::MeasureHills(const HillTerrainDesc& desc, uint32 iterations, unsigned threadCount)
+{
+	TerrainBenchmark result;
+	if (desc.Rows == 0 || desc.Columns == 0 || iterations == 0)
+		return result;
+
+	const std::size_t vertexCount = (std::size_t)desc.Rows * desc.Columns;
+	const std::size_t floatsPerVertex = 8;
+	std::vector<float> scalar(vertexCount * floatsPerVertex);
+	std::vector<float> batch(vertexCount * floatsPerVertex);
+
+	auto layoutOf = [&](std::vector<float>& vertices)
+	{
+		TerrainVertexLayout layout;
+		layout.Positions = vertices.data();
+		layout.Normals = vertices.data() + 3;
+		layout.TexCoords = vertices.data() + 6;
+		layout.Stride = floatsPerVertex * sizeof(float);
+		return layout;
+	};
+
+	auto fastest = [iterations](const auto& run)
+	{
+		double best = 0.0;
+		for (uint32 i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			run();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+		}
+		return best;
+	};
+
+	TerrainVertexLayout scalarLayout = layoutOf(scalar);
+	TerrainVertexLayout batchLayout = layoutOf(batch);
+	result.ScalarMilliseconds = fastest([&]() { GenerateHillsScalar(desc, scalarLayout); });
+	result.BatchMilliseconds = fastest([&]() { GenerateHills(desc, batchLayout, threadCount); });
+
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		const float* s = &scalar[v * floatsPerVertex];
+		const float* b = &batch[v * floatsPerVertex];
+		result.MaxHeightError = std::max(result.MaxHeightError, std::fabs(s[1] - b[1]));
+		for (int k = 3; k < 6; ++k)
+			result.MaxNormalError = std::max(result.MaxNormalError, std::fabs(s[k] - b[k]));
+	}
+
+	return result;
+}
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// TerrainGenerator.h
+//
+// Batch generation of the sinusoidal hills terrain,
+//
+//   h(x, z) = Amplitude * (z * sin(Frequency * x) + x * cos(Frequency * z)),
+//
+// over a regular grid laid out like GeometryGenerator::CreateGrid().  The height is
+// separable, so the trigonometry is evaluated once per column and once per row with
+// a vectorized sin/cos approximation, and each vertex is a few multiply-adds plus a
+// normalization.  Rows are processed four vertices at a time with SSE2 when the
+// compiler targets it (always on x64) and in scalar code otherwise; both paths give
+// identical output.  Large grids are split into tiles of rows generated on several
+// threads.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Size, resolution and shape of a hills terrain
+ */
+struct HillTerrainDesc
+{
+	float Width = 160.0f;        ///< Extent along x, centred on the origin
+	float Depth = 160.0f;        ///< Extent along z, centred on the origin
+	std::uint32_t Rows = 50;     ///< Vertices along z (m in CreateGrid)
+	std::uint32_t Columns = 50;  ///< Vertices along x (n in CreateGrid)
+	float Amplitude = 0.1f;
+	float Frequency = 0.1f;
+
+	// Shift the sampled window by whole grid cells: vertex (i, j) is generated as
+	// grid vertex (RowOffset + i, ColumnOffset + j) of the centred terrain, so windows
+	// that share a grid line compute bit-identical vertices along it.
+	std::int32_t RowOffset = 0;
+	std::int32_t ColumnOffset = 0;
+};
+
+/**
+ * @brief Where generated attributes are written
+ *
+ * Each pointer addresses the attribute of vertex 0; vertex k is Stride * k bytes
+ * further.  Null attributes are skipped.
+ */
+struct TerrainVertexLayout
+{
+	float* Positions = nullptr;  ///< Three floats
+	float* Normals = nullptr;    ///< Three floats
+	float* TexCoords = nullptr;  ///< Two floats
+	std::size_t Stride = 0;
+};
+
+/**
+ * @brief Timings of the scalar and batch paths on the same terrain
+ */
+struct TerrainBenchmark
+{
+	double ScalarMilliseconds = 0.0;  ///< One vertex at a time with sinf / cosf
+	double BatchMilliseconds = 0.0;   ///< GenerateHills()
+	float MaxHeightError = 0.0f;      ///< Largest height difference between the two
+	float MaxNormalError = 0.0f;      ///< Largest normal component difference
+};
+
+class TerrainGenerator
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	static float HillHeight(float x, float z, float amplitude, float frequency);  ///< Scalar reference
+	static void HillNormal(float x, float z, float amplitude, float frequency, float normal[3]);  ///< Scalar reference, unit length
+
+	/**
+	 * @brief True if the SSE2 path was compiled in
+	 */
+	static bool IsSimdEnabled();
+
+	/**
+	 * @brief Vectorized sine and cosine, accurate to a few ulp for |angle| < 8192
+	 */
+	static void SinCos(const float* angles, float* sines, float* cosines, std::size_t count);
+
+	/**
+	 * @brief Generates every vertex of a hills terrain
+	 * @param threadCount Worker threads, 0 to use every hardware thread
+	 */
+	static void GenerateHills(const HillTerrainDesc& desc, const TerrainVertexLayout& layout, unsigned threadCount = 0);
+
+	/**
+	 * @brief Generates the same vertices one at a time with sinf / cosf
+	 */
+	static void GenerateHillsScalar(const HillTerrainDesc& desc, const TerrainVertexLayout& layout);
+
+	/**
+	 * @brief Writes the triangle list of a rows x columns grid, in CreateGrid() order
+	 * @param indices Receives 6 * (rows - 1) * (columns - 1) indices
+	 */
+	static void GenerateGridIndices(uint32 rows, uint32 columns, uint32* indices, unsigned threadCount = 0);
+
+	/**
+	 * @brief Times GenerateHillsScalar() against GenerateHills() and compares their output
+	 * @param iterations Runs of each path; the fastest run is reported
+	 */
+	static TerrainBenchmark MeasureHills(const HillTerrainDesc& desc, uint32 iterations, unsigned threadCount = 0);
+};
@@ -0,0 +1,214 @@
+//***************************************************************************************
+// TextureAtlas.cpp
+//***************************************************************************************
+
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <numeric>
+
+TextureAtlasPacker::TextureAtlasPacker(uint32 pageWidth, uint32 pageHeight, uint32 padding, uint32 alignment)
+	: mPageWidth(pageWidth)
+	, mPageHeight(pageHeight)
+	, mPadding(padding)
+	, mAlignment(alignment == 0 ? 1 : alignment)
+{
+}
+
+void TextureAtlasPacker::Add(const std::string& name, uint32 width, uint32 height)
+{
+	Placement placement;
+	placement.Name = name;
+	placement.Region.Width = width;
+	placement.Region.Height = height;
+	mPlacements.push_back(placement);
+}
+
+void TextureAtlasPacker::Pack()
+{
+	mPages.clear();
+
+	// Tallest images first; ties broken by width and then by insertion order so the
+	// result is deterministic from run to run.
+	std::vector<size_t> order(mPlacements.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+		{
+			const Rect& ra = mPlacements[a].Region;
+			const Rect& rb = mPlacements[b].Region;
+			if (ra.Height != rb.Height)
+				return ra.Height > rb.Height;
+			return ra.Width > rb.Width;
+		});
+
+	for (size_t i : order)
+	{
+		Placement& placement = mPlacements[i];
+		placement.Packed = false;
+
+		// Images that would not even fit an empty page are left for the caller
+		// to keep as standalone textures.
+		if (Align(placement.Region.Width) > mPageWidth || Align(placement.Region.Height) > mPageHeight)
+			continue;
+
+		uint32 paddedWidth = std::min(Align(placement.Region.Width + mPadding), mPageWidth);
+		uint32 paddedHeight = std::min(Align(placement.Region.Height + mPadding), mPageHeight);
+
+		for (uint32 p = 0; p <= (uint32)mPages.size() && !placement.Packed; ++p)
+		{
+			if (p == mPages.size())
+				mPages.push_back(NewPage());
+
+			uint32 x = 0;
+			uint32 y = 0;
+			if (Insert(mPages[p], paddedWidth, paddedHeight, x, y))
+			{
+				Page& page = mPages[p];
+				placement.Page = p;
+				placement.Region.X = x;
+				placement.Region.Y = y;
+				placement.Packed = true;
+
+				page.UsedWidth = std::max(page.UsedWidth, x + Align(placement.Region.Width));
+				page.UsedHeight = std::max(page.UsedHeight, y + Align(placement.Region.Height));
+				page.UsedArea += (uint64_t)placement.Region.Width * placement.Region.Height;
+			}
+		}
+	}
+
+	// A page may have been opened for an image that then turned out not to fit.
+	while (!mPages.empty() && mPages.back().UsedArea == 0)
+		mPages.pop_back();
+}
+
+TextureAtlasPacker::Rect TextureAtlasPacker::GetPageExtent(uint32 page) const
+{
+	Rect extent;
+	if (page < mPages.size())
+	{
+		extent.Width = mPages[page].UsedWidth;
+		extent.Height = mPages[page].UsedHeight;
+	}
+	return extent;
+}
+
+float TextureAtlasPacker::GetOccupancy() const
+{
+	uint64_t used = 0;
+	uint64_t total = 0;
+	for (const Page& page : mPages)
+	{
+		used += page.UsedArea;
+		total += (uint64_t)page.UsedWidth * page.UsedHeight;
+	}
+	return total > 0 ? (float)((double)used / (double)total) : 0.0f;
+}
+
+bool TextureAtlasPacker::Insert(Page& page, uint32 width, uint32 height, uint32& outX, uint32& outY)
+{
+	size_t bestIndex = page.Skyline.size();
+	uint32 bestTop = UINT32_MAX;
+	uint32 bestWidth = UINT32_MAX;
+
+	// Bottom-left rule: choose the position whose top edge ends lowest, and on
+	// ties the narrowest skyline segment so wide gaps stay available.
+	for (size_t i = 0; i < page.Skyline.size(); ++i)
+	{
+		uint32 y = 0;
+		if (!Fit(page, i, width, height, y))
+			continue;
+
+		uint32 top = y + height;
+		if (top < bestTop || (top == bestTop && page.Skyline[i].Width < bestWidth))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = page.Skyline[i].Width;
+			outX = page.Skyline[i].X;
+			outY = y;
+		}
+	}
+
+	if (bestIndex == page.Skyline.size())
+		return false;
+
+	AddSkylineLevel(page, bestIndex, outX, outY, width, height);
+	return true;
+}
+
+bool TextureAtlasPacker::Fit(const Page& page, size_t index, uint32 width, uint32 height, uint32& outY) const
+{
+	uint32 x = page.Skyline[index].X;
+	if (x + width > mPageWidth)
+		return false;
+
+	uint32 y = page.Skyline[index].Y;
+	int64_t widthLeft = width;
+	for (size_t i = index; widthLeft > 0; ++i)
+	{
+		if (i == page.Skyline.size())
+			return false;
+
+		y = std::max(y, page.Skyline[i].Y);
+		if (y + height > mPageHeight)
+			return false;
+
+		widthLeft -= page.Skyline[i].Width;
+	}
+
+	outY = y;
+	return true;
+}
+
+void TextureAtlasPacker::AddSkylineLevel(Page& page, size_t index, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	SkylineNode node = { x, y + height, width };
+	page.Skyline.insert(page.Skyline.begin() + index, node);
+
+	// Trim or remove the segments now covered by the new one.
+	for (size_t i = index + 1; i < page.Skyline.size(); )
+	{
+		const SkylineNode& prev = page.Skyline[i - 1];
+		SkylineNode& curr = page.Skyline[i];
+
+		uint32 prevRight = prev.X + prev.Width;
+		if (curr.X >= prevRight)
+			break;
+
+		uint32 shrink = prevRight - curr.X;
+		if (curr.Width <= shrink)
+		{
+			page.Skyline.erase(page.Skyline.begin() + i);
+			continue;
+		}
+
+		curr.X += shrink;
+		curr.Width -= shrink;
+		break;
+	}
+
+	// Merge neighbours sitting at the same height.
+	for (size_t i = 0; i + 1 < page.Skyline.size(); )
+	{
+		if (page.Skyline[i].Y == page.Skyline[i + 1].Y)
+		{
+			page.Skyline[i].Width += page.Skyline[i + 1].Width;
+			page.Skyline.erase(page.Skyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+TextureAtlasPacker::Page TextureAtlasPacker::NewPage() const
+{
+	Page page;
+	page.Skyline.push_back({ 0, 0, mPageWidth });
+	return page;
+}
+
+TextureAtlasPacker::uint32 TextureAtlasPacker::Align(uint32 value) const
+{
+	return (value + mAlignment - 1) / mAlignment * mAlignment;
+}
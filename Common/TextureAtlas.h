@@ -0,0 +1,141 @@
+//***************************************************************************************
+// TextureAtlas.h
+//
+// Skyline bottom-left rectangle packer used to combine many small images into a few
+// shared atlas pages.  The packer is pure CPU code: it only decides where every
+// image goes, the caller is responsible for copying texels and building the
+// matching texture-coordinate transforms.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TextureAtlasPacker
+{
+public:
+
+	using uint32 = std::uint32_t;
+
+	/**
+	 * @brief Axis aligned rectangle in texels
+	 */
+	struct Rect
+	{
+		uint32 X = 0;       ///< Left edge
+		uint32 Y = 0;       ///< Top edge
+		uint32 Width = 0;   ///< Width of the image (without padding)
+		uint32 Height = 0;  ///< Height of the image (without padding)
+	};
+
+	/**
+	 * @brief Result of packing one image
+	 */
+	struct Placement
+	{
+		std::string Name;    ///< Caller supplied identifier
+		uint32 Page = 0;     ///< Atlas page the image was placed on
+		Rect Region;         ///< Location of the image inside the page
+		bool Packed = false; ///< False if the image does not fit in an empty page
+	};
+
+	/**
+	 * @brief Constructs a packer
+	 * @param pageWidth Maximum page width in texels
+	 * @param pageHeight Maximum page height in texels
+	 * @param padding Empty texels kept between neighbouring images
+	 * @param alignment Every placement is aligned to this many texels (4 for BC formats)
+	 */
+	TextureAtlasPacker(uint32 pageWidth, uint32 pageHeight, uint32 padding = 2, uint32 alignment = 4);
+
+	/**
+	 * @brief Queues an image for packing
+	 * @param name Identifier returned in the matching Placement
+	 * @param width Image width in texels
+	 * @param height Image height in texels
+	 */
+	void Add(const std::string& name, uint32 width, uint32 height);
+
+	/**
+	 * @brief Places every queued image, opening new pages as needed
+	 *
+	 * Images are packed tallest first, which keeps the skyline flat and wastes
+	 * the least space for the wide, short text banners used by the menus.
+	 */
+	void Pack();
+
+	/**
+	 * @brief Gets the placements computed by Pack()
+	 * @return One placement per queued image, in insertion order
+	 */
+	const std::vector<Placement>& GetPlacements() const { return mPlacements; }
+
+	/**
+	 * @brief Gets the number of pages opened by Pack()
+	 */
+	uint32 GetPageCount() const { return (uint32)mPages.size(); }
+
+	/**
+	 * @brief Gets the used extent of a page, rounded up to the alignment
+	 * @param page Page index
+	 * @return Smallest rectangle at the origin containing every image on the page
+	 */
+	Rect GetPageExtent(uint32 page) const;
+
+	/**
+	 * @brief Ratio of image area to used page area (1.0 is a perfect pack)
+	 */
+	float GetOccupancy() const;
+
+private:
+	/**
+	 * @brief One horizontal segment of the skyline
+	 */
+	struct SkylineNode
+	{
+		uint32 X;
+		uint32 Y;
+		uint32 Width;
+	};
+
+	/**
+	 * @brief Packing state of a single page
+	 */
+	struct Page
+	{
+		std::vector<SkylineNode> Skyline;
+		uint32 UsedWidth = 0;
+		uint32 UsedHeight = 0;
+		uint64_t UsedArea = 0;
+	};
+
+	/**
+	 * @brief Tries to place a padded rectangle on a page
+	 * @return True and the position if the rectangle fits
+	 */
+	bool Insert(Page& page, uint32 width, uint32 height, uint32& outX, uint32& outY);
+
+	/**
+	 * @brief Finds the lowest y a rectangle starting at skyline node index can rest on
+	 * @return False if the rectangle would leave the page
+	 */
+	bool Fit(const Page& page, size_t index, uint32 width, uint32 height, uint32& outY) const;
+
+	/**
+	 * @brief Raises the skyline after placing a rectangle at node index
+	 */
+	void AddSkylineLevel(Page& page, size_t index, uint32 x, uint32 y, uint32 width, uint32 height);
+
+	Page NewPage() const;
+	uint32 Align(uint32 value) const;
+
+	uint32 mPageWidth;
+	uint32 mPageHeight;
+	uint32 mPadding;
+	uint32 mAlignment;
+
+	std::vector<Placement> mPlacements;
+	std::vector<Page> mPages;
+};
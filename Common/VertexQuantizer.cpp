@@ -0,0 +1,171 @@
+//***************************************************************************************
+// VertexQuantizer.cpp
+//***************************************************************************************
+
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+namespace
+{
+	template<typename T>
+	T* Advance(T* pointer, std::size_t bytes)
+	{
+		using Byte = typename std::conditional<std::is_const<T>::value, const unsigned char, unsigned char>::type;
+		return reinterpret_cast<T*>(reinterpret_cast<Byte*>(pointer) + bytes);
+	}
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+std::int16_t VertexQuantizer::ToSnorm16(float value)
+{
+	value = std::min(std::max(value, -1.0f), 1.0f);
+	return static_cast<std::int16_t>(std::lround(value * 32767.0f));
+}
+
+float VertexQuantizer::FromSnorm16(std::int16_t value)
+{
+	// Both -32768 and -32767 decode to -1, as on the GPU.
+	return std::max(value / 32767.0f, -1.0f);
+}
+
+std::uint16_t VertexQuantizer::ToUnorm16(float value)
+{
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return static_cast<std::uint16_t>(std::lround(value * 65535.0f));
+}
+
+float VertexQuantizer::FromUnorm16(std::uint16_t value)
+{
+	return value / 65535.0f;
+}
+
+void VertexQuantizer::EncodeOctahedral(const float normal[3], float encoded[2])
+{
+	float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+	if (length == 0.0f)
+	{
+		encoded[0] = encoded[1] = 0.0f;
+		return;
+	}
+
+	float x = normal[0] / length;
+	float y = normal[1] / length;
+
+	// Fold the lower hemisphere over the diagonals of the square.
+	if (normal[2] < 0.0f)
+	{
+		float foldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+		float foldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = x;
+	encoded[1] = y;
+}
+
+void VertexQuantizer::DecodeOctahedral(const float encoded[2], float normal[3])
+{
+	float x = encoded[0];
+	float y = encoded[1];
+	float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+		float unfoldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	float length = std::sqrt(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
+
+void VertexQuantizer::PackPositions(std::int16_t* destination, std::size_t destinationStride,
+	const float* positions, std::size_t positionStride, std::size_t count,
+	float center[3], float extents[3])
+{
+	float lower[3] = { 0.0f, 0.0f, 0.0f };
+	float upper[3] = { 0.0f, 0.0f, 0.0f };
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float* p = Advance(positions, i * positionStride);
+		for (int k = 0; k < 3; ++k)
+		{
+			lower[k] = i == 0 ? p[k] : std::min(lower[k], p[k]);
+			upper[k] = i == 0 ? p[k] : std::max(upper[k], p[k]);
+		}
+	}
+
+	float inverseExtents[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		center[k] = 0.5f * (lower[k] + upper[k]);
+		extents[k] = 0.5f * (upper[k] - lower[k]);
+
+		// A flat axis decodes to the centre whatever is stored.
+		inverseExtents[k] = extents[k] > 0.0f ? 1.0f / extents[k] : 0.0f;
+	}
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float* p = Advance(positions, i * positionStride);
+		std::int16_t* q = Advance(destination, i * destinationStride);
+		for (int k = 0; k < 3; ++k)
+			q[k] = ToSnorm16((p[k] - center[k]) * inverseExtents[k]);
+	}
+}
+
+void VertexQuantizer::PackNormals(std::int16_t* destination, std::size_t destinationStride,
+	const float* normals, std::size_t normalStride, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		float encoded[2];
+		EncodeOctahedral(Advance(normals, i * normalStride), encoded);
+
+		std::int16_t* q = Advance(destination, i * destinationStride);
+		q[0] = ToSnorm16(encoded[0]);
+		q[1] = ToSnorm16(encoded[1]);
+	}
+}
+
+void VertexQuantizer::PackTexCoords(std::uint16_t* destination, std::size_t destinationStride,
+	const float* texCoords, std::size_t texCoordStride, std::size_t count,
+	float offset[2], float scale[2])
+{
+	float lower[2] = { 0.0f, 0.0f };
+	float upper[2] = { 0.0f, 0.0f };
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float* t = Advance(texCoords, i * texCoordStride);
+		for (int k = 0; k < 2; ++k)
+		{
+			lower[k] = i == 0 ? t[k] : std::min(lower[k], t[k]);
+			upper[k] = i == 0 ? t[k] : std::max(upper[k], t[k]);
+		}
+	}
+
+	for (int k = 0; k < 2; ++k)
+	{
+		offset[k] = lower[k];
+		scale[k] = upper[k] > lower[k] ? upper[k] - lower[k] : 1.0f;
+	}
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float* t = Advance(texCoords, i * texCoordStride);
+		std::uint16_t* q = Advance(destination, i * destinationStride);
+		for (int k = 0; k < 2; ++k)
+			q[k] = ToUnorm16((t[k] - offset[k]) / scale[k]);
+	}
+}
@@ -0,0 +1,71 @@
+//***************************************************************************************
+// VertexQuantizer.h
+//
+// Packs float vertex attributes into 16-bit normalized integers that the input
+// assembler expands back to floats:
+//
+//   Positions   SNORM16, relative to the mesh bounds: p = center + extents * q
+//   Normals     SNORM16 octahedral encoding (Meyer et al. 2010), two components
+//   TexCoords   UNORM16, relative to the mesh UV range: uv = offset + scale * q
+//
+// Attributes are read from and written to strided arrays so any vertex layout can be
+// packed.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class VertexQuantizer
+{
+public:
+
+	static std::int16_t ToSnorm16(float value);  ///< Clamps to [-1, 1]
+	static float FromSnorm16(std::int16_t value);
+	static std::uint16_t ToUnorm16(float value);  ///< Clamps to [0, 1]
+	static float FromUnorm16(std::uint16_t value);
+
+	/**
+	 * @brief Maps a unit vector onto the [-1, 1] square
+	 */
+	static void EncodeOctahedral(const float normal[3], float encoded[2]);
+
+	/**
+	 * @brief Inverse of EncodeOctahedral(), returns a unit vector
+	 */
+	static void DecodeOctahedral(const float encoded[2], float normal[3]);
+
+	/**
+	 * @brief Packs positions relative to their bounding box
+	 * @param destination First packed position (three int16)
+	 * @param destinationStride Distance in bytes between packed positions
+	 * @param positions First position (three floats)
+	 * @param positionStride Distance in bytes between positions
+	 * @param count Number of positions
+	 * @param[out] center Centre of the bounding box
+	 * @param[out] extents Half size of the bounding box
+	 */
+	static void PackPositions(std::int16_t* destination, std::size_t destinationStride,
+		const float* positions, std::size_t positionStride, std::size_t count,
+		float center[3], float extents[3]);
+
+	/**
+	 * @brief Packs unit normals with the octahedral encoding
+	 * @param destination First packed normal (two int16)
+	 * @param normals First normal (three floats)
+	 */
+	static void PackNormals(std::int16_t* destination, std::size_t destinationStride,
+		const float* normals, std::size_t normalStride, std::size_t count);
+
+	/**
+	 * @brief Packs texture coordinates relative to their range
+	 * @param destination First packed coordinate pair (two uint16)
+	 * @param texCoords First coordinate pair (two floats)
+	 * @param[out] offset Smallest u and v
+	 * @param[out] scale Range of u and v, 1 where the range is empty
+	 */
+	static void PackTexCoords(std::uint16_t* destination, std::size_t destinationStride,
+		const float* texCoords, std::size_t texCoordStride, std::size_t count,
+		float offset[2], float scale[2]);
+};
@@ -4,6 +4,8 @@
 
 #include "d3dApp.h"
 #include <WindowsX.h>
+#include <chrono>
+#include <sstream>
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -136,8 +138,15 @@ int D3DApp::Run()
 			if( !mAppPaused )
 			{
 				CalculateFrameStats();
+
+				using Clock = std::chrono::steady_clock;
+				mFrameSample = FrameSample();
+				Clock::time_point start = Clock::now();
 				Update(mTimer);	
+				Clock::time_point updated = Clock::now();
                 Draw(mTimer);
+				RecordFrameSample(std::chrono::duration<double, std::milli>(updated - start).count(),
+					std::chrono::duration<double, std::milli>(Clock::now() - updated).count());
 			}
 			else
 			{
@@ -146,6 +155,7 @@ int D3DApp::Run()
         }
     }
 
+	SaveFrameStats("FrameStats.csv");
 	return (int)msg.wParam;
 }
 
@@ -524,9 +534,6 @@ bool D3DApp::InitDirect3D()
 			IID_PPV_ARGS(&md3dDevice)));
 	}
 
-	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE,
-		IID_PPV_ARGS(&mFence)));
-
 	mRtvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	mDsvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	mCbvSrvUavDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -553,6 +560,7 @@ bool D3DApp::InitDirect3D()
 #endif
 
 	CreateCommandObjects();
+	mFrameFence = std::make_unique<D3D12FrameFence>(md3dDevice.Get(), mCommandQueue.Get());
     CreateSwapChain();
     CreateRtvAndDsvDescriptorHeaps();
 
@@ -616,26 +624,17 @@ void D3DApp::CreateSwapChain()
 
 void D3DApp::FlushCommandQueue()
 {
-	//! Advance the fence value to mark commands up to this fence point.
-    mCurrentFence++;
+	//! Initialization may have failed before the fence was created.
+	if(mFrameFence == nullptr)
+		return;
 
     //! Add an instruction to the command queue to set a new fence point.  Because we 
 	//! are on the GPU timeline, the new fence point won't be set until the GPU finishes
 	//! processing all the commands prior to this Signal().
-    ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
+	UINT64 fence = mFrameFence->Signal();
 
 	//! Wait until the GPU has completed commands up to this fence point.
-    if(mFence->GetCompletedValue() < mCurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-
-        //! Fire event when GPU hits current fence.  
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
-
-        //! Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-	}
+	mFrameFence->Wait(fence);
 }
 
 
@@ -664,15 +663,15 @@ void D3DApp::CalculateFrameStats()
 	// average time it takes to render one frame.  These stats 
 	// are appended to the window caption bar.
     
-	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	// The average hides single long frames, so the slowest of the second and the
+	// stutters since start-up are shown next to it.
 
-	frameCnt++;
+	mCaptionFrameCount++;
 
 	// Compute averages over one second period.
-	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
+	if( (mTimer.TotalTime() - mCaptionTimeElapsed) >= 1.0f )
 	{
-		float fps = (float)frameCnt; // fps = frameCnt / 1
+		float fps = (float)mCaptionFrameCount; // fps = frameCnt / 1
 		float mspf = 1000.0f / fps;
 
         wstring fpsStr = to_wstring(fps);
@@ -680,16 +679,40 @@ void D3DApp::CalculateFrameStats()
 
         wstring windowText = mMainWndCaption +
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            L"   p99: " + to_wstring(mCaptionFrameTimes.GetPercentile(99.0)) +
+            L"   max: " + to_wstring(mCaptionFrameTimes.GetMax()) +
+            L"   stutters: " + to_wstring(mFrameStats.GetStutterCount()) +
+            GetFrameStatsText();
 
         SetWindowText(mhMainWnd, windowText.c_str());
 		
 		// Reset for next average.
-		frameCnt = 0;
-		timeElapsed += 1.0f;
+		mCaptionFrameCount = 0;
+		mCaptionTimeElapsed += 1.0f;
+		mCaptionFrameTimes.Reset();
 	}
 }
 
+void D3DApp::RecordFrameSample(double updateMilliseconds, double drawMilliseconds)
+{
+	mFrameSample.Frame = mTimer.DeltaTime() * 1000.0;
+	mFrameSample.Update = updateMilliseconds - mFrameSample.FenceWait;
+	mFrameSample.Draw = drawMilliseconds;
+
+	mFrameStats.AddFrame(mFrameSample);
+	mCaptionFrameTimes.Record(mFrameSample.Frame);
+}
+
+bool D3DApp::SaveFrameStats(const std::string& path) const
+{
+	std::ostringstream summary;
+	mFrameStats.WriteSummary(summary);
+	OutputDebugStringA(summary.str().c_str());
+
+	return mFrameStats.SaveCsv(path);
+}
+
 //! Display adapters implement graphical functionality. Usually, the display adapter
 //! is a physical piece of hardware(e.g., graphics card); however, a system can also have a
 //! software display adapter that emulates hardware graphics functionality.A system can have
@@ -9,6 +9,9 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FrameStatistics.h"
+#include "D3D12FrameFence.h"
+#include <memory>
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -241,6 +244,24 @@ protected:
      */
     void CalculateFrameStats();
 
+    /**
+     * @brief Adds mFrameSample to mFrameStats once the frame has been drawn
+     * @param updateMilliseconds Time spent in Update(), fence wait included
+     * @param drawMilliseconds Time spent in Draw()
+     */
+    void RecordFrameSample(double updateMilliseconds, double drawMilliseconds);
+
+    /**
+     * @brief Writes the kept frame timings as CSV and logs the percentiles
+     * @return False if the file could not be written
+     */
+    bool SaveFrameStats(const std::string& path) const;
+
+    /**
+     * @brief Extra statistics appended to the window caption after fps and mspf
+     */
+    virtual std::wstring GetFrameStatsText() const { return L""; }
+
     /**
      * @brief Logs available GPU adapters
      */
@@ -289,6 +310,12 @@ protected:
 
     GameTimer mTimer;              ///< Game timing utility
 
+    FrameStatistics mFrameStats;            ///< Every frame since start-up, dumped on exit
+    FrameSample mFrameSample;               ///< Frame in progress; FenceWait is added by the derived class
+    LatencyHistogram mCaptionFrameTimes;    ///< Frames since the caption was last refreshed
+    int mCaptionFrameCount = 0;
+    float mCaptionTimeElapsed = 0.0f;
+
     //-------------------------------------------------------------------------
     // Direct3D Core Objects
     //-------------------------------------------------------------------------
@@ -301,8 +328,7 @@ protected:
     // Synchronization
     //-------------------------------------------------------------------------
 
-    Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
-    UINT64 mCurrentFence = 0;      ///< Current fence value for GPU synchronization
+    std::unique_ptr<D3D12FrameFence> mFrameFence;  ///< Signalled on mCommandQueue; every signal goes through it
 
     //-------------------------------------------------------------------------
     // Command Management
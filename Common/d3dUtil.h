@@ -23,7 +23,7 @@
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
 
-extern const int gNumFrameResources;
+extern int gNumFrameResources;
 
 /**
  * @brief Sets a debug name for a Direct3D object
@@ -183,10 +183,24 @@ struct SubmeshGeometry
 	UINT IndexCount = 0;           ///< Number of indices
 	UINT StartIndexLocation = 0;   ///< Start index location
 	INT BaseVertexLocation = 0;    ///< Base vertex location
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;  ///< Width of this submesh's indices
 
-	// Bounding box of the geometry defined by this submesh. 
-	// This is used in later chapters of the book.
+	// Level of detail.  Level n > 0 of submesh "name" is stored in DrawArgs as
+	// "name_lod<n>" and shares the vertices of level 0.  Level 0 also points at
+	// the whole chain, kept in MeshGeometry::LodChains.
+	UINT LodCount = 1;      ///< Levels in the chain, including this one (set on level 0)
+	float LodError = 0.0f;  ///< Object space distance this level may stray from level 0
+	const SubmeshGeometry* Lods = nullptr;  ///< LodCount levels, finest first (set on level 0 of a chain)
+
+	// Bounding box of the geometry defined by this submesh.  Packed vertex
+	// positions are stored relative to it: p = Center + Extents * q.
 	DirectX::BoundingBox Bounds;  ///< Bounding box
+	DirectX::BoundingSphere Sphere;  ///< Bounding sphere of the same geometry
+
+	// Packed texture coordinates are stored relative to the submesh UV range:
+	// uv = TexCoordOffset + TexCoordScale * q.
+	DirectX::XMFLOAT2 TexCoordOffset = { 0.0f, 0.0f };
+	DirectX::XMFLOAT2 TexCoordScale = { 1.0f, 1.0f };
 };
 
 /**
@@ -225,6 +239,7 @@ struct MeshGeometry
 	// the Submeshes individually.
 
 	std::unordered_map<std::string, SubmeshGeometry> DrawArgs;  ///< Draw arguments for submeshes
+	std::unordered_map<std::string, std::vector<SubmeshGeometry>> LodChains;  ///< Levels of each submesh that has a chain, by level 0 name
 
 	/**
 	 * @brief Returns the vertex buffer view
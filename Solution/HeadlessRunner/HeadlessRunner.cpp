@@ -0,0 +1,889 @@
+//***************************************************************************************
+// HeadlessRunner.cpp
+//
+// Drives the engine core without a window or GPU: a StateStack holding a simulation
+// state and a pause state is updated for a number of frames with a synthetic clock,
+// while a script feeds key events through StateStack::HandleEvent().  The simulation
+// state moves a scene graph of entities, refreshes their bounds and culls them
+// against a fixed camera, so the timings cover the same per-frame work as the game
+// minus the rendering.
+//
+//   HeadlessRunner [--frames N] [--entities N] [--dt seconds] [--script file]
+//                  [--trace file] [--csv file] [--stutter ms]
+//                  [--tick-rate Hz] [--max-ticks N]
+//                  [--record] [--render-thread N] [--gpu-ms ms]
+//                  [--frames-in-flight N] [--state-cache] [--async-build]
+//   HeadlessRunner --bench
+//
+// A script line is "<frame> <key>", key being left, right, up, down, pause or
+// restart; '#' starts a comment.  Restart, while paused, clears the stack and pushes
+// the simulation again.  Without a script the player is steered around and the game
+// is paused once half way through.  --state-cache keeps the popped states in the
+// StateStack cache, so a restart resumes them instead of building the scene again;
+// --async-build builds it on a worker thread behind a loading state, which keeps the
+// frames coming meanwhile.  --trace records profiler zones and writes them as a
+// Chrome trace; --csv writes the time of every frame, and frames longer than
+// --stutter milliseconds are counted as stutters.  With --tick-rate the states are
+// updated at that fixed rate, at most --max-ticks times a frame, instead of once per
+// frame with the frame's --dt.
+//
+// --record captures a render snapshot of the visible drones every frame, as the game
+// does, and records it after the update; --render-thread records the snapshots on a
+// render thread instead, with N snapshot buffers.  Recording waits for a free frame
+// resource, writes the changed object constants into it and encodes the draws, then
+// submits --gpu-ms of work to a simulated GPU.  --frames-in-flight sets how many
+// frames the GPU may lag behind, 3 by default as in the game.
+//
+// --bench skips the run and measures the engine's standalone kernels instead: the
+// block decoder's throughput per BC format on one thread, with each SIMD level the
+// CPU supports, the hills terrain generated vertex by vertex against the batch
+// generator, the occlusion culler rasterizing walls and testing boxes behind them
+// at two depth buffer sizes, and the vertex cache statistics of the game's meshes
+// before and after GeometryGenerator::Optimize().
+//***************************************************************************************
+
+#include "../InitializeDirect3D/StateStack.hpp"
+#include "../InitializeDirect3D/Entity.hpp"
+#include "../InitializeDirect3D/CommandQueue.hpp"
+#include "../InitializeDirect3D/RenderSnapshot.hpp"
+#include "../../Common/BlockDecoder.h"
+#include "../../Common/FixedTimestep.h"
+#include "../../Common/FrameScheduler.h"
+#include "../../Common/FrameStatistics.h"
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/OcclusionCuller.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/TerrainGenerator.h"
+#include "../../Common/RenderThread.h"
+#include "../../Common/SimulatedGpu.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Set to --frames-in-flight before the scene is built.
+int gNumFrameResources = 3;
+
+namespace
+{
+	// Key codes of the script, matching the Win32 virtual keys the game reads.
+	enum Key : std::uintptr_t
+	{
+		KeyLeft = 0x25,
+		KeyUp = 0x26,
+		KeyRight = 0x27,
+		KeyDown = 0x28,
+		KeyPause = 'P',
+		KeyRestart = 'R'
+	};
+
+	struct ScriptEvent
+	{
+		unsigned Frame;
+		std::uintptr_t Key;
+	};
+
+	struct RunnerOptions
+	{
+		unsigned Frames = 1000;
+		unsigned Entities = 2000;
+		double DeltaTime = 1.0 / 60.0;
+		std::string Script;
+		std::string Trace;
+		std::string Csv;
+		double StutterThreshold = 0.0;  // Milliseconds, 0 keeps the FrameStatistics default
+		double TickRate = 0.0;          // Hz, 0 updates once per frame
+		unsigned MaxTicks = 4;
+		bool Record = false;
+		unsigned RenderBuffers = 0;     // Snapshot buffers of the render thread, 0 records on the main thread
+		double GpuMilliseconds = 0.0;
+		unsigned FramesInFlight = 3;
+		bool StateCache = false;
+		bool AsyncBuild = false;
+		bool Bench = false;
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	/**
+	 * @brief What the states of the run share; the headless context has no Game
+	 */
+	struct Simulation
+	{
+		RunnerOptions Options;
+		FrustumPlanes Camera;
+		CullingStats LastCull;
+		LatencyHistogram SceneUpdate;  // Milliseconds per phase, over every frame that ran it
+		LatencyHistogram Bounds;
+		LatencyHistogram Culling;
+		LatencyHistogram Capture;
+		LatencyHistogram Recording;    // Written by the render thread while it runs
+		unsigned PausedUpdates = 0;
+		unsigned LoadingUpdates = 0;
+		RenderSnapshot* Snapshot = nullptr;  // Filled by the states' Draw() when recording
+	};
+
+	Simulation* gSimulation = nullptr;
+
+	/**
+	 * @brief Entity with a box render item that bounces inside the arena
+	 */
+	class Drone : public Entity
+	{
+	public:
+		Drone(State* state, unsigned category, float arena)
+			: Entity(state)
+			, mCategory(category)
+			, mArena(arena)
+		{
+		}
+
+		unsigned int getCategory() const override { return mCategory; }
+
+	private:
+		void drawCurrent() const override
+		{
+			if (!renderer->Visible)
+				return;
+
+			DrawRecord draw;
+			draw.ObjCBIndex = renderer->ObjCBIndex;
+			draw.IndexCount = renderer->IndexCount;
+			gSimulation->Snapshot->Draws.push_back(draw);
+		}
+
+		void updateCurrent(const GameTimer& gt) override
+		{
+			XMFLOAT3 position = getWorldPosition();
+			if (std::fabs(position.x) > mArena && position.x * mVelocity.x > 0.0f)
+				mVelocity.x = -mVelocity.x;
+			if (std::fabs(position.z) > mArena && position.z * mVelocity.z > 0.0f)
+				mVelocity.z = -mVelocity.z;
+
+			Entity::updateCurrent(gt);
+		}
+
+		void buildCurrent() override
+		{
+			auto render = std::make_unique<RenderItem>();
+			renderer = render.get();
+			renderer->World = getTransform();
+			renderer->IndexCount = 36;
+			renderer->LocalBounds.Extents = XMFLOAT3(0.5f, 0.5f, 0.5f);
+			renderer->LocalSphere.Radius = 0.87f;
+			mState->addRenderItem(std::move(render));
+		}
+
+		unsigned mCategory;
+		float mArena;
+	};
+
+	/**
+	 * @brief Moves the drones, then refreshes their bounds and culls them
+	 */
+	class SimulationState : public State
+	{
+	public:
+		SimulationState(StateStack* stack, Context* context)
+			: State(stack, context)
+		{
+			const float arena = 100.0f;
+			std::mt19937 random(7);
+			std::uniform_real_distribution<float> position(-arena, arena);
+			std::uniform_real_distribution<float> speed(-8.0f, 8.0f);
+
+			mSceneGraph->attachChild(std::make_unique<Drone>(this, Category::PlayerAircraft, arena));
+
+			// Leaders with a few wingmen each, so world transforms walk a hierarchy.
+			Drone* leader = nullptr;
+			for (unsigned i = 1; i < gSimulation->Options.Entities; ++i)
+			{
+				bool wingman = leader != nullptr && i % 4 != 0;
+				auto drone = std::make_unique<Drone>(this, Category::EnemyAircraft, arena);
+				if (wingman)
+				{
+					drone->setPosition(position(random) * 0.02f, 0.0f, position(random) * 0.02f);
+					drone->setVelocity(speed(random) * 0.1f, 0.0f, speed(random) * 0.1f);
+					leader->attachChild(std::move(drone));
+				}
+				else
+				{
+					drone->setPosition(position(random), 0.0f, position(random));
+					drone->setVelocity(speed(random), 0.0f, speed(random));
+					leader = drone.get();
+					mSceneGraph->attachChild(std::move(drone));
+				}
+			}
+
+			mSceneGraph->build();
+		}
+
+		/**
+		 * @brief Captures the changed object constants and the visible drones, like Game::Update()
+		 */
+		void Draw() override
+		{
+			PROFILE_SCOPE("SimulationState::Capture");
+			Clock::time_point start = Clock::now();
+
+			RenderSnapshot& snapshot = *gSimulation->Snapshot;
+			for (auto& item : getRenderItems())
+			{
+				if (item->NumFramesDirty > 0)
+				{
+					ObjectRecord record;
+					record.ObjCBIndex = item->ObjCBIndex;
+					record.World = item->World;
+					record.TexTransform = item->TexTransform;
+					snapshot.Objects.push_back(record);
+					item->NumFramesDirty--;
+				}
+			}
+			mSceneGraph->draw();
+
+			gSimulation->Capture.Record(MillisecondsSince(start));
+		}
+
+		bool Update(const GameTimer& gt) override
+		{
+			{
+				PROFILE_SCOPE("SimulationState::SceneUpdate");
+				Clock::time_point start = Clock::now();
+				while (!mCommands.isEmpty())
+					mSceneGraph->onCommand(mCommands.pop(), gt);
+				mSceneGraph->update(gt);
+				gSimulation->SceneUpdate.Record(MillisecondsSince(start));
+			}
+			{
+				PROFILE_SCOPE("SimulationState::UpdateBounds");
+				Clock::time_point start = Clock::now();
+				UpdateBounds();
+				gSimulation->Bounds.Record(MillisecondsSince(start));
+			}
+			{
+				PROFILE_SCOPE("SimulationState::CullRenderItems");
+				Clock::time_point start = Clock::now();
+				gSimulation->LastCull = CullRenderItems(gSimulation->Camera);
+				gSimulation->Culling.Record(MillisecondsSince(start));
+			}
+			return true;
+		}
+
+		bool HandleEvent(std::uintptr_t key) override
+		{
+			float x = key == KeyLeft ? -1.0f : key == KeyRight ? 1.0f : 0.0f;
+			float z = key == KeyDown ? -1.0f : key == KeyUp ? 1.0f : 0.0f;
+			if (x != 0.0f || z != 0.0f)
+			{
+				Command steer;
+				steer.category = Category::PlayerAircraft;
+				steer.action = derivedAction<Drone>([x, z](Drone& drone, const GameTimer&)
+				{
+					drone.accelerate(x * 5.0f, 0.0f, z * 5.0f);
+				});
+				mCommands.push(steer);
+			}
+			else if (key == KeyPause)
+			{
+				RequestStackPush(States::Pause);
+			}
+			return true;
+		}
+
+		bool HandleRealTimeInput() override
+		{
+			return true;
+		}
+
+	private:
+		CommandQueue mCommands;
+	};
+
+	/**
+	 * @brief Blocks the simulation below it until the pause key comes again
+	 */
+	class PausedState : public State
+	{
+	public:
+		PausedState(StateStack* stack, Context* context)
+			: State(stack, context)
+		{
+		}
+
+		void Draw() override
+		{
+		}
+
+		bool Update(const GameTimer& gt) override
+		{
+			++gSimulation->PausedUpdates;
+			return false;
+		}
+
+		bool HandleEvent(std::uintptr_t key) override
+		{
+			if (key == KeyPause)
+				RequestStackPop();
+			else if (key == KeyRestart)
+			{
+				RequestStateClear();
+				if (gSimulation->Options.AsyncBuild)
+					RequestStackPushAsync(States::Game, States::Loading);
+				else
+					RequestStackPush(States::Game);
+			}
+			return false;
+		}
+
+		bool HandleRealTimeInput() override
+		{
+			return false;
+		}
+
+		bool IsTransparent() const override { return true; }
+	};
+
+	/**
+	 * @brief Stands in for the loading screen while the simulation is built
+	 */
+	class LoadingScreenState : public State
+	{
+	public:
+		LoadingScreenState(StateStack* stack, Context* context)
+			: State(stack, context)
+		{
+		}
+
+		void Draw() override
+		{
+		}
+
+		bool Update(const GameTimer& gt) override
+		{
+			++gSimulation->LoadingUpdates;
+			return false;
+		}
+
+		bool HandleEvent(std::uintptr_t key) override
+		{
+			return false;
+		}
+
+		bool HandleRealTimeInput() override
+		{
+			return false;
+		}
+	};
+
+	/**
+	 * @brief Stands in for Game::RenderFrame()
+	 *
+	 * Waits for the simulated GPU to release the next frame resource, writes the
+	 * snapshot's object constants, transposed, into it and encodes each draw into
+	 * a command stream, then submits the frame's GPU work.
+	 */
+	class SnapshotRecorder
+	{
+	public:
+		explicit SnapshotRecorder(unsigned framesInFlight)
+			: mScheduler(framesInFlight)
+			, mObjectConstants(framesInFlight)
+		{
+			mScheduler.SetFence(&mGpu);
+		}
+
+		void Record(const RenderSnapshot& snapshot)
+		{
+			PROFILE_SCOPE("SnapshotRecorder::Record");
+			Clock::time_point start = Clock::now();
+
+			unsigned slot = mScheduler.BeginFrame();
+			std::vector<XMFLOAT4X4>& objectConstants = mObjectConstants[slot];
+			for (const ObjectRecord& record : snapshot.Objects)
+			{
+				if (record.ObjCBIndex >= objectConstants.size())
+					objectConstants.resize(record.ObjCBIndex + 1);
+				XMStoreFloat4x4(&objectConstants[record.ObjCBIndex], XMMatrixTranspose(XMLoadFloat4x4(&record.World)));
+			}
+
+			mCommands.clear();
+			for (const DrawRecord& draw : snapshot.Draws)
+			{
+				mCommands.push_back(draw.ObjCBIndex);
+				mCommands.push_back(draw.MatCBIndex);
+				mCommands.push_back(draw.IndexCount);
+				mCommands.push_back(draw.StartIndexLocation);
+			}
+			mDraws += snapshot.Draws.size();
+
+			mGpu.Execute(gSimulation->Options.GpuMilliseconds);
+			mScheduler.EndFrame();
+
+			gSimulation->Recording.Record(MillisecondsSince(start));
+		}
+
+		/**
+		 * @brief Waits for the GPU to finish every submitted frame
+		 */
+		void Finish() { mScheduler.WaitForIdle(); }
+
+		std::uint64_t GetDrawCount() const { return mDraws; }
+		const LatencyHistogram& GetGpuWaits() const { return mScheduler.GetStallHistogram(); }
+		double GetGpuBusySeconds() const { return mGpu.GetBusySeconds(); }
+
+	private:
+		SimulatedGpu mGpu;
+		FrameScheduler mScheduler;
+		std::vector<std::vector<XMFLOAT4X4>> mObjectConstants;  // One per frame in flight
+		std::vector<std::uint32_t> mCommands;
+		std::uint64_t mDraws = 0;
+	};
+
+	bool ParseKey(const std::string& name, std::uintptr_t& key)
+	{
+		if (name == "left") key = KeyLeft;
+		else if (name == "right") key = KeyRight;
+		else if (name == "up") key = KeyUp;
+		else if (name == "down") key = KeyDown;
+		else if (name == "pause") key = KeyPause;
+		else if (name == "restart") key = KeyRestart;
+		else return false;
+		return true;
+	}
+
+	bool LoadScript(const std::string& path, std::vector<ScriptEvent>& script)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			std::fprintf(stderr, "Cannot open script %s\n", path.c_str());
+			return false;
+		}
+
+		std::string line;
+		for (unsigned number = 1; std::getline(file, line); ++number)
+		{
+			line = line.substr(0, line.find('#'));
+			std::istringstream fields(line);
+			ScriptEvent event;
+			std::string name;
+			if (!(fields >> event.Frame))
+				continue;
+			if (!(fields >> name) || !ParseKey(name, event.Key))
+			{
+				std::fprintf(stderr, "%s:%u: expected \"<frame> left|right|up|down|pause|restart\"\n", path.c_str(), number);
+				return false;
+			}
+			script.push_back(event);
+		}
+
+		std::stable_sort(script.begin(), script.end(),
+			[](const ScriptEvent& a, const ScriptEvent& b) { return a.Frame < b.Frame; });
+		return true;
+	}
+
+	std::vector<ScriptEvent> DefaultScript(unsigned frames)
+	{
+		std::vector<ScriptEvent> script;
+		const std::uintptr_t steering[] = { KeyUp, KeyRight, KeyDown, KeyLeft };
+		for (unsigned frame = 0; frame < frames; frame += 30)
+			script.push_back({ frame, steering[(frame / 30) % 4] });
+
+		// Pause for a second of simulated time half way through.
+		script.push_back({ frames / 2, KeyPause });
+		script.push_back({ frames / 2 + 60, KeyPause });
+		std::stable_sort(script.begin(), script.end(),
+			[](const ScriptEvent& a, const ScriptEvent& b) { return a.Frame < b.Frame; });
+		return script;
+	}
+
+	bool ParseOptions(int argc, char** argv, RunnerOptions& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			bool hasValue = i + 1 < argc;
+			if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+				options.Frames = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+			else if (std::strcmp(argv[i], "--entities") == 0 && hasValue)
+				options.Entities = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+			else if (std::strcmp(argv[i], "--dt") == 0 && hasValue)
+				options.DeltaTime = std::strtod(argv[++i], nullptr);
+			else if (std::strcmp(argv[i], "--script") == 0 && hasValue)
+				options.Script = argv[++i];
+			else if (std::strcmp(argv[i], "--trace") == 0 && hasValue)
+				options.Trace = argv[++i];
+			else if (std::strcmp(argv[i], "--csv") == 0 && hasValue)
+				options.Csv = argv[++i];
+			else if (std::strcmp(argv[i], "--stutter") == 0 && hasValue)
+				options.StutterThreshold = std::strtod(argv[++i], nullptr);
+			else if (std::strcmp(argv[i], "--tick-rate") == 0 && hasValue)
+				options.TickRate = std::max(0.0, std::strtod(argv[++i], nullptr));
+			else if (std::strcmp(argv[i], "--max-ticks") == 0 && hasValue)
+				options.MaxTicks = std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+			else if (std::strcmp(argv[i], "--record") == 0)
+				options.Record = true;
+			else if (std::strcmp(argv[i], "--render-thread") == 0 && hasValue)
+			{
+				options.Record = true;
+				options.RenderBuffers = std::max(2u, (unsigned)std::strtoul(argv[++i], nullptr, 10));
+			}
+			else if (std::strcmp(argv[i], "--gpu-ms") == 0 && hasValue)
+				options.GpuMilliseconds = std::max(0.0, std::strtod(argv[++i], nullptr));
+			else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && hasValue)
+				options.FramesInFlight = std::min(std::max(1u, (unsigned)std::strtoul(argv[++i], nullptr, 10)),
+					FrameScheduler::MaxFramesInFlight);
+			else if (std::strcmp(argv[i], "--state-cache") == 0)
+				options.StateCache = true;
+			else if (std::strcmp(argv[i], "--async-build") == 0)
+				options.AsyncBuild = true;
+			else if (std::strcmp(argv[i], "--bench") == 0)
+				options.Bench = true;
+			else
+			{
+				std::fprintf(stderr, "Usage: %s [--frames N] [--entities N] [--dt seconds] [--script file]\n"
+					"       [--trace file] [--csv file] [--stutter ms] [--tick-rate Hz] [--max-ticks N]\n"
+					"       [--record] [--render-thread N] [--gpu-ms ms] [--frames-in-flight N]\n"
+					"       [--state-cache] [--async-build]\n"
+					"       %s --bench\n", argv[0], argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void PrintTiming(const char* name, const LatencyHistogram& timing)
+	{
+		if (timing.GetCount() == 0)
+			return;
+		std::printf("  %-14s p50 %8.4f ms   p90 %8.4f ms   p99 %8.4f ms   max %8.4f ms   mean %8.4f ms   (%llu frames)\n",
+			name, timing.GetPercentile(50.0), timing.GetPercentile(90.0), timing.GetPercentile(99.0),
+			timing.GetMax(), timing.GetMean(), (unsigned long long)timing.GetCount());
+	}
+
+	/**
+	 * @brief Decodes a 1024 x 1024 surface of every BC format with each supported kernel
+	 */
+	void BenchBlockDecoder()
+	{
+		const BlockFormat formats[] =
+		{
+			BlockFormat::BC1, BlockFormat::BC2, BlockFormat::BC3, BlockFormat::BC4UNorm, BlockFormat::BC4SNorm,
+			BlockFormat::BC5UNorm, BlockFormat::BC5SNorm, BlockFormat::BC6HUF16, BlockFormat::BC6HSF16, BlockFormat::BC7,
+		};
+		const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2 };
+		const SimdLevel supported = BlockDecoder::GetSupportedSimdLevel();
+
+		std::printf("Block decoder, 1024 x 1024 on one thread, MB/s of RGBA8 output\n  %-10s", "format");
+		for (SimdLevel level : levels)
+		{
+			if (level <= supported)
+				std::printf(" %10s", BlockDecoder::SimdLevelName(level));
+		}
+		std::printf("\n");
+
+		for (BlockFormat format : formats)
+		{
+			std::printf("  %-10s", BlockDecoder::FormatName(format));
+			for (SimdLevel level : levels)
+			{
+				if (level > supported)
+					continue;
+				BlockDecoder::SetSimdLevel(level);
+				std::printf(" %10.1f", BlockDecoder::MeasureThroughput(format, 1024, 1024, 8, 1));
+			}
+			std::printf("\n");
+		}
+		BlockDecoder::SetSimdLevel(supported);
+	}
+
+	/**
+	 * @brief Generates a 1000 x 1000 vertex hills terrain per vertex and in batches
+	 */
+	void BenchTerrain()
+	{
+		HillTerrainDesc desc;
+		desc.Rows = 1000;
+		desc.Columns = 1000;
+
+		std::printf("Hills terrain, %u x %u vertices, fastest of 5 (batch path %s)\n",
+			desc.Rows, desc.Columns, TerrainGenerator::IsSimdEnabled() ? "SSE2" : "scalar");
+		for (unsigned threads : { 1u, 0u })
+		{
+			TerrainBenchmark result = TerrainGenerator::MeasureHills(desc, 5, threads);
+			std::printf("  %-10s per vertex %8.3f ms   batch %8.3f ms   %5.1fx   max error %.2g height, %.2g normal\n",
+				threads == 1 ? "1 thread" : "all cores", result.ScalarMilliseconds, result.BatchMilliseconds,
+				result.BatchMilliseconds > 0.0 ? result.ScalarMilliseconds / result.BatchMilliseconds : 0.0,
+				result.MaxHeightError, result.MaxNormalError);
+		}
+	}
+
+	/**
+	 * @brief Rasterizes 40 occluder boxes and tests 20000 boxes behind them
+	 */
+	void BenchOcclusion()
+	{
+		const unsigned occluders = 40;
+		const unsigned tests = 20000;
+		std::printf("Occlusion culler, %u occluders, %u test boxes, %d pixels per step, fastest of 20\n",
+			occluders, tests, OcclusionCuller::GetSimdWidth());
+
+		const std::uint32_t sizes[][2] = { { 256, 128 }, { 512, 256 } };
+		for (const auto& size : sizes)
+		{
+			OcclusionCullerDesc desc;
+			desc.Width = size[0];
+			desc.Height = size[1];
+			OcclusionBenchmark result = OcclusionCuller::Measure(desc, occluders, tests, 20);
+			std::printf("  %4u x %-4u raster %8.3f ms   test %8.3f ms   %zu triangles, %zu / %zu boxes occluded\n",
+				desc.Width, desc.Height, result.RasterMilliseconds, result.TestMilliseconds,
+				result.Triangles, result.Occluded, result.Tested);
+		}
+	}
+
+	/**
+	 * @brief Optimizes the box and hills grid the game builds and prints their cache statistics
+	 *
+	 * Each mesh is optimized with and without the overdraw pass, and the triangles the
+	 * pass moved are counted.
+	 */
+	void BenchMeshOptimizer()
+	{
+		GeometryGenerator geoGen;
+
+		// The 50 x 50 hills of Game::BuildHillGeometry().
+		HillTerrainDesc hills;
+		hills.Width = 1.0f;
+		hills.Depth = 1.0f;
+		GeometryGenerator::MeshData grid;
+		grid.Vertices.resize((std::size_t)hills.Rows * hills.Columns);
+		grid.Indices32.resize((std::size_t)(hills.Rows - 1) * (hills.Columns - 1) * 6);
+		TerrainVertexLayout layout;
+		layout.Positions = &grid.Vertices[0].Position.x;
+		layout.Normals = &grid.Vertices[0].Normal.x;
+		layout.TexCoords = &grid.Vertices[0].TexC.x;
+		layout.Stride = sizeof(GeometryGenerator::Vertex);
+		TerrainGenerator::GenerateHills(hills, layout);
+		TerrainGenerator::GenerateGridIndices(hills.Rows, hills.Columns, grid.Indices32.data());
+
+		struct NamedMesh { const char* Name; GeometryGenerator::MeshData Mesh; };
+		NamedMesh meshes[] =
+		{
+			{ "box", geoGen.CreateBox(1, 0, 1, 1) },
+			{ "grid", grid },
+			{ "sphere", geoGen.CreateSphere(1.0f, 40, 40) },
+		};
+
+		std::printf("Mesh optimizer, %u entry FIFO cache\n", MeshOptimizer::DefaultCacheSize);
+		for (NamedMesh& named : meshes)
+		{
+			GeometryGenerator::MeshData withOverdraw = named.Mesh;
+			MeshOptimizationReport report = geoGen.Optimize(named.Mesh, false);
+			geoGen.Optimize(withOverdraw, true);
+
+			std::size_t triangles = named.Mesh.Indices32.size() / 3;
+			std::size_t moved = 0;
+			for (std::size_t t = 0; t < triangles; ++t)
+			{
+				if (!std::equal(&named.Mesh.Indices32[t * 3], &named.Mesh.Indices32[t * 3] + 3, &withOverdraw.Indices32[t * 3]))
+					++moved;
+			}
+
+			std::printf("  %-8s ACMR %.3f -> %.3f   ATVR %.3f -> %.3f   vertices %zu -> %zu   overdraw pass moves %zu / %zu triangles\n",
+				named.Name, report.Before.ACMR, report.After.ACMR, report.Before.ATVR, report.After.ATVR,
+				report.VertexCountBefore, report.VertexCountAfter, moved, triangles);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Simulation simulation;
+	if (!ParseOptions(argc, argv, simulation.Options))
+		return 1;
+	if (simulation.Options.Bench)
+	{
+		BenchBlockDecoder();
+		BenchTerrain();
+		BenchOcclusion();
+		BenchMeshOptimizer();
+		return 0;
+	}
+	gSimulation = &simulation;
+	gNumFrameResources = (int)simulation.Options.FramesInFlight;
+
+	std::vector<ScriptEvent> script;
+	if (simulation.Options.Script.empty())
+		script = DefaultScript(simulation.Options.Frames);
+	else if (!LoadScript(simulation.Options.Script, script))
+		return 1;
+
+	if (!simulation.Options.Trace.empty())
+	{
+		Profiler::SetThreadName("Main");
+		Profiler::SetEnabled(true);
+	}
+
+	// Camera above the arena looking down at its middle, 150 units wide.
+	const float viewProjection[16] = {
+		1.0f / 75.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, -1.0f / 500.0f, 0.0f,
+		0.0f, 1.0f / 75.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.5f, 1.0f };
+	FrustumCuller::ExtractPlanes(viewProjection, simulation.Camera);
+
+	StateStack stateStack(State::Context(nullptr, nullptr));
+	stateStack.registerState<SimulationState>(States::Game);
+	stateStack.registerState<PausedState>(States::Pause);
+	stateStack.registerState<LoadingScreenState>(States::Loading);
+	if (simulation.Options.StateCache)
+	{
+		stateStack.SetStateCaching(States::Game, true);
+		stateStack.SetStateCaching(States::Pause, true);
+		stateStack.SetStateCacheLimits(4, 256 * 1024 * 1024);
+	}
+
+	// The push is applied at the end of the first update, which builds the scene.
+	GameTimer timer;
+	timer.Reset();
+	Clock::time_point start = Clock::now();
+	stateStack.pushState(States::Game);
+	stateStack.Update(timer);
+	double buildMilliseconds = MillisecondsSince(start);
+
+	// Nothing is drawn or waited on, so the whole frame counts as update.
+	FrameStatistics frameStats;
+	if (simulation.Options.StutterThreshold > 0.0)
+		frameStats.SetStutterThreshold(simulation.Options.StutterThreshold);
+
+	FixedTimestep step(simulation.Options.TickRate > 0.0 ? simulation.Options.TickRate : 60.0,
+		simulation.Options.MaxTicks);
+	auto tick = [&stateStack](const GameTimer& gt)
+	{
+		stateStack.Update(gt);
+		stateStack.handleRealTimeInput();
+	};
+
+	// Without a render thread the snapshots are recorded as they are handed over.
+	SnapshotRecorder recorder(simulation.Options.FramesInFlight);
+	RenderThread renderThread(simulation.Options.RenderBuffers);
+	std::vector<RenderSnapshot> snapshots(renderThread.GetBufferCount());
+	if (simulation.Options.Record)
+		renderThread.Start([&](unsigned buffer) { recorder.Record(snapshots[buffer]); }, simulation.Options.RenderBuffers > 0);
+
+	Clock::time_point runStart = Clock::now();
+	size_t nextEvent = 0;
+	for (unsigned frame = 0; frame < simulation.Options.Frames && !stateStack.isEmpty(); ++frame)
+	{
+		PROFILE_SCOPE("Frame");
+		start = Clock::now();
+		timer.Advance(simulation.Options.DeltaTime);
+
+		for (; nextEvent < script.size() && script[nextEvent].Frame <= frame; ++nextEvent)
+			stateStack.HandleEvent(script[nextEvent].Key);
+
+		if (simulation.Options.TickRate > 0.0)
+			step.Update(simulation.Options.DeltaTime, tick);
+		else
+			tick(timer);
+
+		FrameSample sample;
+		if (simulation.Options.Record && !stateStack.isEmpty())
+		{
+			double stallSeconds = renderThread.GetStallSeconds();
+			unsigned buffer = renderThread.BeginFrame();
+			sample.FenceWait = (renderThread.GetStallSeconds() - stallSeconds) * 1000.0;
+
+			simulation.Snapshot = &snapshots[buffer];
+			simulation.Snapshot->Clear();
+			stateStack.Draw();
+			simulation.Snapshot = nullptr;
+
+			Clock::time_point handedOver = Clock::now();
+			renderThread.EndFrame(buffer);
+			sample.Draw = MillisecondsSince(handedOver);
+			sample.Update = std::chrono::duration<double, std::milli>(handedOver - start).count() - sample.FenceWait;
+			sample.Frame = MillisecondsSince(start);
+		}
+		else
+		{
+			sample.Frame = sample.Update = MillisecondsSince(start);
+		}
+		frameStats.AddFrame(sample);
+	}
+	renderThread.Stop();
+	recorder.Finish();
+	double runSeconds = MillisecondsSince(runStart) / 1000.0;
+
+	std::printf("Headless run: %u frames of %.4f s, %u entities, %zu script events\n",
+		(unsigned)frameStats.GetFrameCount(), simulation.Options.DeltaTime, simulation.Options.Entities, script.size());
+	std::printf("  build          %8.3f ms\n", buildMilliseconds);
+	PrintTiming("frame", frameStats.GetHistogram(FrameStatistics::Frame));
+	PrintTiming("scene update", simulation.SceneUpdate);
+	PrintTiming("bounds", simulation.Bounds);
+	PrintTiming("culling", simulation.Culling);
+	PrintTiming("capture", simulation.Capture);
+	PrintTiming("recording", simulation.Recording);
+	if (simulation.Options.Record)
+	{
+		PrintTiming("snapshot wait", frameStats.GetHistogram(FrameStatistics::FenceWait));
+		PrintTiming("end frame", frameStats.GetHistogram(FrameStatistics::Draw));
+		PrintTiming("gpu wait", recorder.GetGpuWaits());
+		if (simulation.Options.RenderBuffers > 0)
+			std::printf("  %llu draws recorded on a render thread with %u snapshots, %.3f s waiting for a free one\n",
+				(unsigned long long)recorder.GetDrawCount(), renderThread.GetBufferCount(), renderThread.GetStallSeconds());
+		else
+			std::printf("  %llu draws recorded inline\n", (unsigned long long)recorder.GetDrawCount());
+		std::printf("  %u frames in flight, simulated GPU busy %.3f s of %.3f s (%.1f%%)\n",
+			simulation.Options.FramesInFlight, recorder.GetGpuBusySeconds(), runSeconds,
+			runSeconds > 0.0 ? 100.0 * recorder.GetGpuBusySeconds() / runSeconds : 0.0);
+	}
+	std::printf("  %zu states built, %zu resumed from the cache, %zu cached (%zu KB)\n",
+		stateStack.GetStateBuildCount(), stateStack.GetStateResumeCount(), stateStack.GetCachedStateCount(),
+		stateStack.GetCachedBytes() / 1024);
+	std::printf("  %u render items hold %u object constant slots\n",
+		stateStack.GetRenderItemRegistry().GetItemCount(), stateStack.GetRenderItemRegistry().GetSlotCount());
+	std::printf("  %llu stutters over %.2f ms\n",
+		(unsigned long long)frameStats.GetStutterCount(), frameStats.GetStutterThreshold());
+	if (simulation.Options.TickRate > 0.0)
+		std::printf("  %llu ticks at %.1f Hz, %.3f s dropped by the cap of %u a frame\n",
+			(unsigned long long)step.GetTickCount(), simulation.Options.TickRate, step.GetDroppedSeconds(),
+			step.GetMaxTicksPerFrame());
+	if (simulation.Options.AsyncBuild)
+		std::printf("  %u updates on the loading state while the scene was built\n", simulation.LoadingUpdates);
+	std::printf("  simulated %.2f s, %u updates paused, last frame %zu visible / %zu culled\n",
+		simulation.Options.TickRate > 0.0 ? step.GetClock().TotalTime() : timer.TotalTime(),
+		simulation.PausedUpdates, simulation.LastCull.Visible, simulation.LastCull.Culled);
+
+	if (!simulation.Options.Csv.empty())
+	{
+		if (!frameStats.SaveCsv(simulation.Options.Csv))
+		{
+			std::fprintf(stderr, "Cannot write %s\n", simulation.Options.Csv.c_str());
+			return 1;
+		}
+		std::printf("  frame times written to %s\n", simulation.Options.Csv.c_str());
+	}
+
+	if (!simulation.Options.Trace.empty())
+	{
+		if (!Profiler::SaveChromeTrace(simulation.Options.Trace))
+		{
+			std::fprintf(stderr, "Cannot write trace %s\n", simulation.Options.Trace.c_str());
+			return 1;
+		}
+		std::printf("  trace written to %s\n", simulation.Options.Trace.c_str());
+	}
+	return 0;
+}
@@ -42,48 +42,18 @@ unsigned int Aircraft::getCategory() const
 }
 
 /**
- * @brief Executes DirectX 12 rendering commands for the aircraft
+ * @brief Adds the aircraft's draw to the frame's render snapshot
  *
- * Configures and submits draw calls using current frame resources:
- * 1. Retrieves constant buffer resources
- * 2. Sets up vertex/index buffers
- * 3. Binds shader resources (textures, materials)
- * 4. Submits indexed draw call
+ * The render thread binds the aircraft's constants, texture and index buffer
+ * and records the draw once the snapshot is handed over.
  *
- * @note Skips rendering if mAircraftRitem is null. Requires valid
- *       frame resource setup in Game class.
+ * @note Skips rendering if mAircraftRitem is null or was culled.
  */
 void Aircraft::drawCurrent() const
-{	
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
-
-	Game* game = mState->GetContext()->game;
-
-	auto objectCB = game->mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = game->mCurrFrameResource->MaterialCB->Resource();
-
-	if (mAircraftRitem != nullptr)
-	{
-		auto vertexBufferView = mAircraftRitem->Geo->VertexBufferView();
-		auto indexBufferView = mAircraftRitem->Geo->IndexBufferView();
-
-		game->getCmdList()->IASetVertexBuffers(0, 1, &vertexBufferView);
-		game->getCmdList()->IASetIndexBuffer(&indexBufferView);
-		game->getCmdList()->IASetPrimitiveTopology(mAircraftRitem->PrimitiveType);
-
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(game->mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(mAircraftRitem->Mat->DiffuseSrvHeapIndex, game->mCbvSrvDescriptorSize);
-
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + (UINT64)mAircraftRitem->ObjCBIndex * objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + (UINT64)mAircraftRitem->Mat->MatCBIndex * matCBByteSize;
-
-		game->getCmdList()->SetGraphicsRootDescriptorTable(0, tex);
-		game->getCmdList()->SetGraphicsRootConstantBufferView(1, objCBAddress);
-		game->getCmdList()->SetGraphicsRootConstantBufferView(3, matCBAddress);
-
-		game->getCmdList()->DrawIndexedInstanced(mAircraftRitem->IndexCount, 1, mAircraftRitem->StartIndexLocation, mAircraftRitem->BaseVertexLocation, 0);
-	}
+{
+	// Items outside the camera frustum were flagged by State::CullRenderItems().
+	if (mAircraftRitem != nullptr && mAircraftRitem->Visible)
+		mState->GetContext()->game->CaptureDraw(*mAircraftRitem);
 }
 
 /**
@@ -107,13 +77,9 @@ void Aircraft::buildCurrent()
 	auto render = std::make_unique<RenderItem>();
 	renderer = render.get();
 	renderer->World = getTransform();
-	renderer->ObjCBIndex = (UINT)mState->getRenderItems().size();
-	renderer->Mat = game->getMaterials()[mSprite].get();
-	renderer->Geo = game->getGeometries()["boxGeo"].get();
-	renderer->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	renderer->IndexCount = renderer->Geo->DrawArgs["box"].IndexCount;
-	renderer->StartIndexLocation = renderer->Geo->DrawArgs["box"].StartIndexLocation;
-	renderer->BaseVertexLocation = renderer->Geo->DrawArgs["box"].BaseVertexLocation;
+	renderer->Mat = game->AcquireMaterial(mSprite);
+	renderer->Geo = game->getGeometries().at("boxGeo").get();
+	renderer->SetSubmesh(renderer->Geo->DrawArgs.at("box"));
 	mAircraftRitem = render.get();
-	mState->getRenderItems().push_back(std::move(render));
+	mState->addRenderItem(std::move(render));
 }
@@ -49,11 +49,8 @@ private:
 	/**
 	 * @brief Implements aircraft-specific drawing logic
 	 *
-	 * Overrides Entity::drawCurrent(). Configures DirectX 12 commands for:
-	 * - Vertex/Index buffer setup
-	 * - Constant buffer binding
-	 * - Texture descriptor handling
-	 * - Draw call submission
+	 * Overrides Entity::drawCurrent(). Adds the aircraft's draw to the
+	 * render snapshot, see Game::CaptureDraw().
 	 */
 	virtual void		drawCurrent() const;
 
@@ -1,7 +1,7 @@
 #pragma region Step 5
 #pragma once
 #include "Category.hpp"
-#include "../../Common/d3dApp.h"
+#include "../../Common/GameTimer.h"
 #include <functional>
 #include <cassert>
 
@@ -62,6 +62,7 @@ void Entity::updateCurrent(const GameTimer& gt)
 
 	renderer->World = getWorldTransform();
 	renderer->NumFramesDirty++;
+	renderer->BoundsDirty = true;
 }
 
 /**
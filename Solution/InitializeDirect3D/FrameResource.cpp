@@ -6,8 +6,14 @@
  * @param passCount Number of passes.
  * @param objectCount Number of objects.
  * @param materialCount Number of materials.
+ * @param terrainChunkCount Number of terrain chunks drawn at most.
+ * @param spriteCount Number of sprite instances.
  */
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT terrainChunkCount,
+    UINT spriteCount)
+    : ObjectCount(objectCount)
+    , MaterialCount(materialCount)
+    , SpriteCount(spriteCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -17,6 +23,8 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCo
     PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
     MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
     ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    TerrainCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, terrainChunkCount, true);
+    Sprites = std::make_unique<UploadBuffer<SpriteInstance>>(device, spriteCount, false);
 }
 
 /**
@@ -11,6 +11,35 @@ struct ObjectConstants
 {
     DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+	// Decode the packed vertices of the object's submesh (see PackedVertex).
+	DirectX::XMFLOAT3 PosCenter = { 0.0f, 0.0f, 0.0f };
+	float ObjPad0 = 0.0f;
+	DirectX::XMFLOAT3 PosExtents = { 1.0f, 1.0f, 1.0f };
+	float ObjPad1 = 0.0f;
+	DirectX::XMFLOAT2 TexCoordOffset = { 0.0f, 0.0f };
+	DirectX::XMFLOAT2 TexCoordScale = { 1.0f, 1.0f };
+};
+
+/**
+ * @brief Object and material constants of one sprite, read by SpriteVS as gSprites[i].
+ *
+ * Matrices are transposed for the shaders, as in the constant buffers.
+ */
+struct SpriteInstance
+{
+	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+	DirectX::XMFLOAT3 PosCenter = { 0.0f, 0.0f, 0.0f };
+	float SpritePad0 = 0.0f;
+	DirectX::XMFLOAT3 PosExtents = { 1.0f, 1.0f, 1.0f };
+	float SpritePad1 = 0.0f;
+	DirectX::XMFLOAT2 TexCoordOffset = { 0.0f, 0.0f };
+	DirectX::XMFLOAT2 TexCoordScale = { 1.0f, 1.0f };
 };
 
 /**
@@ -53,6 +82,19 @@ struct Vertex
 	DirectX::XMFLOAT2 TexC;
 };
 
+/**
+ * @brief Vertex as stored in the geometry arena, 16 bytes instead of 32.
+ *
+ * Built from Vertex by Game::AddMeshGeometry() with VertexQuantizer.  The vertex
+ * shader expands it with the submesh constants in ObjectConstants.
+ */
+struct PackedVertex
+{
+	std::int16_t Pos[4];     ///< SNORM16 relative to the submesh bounds, w unused
+	std::int16_t Normal[2];  ///< SNORM16 octahedral encoding
+	std::uint16_t TexC[2];   ///< UNORM16 relative to the submesh UV range
+};
+
 /**
  * @brief Class representing resources needed for the CPU to build command lists for a frame.
  */
@@ -66,8 +108,11 @@ public:
      * @param passCount Number of passes.
      * @param objectCount Number of objects.
      * @param materialCount Number of materials.
+     * @param terrainChunkCount Number of terrain chunks drawn at most.
+     * @param spriteCount Number of sprite instances.
      */
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
+    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT terrainChunkCount,
+        UINT spriteCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     /**
@@ -85,8 +130,10 @@ public:
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+    std::unique_ptr<UploadBuffer<ObjectConstants>> TerrainCB = nullptr;  ///< One entry per terrain chunk drawn
+    std::unique_ptr<UploadBuffer<SpriteInstance>> Sprites = nullptr;     ///< Structured buffer of the sprite batches
 
-    // Fence value to mark commands up to this fence point.  This lets us
-    // check if these frame resources are still in use by the GPU.
-    UINT64 Fence = 0;
+    UINT ObjectCount = 0;    ///< Entries in ObjectCB
+    UINT MaterialCount = 0;  ///< Entries in MaterialCB
+    UINT SpriteCount = 0;    ///< Entries in Sprites
 };
\ No newline at end of file
@@ -6,9 +6,78 @@
 #include "MainMenuState.hpp"
 #include "PauseState.hpp"
 #include "InstructionsState.hpp"
+#include "LoadingState.hpp"
 
 
-const int gNumFrameResources = 3;
+// Frame resources in the ring; Game::SetFramesInFlight() keeps it equal to
+// mFrameScheduler.GetFramesInFlight(), so new render items are dirty for every one.
+int gNumFrameResources = 3;
+
+// Banners small enough to share an atlas page; BuildTextureAtlas() packs them together.
+static const std::array<std::string, 6> gAtlasTextureNames =
+{
+	"TitleTex", "MenuTextTex", "PauseTextTex", "GameTextTex", "WASDTex", "BackTex"
+};
+
+// The SRV heap holds resident textures; room is left for textures registered
+// after start-up.
+static const UINT gSrvHeapPersistentCapacity = 256;
+
+// Smallest constant buffers of a frame resource. They grow by doubling when a state
+// needs more, so entering a state seldom replaces the frame resources.
+static const UINT gMinObjectCBCapacity = 64;
+static const UINT gMinMaterialCBCapacity = 32;
+
+// Smallest sprite instance buffer of a frame resource. It is rewritten every frame,
+// so the render thread grows it on its own, by doubling, when a snapshot needs more.
+static const UINT gMinSpriteCapacity = 64;
+
+// Popped menu states kept for their next push. A menu scene is a few sprites, so the
+// byte limit is only there to stop a runaway state from being kept.
+static const size_t gStateCacheMaxStates = 4;
+static const size_t gStateCacheMaxBytes = 4 * 1024 * 1024;
+
+// Staging memory shared by every buffer and texture upload. Larger than any single
+// texture the game ships, so uploads only wait on the GPU when many are queued at once.
+static const UINT64 gStagingRingSize = 16 * 1024 * 1024;
+
+// Every mesh is suballocated from one vertex and one index buffer of this size.
+static const UINT gGeometryArenaVertexCapacity = 256 * 1024;
+static const UINT gGeometryArenaIndex16Capacity = 256 * 1024;
+static const UINT gGeometryArenaIndex32Capacity = 256 * 1024;
+
+// Shape of the hills terrain, h = amplitude * (z sin(frequency x) + x cos(frequency z)).
+static const float gHillAmplitude = 0.1f;
+static const float gHillFrequency = 0.1f;
+
+// Streamed hills: chunk size and resolution, distance between levels of detail and
+// chunks kept on each side of the one under the camera.
+static const float gTerrainChunkSize = 4.0f;
+static const UINT gTerrainChunkQuads = 16;
+static const UINT gTerrainLodCount = 3;
+static const float gTerrainLodDistance = 4.0f;
+static const UINT gTerrainViewRadius = 3;
+
+// Resolution of the CPU depth buffer the occluders are rasterized into.
+static const UINT gOcclusionBufferWidth = 256;
+static const UINT gOcclusionBufferHeight = 128;
+
+// Meshes switch to a coarser level of detail once its error covers less than this
+// many pixels on screen.
+static const float gLodPixelError = 1.0f;
+
+// Object constants are stored transposed for the shaders.
+static ObjectConstants MakeObjectConstants(const ObjectRecord& record)
+{
+	ObjectConstants constants;
+	XMStoreFloat4x4(&constants.World, XMMatrixTranspose(XMLoadFloat4x4(&record.World)));
+	XMStoreFloat4x4(&constants.TexTransform, XMMatrixTranspose(XMLoadFloat4x4(&record.TexTransform)));
+	constants.PosCenter = record.PosCenter;
+	constants.PosExtents = record.PosExtents;
+	constants.TexCoordOffset = record.TexCoordOffset;
+	constants.TexCoordScale = record.TexCoordScale;
+	return constants;
+}
 
 /**
  * @brief Constructor for the Game class.
@@ -18,18 +87,23 @@ Game::Game(HINSTANCE hInstance)
 	: D3DApp(hInstance)
 	//, mWorld(this) // Pass 'this' pointer to the World constructor
 	, mPlayer()
-	, mStateStack(State::Context(this, &mPlayer))
+	, mStateStack(State::Context(this, &mPlayer, [this](RenderItem& item) { ReleaseMaterial(item.Mat); }))
 {
 }
 
 /**
  * @brief Destructor for the Game class.
  *
- * Flushes the command queue to ensure all GPU commands are completed
- * before releasing resources.
+ * Waits for a state being built on a worker, lets the render thread submit
+ * the frames it was handed, then flushes the command queue to ensure all GPU
+ * commands are completed before releasing resources.
  */
 Game::~Game()
 {
+	// A state still being built holds pointers to the materials and geometry.
+	try { mStateStack.WaitForAsyncBuild(); } catch (...) {}
+
+	mRenderThread.Stop();
 	if (md3dDevice != nullptr)
 		FlushCommandQueue();
 }
@@ -48,36 +122,73 @@ bool Game::Initialize()
 	if (!D3DApp::Initialize())
 		return false;
 
+	// Zones are always recorded; F3 saves the most recent ones, see OnKeyDown().
+	Profiler::SetThreadName("Main");
+	mSimulationThread = std::this_thread::get_id();
+	Profiler::SetEnabled(true);
+
+	// Frames wait for their frame resource, and uploads for their batch, on the queue fence.
+	mFrameScheduler.SetFence(mFrameFence.get());
+
 	// Set initial camera position and orientation
 	mCamera.SetPosition(0, 8, 0);
 	mCamera.Pitch(3.14 / 2);
 
-	// Reset the command list to prep for initialization commands.
-	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
+	// Uploads are recorded on their own command list, so states can stage textures and
+	// terrain chunks while the render thread records a frame on mCommandList.
+	ThrowIfFailed(md3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+		IID_PPV_ARGS(mUploadCmdListAlloc.GetAddressOf())));
+	ThrowIfFailed(md3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+		mUploadCmdListAlloc.Get(), nullptr, IID_PPV_ARGS(mUploadCommandList.GetAddressOf())));
+	mUploadsOpen = true;
+
+	mStagingUploader = std::make_unique<StagingUploader>(md3dDevice.Get(), gStagingRingSize);
+	mGeometryArena = std::make_unique<GeometryArena>(md3dDevice.Get(), (UINT)sizeof(PackedVertex), gGeometryArenaVertexCapacity,
+		gGeometryArenaIndex16Capacity, gGeometryArenaIndex32Capacity);
 
 	// Get the increment size of a descriptor in this heap type
 	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-	// Build the core game resources
+	// Build the core game resources. Textures and materials are only registered
+	// here; each state creates the ones it uses when its scene is built.
 	LoadTextures();
 	BuildRootSignature();
 	BuildDescriptorHeaps();
 	BuildShadersAndInputLayout();
 	BuildShapeGeometry();
 	BuildHillGeometry();
+	BuildTerrain();
 	BuildMaterials();
+
+	OcclusionCullerDesc occlusionDesc;
+	occlusionDesc.Width = gOcclusionBufferWidth;
+	occlusionDesc.Height = gOcclusionBufferHeight;
+	mOcclusionCuller = std::make_unique<OcclusionCuller>(occlusionDesc);
+
 	RegisterStates();
 	mStateStack.pushState(States::Title);
 
 	BuildPSOs();
 
-	// Execute the initialization commands.
-	ThrowIfFailed(mCommandList->Close());
-	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	// Enter the title state now: the states run at a fixed tick rate, and the first
+	// frame usually comes too soon after start-up to owe a tick.
+	mStateStack.Update(mSimulationStep.GetClock());
+
+	// Submit the initialization uploads as one batch; the first frame runs after them on the queue.
+	FlushResourceUploads();
+
+	// Sized for the title state; later states grow them from Update().
+	ReserveFrameResources();
+	BuildFrameResources();
+
+	std::wostringstream stats;
+	stats << L"Staging: " << mStagingUploader->GetBytesStaged() / 1024 << L" KB uploaded through "
+		<< mStagingUploader->GetUploadResourceCount() << L" upload heap(s), high-water mark "
+		<< mStagingUploader->GetHighWaterMark() / 1024 << L" of " << mStagingUploader->GetCapacity() / 1024 << L" KB\n";
+	OutputDebugString(stats.str().c_str());
 
-	// Wait until initialization is complete.
-	FlushCommandQueue();
+	mSnapshots.resize(mRenderThread.GetBufferCount());
+	mRenderThread.Start([this](unsigned buffer) { RenderFrame(mSnapshots[buffer]); });
 
 	return true;
 }
@@ -90,6 +201,9 @@ bool Game::Initialize()
  */
 void Game::OnResize()
 {
+	// The back buffers and depth buffer are about to be recreated under the render thread.
+	mRenderThread.Flush();
+
 	D3DApp::OnResize();
 
 	// The window resized, so update the aspect ratio and recompute the projection matrix.
@@ -103,19 +217,31 @@ void Game::OnResize()
 /**
  * @brief Updates the game state.
  *
- * This method processes input, updates the game world, updates the camera,
- * cycles through frame resources, waits for the GPU to complete previous
- * commands, animates materials, and updates constant buffers.
+ * This method processes input, updates the game world and the camera, culls
+ * the render items and fills a render snapshot with the changed constants and
+ * the draws of the visible items.  The render thread may still be recording the
+ * previous snapshot meanwhile.
  *
  * @param gt A const reference to a GameTimer object.
  */
 void Game::Update(const GameTimer& gt)
 {
-	// Handle input and game world updates
-	//ProcessInput();
-	//mWorld.update(gt);
-	mStateStack.Update(gt);
-	mStateStack.handleRealTimeInput();
+	PROFILE_SCOPE("Game::Update");
+
+	// Handle input and game world updates at a fixed rate; the camera, materials and
+	// pass constants below still follow the frame time, and the items that moved in
+	// the last tick are drawn between their last two positions, see CaptureObjects().
+	mSimulationStep.Update(gt.DeltaTime(), [this](const GameTimer& tick)
+	{
+		SavePreviousWorlds();
+		mStateStack.Update(tick);
+		mStateStack.handleRealTimeInput();
+	});
+
+	// A state that was just entered may have loaded textures, and one that was
+	// popped or evicted from the cache may have left some unused.
+	FlushResourceUploads();
+	TrimUnusedAssets();
 
 	if (mStateStack.isEmpty())
 	{
@@ -125,42 +251,119 @@ void Game::Update(const GameTimer& gt)
 
 	UpdateCamera(gt);
 
-	// Cycle through the circular frame resource array.
-	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
-	mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, mCamera.GetView() * mCamera.GetProj());
+	FrustumCuller::ExtractPlanes(&viewProj.m[0][0], mCameraFrustum);
+	mOcclusionCuller->BeginFrame(&viewProj.m[0][0]);
 
-	// Wait for GPU completion
-	if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
+	ReleaseCompletedUploads();
+	ReleaseRetiredTextures();
+
+	// An overlay such as the pause state is drawn over the state under it, so
+	// every visible state is culled and captured.
+	mStateStack.GetVisibleStates(mVisibleStates);
+
+	// World bounds follow the transforms the state update has just written.
+	for (State* state : mVisibleStates)
+		state->UpdateBounds();
+
+	// Only the items inside the camera frustum and not hidden by an occluder reach
+	// the snapshot; terrain chunks are culled as they are captured and add to the
+	// same counts.  A state's occluders also hide the items of the states above it.
+	mCullStats = CullingStats();
+	for (State* state : mVisibleStates)
 	{
-		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
+		CullingStats stats = state->CullRenderItems(mCameraFrustum, mOcclusionCuller.get());
+		mCullStats.Visible += stats.Visible;
+		mCullStats.Culled += stats.Culled;
+		mCullStats.Occluded += stats.Occluded;
 	}
 
-	// Update scene-dependent constant buffers
+	// The render thread waits for the GPU to free a frame resource, so a GPU-bound
+	// frame shows up here as the wait for a snapshot it has finished reading.
+	double stallSeconds = mRenderThread.GetStallSeconds();
+	mCaptureBuffer = mRenderThread.BeginFrame();
+	mFrameSample.FenceWait += (mRenderThread.GetStallSeconds() - stallSeconds) * 1000.0;
+
+	mCapture = &mSnapshots[mCaptureBuffer];
+	mCapture->Clear();
+
+	ReserveFrameResources();
+	mCapture->ObjectCapacity = mObjectCBCapacity;
+	mCapture->MaterialCapacity = mMaterialCBCapacity;
+
 	AnimateMaterials(gt);
-	UpdateObjectCBs(gt);
-	UpdateMaterialCBs(gt);
-	UpdateMainPassCB(gt);
+	CaptureObjects();
+	CaptureMaterials();
+	CapturePass(gt);
+
+	// The scene nodes add their draws in scene graph order.
+	mStateStack.Draw();
 }
 
 /**
- * @brief Draws the game scene.
+ * @brief Hands the snapshot filled by Update() to the render thread.
  *
- * This method draws the game scene by resetting the command list,
- * setting the viewport and scissor rectangles, transitioning the
- * back buffer to the render target state, clearing the back buffer
- * and depth buffer, setting render targets, setting descriptor heaps,
- * setting the root signature, setting the pass constant buffer,
- * drawing the game world, drawing render items, transitioning the
- * back buffer to the present state, executing the command list,
- * presenting the back buffer, and advancing the fence value.
+ * Only waits when the render thread is not running, in which case the frame
+ * is recorded here.
  *
  * @param gt A const reference to a GameTimer object.
  */
 void Game::Draw(const GameTimer& gt)
 {
+	PROFILE_SCOPE("Game::Draw");
+
+	// Update() returns before capturing once the last state has been popped.
+	if (mCapture == nullptr)
+		return;
+
+	mCapture = nullptr;
+	mRenderThread.EndFrame(mCaptureBuffer);
+}
+
+/**
+ * @brief Records and submits one snapshot.
+ *
+ * Runs on the render thread.  This method cycles to the next frame resource,
+ * waits for the GPU to finish with it and writes the snapshot's constants
+ * into it. It then resets the command list, sets the viewport and scissor
+ * rectangles, transitions the back buffer to the render target state, clears
+ * the back buffer and depth buffer, sets render targets, descriptor heaps,
+ * the root signature and the pass constant buffer, records the snapshot's
+ * draws, transitions the back buffer to the present state, executes the
+ * command list, presents the back buffer and advances the fence value.
+ *
+ * @param snapshot Filled by Update(), not written until this returns.
+ */
+void Game::RenderFrame(const RenderSnapshot& snapshot)
+{
+	PROFILE_SCOPE("Game::RenderFrame");
+
+	// Move to the next frame resource, waiting for the GPU to finish with it.
+	mCurrFrameResourceIndex = (int)mFrameScheduler.BeginFrame();
+
+	// The GPU is done with this frame resource, so it can be replaced by a larger one
+	// here; the others are replaced in turn as the scheduler hands them out.
+	std::unique_ptr<FrameResource>& frameResource = mFrameResources[mCurrFrameResourceIndex];
+	if (frameResource->ObjectCount < snapshot.ObjectCapacity || frameResource->MaterialCount < snapshot.MaterialCapacity)
+	{
+		PROFILE_SCOPE("Game::GrowFrameResource");
+		frameResource = std::make_unique<FrameResource>(md3dDevice.Get(), 1, snapshot.ObjectCapacity,
+			snapshot.MaterialCapacity, mTerrain->GetSlotCount(), frameResource->SpriteCount);
+	}
+	if (frameResource->SpriteCount < snapshot.Sprites.size())
+	{
+		while (frameResource->SpriteCount < snapshot.Sprites.size())
+			frameResource->SpriteCount *= 2;
+		frameResource->Sprites = std::make_unique<UploadBuffer<SpriteInstance>>(md3dDevice.Get(), frameResource->SpriteCount, false);
+	}
+	mCurrFrameResource = frameResource.get();
+
+	UpdateObjectCBs(snapshot);
+	UpdateMaterialCBs(snapshot);
+	UpdateMainPassCB(snapshot);
+	UpdateSpriteInstances(snapshot);
+
 	auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
 
 	// Reuse the memory associated with command recording.
@@ -171,6 +374,7 @@ void Game::Draw(const GameTimer& gt)
 	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
 	// Reusing the command list reuses memory.
 	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mOpaquePSO.Get()));
+	mBoundPSO = mOpaquePSO.Get();
 
 	// Set the viewport and scissor rectangle
 	mCommandList->RSSetViewports(1, &mScreenViewport);
@@ -199,11 +403,22 @@ void Game::Draw(const GameTimer& gt)
 	// Set root signature
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
+	// Changing the root signature clears every root binding.
+	mBoundDiffuseSrvIndex = -1;
+	mBoundIndexFormat = DXGI_FORMAT_UNKNOWN;
+
+	// Every mesh lives in the geometry arena, so its vertex buffer is bound once for the
+	// frame.  Draws pick the 16 or 32-bit index buffer through BindIndexBuffer().
+	auto vertexBufferView = mGeometryArena->VertexBufferView();
+	mCommandList->IASetVertexBuffers(0, 1, &vertexBufferView);
+	mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	BindIndexBuffer(DXGI_FORMAT_R16_UINT);
+
 	// Set pass constant buffer
 	auto passCB = mCurrFrameResource->PassCB->Resource();
 	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
-	mStateStack.Draw();
+	DrawSnapshot(snapshot);
 
 	// Transition the back buffer to the present state
 	auto transition2 = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -221,14 +436,24 @@ void Game::Draw(const GameTimer& gt)
 	ThrowIfFailed(mSwapChain->Present(0, 0));
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
-	// Advance the fence value to mark commands up to this fence point.
-	mCurrFrameResource->Fence = ++mCurrentFence;
-
 	// Add an instruction to the command queue to set a new fence point. 
 	// Because we are on the GPU timeline, the new fence point won't be 
 	// set until the GPU finishes processing all the commands prior to this Signal().
-	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	mFrameScheduler.EndFrame();
+}
 
+/**
+ * @brief Formats the culling and occlusion counts of the last completed frame
+ * @return Text appended to the window caption
+ *
+ * CalculateFrameStats() runs before Update(), so mCullStats still holds the
+ * counts of the frame that was just drawn.
+ */
+std::wstring Game::GetFrameStatsText() const
+{
+	return L"   visible: " + std::to_wstring(mCullStats.Visible) +
+		L"   culled: " + std::to_wstring(mCullStats.Culled) +
+		L"   occluded: " + std::to_wstring(mCullStats.Occluded);
 }
 
 void Game::OnMouseDown(WPARAM btnState, int x, int y)
@@ -263,6 +488,37 @@ void Game::OnMouseMove(WPARAM btnState, int x, int y)
 
 void Game::OnKeyDown(WPARAM btnState)
 {
+	// F3 writes the recorded zones for chrome://tracing or ui.perfetto.dev.
+	if (btnState == VK_F3)
+	{
+		bool saved = Profiler::SaveChromeTrace("ProfileTrace.json");
+		OutputDebugString(saved ? L"Profile saved to ProfileTrace.json\n" : L"Could not write ProfileTrace.json\n");
+		return;
+	}
+
+	// F4 writes the frame timings kept so far; they are also written on exit.
+	if (btnState == VK_F4)
+	{
+		bool saved = SaveFrameStats("FrameStats.csv");
+		OutputDebugString(saved ? L"Frame timings saved to FrameStats.csv\n" : L"Could not write FrameStats.csv\n");
+
+		// The scheduler is used by the render thread, so let it go idle first.
+		mRenderThread.Flush();
+		const LatencyHistogram& stalls = mFrameScheduler.GetStallHistogram();
+		std::wstring text = L"Frames in flight: " + std::to_wstring(mFrameScheduler.GetFramesInFlight()) +
+			L", frame resource wait p50 " + std::to_wstring(stalls.GetPercentile(50.0)) +
+			L" ms, p99 " + std::to_wstring(stalls.GetPercentile(99.0)) + L" ms\n";
+		OutputDebugString(text.c_str());
+		return;
+	}
+
+	// F5 cycles the number of frames the CPU may run ahead of the GPU.
+	if (btnState == VK_F5)
+	{
+		SetFramesInFlight(mFrameScheduler.GetFramesInFlight() % FrameScheduler::MaxFramesInFlight + 1);
+		return;
+	}
+
 	mStateStack.HandleEvent(btnState);
 }
 
@@ -290,69 +546,308 @@ void Game::AnimateMaterials(const GameTimer& gt)
 }
 
 /**
- * @brief Updates the object constant buffers.
+ * @brief Copies the changed object constants into the snapshot.
  *
- * Updates the object constant buffers for each render item if the
- * constants have changed.
+ * The render items of every visible state are captured in one pass, and
+ * only those whose constants have changed in the last gNumFrameResources
+ * frames or that moved in the last tick.  A moving item is drawn at its
+ * interpolated world matrix and stays dirty, so once it stops every frame
+ * resource gets its final one.  Their slots never overlap, see RenderItemRegistry.
+ */
+void Game::CaptureObjects()
+{
+	PROFILE_SCOPE("Game::CaptureObjects");
+
+	for (State* state : mVisibleStates)
+	{
+		for (auto& e : state->getRenderItems())
+		{
+			// Only copy the constants if they have changed.
+			XMFLOAT4X4 world;
+			bool moving = InterpolateWorld(*e, world);
+			if (moving)
+				e->NumFramesDirty = gNumFrameResources;
+
+			if (e->NumFramesDirty > 0)
+			{
+				ObjectRecord record;
+				record.ObjCBIndex = e->ObjCBIndex;
+				record.World = world;
+				record.TexTransform = e->TexTransform;
+				record.PosCenter = e->PosCenter;
+				record.PosExtents = e->PosExtents;
+				record.TexCoordOffset = e->TexCoordOffset;
+				record.TexCoordScale = e->TexCoordScale;
+				mCapture->Objects.push_back(record);
+
+				// Next FrameResource need to be updated too.
+				e->NumFramesDirty--;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Saves the world matrices of the visible states' render items as PrevWorld.
  *
- * @param gt A const reference to a GameTimer object.
+ * Called before each tick.  An item the tick does not move keeps PrevWorld equal
+ * to World and is drawn as before; one that was not visible, or was added since,
+ * has a stale PrevWorldTick and is drawn at World until the next tick.
  */
-void Game::UpdateObjectCBs(const GameTimer& gt)
+void Game::SavePreviousWorlds()
 {
-	State* currentState = mStateStack.GetCurrentState();
+	std::uint64_t tick = mSimulationStep.GetTickCount();
 
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for (auto& e : currentState->getRenderItems())
+	mStateStack.GetVisibleStates(mVisibleStates);
+	for (State* state : mVisibleStates)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		if (e->NumFramesDirty > 0)
+		for (auto& e : state->getRenderItems())
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+			e->PrevWorld = e->World;
+			e->PrevWorldTick = tick;
+		}
+	}
+}
+
+/**
+ * @brief Blends an item's world matrix between the last two ticks.
+ *
+ * The render time is GetAlpha() of a tick past the last one, so the item is drawn
+ * that far from PrevWorld to World, one tick behind the simulation.  Scale and
+ * translation are blended linearly and the rotation along the arc, which keeps a
+ * turning item rigid; a matrix that cannot be decomposed is blended per element.
+ */
+bool Game::InterpolateWorld(const RenderItem& item, XMFLOAT4X4& world) const
+{
+	world = item.World;
+	if (item.PrevWorldTick != mSimulationStep.GetTickCount() ||
+		std::equal(&item.World.m[0][0], &item.World.m[0][0] + 16, &item.PrevWorld.m[0][0]))
+		return false;
+
+	float alpha = mSimulationStep.GetAlpha();
+	XMMATRIX prev = XMLoadFloat4x4(&item.PrevWorld);
+	XMMATRIX curr = XMLoadFloat4x4(&item.World);
+
+	XMVECTOR prevScale, prevRotation, prevTranslation;
+	XMVECTOR currScale, currRotation, currTranslation;
+	if (XMMatrixDecompose(&prevScale, &prevRotation, &prevTranslation, prev) &&
+		XMMatrixDecompose(&currScale, &currRotation, &currTranslation, curr))
+	{
+		XMStoreFloat4x4(&world, XMMatrixAffineTransformation(
+			XMVectorLerp(prevScale, currScale, alpha), XMVectorZero(),
+			XMQuaternionSlerp(prevRotation, currRotation, alpha),
+			XMVectorLerp(prevTranslation, currTranslation, alpha)));
+	}
+	else
+	{
+		XMStoreFloat4x4(&world, prev + (curr - prev) * alpha);
+	}
+	return true;
+}
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+/**
+ * @brief Copies the changed material constants into the snapshot.
+ */
+void Game::CaptureMaterials()
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+	for (auto& e : mMaterials)
+	{
+		// Only copy the constants if they have changed.  If they change, they need
+		// to be written to each FrameResource.
+		Material* mat = e.second.get();
+		if (mat->NumFramesDirty > 0)
+		{
+			MaterialRecord record;
+			record.MatCBIndex = mat->MatCBIndex;
+			record.DiffuseAlbedo = mat->DiffuseAlbedo;
+			record.FresnelR0 = mat->FresnelR0;
+			record.Roughness = mat->Roughness;
+			record.MatTransform = mat->MatTransform;
+			mCapture->Materials.push_back(record);
 
 			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
+			mat->NumFramesDirty--;
+		}
+	}
+}
+
+/**
+ * @brief Copies the camera and timer into the snapshot.
+ *
+ * @param gt A const reference to a GameTimer object.
+ */
+void Game::CapturePass(const GameTimer& gt)
+{
+	mCapture->View = mCamera.GetView4x4f();
+	mCapture->Proj = mCamera.GetProj4x4f();
+	mCapture->EyePosW = mCamera.GetPosition3f();
+	mCapture->RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
+	mCapture->TotalTime = gt.TotalTime();
+	mCapture->DeltaTime = gt.DeltaTime();
+}
+
+/**
+ * @brief Adds a render item's draw to the snapshot.
+ *
+ * The draw refers to the item's constant buffer slots and the material's
+ * texture by index, so the item can change or go away before it is recorded.
+ *
+ * @param item A visible render item with a material.
+ */
+void Game::CaptureDraw(const RenderItem& item)
+{
+	mCapture->Draws.push_back(DescribeDraw(item));
+}
+
+/**
+ * @brief Adds a sprite's draw to the snapshot.
+ *
+ * The sprite's object and material constants are copied into the snapshot's
+ * sprite instances.  If the previous draw is a sprite batch of the same submesh
+ * and texture, the sprite becomes its next instance; otherwise it starts a new
+ * batch.  Only consecutive sprites are merged, so the scene graph order is kept.
+ *
+ * @param item A visible render item with a material.
+ */
+void Game::CaptureSpriteDraw(const RenderItem& item)
+{
+	SpriteRecord sprite;
+	InterpolateWorld(item, sprite.Object.World);
+	sprite.Object.TexTransform = item.TexTransform;
+	sprite.Object.PosCenter = item.PosCenter;
+	sprite.Object.PosExtents = item.PosExtents;
+	sprite.Object.TexCoordOffset = item.TexCoordOffset;
+	sprite.Object.TexCoordScale = item.TexCoordScale;
+	sprite.Material.DiffuseAlbedo = item.Mat->DiffuseAlbedo;
+	sprite.Material.FresnelR0 = item.Mat->FresnelR0;
+	sprite.Material.Roughness = item.Mat->Roughness;
+	sprite.Material.MatTransform = item.Mat->MatTransform;
+
+	std::uint32_t index = (std::uint32_t)mCapture->Sprites.size();
+	mCapture->Sprites.push_back(sprite);
+
+	DrawRecord draw = DescribeDraw(item);
+	if (!mCapture->Draws.empty())
+	{
+		DrawRecord& last = mCapture->Draws.back();
+		if (last.SpriteCount > 0 && last.FirstSprite + last.SpriteCount == index &&
+			last.DiffuseSrvHeapIndex == draw.DiffuseSrvHeapIndex && last.IndexCount == draw.IndexCount &&
+			last.StartIndexLocation == draw.StartIndexLocation && last.BaseVertexLocation == draw.BaseVertexLocation &&
+			last.Index32 == draw.Index32)
+		{
+			++last.SpriteCount;
+			return;
 		}
 	}
+
+	draw.FirstSprite = index;
+	draw.SpriteCount = 1;
+	mCapture->Draws.push_back(draw);
+}
+
+/**
+ * @brief Describes the draw of a render item.
+ *
+ * The draw refers to the item's constant buffer slots and the material's
+ * texture by index, and to the item's submesh at the level of detail
+ * SelectLod() picks.
+ *
+ * @param item A render item with a material.
+ * @return The draw, not yet added to the snapshot.
+ */
+DrawRecord Game::DescribeDraw(const RenderItem& item) const
+{
+	DrawRecord draw;
+	draw.ObjCBIndex = item.ObjCBIndex;
+	draw.MatCBIndex = item.Mat->MatCBIndex;
+	draw.DiffuseSrvHeapIndex = item.Mat->DiffuseSrvHeapIndex;
+	draw.IndexCount = item.IndexCount;
+	draw.StartIndexLocation = item.StartIndexLocation;
+	draw.BaseVertexLocation = item.BaseVertexLocation;
+	if (const SubmeshGeometry* lod = SelectLod(item))
+	{
+		draw.IndexCount = lod->IndexCount;
+		draw.StartIndexLocation = lod->StartIndexLocation;
+	}
+	draw.Index32 = item.Index32;
+	return draw;
+}
+
+/**
+ * @brief Updates the object constant buffers.
+ *
+ * Writes the object constants that changed and the constants of every terrain
+ * chunk in the snapshot.
+ *
+ * @param snapshot The snapshot being recorded.
+ */
+void Game::UpdateObjectCBs(const RenderSnapshot& snapshot)
+{
+	PROFILE_SCOPE("Game::UpdateObjectCBs");
+
+	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+	for (const ObjectRecord& record : snapshot.Objects)
+		currObjectCB->CopyData(record.ObjCBIndex, MakeObjectConstants(record));
+
+	// The set of chunks and their slots change from one frame to the next.
+	auto currTerrainCB = mCurrFrameResource->TerrainCB.get();
+	for (const ObjectRecord& record : snapshot.TerrainChunks)
+		currTerrainCB->CopyData(record.ObjCBIndex, MakeObjectConstants(record));
 }
 
 /**
  * @brief Updates the material constant buffers.
  *
- * Updates the material constant buffers for each material if the
- * constants have changed.
+ * Writes the material constants that changed.
  *
- * @param gt A const reference to a GameTimer object.
+ * @param snapshot The snapshot being recorded.
  */
-void Game::UpdateMaterialCBs(const GameTimer& gt)
+void Game::UpdateMaterialCBs(const RenderSnapshot& snapshot)
 {
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
-	for (auto& e : mMaterials)
+	for (const MaterialRecord& record : snapshot.Materials)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if (mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+		XMMATRIX matTransform = XMLoadFloat4x4(&record.MatTransform);
 
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+		MaterialConstants matConstants;
+		matConstants.DiffuseAlbedo = record.DiffuseAlbedo;
+		matConstants.FresnelR0 = record.FresnelR0;
+		matConstants.Roughness = record.Roughness;
+		XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+		currMaterialCB->CopyData(record.MatCBIndex, matConstants);
+	}
+}
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
+/**
+ * @brief Updates the sprite instance buffer.
+ *
+ * Writes the constants of every sprite in the snapshot; the sprite batches
+ * index them from FirstSprite.
+ *
+ * @param snapshot The snapshot being recorded.
+ */
+void Game::UpdateSpriteInstances(const RenderSnapshot& snapshot)
+{
+	auto currSprites = mCurrFrameResource->Sprites.get();
+	for (size_t i = 0; i < snapshot.Sprites.size(); ++i)
+	{
+		const SpriteRecord& record = snapshot.Sprites[i];
+
+		SpriteInstance instance;
+		XMStoreFloat4x4(&instance.World, XMMatrixTranspose(XMLoadFloat4x4(&record.Object.World)));
+		XMStoreFloat4x4(&instance.TexTransform, XMMatrixTranspose(XMLoadFloat4x4(&record.Object.TexTransform)));
+		XMStoreFloat4x4(&instance.MatTransform, XMMatrixTranspose(XMLoadFloat4x4(&record.Material.MatTransform)));
+		instance.DiffuseAlbedo = record.Material.DiffuseAlbedo;
+		instance.FresnelR0 = record.Material.FresnelR0;
+		instance.Roughness = record.Material.Roughness;
+		instance.PosCenter = record.Object.PosCenter;
+		instance.PosExtents = record.Object.PosExtents;
+		instance.TexCoordOffset = record.Object.TexCoordOffset;
+		instance.TexCoordScale = record.Object.TexCoordScale;
+		currSprites->CopyData((int)i, instance);
 	}
 }
 
@@ -362,14 +857,13 @@ void Game::UpdateMaterialCBs(const GameTimer& gt)
  * Updates the main pass constant buffer with view, projection, and
  * lighting information.
  *
- * @param gt A const reference to a GameTimer object.
+ * @param snapshot The snapshot being recorded.
  */
-void Game::UpdateMainPassCB(const GameTimer& gt)
+void Game::UpdateMainPassCB(const RenderSnapshot& snapshot)
 {
-	// Get the view and projection matrices from the camera
-	XMMATRIX view = mCamera.GetView();
-	XMMATRIX proj = mCamera.GetProj();
-
+	// Get the view and projection matrices captured from the camera
+	XMMATRIX view = XMLoadFloat4x4(&snapshot.View);
+	XMMATRIX proj = XMLoadFloat4x4(&snapshot.Proj);
 	// Calculate the view-projection matrix
 	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
 
@@ -391,13 +885,13 @@ void Game::UpdateMainPassCB(const GameTimer& gt)
 	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
 
 	// Set other pass constants
-	mMainPassCB.EyePosW = mCamera.GetPosition3f();
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
+	mMainPassCB.EyePosW = snapshot.EyePosW;
+	mMainPassCB.RenderTargetSize = snapshot.RenderTargetSize;
+	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / snapshot.RenderTargetSize.x, 1.0f / snapshot.RenderTargetSize.y);
 	mMainPassCB.NearZ = 1.0f;
 	mMainPassCB.FarZ = 1000.0f;
-	mMainPassCB.TotalTime = gt.TotalTime();
-	mMainPassCB.DeltaTime = gt.DeltaTime();
+	mMainPassCB.TotalTime = snapshot.TotalTime;
+	mMainPassCB.DeltaTime = snapshot.DeltaTime;
 	mMainPassCB.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
 	mMainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
 	mMainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
@@ -412,25 +906,20 @@ void Game::UpdateMainPassCB(const GameTimer& gt)
 }
 
 /**
- * @brief Loads the textures.
+ * @brief Registers a texture.
  *
- * Loads texture resources from files and stores them in the texture map.
+ * Nothing is read from disk here; the file is loaded by LoadTexture() the
+ * first time a material that samples it is acquired.
  */
 void Game::CreateTexture(std::string Name, std::wstring FileName)
 {
-	auto texture = std::make_unique<Texture>();
-	texture->Name = Name;
-	texture->Filename = FileName;
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), texture->Filename.c_str(),
-		texture->Resource, texture->UploadHeap));
-	mTextures[texture->Name] = std::move(texture);
+	TextureDefinition definition;
+	definition.FileName = FileName;
+	mTextureDefinitions[Name] = definition;
 }
 
 /**
- * @brief Loads all textures used in the game.
- *
- * This method creates texture resources for various game assets.
+ * @brief Registers all textures used in the game.
  */
 void Game::LoadTextures()
 {
@@ -465,6 +954,121 @@ void Game::LoadTextures()
 
 }
 
+/**
+ * @brief Packs the UI textures into shared atlas pages.
+ *
+ * The title, menu, pause, instruction and back-screen banners are each small
+ * enough to share a page. Every one of them is copied (GPU side, on the
+ * initialization command list) into an atlas page of the same format, and
+ * its AtlasRegion records the texture transform that maps the sprite's [0,1]
+ * UVs onto the packed sub-rectangle. Sprites using these textures then share
+ * one descriptor table instead of switching it for every draw.
+ *
+ * Runs the first time a material samples one of the banners, so states that
+ * show none of them never load them.
+ */
+void Game::BuildTextureAtlas()
+{
+	PROFILE_SCOPE("Game::BuildTextureAtlas");
+
+	mAtlasBuilt = true;
+
+	// The banners may already be resident, in which case nothing has opened the list yet.
+	BeginResourceUploads();
+
+	// Copies between textures require matching formats, so each format gets its own pages.
+	std::map<DXGI_FORMAT, std::vector<std::string>> texturesByFormat;
+	for (const std::string& name : gAtlasTextureNames)
+	{
+		Texture* texture = LoadTexture(name);
+		if (texture == nullptr)
+			continue;
+
+		D3D12_RESOURCE_DESC desc = texture->Resource->GetDesc();
+		if (desc.MipLevels > 1 || desc.DepthOrArraySize > 1)
+			continue;
+
+		texturesByFormat[desc.Format].push_back(name);
+	}
+
+	int pageCount = 0;
+	for (auto& group : texturesByFormat)
+	{
+		// 4-texel alignment keeps block-compressed copies on block boundaries.
+		TextureAtlasPacker packer(D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION, 4, 4);
+		for (const std::string& name : group.second)
+		{
+			D3D12_RESOURCE_DESC desc = mTextures[name]->Resource->GetDesc();
+			packer.Add(name, (UINT)desc.Width, desc.Height);
+		}
+		packer.Pack();
+
+		// Create the pages at their packed size.
+		std::vector<Texture*> pages;
+		for (UINT p = 0; p < packer.GetPageCount(); ++p)
+		{
+			TextureAtlasPacker::Rect extent = packer.GetPageExtent(p);
+
+			auto page = std::make_unique<Texture>();
+			page->Name = "UIAtlas" + std::to_string(pageCount++);
+
+			auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+			auto texDesc = CD3DX12_RESOURCE_DESC::Tex2D(group.first, extent.Width, extent.Height, 1, 1);
+			ThrowIfFailed(md3dDevice->CreateCommittedResource(
+				&heapProperties,
+				D3D12_HEAP_FLAG_NONE,
+				&texDesc,
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				nullptr,
+				IID_PPV_ARGS(page->Resource.GetAddressOf())));
+
+			pages.push_back(page.get());
+			mTextureDefinitions[page->Name] = TextureDefinition();
+			mTextures[page->Name] = std::move(page);
+		}
+
+		for (const TextureAtlasPacker::Placement& placement : packer.GetPlacements())
+		{
+			// Anything too big for a page keeps its own texture and descriptor.
+			if (!placement.Packed)
+				continue;
+
+			Texture* page = pages[placement.Page];
+			ID3D12Resource* source = mTextures[placement.Name]->Resource.Get();
+
+			auto toCopySource = CD3DX12_RESOURCE_BARRIER::Transition(source,
+				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			mUploadCommandList->ResourceBarrier(1, &toCopySource);
+
+			CD3DX12_TEXTURE_COPY_LOCATION dst(page->Resource.Get(), 0);
+			CD3DX12_TEXTURE_COPY_LOCATION src(source, 0);
+			mUploadCommandList->CopyTextureRegion(&dst, placement.Region.X, placement.Region.Y, 0, &src, nullptr);
+
+			D3D12_RESOURCE_DESC pageDesc = page->Resource->GetDesc();
+			float pageWidth = (float)pageDesc.Width;
+			float pageHeight = (float)pageDesc.Height;
+
+			AtlasRegion region;
+			region.PageName = page->Name;
+			XMStoreFloat4x4(&region.MatTransform,
+				XMMatrixScaling(placement.Region.Width / pageWidth, placement.Region.Height / pageHeight, 1.0f) *
+				XMMatrixTranslation(placement.Region.X / pageWidth, placement.Region.Y / pageHeight, 0.0f));
+			mAtlasRegions[placement.Name] = region;
+
+			// The source must outlive the copy, so park it until the uploads have been flushed.
+			mAtlasSourceTextures.push_back(std::move(mTextures[placement.Name]));
+			mTextures.erase(placement.Name);
+		}
+
+		for (Texture* page : pages)
+		{
+			auto toShaderResource = CD3DX12_RESOURCE_BARRIER::Transition(page->Resource.Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			mUploadCommandList->ResourceBarrier(1, &toShaderResource);
+		}
+	}
+}
+
 /**
  * @brief Builds the root signature.
  *
@@ -476,7 +1080,7 @@ void Game::BuildRootSignature()
 	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
 
 	// Root parameter can be a table, root descriptor or root constants.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[6];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
 	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
@@ -484,12 +1088,17 @@ void Game::BuildRootSignature()
 	slotRootParameter[2].InitAsConstantBufferView(1);
 	slotRootParameter[3].InitAsConstantBufferView(2);
 
+	// Sprite batches: the instance buffer, and the batch's first instance in it, since
+	// SV_InstanceID does not include the draw's start instance.
+	slotRootParameter[4].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	slotRootParameter[5].InitAsConstants(1, 3, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
 	auto staticSamplers = GetStaticSamplers();
 
 	// A root signature is an array of root parameters.
 	//The Init function of the CD3DX12_ROOT_SIGNATURE_DESC class has two parameters that allow you to
 		//define an array of so - called static samplers your application can use.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(6, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),  //6 samplers!
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -515,130 +1124,27 @@ void Game::BuildRootSignature()
 /**
  * @brief Builds the descriptor heaps.
  *
- * Creates and fills the descriptor heaps used for shader resource views (SRVs).
+ * Creates the shader visible SRV heap. The front of the heap holds the
+ * descriptors of resident textures, written by AcquireTexture() when a texture
+ * is first used and recycled once a trimmed texture retires.  Every frame
+ * samples resident textures only, so the allocator's transient ring is left
+ * empty.
  */
-
-//Once a texture resource is created, we need to create an SRV descriptor to it which we
-//can set to a root signature parameter slot for use by the shader programs.
 void Game::BuildDescriptorHeaps()
 {
 	//
 	// Create the SRV heap.
 	//
+	UINT persistentCount = MathHelper::Max(gSrvHeapPersistentCapacity, (UINT)(mTextureDefinitions.size() + gAtlasTextureNames.size()));
+
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 14;
+	srvHeapDesc.NumDescriptors = persistentCount;
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
 
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto EagleTex = mTextures["EagleTex"]->Resource;
-	auto RaptorTex = mTextures["RaptorTex"]->Resource;
-	auto DesertTex = mTextures["DesertTex"]->Resource;
-	auto GalaxyTex = mTextures["GalaxyTex"]->Resource;
-	auto TitleTex = mTextures["TitleTex"]->Resource;
-	auto MMTextTex = mTextures["MenuTextTex"]->Resource;
-	auto PauseTextTex = mTextures["PauseTextTex"]->Resource;
-	auto GameTextTex = mTextures["GameTextTex"]->Resource;
-	auto PlanetTex = mTextures["PlanetTex"]->Resource;
-	auto PlanetTex2 = mTextures["PlanetTex2"]->Resource;
-	auto StarTex = mTextures["StarTex"]->Resource;
-	auto ShipMMTex = mTextures["ShipMM"]->Resource;
-	auto WASDTex = mTextures["WASDTex"]->Resource;
-	auto BackTex = mTextures["BackTex"]->Resource;
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-
-	//This mapping enables the shader resource view (SRV) to choose how memory gets routed to the 4 return components in a shader after a memory fetch.
-	//When a texture is sampled in a shader, it will return a vector of the texture data at the specified texture coordinates.
-	//This field provides a way to reorder the vector components returned when sampling the texture.
-	//D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING  will not reorder the components and just return the data in the order it is stored in the texture resource.
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-
-	srvDesc.Format = EagleTex->GetDesc().Format;
-
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	//The number of mipmap levels to view, starting at MostDetailedMip.This field, along with MostDetailedMip allows us to
-	//specify a subrange of mipmap levels to view.You can specify - 1 to indicate to view
-	//all mipmap levels from MostDetailedMip down to the last mipmap level.
-
-	srvDesc.Texture2D.MipLevels = EagleTex->GetDesc().MipLevels;
-
-	//Specifies the minimum mipmap level that can be accessed. 0.0 means all the mipmap levels can be accessed.
-	//Specifying 3.0 means mipmap levels 3.0 to MipCount - 1 can be accessed.
-	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	md3dDevice->CreateShaderResourceView(EagleTex.Get(), &srvDesc, hDescriptor);
-
-	//Raptor Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = RaptorTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(RaptorTex.Get(), &srvDesc, hDescriptor);
-
-	//Desert Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = DesertTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(DesertTex.Get(), &srvDesc, hDescriptor);
-
-	//Galaxy Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = GalaxyTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(GalaxyTex.Get(), &srvDesc, hDescriptor);
-
-	//Title Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = TitleTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(TitleTex.Get(), &srvDesc, hDescriptor);
-
-	//MM TExt Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = MMTextTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(MMTextTex.Get(), &srvDesc, hDescriptor);
-
-	//Pause Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = PauseTextTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(PauseTextTex.Get(), &srvDesc, hDescriptor);
-
-	//Game Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = GameTextTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(GameTextTex.Get(), &srvDesc, hDescriptor);
-
-	//Planet One Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = PlanetTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(PlanetTex.Get(), &srvDesc, hDescriptor);
-
-	//Planet Two Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = PlanetTex2->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(PlanetTex2.Get(), &srvDesc, hDescriptor);
-
-	//Star Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = StarTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(StarTex.Get(), &srvDesc, hDescriptor);
-	
-	//Ship Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = ShipMMTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(ShipMMTex.Get(), &srvDesc, hDescriptor);
-
-
-	//WASD Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = WASDTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(WASDTex.Get(), &srvDesc, hDescriptor);
-
-	//Back Descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = BackTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(BackTex.Get(), &srvDesc, hDescriptor);
+	mTextureSrvIndices.clear();
+	mSrvAllocator.Reset(persistentCount, 0);
 }
 
 /**
@@ -650,21 +1156,25 @@ void Game::BuildShadersAndInputLayout()
 {
 	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
 	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+	mShaders["spriteVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "SpriteVS", "vs_5_1");
+	mShaders["spritePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "SpritePS", "ps_5_1");
 
 	mInputLayout =
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		// PackedVertex: the input assembler expands the 16-bit normalized integers to
+		// floats, and the vertex shader rescales them with the object constants.
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		//step3
 		//The texture coordinates determine what part of the texture gets mapped on the triangles.
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 	};
 }
 
 /**
  * @brief Builds the shape geometry.
  *
- * Creates the vertex and index buffers for the shapes used in the scene.
+ * Adds the shapes used in the scene to the geometry arena.
  */
 void Game::BuildShapeGeometry()
 {
@@ -672,12 +1182,13 @@ void Game::BuildShapeGeometry()
 
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData box = geoGen.CreateBox(1, 0, 1, 1);
+	// Convex, so with back faces culled no two triangles overlap on screen and there is
+	// no overdraw to reorder for.  HeadlessRunner --bench reports the cache statistics.
+	geoGen.Optimize(box, false);
 
-	SubmeshGeometry boxSubmesh;
-	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
-	boxSubmesh.StartIndexLocation = 0;
-	boxSubmesh.BaseVertexLocation = 0;
-
+	// The subdivisions of each face are coplanar, so the coarser levels lose nothing
+	// and are drawn from any distance.
+	std::vector<GeometryGenerator::MeshLod> lods = geoGen.BuildLodChain(box, 4);
 
 	std::vector<Vertex> vertices(box.Vertices.size());
 
@@ -688,96 +1199,55 @@ void Game::BuildShapeGeometry()
 		vertices[i].TexC = box.Vertices[i].TexC;
 	}
 
-	std::vector<std::uint16_t> indices = box.GetIndices16();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
-
-	auto geo = std::make_unique<MeshGeometry>();
-	geo->Name = "boxGeo";
-
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
-	geo->VertexByteStride = sizeof(Vertex);
-	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
-
-	geo->DrawArgs["box"] = boxSubmesh;
-
-	mGeometries[geo->Name] = std::move(geo);
-
+	AddMeshGeometry("boxGeo", "box", vertices, lods);
 }
 
 /**
  * @brief Builds the hill geometry.
  *
- * Creates the vertex and index buffers for the hills used in the scene.
+ * Adds the hills used in the scene to the geometry arena.
  */
 void Game::BuildHillGeometry()
 {
 	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(1, 1, 50, 50);
-
-	SubmeshGeometry gridSubmesh;
-	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
-	gridSubmesh.StartIndexLocation = 0;
-	gridSubmesh.BaseVertexLocation = 0;
-
+	GeometryGenerator::MeshData grid;
+
+	HillTerrainDesc hills;
+	hills.Width = 1.0f;
+	hills.Depth = 1.0f;
+	hills.Rows = 50;
+	hills.Columns = 50;
+	hills.Amplitude = gHillAmplitude;
+	hills.Frequency = gHillFrequency;
+
+	// Generate the final surface up front, in the same layout as CreateGrid(), so the
+	// simplifier sees the real hills.
+	grid.Vertices.resize((size_t)hills.Rows * hills.Columns);
+	grid.Indices32.resize((size_t)(hills.Rows - 1) * (hills.Columns - 1) * 6);
+
+	TerrainVertexLayout layout;
+	layout.Positions = &grid.Vertices[0].Position.x;
+	layout.Normals = &grid.Vertices[0].Normal.x;
+	layout.TexCoords = &grid.Vertices[0].TexC.x;
+	layout.Stride = sizeof(GeometryGenerator::Vertex);
+	TerrainGenerator::GenerateHills(hills, layout);
+	TerrainGenerator::GenerateGridIndices(hills.Rows, hills.Columns, grid.Indices32.data());
+
+	// A gentle height field folds over itself from no viewpoint, so only the cache and
+	// fetch order are worth optimizing; the overdraw pass leaves it as it was.
+	geoGen.Optimize(grid, false);
+	std::vector<GeometryGenerator::MeshLod> lods = geoGen.BuildLodChain(grid, 4);
 
 	std::vector<Vertex> vertices(grid.Vertices.size());
 
 	for (size_t i = 0; i < grid.Vertices.size(); ++i)
 	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
-		vertices[i].Normal = GetHillsNormal(p.x, p.z);
-		//vertices[i].TexC = grid.Vertices[i].TexC;
-
-		//vertices[k].Pos = grid.Vertices[i].Position;
-		//vertices[k].Normal = grid.Vertices[i].Normal;
+		vertices[i].Pos = grid.Vertices[i].Position;
+		vertices[i].Normal = grid.Vertices[i].Normal;
 		vertices[i].TexC = grid.Vertices[i].TexC;
 	}
 
-	std::vector<std::uint16_t> indices = grid.GetIndices16();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
-
-	auto geo = std::make_unique<MeshGeometry>();
-	geo->Name = "gridGeo";
-
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
-	geo->VertexByteStride = sizeof(Vertex);
-	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
-
-	geo->DrawArgs["grid"] = gridSubmesh;
-
-	mGeometries[geo->Name] = std::move(geo);
+	AddMeshGeometry("gridGeo", "grid", vertices, lods);
 
 }
 
@@ -817,77 +1287,879 @@ void Game::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mOpaquePSO)));
+
+	//
+	// PSO for sprite batches: the same state, with the constants read per instance.
+	//
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC spritePsoDesc = opaquePsoDesc;
+	spritePsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["spriteVS"]->GetBufferPointer()),
+		mShaders["spriteVS"]->GetBufferSize()
+	};
+	spritePsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["spritePS"]->GetBufferPointer()),
+		mShaders["spritePS"]->GetBufferSize()
+	};
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&spritePsoDesc, IID_PPV_ARGS(&mSpritePSO)));
 }
 
 /**
- * @brief Builds the frame resources.
+ * @brief Starts the terrain chunk streamer and reserves its geometry.
  *
- * Creates the frame resources used for double buffering.
+ * The arena gets one vertex slot per chunk the streamer can keep resident and the
+ * index list of every level of detail and stitching variant.  Chunks are copied into
+ * their slot by UpdateTerrain() as the workers finish them.
  */
-void Game::BuildFrameResources(int renderItemCount)
+void Game::BuildTerrain()
 {
-	for (int i = 0; i < gNumFrameResources; ++i)
+	ChunkedTerrainDesc desc;
+	desc.ChunkSize = gTerrainChunkSize;
+	desc.ChunkQuads = gTerrainChunkQuads;
+	desc.LodCount = gTerrainLodCount;
+	desc.LodDistance = gTerrainLodDistance;
+	desc.ViewRadius = gTerrainViewRadius;
+	desc.SlotReuseDelay = FrameScheduler::MaxFramesInFlight;
+	desc.Amplitude = gHillAmplitude;
+	desc.Frequency = gHillFrequency;
+	mTerrain = std::make_unique<ChunkedTerrain>(desc);
+
+	const UINT vertexCount = mTerrain->GetVerticesPerChunk();
+	if (GeometryArena::ChooseIndexFormat(vertexCount) != DXGI_FORMAT_R16_UINT ||
+		!mGeometryArena->Allocate(mTerrain->GetSlotCount() * vertexCount, 0, DXGI_FORMAT_R16_UINT, mTerrainVertices))
+		throw DxException(E_OUTOFMEMORY, L"Game::BuildTerrain", AnsiToWString(__FILE__), __LINE__);
+
+	const UINT lodCount = mTerrain->GetDesc().LodCount;
+	mTerrainIndexLists.resize(lodCount * ChunkedTerrain::StitchVariants);
+	for (UINT lod = 0; lod < lodCount; ++lod)
 	{
-		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-			1, (UINT)renderItemCount, (UINT)mMaterials.size()));
+		for (UINT mask = 0; mask < ChunkedTerrain::StitchVariants; ++mask)
+		{
+			const std::vector<std::uint32_t>& indices32 = mTerrain->GetIndices(lod, mask);
+			std::vector<std::uint16_t> indices16(indices32.begin(), indices32.end());
+
+			SubmeshGeometry& submesh = mTerrainIndexLists[lod * ChunkedTerrain::StitchVariants + mask];
+			if (!mGeometryArena->Allocate(0, (UINT)indices16.size(), DXGI_FORMAT_R16_UINT, submesh))
+				throw DxException(E_OUTOFMEMORY, L"Game::BuildTerrain", AnsiToWString(__FILE__), __LINE__);
+
+			StageBufferCopy(mGeometryArena->GetIndexBuffer(DXGI_FORMAT_R16_UINT), mGeometryArena->GetIndexByteOffset(submesh),
+				indices16.data(), (UINT64)indices16.size() * sizeof(std::uint16_t));
+		}
 	}
+
+	mTerrainSlots.assign(mTerrain->GetSlotCount(), TerrainSlot());
 }
 
 /**
- * @brief Builds the materials.
+ * @brief Streams the terrain around a point and uploads the chunks that are ready.
  *
- * Creates the materials used in the scene.
+ * Called while the state stack updates, so the copies join the upload batch that
+ * Game::Update() submits before the frame is drawn.
+ *
+ * @param focusX Terrain x coordinate under the camera
+ * @param focusZ Terrain z coordinate under the camera
  */
-//step13
+void Game::UpdateTerrain(float focusX, float focusZ)
+{
+	if (mTerrain == nullptr)
+		return;
+
+	mTerrain->Update(focusX, focusZ);
+
+	const UINT vertexCount = mTerrain->GetVerticesPerChunk();
+	const size_t vertexStride = ChunkedTerrain::FloatsPerVertex * sizeof(float);
+	std::vector<PackedVertex> packed(vertexCount);
+
+	for (const TerrainChunkUpload& chunk : mTerrain->TakeUploads())
+	{
+		// Each slot is packed against its own chunk's bounds, like any other submesh.
+		TerrainSlot& slot = mTerrainSlots[chunk.Slot];
+		const float* vertices = chunk.Vertices.data();
+		VertexQuantizer::PackPositions(packed[0].Pos, sizeof(PackedVertex), vertices, vertexStride,
+			vertexCount, &slot.PosCenter.x, &slot.PosExtents.x);
+		VertexQuantizer::PackNormals(packed[0].Normal, sizeof(PackedVertex), vertices + 3, vertexStride, vertexCount);
+		VertexQuantizer::PackTexCoords(packed[0].TexC, sizeof(PackedVertex), vertices + 6, vertexStride,
+			vertexCount, &slot.TexCoordOffset.x, &slot.TexCoordScale.x);
+
+		UINT64 slotOffset = mGeometryArena->GetVertexByteOffset(mTerrainVertices) + (UINT64)chunk.Slot * vertexCount * sizeof(PackedVertex);
+		StageBufferCopy(mGeometryArena->GetVertexBuffer(), slotOffset, packed.data(), (UINT64)packed.size() * sizeof(PackedVertex));
+	}
+
+	mTerrain->BuildDrawList(focusX, focusZ, mTerrainDraws);
+}
+
+/**
+ * @brief Culls the resident terrain chunks and captures the visible ones.
+ *
+ * Each chunk's constants go into the snapshot's terrain list, since the set of
+ * chunks and their slots change from one frame to the next.
+ *
+ * @param world Places the terrain in the scene
+ * @param material Material the chunks are drawn with
+ */
+void Game::CaptureTerrain(const XMFLOAT4X4& world, const Material* material)
+{
+	if (mTerrain == nullptr || mTerrainDraws.empty() || material == nullptr)
+		return;
+
+	// The decoding box of a slot bounds its chunk, so it doubles as the culling box.
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	mTerrainCullBoxes.Resize(mTerrainDraws.size());
+	mTerrainCullResults.resize(mTerrainDraws.size());
+	for (size_t i = 0; i < mTerrainDraws.size(); ++i)
+	{
+		const TerrainSlot& slot = mTerrainSlots[mTerrainDraws[i].Slot];
+		BoundingBox bounds(slot.PosCenter, slot.PosExtents);
+		bounds.Transform(bounds, worldMatrix);
+		mTerrainCullBoxes.Set(i, &bounds.Center.x, &bounds.Extents.x);
+	}
+	size_t inFrustumCount = FrustumCuller::CullBoxes(mCameraFrustum, mTerrainCullBoxes, mTerrainCullResults.data());
+	size_t visibleCount = mOcclusionCuller->TestBoxes(mTerrainCullBoxes, mTerrainCullResults.data());
+	mCullStats.Visible += visibleCount;
+	mCullStats.Culled += mTerrainDraws.size() - inFrustumCount;
+	mCullStats.Occluded += inFrustumCount - visibleCount;
+
+	const UINT vertexCount = mTerrain->GetVerticesPerChunk();
+	for (size_t i = 0; i < mTerrainDraws.size(); ++i)
+	{
+		if (!mTerrainCullResults[i])
+			continue;
+
+		const TerrainChunkDraw& chunk = mTerrainDraws[i];
+		const TerrainSlot& slot = mTerrainSlots[chunk.Slot];
+		ObjectRecord constants;
+		constants.ObjCBIndex = (std::uint32_t)i;
+		constants.World = world;
+		constants.PosCenter = slot.PosCenter;
+		constants.PosExtents = slot.PosExtents;
+		constants.TexCoordOffset = slot.TexCoordOffset;
+		constants.TexCoordScale = slot.TexCoordScale;
+		mCapture->TerrainChunks.push_back(constants);
+
+		const SubmeshGeometry& indices = mTerrainIndexLists[chunk.Lod * ChunkedTerrain::StitchVariants + chunk.StitchMask];
+		DrawRecord draw;
+		draw.ObjCBIndex = (std::uint32_t)i;
+		draw.MatCBIndex = material->MatCBIndex;
+		draw.DiffuseSrvHeapIndex = material->DiffuseSrvHeapIndex;
+		draw.IndexCount = indices.IndexCount;
+		draw.StartIndexLocation = indices.StartIndexLocation;
+		draw.BaseVertexLocation = mTerrainVertices.BaseVertexLocation + (INT)(chunk.Slot * vertexCount);
+		draw.Index32 = indices.IndexFormat == DXGI_FORMAT_R32_UINT;
+		draw.Terrain = true;
+		mCapture->Draws.push_back(draw);
+	}
+}
+
+/**
+ * @brief Records the draws of a snapshot.
+ *
+ * The vertex buffer is the geometry arena's, bound once per frame in
+ * RenderFrame(); the pipeline state, texture and index buffer are only
+ * rebound when they change from one draw to the next.  A sprite batch is one
+ * instanced draw with the sprite PSO, which reads each instance's constants
+ * from the frame's sprite buffer.
+ *
+ * @param snapshot The snapshot being recorded.
+ */
+void Game::DrawSnapshot(const RenderSnapshot& snapshot)
+{
+	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	D3D12_GPU_VIRTUAL_ADDRESS objectCB = mCurrFrameResource->ObjectCB->Resource()->GetGPUVirtualAddress();
+	D3D12_GPU_VIRTUAL_ADDRESS terrainCB = mCurrFrameResource->TerrainCB->Resource()->GetGPUVirtualAddress();
+	D3D12_GPU_VIRTUAL_ADDRESS matCB = mCurrFrameResource->MaterialCB->Resource()->GetGPUVirtualAddress();
+
+	if (!snapshot.Sprites.empty())
+		mCommandList->SetGraphicsRootShaderResourceView(4, mCurrFrameResource->Sprites->Resource()->GetGPUVirtualAddress());
+
+	for (const DrawRecord& draw : snapshot.Draws)
+	{
+		if (draw.SpriteCount > 0)
+		{
+			BindPipelineState(mSpritePSO.Get());
+			BindDiffuseSrv(draw.DiffuseSrvHeapIndex);
+			BindIndexBuffer(draw.Index32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT);
+			mCommandList->SetGraphicsRoot32BitConstant(5, draw.FirstSprite, 0);
+
+			mCommandList->DrawIndexedInstanced(draw.IndexCount, draw.SpriteCount, draw.StartIndexLocation, draw.BaseVertexLocation, 0);
+			continue;
+		}
+
+		BindPipelineState(mOpaquePSO.Get());
+
+		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = (draw.Terrain ? terrainCB : objectCB) + (UINT64)draw.ObjCBIndex * objCBByteSize;
+		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB + (UINT64)draw.MatCBIndex * matCBByteSize;
+
+		BindDiffuseSrv(draw.DiffuseSrvHeapIndex);
+		BindIndexBuffer(draw.Index32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT);
+		mCommandList->SetGraphicsRootConstantBufferView(1, objCBAddress);
+		mCommandList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+
+		mCommandList->DrawIndexedInstanced(draw.IndexCount, 1, draw.StartIndexLocation, draw.BaseVertexLocation, 0);
+	}
+}
+
+/**
+ * @brief Builds the frame resources.
+ *
+ * Creates one frame resource per frame in flight, with constant buffers of
+ * the sizes reserved by ReserveFrameResources().
+ */
+void Game::BuildFrameResources()
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	UINT terrainChunkCount = mTerrain != nullptr ? mTerrain->GetSlotCount() : 1;
+	for (unsigned i = 0; i < mFrameScheduler.GetFramesInFlight(); ++i)
+	{
+		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
+			1, mObjectCBCapacity, mMaterialCBCapacity, terrainChunkCount, gMinSpriteCapacity));
+	}
+
+	// The new buffers start out empty, so cached materials must be uploaded again.
+	for (auto& e : mMaterials)
+		e.second->NumFramesDirty = gNumFrameResources;
+}
+
+/**
+ * @brief Grows the frame resource constant buffers to fit the current state.
+ *
+ * Runs on the simulation thread and only records the new sizes, which reach
+ * the render thread with the snapshot; it replaces each frame resource when
+ * it next uses it, once the GPU has finished with the old one. The sizes
+ * double, so a state change rarely grows them, and never shrink.  The object
+ * constants cover the slots of every live state, cached ones included, so
+ * that any of them can be drawn without a resize.
+ */
+void Game::ReserveFrameResources()
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	// Render item and material slots are both shared by every state.
+	UINT objectCount = mStateStack.GetRenderItemRegistry().GetSlotCount();
+	UINT materialCount = (UINT)mCurrentMaterialCBIndex;
+	if (objectCount <= mObjectCBCapacity && materialCount <= mMaterialCBCapacity)
+		return;
+
+	mObjectCBCapacity = MathHelper::Max(mObjectCBCapacity, gMinObjectCBCapacity);
+	while (mObjectCBCapacity < objectCount)
+		mObjectCBCapacity *= 2;
+	mMaterialCBCapacity = MathHelper::Max(mMaterialCBCapacity, gMinMaterialCBCapacity);
+	while (mMaterialCBCapacity < materialCount)
+		mMaterialCBCapacity *= 2;
+
+	// The replacements start out empty. Each of the next gNumFrameResources
+	// frames replaces a different one, so everything must be captured for as long.
+	mStateStack.MarkRenderItemsDirty();
+	for (auto& e : mMaterials)
+		e.second->NumFramesDirty = gNumFrameResources;
+}
+
+/**
+ * @brief Registers the materials.
+ *
+ * Registers the materials used in the scene. Each one is created by
+ * AcquireMaterial() when a scene node first uses it.
+ */
+//step13
 void Game::BuildMaterials()
 {
 	//mWorld.buildMaterials(mMaterials);
-	OutputDebugStringA("Building materials...\n");
-	mCurrentMaterialCBIndex = 0;
-	mCurrentDiffuseSrvHeapIndex = 0;
-	CreateMaterials("Eagle", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("Raptor", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("Desert", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("Galaxy", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("Title", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("MMText", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("PauseText", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("GameText", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("PlanetOne", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("PlanetTwo", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("Star", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("ShipMM", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("WASD", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-	CreateMaterials("Back", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
-}
-
-/**
- * @brief Creates a material.
- *
- * Creates a material with the specified properties and adds it to the materials map.
+	OutputDebugStringA("Registering materials...\n");
+	CreateMaterials("Eagle", "EagleTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("Raptor", "RaptorTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("Desert", "DesertTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("Galaxy", "GalaxyTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("Title", "TitleTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("MMText", "MenuTextTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("PauseText", "PauseTextTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("GameText", "GameTextTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("PlanetOne", "PlanetTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("PlanetTwo", "PlanetTex2", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("Star", "StarTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("ShipMM", "ShipMM", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("WASD", "WASDTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+	CreateMaterials("Back", "BackTex", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.05f, 0.05f, 0.05f), 0.2f);
+}
+
+/**
+ * @brief Registers a material.
  *
  * @param Name The name of the material.
+ * @param TexName The name of the diffuse texture.
  * @param DiffuseAlbedo The diffuse albedo color of the material.
  * @param FresnelR0 The Fresnel reflectance at normal incidence.
  * @param Roughness The roughness of the material.
  */
-void Game::CreateMaterials(std::string Name, XMFLOAT4 DiffuseAlbedo, XMFLOAT3 FresnelR0, float Roughness)
+void Game::CreateMaterials(std::string Name, std::string TexName, XMFLOAT4 DiffuseAlbedo, XMFLOAT3 FresnelR0, float Roughness)
 {
+	MaterialDefinition definition;
+	definition.TexName = TexName;
+	definition.DiffuseAlbedo = DiffuseAlbedo;
+	definition.FresnelR0 = FresnelR0;
+	definition.Roughness = Roughness;
+	mMaterialDefinitions[Name] = definition;
+}
+
+/**
+ * @brief Gets a material for a render item.
+ *
+ * The first request creates the material, loading its texture and writing
+ * the texture's descriptor if no other material did so already. Later
+ * requests, including ones from states entered again, reuse it. If the
+ * texture was packed into an atlas page, the material samples the page and
+ * its MatTransform selects the packed sub-rectangle.
+ *
+ * @param name The name given to CreateMaterials().
+ * @return The material, or nullptr if it was never registered.
+ */
+Material* Game::AcquireMaterial(const std::string& name)
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	auto definition = mMaterialDefinitions.find(name);
+	if (definition == mMaterialDefinitions.end())
+	{
+		OutputDebugStringA(("Unknown material: " + name + "\n").c_str());
+		return nullptr;
+	}
+
+	definition->second.RefCount++;
+
+	auto resident = mMaterials.find(name);
+	if (resident != mMaterials.end())
+		return resident->second.get();
+
+	std::string texName = definition->second.TexName;
+	if (!mAtlasBuilt && std::find(gAtlasTextureNames.begin(), gAtlasTextureNames.end(), texName) != gAtlasTextureNames.end())
+		BuildTextureAtlas();
+
 	auto material = std::make_unique<Material>();
-	material->Name = Name;
-	material->MatCBIndex = mCurrentMaterialCBIndex++;
-	material->DiffuseSrvHeapIndex = mCurrentDiffuseSrvHeapIndex++;
-	material->DiffuseAlbedo = DiffuseAlbedo;
-	material->FresnelR0 = FresnelR0;
-	material->Roughness = Roughness;
+	material->Name = name;
+
+	auto region = mAtlasRegions.find(texName);
+	if (region != mAtlasRegions.end())
+	{
+		texName = region->second.PageName;
+		material->MatTransform = region->second.MatTransform;
+	}
+
+	if (mFreeMaterialCBIndices.empty())
+	{
+		material->MatCBIndex = mCurrentMaterialCBIndex++;
+	}
+	else
+	{
+		material->MatCBIndex = mFreeMaterialCBIndices.back();
+		mFreeMaterialCBIndices.pop_back();
+	}
+
+	material->DiffuseSrvHeapIndex = AcquireTexture(texName);
+	material->DiffuseAlbedo = definition->second.DiffuseAlbedo;
+	material->FresnelR0 = definition->second.FresnelR0;
+	material->Roughness = definition->second.Roughness;
+
+	Material* result = material.get();
+	mMaterials[name] = std::move(material);
+	return result;
+}
+
+/**
+ * @brief Drops one reference to a material.
+ *
+ * @param material A material returned by AcquireMaterial(), may be null.
+ */
+void Game::ReleaseMaterial(Material* material)
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	if (material == nullptr)
+		return;
+
+	auto definition = mMaterialDefinitions.find(material->Name);
+	if (definition != mMaterialDefinitions.end() && definition->second.RefCount > 0
+		&& --definition->second.RefCount == 0)
+		mTrimPending = true;
+}
+
+/**
+ * @brief Frees unreferenced materials and textures.
+ *
+ * Does nothing unless a material has lost its last reference since the
+ * previous trim, which only happens when a state is destroyed.  Atlas pages
+ * are kept, since rebuilding one would reload every banner on it.
+ *
+ * A material's constant buffer slot is recycled at once: each frame
+ * resource has its own copy of the material constants, and a new material
+ * in the slot rewrites all of them.  A texture's resource and descriptor are
+ * still read by the frames submitted before the trim, so they are retired
+ * with the last fence signaled once those frames are on the queue.
+ */
+void Game::TrimUnusedAssets()
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	if (!mTrimPending)
+		return;
+	mTrimPending = false;
+
+	for (auto it = mMaterials.begin(); it != mMaterials.end(); )
+	{
+		if (mMaterialDefinitions[it->first].RefCount > 0)
+		{
+			++it;
+			continue;
+		}
+
+		std::string texName = mMaterialDefinitions[it->first].TexName;
+		auto region = mAtlasRegions.find(texName);
+		if (region != mAtlasRegions.end())
+			texName = region->second.PageName;
+
+		ReleaseTexture(texName);
+		mFreeMaterialCBIndices.push_back(it->second->MatCBIndex);
+		it = mMaterials.erase(it);
+	}
+
+	size_t firstRetired = mRetiredTextures.size();
+	for (auto it = mTextures.begin(); it != mTextures.end(); )
+	{
+		const TextureDefinition& definition = mTextureDefinitions[it->first];
+		if (definition.RefCount > 0 || definition.FileName.empty())
+		{
+			++it;
+			continue;
+		}
+
+		RetiredTexture retired;
+		retired.Resource = std::move(it->second);
+		auto srv = mTextureSrvIndices.find(it->first);
+		if (srv != mTextureSrvIndices.end())
+		{
+			retired.SrvIndex = srv->second;
+			mTextureSrvIndices.erase(srv);
+		}
+		mRetiredTextures.push_back(std::move(retired));
+		it = mTextures.erase(it);
+	}
 
-	mMaterials[Name] = std::move(material);
+	if (mRetiredTextures.size() == firstRetired)
+		return;
+
+	// Frames captured before the trim may still be waiting for the render thread.
+	mRenderThread.Flush();
+	UINT64 fence = mFrameFence->GetLastSignaledValue();
+	for (size_t i = firstRetired; i < mRetiredTextures.size(); ++i)
+		mRetiredTextures[i].Fence = fence;
+}
+
+/**
+ * @brief Frees the textures trimmed before the last completed fence.
+ *
+ * Their descriptor slots go back to mSrvAllocator for the next texture.
+ */
+void Game::ReleaseRetiredTextures()
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	UINT64 completed = mFrameFence->GetCompletedValue();
+	auto firstPending = mRetiredTextures.begin();
+	for (; firstPending != mRetiredTextures.end() && firstPending->Fence <= completed; ++firstPending)
+	{
+		if (firstPending->SrvIndex >= 0)
+			mSrvAllocator.Free(firstPending->SrvIndex);
+	}
+	mRetiredTextures.erase(mRetiredTextures.begin(), firstPending);
+}
+
+/**
+ * @brief Opens the command list for resource uploads.
+ *
+ * Outside of Initialize() the upload list is closed between batches, so the
+ * first texture loaded during a state change reopens it on its own
+ * allocator, which no frame uses. The allocator can only be reset once the
+ * previous upload batch has executed.
+ */
+void Game::BeginResourceUploads()
+{
+	if (mUploadsOpen)
+		return;
+
+	WaitForFence(mUploadFence);
+	ThrowIfFailed(mUploadCmdListAlloc->Reset());
+	ThrowIfFailed(mUploadCommandList->Reset(mUploadCmdListAlloc.Get(), nullptr));
+	mUploadsOpen = true;
+}
+
+/**
+ * @brief Submits the pending upload commands as one batch.
+ *
+ * The batch is tagged with its own fence value; ReleaseCompletedUploads()
+ * reclaims its staging memory and atlas source textures once the GPU
+ * reaches it.
+ *
+ * The frames already handed to the render thread are submitted first: they
+ * were captured against the old contents of the buffers being copied into,
+ * such as recycled terrain slots.  The render thread is idle until the next
+ * frame is handed over, so the queue and fence are not shared meanwhile.
+ * Only the simulation thread gets here: a state built on a worker records
+ * into the open batch, which Update() submits on its next frame.
+ */
+void Game::FlushResourceUploads()
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	if (!mUploadsOpen)
+		return;
+
+	// Buffers are promoted to COPY_DEST by their first copy and decay back to
+	// COMMON once the batch has executed, so one barrier per buffer is enough.
+	std::vector<CD3DX12_RESOURCE_BARRIER> toGenericRead;
+	for (ID3D12Resource* buffer : mStagedBuffers)
+		toGenericRead.push_back(CD3DX12_RESOURCE_BARRIER::Transition(buffer,
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+	if (!toGenericRead.empty())
+		mUploadCommandList->ResourceBarrier((UINT)toGenericRead.size(), toGenericRead.data());
+	mStagedBuffers.clear();
+
+	mRenderThread.Flush();
+
+	ThrowIfFailed(mUploadCommandList->Close());
+	ID3D12CommandList* cmdsLists[] = { mUploadCommandList.Get() };
+	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	mUploadsOpen = false;
+
+	mUploadFence = mFrameFence->Signal();
+	mStagingUploader->FinishBatch(mUploadFence);
+}
+
+/**
+ * @brief Makes room in the staging ring.
+ *
+ * Called on the simulation thread when an upload does not fit: the batch
+ * recorded so far is submitted, the GPU drains it, and recording continues
+ * on a fresh list.  A worker never waits here; its uploads that find the
+ * ring full are staged in dedicated buffers instead.
+ */
+void Game::WaitForUploads()
+{
+	FlushResourceUploads();
+	WaitForFence(mUploadFence);
+	ReleaseCompletedUploads();
+	BeginResourceUploads();
+}
+
+/**
+ * @brief Reclaims the resources of upload batches the GPU has finished.
+ */
+void Game::ReleaseCompletedUploads()
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	UINT64 completed = mFrameFence->GetCompletedValue();
+	mStagingUploader->ReleaseCompletedBatches(completed);
+
+	if (!mUploadsOpen && completed >= mUploadFence)
+		mAtlasSourceTextures.clear();
+}
+
+/**
+ * @brief Blocks until the GPU has reached a fence value.
+ */
+void Game::WaitForFence(UINT64 fence)
+{
+	mFrameFence->Wait(fence);
+}
+
+/**
+ * @brief Stages data into part of a buffer.
+ *
+ * The buffer is expected in the COMMON state, which it is in whenever no
+ * batch is using it, and is implicitly promoted to COPY_DEST by the copy.
+ * FlushResourceUploads() transitions it to GENERIC_READ at the end of the
+ * batch.
+ *
+ * @param dest Default heap buffer.
+ * @param destOffset Byte offset of the copy inside dest.
+ * @param data Contents to copy.
+ * @param byteSize Number of bytes to copy.
+ */
+void Game::StageBufferCopy(ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 byteSize)
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	BeginResourceUploads();
+
+	// Nothing is recorded for dest before the copy, so a flush here cannot split its barriers.
+	while (!mStagingUploader->CopyBuffer(mUploadCommandList.Get(), dest, destOffset, data, byteSize, !OnSimulationThread()))
+		WaitForUploads();
+
+	if (std::find(mStagedBuffers.begin(), mStagedBuffers.end(), dest) == mStagedBuffers.end())
+		mStagedBuffers.push_back(dest);
+}
+
+/**
+ * @brief Appends a mesh to the geometry arena.
+ *
+ * The returned MeshGeometry refers to the arena buffers, and the submesh's
+ * BaseVertexLocation and StartIndexLocation locate the mesh inside them.
+ */
+MeshGeometry* Game::AddMeshGeometry(const std::string& geoName, const std::string& submeshName,
+	const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices)
+{
+	std::vector<GeometryGenerator::MeshLod> lods(1);
+	lods[0].Indices32 = indices;
+	return AddMeshGeometry(geoName, submeshName, vertices, lods);
+}
+
+/**
+ * @brief Appends a mesh with levels of detail to the geometry arena.
+ *
+ * All levels are allocated as one block so they share BaseVertexLocation; each
+ * level's submesh then points at its own part of the block's indices.  Vertices
+ * are packed into PackedVertex relative to the mesh bounds, and the indices use
+ * 16 bits whenever the mesh has few enough vertices.
+ */
+MeshGeometry* Game::AddMeshGeometry(const std::string& geoName, const std::string& submeshName,
+	const std::vector<Vertex>& vertices, const std::vector<GeometryGenerator::MeshLod>& lods)
+{
+	const DXGI_FORMAT indexFormat = GeometryArena::ChooseIndexFormat((UINT)vertices.size());
+
+	std::vector<std::uint32_t> indices32;
+	for (const auto& lod : lods)
+		indices32.insert(indices32.end(), lod.Indices32.begin(), lod.Indices32.end());
+
+	SubmeshGeometry block;
+	if (!mGeometryArena->Allocate((UINT)vertices.size(), (UINT)indices32.size(), indexFormat, block))
+		throw DxException(E_OUTOFMEMORY, L"Game::AddMeshGeometry(" + AnsiToWString(geoName) + L")", AnsiToWString(__FILE__), __LINE__);
+
+	std::vector<PackedVertex> packed(vertices.size());
+	if (!vertices.empty())
+	{
+		VertexQuantizer::PackPositions(packed[0].Pos, sizeof(PackedVertex), &vertices[0].Pos.x, sizeof(Vertex),
+			vertices.size(), &block.Bounds.Center.x, &block.Bounds.Extents.x);
+		VertexQuantizer::PackNormals(packed[0].Normal, sizeof(PackedVertex), &vertices[0].Normal.x, sizeof(Vertex),
+			vertices.size());
+		VertexQuantizer::PackTexCoords(packed[0].TexC, sizeof(PackedVertex), &vertices[0].TexC.x, sizeof(Vertex),
+			vertices.size(), &block.TexCoordOffset.x, &block.TexCoordScale.x);
+		BoundingSphere::CreateFromPoints(block.Sphere, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
+	}
+
+	StageBufferCopy(mGeometryArena->GetVertexBuffer(), mGeometryArena->GetVertexByteOffset(block),
+		packed.data(), (UINT64)packed.size() * sizeof(PackedVertex));
+
+	ID3D12Resource* indexBuffer = mGeometryArena->GetIndexBuffer(indexFormat);
+	if (indexFormat == DXGI_FORMAT_R16_UINT)
+	{
+		std::vector<std::uint16_t> indices16(indices32.begin(), indices32.end());
+		StageBufferCopy(indexBuffer, mGeometryArena->GetIndexByteOffset(block),
+			indices16.data(), (UINT64)indices16.size() * sizeof(std::uint16_t));
+	}
+	else
+	{
+		StageBufferCopy(indexBuffer, mGeometryArena->GetIndexByteOffset(block),
+			indices32.data(), (UINT64)indices32.size() * sizeof(std::uint32_t));
+	}
+
+	auto& geo = mGeometries[geoName];
+	if (geo == nullptr)
+	{
+		geo = std::make_unique<MeshGeometry>();
+		geo->Name = geoName;
+		geo->VertexBufferGPU = mGeometryArena->GetVertexBuffer();
+		geo->VertexByteStride = mGeometryArena->GetVertexByteStride();
+		geo->VertexBufferByteSize = mGeometryArena->VertexBufferView().SizeInBytes;
+
+		// Informational only: each submesh carries its own IndexFormat, and draws bind
+		// the matching index buffer with BindIndexBuffer().
+		geo->IndexBufferGPU = mGeometryArena->GetIndexBuffer(indexFormat);
+		geo->IndexFormat = indexFormat;
+		geo->IndexBufferByteSize = mGeometryArena->IndexBufferView(indexFormat).SizeInBytes;
+	}
+
+	std::vector<SubmeshGeometry> chain;
+	UINT startIndex = block.StartIndexLocation;
+	for (size_t level = 0; level < lods.size(); ++level)
+	{
+		SubmeshGeometry submesh = block;
+		submesh.IndexCount = (UINT)lods[level].Indices32.size();
+		submesh.StartIndexLocation = startIndex;
+		submesh.LodCount = (UINT)(lods.size() - level);
+		submesh.LodError = lods[level].Error;
+		startIndex += submesh.IndexCount;
+
+		geo->DrawArgs[level == 0 ? submeshName : submeshName + "_lod" + std::to_string(level)] = submesh;
+		chain.push_back(submesh);
+	}
+
+	// Render items copy the chain pointer from level 0; geometry is only added
+	// during initialization, so the chain never moves afterwards.
+	if (chain.size() > 1)
+	{
+		geo->LodChains[submeshName] = std::move(chain);
+		geo->DrawArgs[submeshName].Lods = geo->LodChains[submeshName].data();
+	}
+
+	return geo.get();
+}
+
+/**
+ * @brief Selects a level of detail by projected error.
+ *
+ * An object space error e at view depth z covers e * h / (2 z tan(fovY / 2)) pixels
+ * on a viewport h pixels high.  The depth is that of the nearest point of the
+ * item's world sphere, and the error is scaled by the item's world scale.  The
+ * levels are ordered by increasing error, so the last one under the threshold
+ * draws the fewest triangles without visible change.
+ */
+const SubmeshGeometry* Game::SelectLod(const RenderItem& item) const
+{
+	if (item.LodCount <= 1)
+		return nullptr;
+
+	XMFLOAT3 eye = mCamera.GetPosition3f();
+	XMFLOAT3 look = mCamera.GetLook3f();
+	const BoundingSphere& sphere = item.WorldSphere;
+	float viewDepth = (sphere.Center.x - eye.x) * look.x + (sphere.Center.y - eye.y) * look.y
+		+ (sphere.Center.z - eye.z) * look.z - sphere.Radius;
+	if (viewDepth <= mCamera.GetNearZ())
+		return &item.Lods[0];
+
+	float worldScale = item.LocalSphere.Radius > 0.0f ? sphere.Radius / item.LocalSphere.Radius : 1.0f;
+	const float pixelsPerUnit = worldScale * mClientHeight / (2.0f * viewDepth * tanf(0.5f * mCamera.GetFovY()));
+
+	const SubmeshGeometry* selected = &item.Lods[0];
+	for (UINT level = 1; level < item.LodCount; ++level)
+	{
+		if (item.Lods[level].LodError * pixelsPerUnit > gLodPixelError)
+			break;
+		selected = &item.Lods[level];
+	}
+
+	return selected;
+}
+
+/**
+ * @brief Stages the subresources of a texture.
+ *
+ * Like StageBufferCopy(), relies on the COMMON to COPY_DEST promotion.
+ *
+ * @param texture Texture in the COMMON state.
+ * @param subresources Contents of every subresource, in subresource order.
+ */
+void Game::UploadTexture(ID3D12Resource* texture, std::vector<D3D12_SUBRESOURCE_DATA>& subresources)
+{
+	std::lock_guard<std::recursive_mutex> lock(mAssetMutex);
+
+	BeginResourceUploads();
+
+	while (!mStagingUploader->CopyTexture(mUploadCommandList.Get(), texture, 0, (UINT)subresources.size(), subresources.data(),
+		!OnSimulationThread()))
+		WaitForUploads();
+
+	auto toShaderResource = CD3DX12_RESOURCE_BARRIER::Transition(texture,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	mUploadCommandList->ResourceBarrier(1, &toShaderResource);
+}
+
+/**
+ * @brief Loads a registered texture if it is not resident yet.
+ *
+ * @param name The name given to CreateTexture().
+ * @return The texture, or nullptr if it was never registered.
+ */
+Texture* Game::LoadTexture(const std::string& name)
+{
+	auto resident = mTextures.find(name);
+	if (resident != mTextures.end())
+		return resident->second.get();
+
+	PROFILE_SCOPE("Game::LoadTexture");
+
+	auto definition = mTextureDefinitions.find(name);
+	if (definition == mTextureDefinitions.end() || definition->second.FileName.empty())
+		return nullptr;
+
+	auto texture = std::make_unique<Texture>();
+	texture->Name = name;
+	texture->Filename = definition->second.FileName;
+
+	// The file contents only need to live until they are copied into the staging ring.
+	std::unique_ptr<uint8_t[]> ddsData;
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+	ThrowIfFailed(DirectX::LoadDDSTextureFromFile12(md3dDevice.Get(),
+		texture->Filename.c_str(), texture->Resource, ddsData, subresources));
+	UploadTexture(texture->Resource.Get(), subresources);
+
+	Texture* result = texture.get();
+	mTextures[name] = std::move(texture);
+	return result;
+}
+
+/**
+ * @brief Takes a material reference to a texture.
+ *
+ * Loads the texture and writes its SRV the first time it is referenced.
+ *
+ * @param name The texture, or the atlas page holding it.
+ * @return The texture's slot in the SRV heap.
+ */
+int Game::AcquireTexture(const std::string& name)
+{
+	Texture* texture = LoadTexture(name);
+	// Only reachable through a material whose texture was never registered.
+	if (texture == nullptr)
+		throw DxException(E_INVALIDARG, L"Game::AcquireTexture(" + AnsiToWString(name) + L")", AnsiToWString(__FILE__), __LINE__);
+
+	mTextureDefinitions[name].RefCount++;
+
+	auto resident = mTextureSrvIndices.find(name);
+	if (resident != mTextureSrvIndices.end())
+		return resident->second;
+
+	DescriptorAllocator::uint32 slot = mSrvAllocator.Allocate();
+	if (slot == DescriptorAllocator::InvalidIndex)
+		throw DxException(E_OUTOFMEMORY, L"Game::AcquireTexture(" + AnsiToWString(name) + L")", AnsiToWString(__FILE__), __LINE__);
+	int index = (int)slot;
+
+	D3D12_RESOURCE_DESC desc = texture->Resource->GetDesc();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+
+	//This mapping enables the shader resource view (SRV) to choose how memory gets routed to the 4 return components in a shader after a memory fetch.
+	//D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING  will not reorder the components and just return the data in the order it is stored in the texture resource.
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = desc.MipLevels;
+	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+
+	md3dDevice->CreateShaderResourceView(texture->Resource.Get(), &srvDesc, GetSrvCpuHandle(index));
+
+	mTextureSrvIndices[name] = index;
+	return index;
+}
+
+/**
+ * @brief Drops one material reference to a texture.
+ *
+ * @param name The texture, or the atlas page holding it.
+ */
+void Game::ReleaseTexture(const std::string& name)
+{
+	auto definition = mTextureDefinitions.find(name);
+	if (definition != mTextureDefinitions.end() && definition->second.RefCount > 0)
+		definition->second.RefCount--;
 }
 
 /**
  * @brief Registers the game states.
  *
- * Registers the game states with the state stack.
+ * Registers the game states with the state stack and chooses which of
+ * them it keeps when they are popped.
  */
 void Game::RegisterStates()
 {
@@ -896,43 +2168,105 @@ void Game::RegisterStates()
 	mStateStack.registerState<InstructionsState>(States::Instructions);
 	mStateStack.registerState<GameState>(States::Game);
 	mStateStack.registerState<PauseState>(States::Pause);
+	mStateStack.registerState<LoadingState>(States::Loading);
+
+	// The player goes back and forth between these, so they are resumed rather than
+	// rebuilt, as is the loading screen shown each time a game starts. The game state
+	// is not: leaving it ends the game.
+	mStateStack.SetStateCaching(States::Menu, true);
+	mStateStack.SetStateCaching(States::Instructions, true);
+	mStateStack.SetStateCaching(States::Pause, true);
+	mStateStack.SetStateCaching(States::Loading, true);
+	mStateStack.SetStateCacheLimits(gStateCacheMaxStates, gStateCacheMaxBytes);
 }
 
 /**
- * @brief Waits for the GPU to finish processing.
+ * @brief Sets the pipeline state of the next draws.
+ *
+ * Sprite batches and single objects use different PSOs, so a frame switches
+ * only where one kind of draw follows the other.
  *
- * This method blocks the CPU until the GPU has completed all commands
- * up to the specified fence point.
+ * @param pso mOpaquePSO or mSpritePSO.
  */
-void Game::WaitForGPU()
+void Game::BindPipelineState(ID3D12PipelineState* pso)
 {
-	// Schedule a Signal command in the queue
-	ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
+	if (pso == mBoundPSO)
+		return;
 
-	// Wait until the GPU has completed commands up to this fence point.
-	if (mFence->GetCompletedValue() < mCurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, FALSE, FALSE, EVENT_ALL_ACCESS);
+	mCommandList->SetPipelineState(pso);
 
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+	mBoundPSO = pso;
+}
+
+/**
+ * @brief Binds a diffuse texture to root slot 0.
+ *
+ * Consecutive draws that sample the same SRV (for example sprite batches
+ * split by an object drawn between them) skip the redundant descriptor table change.
+ *
+ * @param srvHeapIndex Slot of the texture in the SRV heap.
+ */
+void Game::BindDiffuseSrv(int srvHeapIndex)
+{
+	if (srvHeapIndex == mBoundDiffuseSrvIndex)
+		return;
+
+	mCommandList->SetGraphicsRootDescriptorTable(0, GetSrvGpuHandle(srvHeapIndex));
 
-	mCurrentFence++;
+	mBoundDiffuseSrvIndex = srvHeapIndex;
 }
 
 /**
- * @brief Resets the frame resources.
+ * @brief Binds one of the geometry arena's index buffers.
  *
- * Clears the frame resources and waits for the GPU to finish processing.
+ * Most meshes use 16-bit indices, so the index buffer rarely changes within a frame.
+ *
+ * @param indexFormat DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT.
  */
-void Game::ResetFrameResources()
+void Game::BindIndexBuffer(DXGI_FORMAT indexFormat)
+{
+	if (indexFormat == mBoundIndexFormat)
+		return;
+
+	auto indexBufferView = mGeometryArena->IndexBufferView(indexFormat);
+	mCommandList->IASetIndexBuffer(&indexBufferView);
+
+	mBoundIndexFormat = indexFormat;
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE Game::GetSrvCpuHandle(int srvHeapIndex) const
 {
-	WaitForGPU();
+	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	handle.Offset(srvHeapIndex, mCbvSrvDescriptorSize);
+	return handle;
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE Game::GetSrvGpuHandle(int srvHeapIndex) const
+{
+	CD3DX12_GPU_DESCRIPTOR_HANDLE handle(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	handle.Offset(srvHeapIndex, mCbvSrvDescriptorSize);
+	return handle;
+}
+
+/**
+ * @brief Changes how many frames the CPU may run ahead of the GPU.
+ *
+ * Drains the render thread and the GPU, then rebuilds the frame resource ring
+ * with one frame resource per frame in flight.  Every constant buffer is
+ * marked dirty, since the new ones start out empty.
+ *
+ * @param count Frames in flight, clamped to [1, FrameScheduler::MaxFramesInFlight]
+ */
+void Game::SetFramesInFlight(unsigned count)
+{
+	mRenderThread.Flush();
+	mFrameScheduler.SetFramesInFlight(count);
+	gNumFrameResources = (int)mFrameScheduler.GetFramesInFlight();
 
 	mFrameResources.clear();
-	
+	BuildFrameResources();
+
+	mStateStack.MarkRenderItemsDirty();
 }
 
 /**
@@ -1010,7 +2344,7 @@ std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> Game::GetStaticSamplers()
  */
 float Game::GetHillsHeight(float x, float z)const
 {
-	return 0.1f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+	return TerrainGenerator::HillHeight(x, z, gHillAmplitude, gHillFrequency);
 }
 
 /**
@@ -1024,14 +2358,9 @@ float Game::GetHillsHeight(float x, float z)const
  */
 XMFLOAT3 Game::GetHillsNormal(float x, float z)const
 {
-	// n = (-df/dx, 1, -df/dz)
-	XMFLOAT3 n(
-		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-		1.0f,
-		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
-
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
+	// n = (-df/dx, 1, -df/dz), normalized
+	XMFLOAT3 n;
+	TerrainGenerator::HillNormal(x, z, gHillAmplitude, gHillFrequency, &n.x);
 
 	return n;
 }
@@ -1,8 +1,87 @@
+#include "../../Common/d3dApp.h"
+#include "../../Common/UploadBuffer.h"
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/Camera.h"
+#include "FrameResource.h"
 #include "World.hpp"
 #include "Player.hpp"
 #include "StateStack.hpp"
+#include "../../Common/TextureAtlas.h"
+#include "../../Common/DescriptorAllocator.h"
+#include "../../Common/StagingUploader.h"
+#include "../../Common/GeometryArena.h"
+#include "../../Common/VertexQuantizer.h"
+#include "../../Common/TerrainGenerator.h"
+#include "../../Common/ChunkedTerrain.h"
+#include "../../Common/FrustumCuller.h"
+#include "../../Common/OcclusionCuller.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/FixedTimestep.h"
+#include "../../Common/RenderThread.h"
+#include "../../Common/FrameScheduler.h"
+#include "RenderSnapshot.hpp"
 #include <dwrite.h>
 #include <d2d1.h>
+#include <mutex>
+#include <thread>
+
+using Microsoft::WRL::ComPtr;
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+#pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "D3D12.lib")
+
+/**
+ * @brief Location of a texture that was packed into a shared atlas page
+ */
+struct AtlasRegion
+{
+	std::string PageName;                                 ///< Name of the atlas page texture
+	XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();  ///< Maps [0,1] UVs onto the packed sub-rectangle
+};
+
+/**
+ * @brief Vertex decoding constants of the terrain chunk held in a vertex slot
+ */
+struct TerrainSlot
+{
+	XMFLOAT3 PosCenter = { 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 PosExtents = { 1.0f, 1.0f, 1.0f };
+	XMFLOAT2 TexCoordOffset = { 0.0f, 0.0f };
+	XMFLOAT2 TexCoordScale = { 1.0f, 1.0f };
+};
+
+/**
+ * @brief Source of a texture and the number of resident materials sampling it
+ */
+struct TextureDefinition
+{
+	std::wstring FileName;  ///< DDS file loaded on first use, empty for generated atlas pages
+	int RefCount = 0;       ///< Resident materials that sample the texture
+};
+
+/**
+ * @brief A trimmed texture kept until the frames that could sample it have executed
+ */
+struct RetiredTexture
+{
+	UINT64 Fence = 0;                   ///< Last fence signaled when the texture was trimmed
+	std::unique_ptr<Texture> Resource;  ///< The texture resource
+	int SrvIndex = -1;                  ///< Descriptor slot, reused once the fence completes
+};
+
+/**
+ * @brief Parameters of a material that is created the first time a scene node asks for it
+ */
+struct MaterialDefinition
+{
+	std::string TexName;      ///< Diffuse texture sampled by the material
+	XMFLOAT4 DiffuseAlbedo;   ///< Base color properties
+	XMFLOAT3 FresnelR0;       ///< Reflectance properties
+	float Roughness;          ///< Surface roughness value
+	int RefCount = 0;         ///< Render items currently using the material
+};
 
 /**
  * @brief Core game application class inheriting from Direct3D base
@@ -58,12 +137,25 @@ public:
 	virtual void Update(const GameTimer& gt) override;
 
 	/**
-	 * @brief Main rendering loop
+	 * @brief Hands the snapshot filled by Update() to the render thread
 	 * @param gt Game timer with frame timing
 	 * @override D3DApp override
 	 */
 	virtual void Draw(const GameTimer& gt) override;
 
+	/**
+	 * @brief Visible and culled draw counts of the last frame for the window caption
+	 * @override D3DApp override
+	 */
+	virtual std::wstring GetFrameStatsText() const override;
+
+	/**
+	 * @brief Changes how many frames the CPU may run ahead of the GPU
+	 * @param count Frames in flight, between 1 and FrameScheduler::MaxFramesInFlight
+	 * @note Waits for the GPU; F5 cycles through the counts
+	 */
+	void SetFramesInFlight(unsigned count);
+
 	//-------------------------------------------------------------------------
 	// Input Handling
 	//-------------------------------------------------------------------------
@@ -83,35 +175,121 @@ public:
 	void RegisterStates();
 
 	/**
-	 * @brief Creates a texture resource
+	 * @brief Registers a texture that is loaded the first time a material samples it
 	 * @param Name Unique identifier for the texture
 	 * @param FileName Path to texture file
 	 */
 	void CreateTexture(std::string Name, std::wstring FileName);
 
 	/**
-	 * @brief Creates a material definition
+	 * @brief Registers a material that is created the first time a scene node uses it
 	 * @param Name Unique identifier for the material
+	 * @param TexName Name of the diffuse texture sampled by the material
 	 * @param DiffuseAlbedo Base color properties
 	 * @param FresnelR0 Reflectance properties
 	 * @param Roughness Surface roughness value
 	 */
-	void CreateMaterials(std::string Name, XMFLOAT4 DiffuseAlbedo, XMFLOAT3 FresnelR0, float Roughness);
+	void CreateMaterials(std::string Name, std::string TexName, XMFLOAT4 DiffuseAlbedo, XMFLOAT3 FresnelR0, float Roughness);
+
+	//-------------------------------------------------------------------------
+	// Asset Lifetime
+	//-------------------------------------------------------------------------
+
+	/**
+	 * @brief Gets a material, creating it and loading its texture on first use
+	 * @param name Material name given to CreateMaterials()
+	 * @return The material, or nullptr if no such material was registered
+	 */
+	Material* AcquireMaterial(const std::string& name);
+
+	/**
+	 * @brief Drops one reference taken by AcquireMaterial()
+	 *
+	 * Unreferenced materials stay resident until the next TrimUnusedAssets(),
+	 * so a state that replaces another one keeps the assets they share.
+	 */
+	void ReleaseMaterial(Material* material);
+
+	/**
+	 * @brief Frees every material and texture that no render item references
+	 *
+	 * Called by Update() once a destroyed state has left a material unused.
+	 * The textures are only released when the frames submitted before the
+	 * trim have executed, see ReleaseRetiredTextures().
+	 */
+	void TrimUnusedAssets();
+
+	/**
+	 * @brief Submits the uploads recorded since the last flush as one batch
+	 *
+	 * Does not wait: the copies run ahead of the next frame on the same queue,
+	 * and their staging memory is reclaimed once the batch's fence completes.
+	 * The asset functions above and below may also run on the thread building
+	 * a state pushed with StateStack::pushStateAsync(); they share mAssetMutex.
+	 * That thread only records: its uploads are submitted by the next Update().
+	 */
+	void FlushResourceUploads();
+
+	/**
+	 * @brief Stages data into part of a buffer
+	 *
+	 * The buffer becomes readable again once the current upload batch runs.
+	 */
+	void StageBufferCopy(ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 byteSize);
+
+	/**
+	 * @brief Appends a mesh to the shared geometry arena
+	 * @param geoName MeshGeometry to add the mesh to, created if needed
+	 * @param submeshName Key of the mesh in the geometry's DrawArgs
+	 * @param vertices Mesh vertices, stored as PackedVertex
+	 * @param indices Mesh indices, relative to the first vertex of the mesh; stored in
+	 *                16 bits when the mesh has at most 65536 vertices, else in 32
+	 * @return The geometry holding the new submesh
+	 */
+	MeshGeometry* AddMeshGeometry(const std::string& geoName, const std::string& submeshName,
+		const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices);
+
+	/**
+	 * @brief Appends a mesh and its level of detail chain to the geometry arena
+	 *
+	 * The vertices are stored once; each level adds its own index range.  Level 0
+	 * is stored as submeshName and level n as submeshName + "_lod<n>".
+	 * @param lods Chain from GeometryGenerator::BuildLodChain()
+	 */
+	MeshGeometry* AddMeshGeometry(const std::string& geoName, const std::string& submeshName,
+		const std::vector<Vertex>& vertices, const std::vector<GeometryGenerator::MeshLod>& lods);
+
+	/**
+	 * @brief Stages every subresource of a texture created in the COMMON state
+	 */
+	void UploadTexture(ID3D12Resource* texture, std::vector<D3D12_SUBRESOURCE_DATA>& subresources);
 
 	//-------------------------------------------------------------------------
 	// Rendering System
 	//-------------------------------------------------------------------------
 
-	void LoadTextures();  ///< Loads all texture resources
+	void LoadTextures();  ///< Registers all texture files
+	void BuildTextureAtlas();  ///< Packs the UI textures into shared atlas pages
 	void BuildRootSignature();  ///< Creates root signature
 	void BuildDescriptorHeaps();  ///< Builds descriptor heaps
 	void BuildShadersAndInputLayout();  ///< Compiles shaders and defines input layout
 	void BuildShapeGeometry();  ///< Creates primitive geometries
 	void BuildHillGeometry();  ///< Creates terrain geometry
+	void BuildTerrain();  ///< Starts the streamed terrain and reserves its geometry
 	void BuildPSOs();  ///< Creates pipeline state objects
-	void BuildFrameResources(int renderItemCount);  ///< Creates frame resources
-	void BuildMaterials();  ///< Initializes default materials
-	void ResetFrameResources();  ///< Resets frame resource allocation
+	void BuildFrameResources();  ///< Creates one frame resource per frame in flight at the reserved sizes
+	void ReserveFrameResources();  ///< Grows the reserved constant buffer sizes to fit the current state
+	void BuildMaterials();  ///< Registers the default materials
+
+	void BeginResourceUploads();  ///< Opens the command list for uploads if needed
+	void WaitForUploads();  ///< Submits pending uploads, waits for them and reopens the command list
+	void ReleaseCompletedUploads();  ///< Reclaims staging memory of finished upload batches
+	void ReleaseRetiredTextures();  ///< Frees the trimmed textures no submitted frame can still sample
+	void WaitForFence(UINT64 fence);  ///< Blocks until the GPU reaches a fence value
+	bool OnSimulationThread() const { return std::this_thread::get_id() == mSimulationThread; }  ///< Only this thread submits upload batches
+	Texture* LoadTexture(const std::string& name);  ///< Loads a registered texture if it is not resident
+	int AcquireTexture(const std::string& name);  ///< Loads a texture and its SRV, returns the heap slot
+	void ReleaseTexture(const std::string& name);  ///< Drops one material reference to a texture
 
 	//-------------------------------------------------------------------------
 	// Camera & View
@@ -121,37 +299,132 @@ public:
 	float GetHillsHeight(float x, float z) const;  ///< Gets terrain height at position
 	XMFLOAT3 GetHillsNormal(float x, float z) const;  ///< Gets terrain normal at position
 
+	/**
+	 * @brief Streams terrain chunks around a point and uploads the finished ones
+	 * @param focusX Terrain x coordinate under the camera
+	 * @param focusZ Terrain z coordinate under the camera
+	 */
+	void UpdateTerrain(float focusX, float focusZ);
+
 	//-------------------------------------------------------------------------
-	// Constant Buffer Updates
+	// Render Snapshots (simulation thread)
 	//-------------------------------------------------------------------------
 
-	void UpdateObjectCBs(const GameTimer& gt);  ///< Updates object constant buffers
-	void UpdateMaterialCBs(const GameTimer& gt);  ///< Updates material constant buffers
-	void UpdateMainPassCB(const GameTimer& gt);  ///< Updates pass constants
+	/**
+	 * @brief Adds a render item's draw to the snapshot being filled
+	 *
+	 * Called by the scene nodes from drawCurrent(), so the draws keep the scene graph order.
+	 */
+	void CaptureDraw(const RenderItem& item);
+
+	/**
+	 * @brief Adds a sprite to the snapshot, as an instance of the last draw where it can
+	 *
+	 * Consecutive sprites that draw the same submesh with the same texture, such as
+	 * the banners packed into the UI atlas, become one instanced draw.
+	 */
+	void CaptureSpriteDraw(const RenderItem& item);
+
+	/**
+	 * @brief Culls the resident terrain chunks picked by the last UpdateTerrain() and adds the visible ones
+	 * @param world Places the terrain in the scene
+	 * @param material Material the chunks are drawn with
+	 */
+	void CaptureTerrain(const XMFLOAT4X4& world, const Material* material);
+
+	void CaptureObjects();  ///< Copies the changed and the moving object constants of the visible states
+	void CaptureMaterials();  ///< Copies the changed material constants
+	void CapturePass(const GameTimer& gt);  ///< Copies the camera and timer
 	void AnimateMaterials(const GameTimer& gt);  ///< Handles material animations
+	void SavePreviousWorlds();  ///< Keeps the world matrices of the visible states before a tick changes them
+
+	/**
+	 * @brief World matrix of an item at the render time, between the last two ticks
+	 * @param world Receives the blend of PrevWorld and World by the simulation step's alpha, or World
+	 * @return True if the item moved in the last tick, so the blend changes from frame to frame
+	 */
+	bool InterpolateWorld(const RenderItem& item, XMFLOAT4X4& world) const;
+
+	//-------------------------------------------------------------------------
+	// Frame Recording (render thread)
+	//-------------------------------------------------------------------------
+
+	void RenderFrame(const RenderSnapshot& snapshot);  ///< Records, submits and presents one snapshot
+	void UpdateObjectCBs(const RenderSnapshot& snapshot);  ///< Writes object and terrain constants to the frame resource
+	void UpdateMaterialCBs(const RenderSnapshot& snapshot);  ///< Writes material constants to the frame resource
+	void UpdateMainPassCB(const RenderSnapshot& snapshot);  ///< Writes pass constants to the frame resource
+	void UpdateSpriteInstances(const RenderSnapshot& snapshot);  ///< Writes the sprite batches' instances to the frame resource
+	void DrawSnapshot(const RenderSnapshot& snapshot);  ///< Records the snapshot's draws
 
 	//-------------------------------------------------------------------------
 	// Resource Access
 	//-------------------------------------------------------------------------
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();  ///< Gets default static samplers
-	void WaitForGPU();  ///< Synchronizes CPU/GPU execution
+	void BindPipelineState(ID3D12PipelineState* pso);  ///< Sets a pipeline state if not already set
+	void BindDiffuseSrv(int srvHeapIndex);  ///< Binds a diffuse texture, skipping redundant table changes
+	void BindIndexBuffer(DXGI_FORMAT indexFormat);  ///< Binds the arena's 16 or 32-bit index buffer if not already bound
+	CD3DX12_CPU_DESCRIPTOR_HANDLE GetSrvCpuHandle(int srvHeapIndex) const;  ///< CPU handle of an SRV heap slot
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GetSrvGpuHandle(int srvHeapIndex) const;  ///< GPU handle of an SRV heap slot
 
 	//-------------------------------------------------------------------------
 	// Public Members (Consider Refactoring)
 	//-------------------------------------------------------------------------
 	
-	std::vector<std::unique_ptr<FrameResource>> mFrameResources; ///< Frame resource ring buffer
-	FrameResource* mCurrFrameResource = nullptr; ///< Current frame resource
+	std::vector<std::unique_ptr<FrameResource>> mFrameResources; ///< Frame resource ring buffer, cycled by the render thread
+	FrameResource* mCurrFrameResource = nullptr; ///< Frame resource the render thread is recording into
 	int mCurrFrameResourceIndex = 0; ///< Current frame resource index
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries; ///< Geometry resources
-	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials; ///< Material definitions
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures; ///< Texture resources
-
-	int mCurrentMaterialCBIndex = 0;
-
-	int mCurrentDiffuseSrvHeapIndex = 0;
+	std::recursive_mutex mAssetMutex; ///< Guards the materials, textures and upload batch against a state built on a worker
+	std::thread::id mSimulationThread; ///< Thread that runs Update() and owns the command queue between frames
+	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials; ///< Resident materials
+	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures; ///< Resident texture resources
+	std::unordered_map<std::string, MaterialDefinition> mMaterialDefinitions; ///< Every material the game can create
+	std::unordered_map<std::string, TextureDefinition> mTextureDefinitions; ///< Every texture the game can load
+	std::unordered_map<std::string, int> mTextureSrvIndices; ///< SRV heap slot of each resident texture
+	std::unordered_map<std::string, AtlasRegion> mAtlasRegions; ///< Textures that live inside an atlas page
+	std::vector<std::unique_ptr<Texture>> mAtlasSourceTextures; ///< Packed textures kept alive until the atlas copies finish
+	bool mAtlasBuilt = false; ///< BuildTextureAtlas() has run
+	bool mUploadsOpen = false; ///< mUploadCommandList is recording upload commands
+	ComPtr<ID3D12CommandAllocator> mUploadCmdListAlloc; ///< Backs mUploadCommandList
+	ComPtr<ID3D12GraphicsCommandList> mUploadCommandList; ///< Records uploads on the simulation thread while mCommandList records a frame
+	std::unique_ptr<StagingUploader> mStagingUploader; ///< Staging ring shared by all initial uploads
+	UINT64 mUploadFence = 0; ///< Fence of the last submitted upload batch
+	std::vector<ID3D12Resource*> mStagedBuffers; ///< Buffers copied into by the open upload batch
+	std::unique_ptr<GeometryArena> mGeometryArena; ///< Vertex and index buffer shared by every mesh
+
+	std::unique_ptr<ChunkedTerrain> mTerrain; ///< Streams the hills around the camera
+	SubmeshGeometry mTerrainVertices; ///< Arena range holding every terrain vertex slot
+	std::vector<SubmeshGeometry> mTerrainIndexLists; ///< Index list of each level of detail and stitching variant
+	std::vector<TerrainSlot> mTerrainSlots; ///< Decoding constants of the chunk in each slot
+	std::vector<TerrainChunkDraw> mTerrainDraws; ///< Chunks drawn this frame
+	BoundsBatch mTerrainCullBoxes; ///< World boxes of mTerrainDraws
+	std::vector<std::uint8_t> mTerrainCullResults; ///< Visibility of each chunk in mTerrainDraws
+
+	FrustumPlanes mCameraFrustum; ///< World space camera frustum, extracted in Update()
+	std::unique_ptr<OcclusionCuller> mOcclusionCuller; ///< Depth buffer of the occluders in view
+	CullingStats mCullStats; ///< Render items and terrain chunks kept, culled and occluded this frame
+	std::vector<State*> mVisibleStates; ///< States culled and captured this frame, bottom to top
+
+	int mCurrentMaterialCBIndex = 0; ///< One past the highest material CB slot handed out
+	std::vector<int> mFreeMaterialCBIndices; ///< Slots of trimmed materials
+	std::vector<RetiredTexture> mRetiredTextures; ///< Trimmed textures, oldest first
+	bool mTrimPending = false; ///< A material has lost its last reference since the last trim
+	DescriptorAllocator mSrvAllocator; ///< Texture slots of the SRV heap
+
+	FrameScheduler mFrameScheduler{ 3 }; ///< Owns the frame resource ring slots and the fences that retire them
+	UINT mObjectCBCapacity = 0; ///< Object constants each frame resource holds; only grows
+	UINT mMaterialCBCapacity = 0; ///< Material constants each frame resource holds; only grows
+
+	RenderThread mRenderThread{ 2 }; ///< Records and submits each frame while the next one is simulated
+	std::vector<RenderSnapshot> mSnapshots; ///< One per render thread buffer
+	RenderSnapshot* mCapture = nullptr; ///< Snapshot filled between Update() and Draw(), or nullptr
+	unsigned mCaptureBuffer = 0; ///< Render thread buffer of mCapture
+
+	ID3D12PipelineState* mBoundPSO = nullptr; ///< Pipeline state currently set on the command list
+	int mBoundDiffuseSrvIndex = -1; ///< Descriptor table currently bound to root slot 0
+	DXGI_FORMAT mBoundIndexFormat = DXGI_FORMAT_UNKNOWN; ///< Arena index buffer currently bound
 
 	UINT mCbvSrvDescriptorSize = 0;
 
@@ -164,12 +437,13 @@ public:
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
 	ComPtr<ID3D12PipelineState> mOpaquePSO = nullptr;
+	ComPtr<ID3D12PipelineState> mSpritePSO = nullptr; ///< Draws sprite batches, instanced
 
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
 
 	std::vector<RenderItem*> mOpaqueRitems;
 
-	PassConstants mMainPassCB;
+	PassConstants mMainPassCB; ///< Written by the render thread
 
 	POINT mLastMousePos;
 
@@ -177,6 +451,7 @@ public:
 
 	Player mPlayer;  ///< Player entity
 	StateStack mStateStack;  ///< Game state manager
+	FixedTimestep mSimulationStep{ 60.0, 4 };  ///< Runs mStateStack at 60 Hz; GetAlpha() blends the moving items between ticks
 
 	//-------------------------------------------------------------------------
 	// Accessors
@@ -184,7 +459,14 @@ public:
 
 	ID3D12GraphicsCommandList* getCmdList() { return mCommandList.Get(); }
 	std::unordered_map<std::string, std::unique_ptr<Material>>& getMaterials() { return mMaterials; }
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& getGeometries() { return mGeometries; }
+	const std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& getGeometries() const { return mGeometries; }  ///< Filled by Initialize(), then only read, also by states built on a worker
+
+	/**
+	 * @brief Picks the coarsest level of an item's submesh whose error stays below gLodPixelError on screen
+	 * @return The level to draw, or nullptr if the submesh has a single level
+	 */
+	const SubmeshGeometry* SelectLod(const RenderItem& item) const;
+	DrawRecord DescribeDraw(const RenderItem& item) const;  ///< Draw of a render item at its selected level of detail
 
 private:
 	//-------------------------------------------------------------------------
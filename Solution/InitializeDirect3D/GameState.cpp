@@ -10,7 +10,6 @@
  * Initializes:
  * - Game world simulation
  * - Pause state UI elements
- * - Rendering resources
  * - Input command system
  */
 GameState::GameState(StateStack* stack, Context* context)
@@ -18,11 +17,6 @@ GameState::GameState(StateStack* stack, Context* context)
 	, mWorld(this)
 	, mPauseStateSceneGraph(std::make_unique<SceneNode>(this))
 {
-	// Reset rendering resources
-	mAllRitems.clear();
-	mContext->game->ResetFrameResources();
-	mContext->game->BuildMaterials();
-
 	// Initialize game world
 	mWorld.buildScene();
 
@@ -36,9 +30,6 @@ GameState::GameState(StateStack* stack, Context* context)
 	mPauseStateSceneGraph->attachChild(std::move(PauseSprite));
 	
 	mPauseStateSceneGraph->build();
-
-	// Finalize resource setup
-	mContext->game->BuildFrameResources(mAllRitems.size());
 }
 
 /**
@@ -73,7 +64,7 @@ bool GameState::Update(const GameTimer& gt)
  * @param btnState Bitmask of button states
  * @return True to consume event, false to propagate
  */
-bool GameState::HandleEvent(WPARAM btnState)
+bool GameState::HandleEvent(std::uintptr_t btnState)
 {
 	if (d3dUtil::IsKeyDown('P'))
 	{
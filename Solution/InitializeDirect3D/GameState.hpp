@@ -47,7 +47,7 @@ public:
      * @return True if event was consumed, false to propagate
      * @override Required State override
      */
-    virtual bool HandleEvent(WPARAM btnState) override;
+    virtual bool HandleEvent(std::uintptr_t btnState) override;
 
     /**
      * @brief Handles continuous/real-time input
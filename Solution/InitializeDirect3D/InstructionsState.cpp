@@ -12,7 +12,6 @@
  * - Background galaxy texture
  * - Control scheme visualization (WASD)
  * - Return to menu button
- * - Frame rendering resources
  */
 InstructionsState::InstructionsState(StateStack* stack, Context* context)
     : State(stack, context)
@@ -27,11 +26,6 @@ InstructionsState::InstructionsState(StateStack* stack, Context* context)
         OutputDebugStringA("mSceneGraph initialized.\n");
     }
 
-    // Reset rendering resources
-    mAllRitems.clear();
-    mContext->game->ResetFrameResources();
-    mContext->game->BuildMaterials();
-
     //-------------------------------------------------------------------------
     // Scene Graph Setup
     //-------------------------------------------------------------------------
@@ -40,6 +34,7 @@ InstructionsState::InstructionsState(StateStack* stack, Context* context)
     std::unique_ptr<SpriteNode> backgroundSprite = std::make_unique<SpriteNode>(this);
     backgroundSprite->SetDrawName("Galaxy", "boxGeo", "box");
     backgroundSprite->setScale(10.0, 1.0, 7.0);
+    backgroundSprite->SetOccluder(true);
     backgroundSprite->setPosition(0, 0, 0);
     mSceneGraph->attachChild(std::move(backgroundSprite));
 
@@ -59,7 +54,6 @@ InstructionsState::InstructionsState(StateStack* stack, Context* context)
 
     // Finalize scene setup
     mSceneGraph->build();
-    mContext->game->BuildFrameResources(mAllRitems.size());
 }
 
 /**
@@ -96,7 +90,7 @@ bool InstructionsState::Update(const GameTimer& gt)
  * @param btnState Bitmask of button states
  * @return True to consume event, false to propagate
  */
-bool InstructionsState::HandleEvent(WPARAM btnState)
+bool InstructionsState::HandleEvent(std::uintptr_t btnState)
 {
     //input goes here
     if (d3dUtil::IsKeyDown('Q'))
@@ -0,0 +1,90 @@
+#include "LoadingState.hpp"
+#include "Game.hpp"
+
+/**
+ * @brief Constructs the Loading State
+ * @param stack State stack manager
+ * @param context Shared game context
+ *
+ * Initializes:
+ * - Background galaxy texture
+ * - Spinning star
+ */
+LoadingState::LoadingState(StateStack* stack, Context* context)
+    : State(stack, context)
+{
+    // Background Galaxy Sprite
+    std::unique_ptr<SpriteNode> backgroundSprite = std::make_unique<SpriteNode>(this);
+    backgroundSprite->SetDrawName("Galaxy", "boxGeo", "box");
+    backgroundSprite->setScale(10.0, 1.0, 7.0);
+    backgroundSprite->SetOccluder(true);
+    backgroundSprite->setPosition(0, 0, 0);
+    mSceneGraph->attachChild(std::move(backgroundSprite));
+
+    // Spinning Star Sprite
+    std::unique_ptr<SpriteNode> starSprite = std::make_unique<SpriteNode>(this);
+    starSprite->SetDrawName("Star", "boxGeo", "box");
+    starSprite->setScale(1.5, 1.5, 1.5);
+    starSprite->setPosition(0, 1, 0);
+    mStarSprite = starSprite.get();
+    mSceneGraph->attachChild(std::move(starSprite));
+
+    // Finalize scene setup
+    mSceneGraph->build();
+}
+
+/**
+ * @brief Destructor for resource cleanup
+ */
+LoadingState::~LoadingState()
+{
+}
+
+/**
+ * @brief Renders the loading screen
+ */
+void LoadingState::Draw()
+{
+    mSceneGraph->draw();
+}
+
+/**
+ * @brief Spins the star
+ * @param gt Game timer with frame timing
+ * @return False to block updates in lower states
+ */
+bool LoadingState::Update(const GameTimer& gt)
+{
+    mSpinAngle = fmodf(mSpinAngle + gt.DeltaTime() * mSpinSpeed, XM_2PI);
+    mStarSprite->setWorldRotation(0.0f, mSpinAngle, 0.0f);
+
+    mSceneGraph->update(gt);
+    return false;
+}
+
+/**
+ * @brief Swallows input events while loading
+ * @param btnState Bitmask of button states
+ * @return False to stop propagation
+ */
+bool LoadingState::HandleEvent(std::uintptr_t btnState)
+{
+    return false;
+}
+
+/**
+ * @brief Swallows real-time input while loading
+ * @return False to stop propagation
+ */
+bool LoadingState::HandleRealTimeInput()
+{
+    return false;
+}
+
+/**
+ * @brief Resets the star when the cached state is shown again
+ */
+void LoadingState::OnResume()
+{
+    mSpinAngle = 0.0f;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "State.hpp"
+#include "SpriteNode.h"
+
+/**
+ * @brief Transitional state shown while another state is built
+ *
+ * Pushed by StateStack::pushStateAsync() in place of the state being built,
+ * and replaced by it once the build completes.  It only uses materials the
+ * menus have already made resident, so it enters without a hitch:
+ * - Galaxy backdrop
+ * - Spinning star
+ */
+class LoadingState : public State
+{
+public:
+    /**
+     * @brief Constructs a LoadingState with stack and context
+     * @param stack State stack for state management
+     * @param context Shared game context (resources, input, etc.)
+     */
+    LoadingState(StateStack* stack, Context* context);
+
+    /**
+     * @brief Destructor for resource cleanup
+     */
+    virtual ~LoadingState();
+
+    //-------------------------------------------------------------------------
+    // State Interface Implementation
+    //-------------------------------------------------------------------------
+
+    /**
+     * @brief Renders the backdrop and the spinning star
+     * @override Required State override
+     */
+    virtual void Draw() override;
+
+    /**
+     * @brief Spins the star
+     * @param gt GameTimer with frame timing information
+     * @return False, nothing below runs while loading
+     * @override Required State override
+     */
+    virtual bool Update(const GameTimer& gt) override;
+
+    /**
+     * @brief Ignores input until the next state is ready
+     * @param btnState Bitmask of button states
+     * @return False, the event does not reach lower states
+     * @override Required State override
+     */
+    virtual bool HandleEvent(std::uintptr_t btnState) override;
+
+    /**
+     * @brief Ignores continuous input until the next state is ready
+     * @return False, the input does not reach lower states
+     * @override Required State override
+     */
+    virtual bool HandleRealTimeInput() override;
+
+    /**
+     * @brief Restarts the spin each time the state is shown again
+     */
+    virtual void OnResume() override;
+
+private:
+    SpriteNode* mStarSprite = nullptr;  ///< Spinning star
+    float mSpinAngle = 0.0f;            ///< Current star rotation (radians)
+    float mSpinSpeed = 3.0f;            ///< Star rotation speed (radians/sec)
+};
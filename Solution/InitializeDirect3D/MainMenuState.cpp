@@ -12,7 +12,6 @@
  * - Background galaxy texture
  * - Menu title text
  * - Animated ship decoration
- * - Frame rendering resources
  */
 MainMenuState::MainMenuState(StateStack* stack, Context* context)
     : State(stack, context)
@@ -27,11 +26,6 @@ MainMenuState::MainMenuState(StateStack* stack, Context* context)
         OutputDebugStringA("mSceneGraph initialized.\n");
     }
 
-    // Reset rendering resources
-    mAllRitems.clear();
-    mContext->game->ResetFrameResources();
-    mContext->game->BuildMaterials();
-
     //-------------------------------------------------------------------------
     // Scene Graph Setup
     //-------------------------------------------------------------------------
@@ -40,6 +34,7 @@ MainMenuState::MainMenuState(StateStack* stack, Context* context)
     std::unique_ptr<SpriteNode> backgroundSprite = std::make_unique<SpriteNode>(this);
     backgroundSprite->SetDrawName("Galaxy", "boxGeo", "box");
     backgroundSprite->setScale(10.0, 1.0, 7.0);
+    backgroundSprite->SetOccluder(true);
     backgroundSprite->setPosition(0, 0, 0);
     mSceneGraph->attachChild(std::move(backgroundSprite));
 
@@ -60,7 +55,6 @@ MainMenuState::MainMenuState(StateStack* stack, Context* context)
 
     // Finalize scene setup
     mSceneGraph->build();
-    mContext->game->BuildFrameResources(mAllRitems.size());
 }
 
 /**
@@ -104,13 +98,13 @@ bool MainMenuState::Update(const GameTimer& gt)
  * @param btnState Bitmask of button states
  * @return True to consume event, false to propagate
  */
-bool MainMenuState::HandleEvent(WPARAM btnState)
+bool MainMenuState::HandleEvent(std::uintptr_t btnState)
 {
-    // Start game on 'P'
+    // Start game on 'P'; the world is built behind a loading screen
     if (d3dUtil::IsKeyDown('P'))
     {
         RequestStackPop();
-        RequestStackPush(States::Game);
+        RequestStackPushAsync(States::Game, States::Loading);
     }
     // Show instructions on 'I'
     else if (d3dUtil::IsKeyDown('I'))
@@ -55,7 +55,7 @@ bool PauseState::Update(const GameTimer& gt)
  * @param btnState Bitmask of button states
  * @return False to propagate unhandled events
  */
-bool PauseState::HandleEvent(WPARAM btnState)
+bool PauseState::HandleEvent(std::uintptr_t btnState)
 {
     if (d3dUtil::IsKeyDown('P'))
     {
@@ -49,7 +49,7 @@ public:
      * @return True if event was consumed, false to propagate
      * @override Required State override
      */
-    virtual bool HandleEvent(WPARAM btnState) override;
+    virtual bool HandleEvent(std::uintptr_t btnState) override;
 
     /**
      * @brief Handles continuous input (keyboard/controller state)
@@ -58,6 +58,12 @@ public:
      */
     virtual bool HandleRealTimeInput() override;
 
+    /**
+     * @brief The paused game stays on screen under the overlay
+     * @return True
+     */
+    virtual bool IsTransparent() const override { return true; }
+
     //-------------------------------------------------------------------------
     // Custom Pause Functionality
     //-------------------------------------------------------------------------
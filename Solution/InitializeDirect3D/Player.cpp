@@ -2,6 +2,7 @@
 #include "Player.hpp"
 #include "CommandQueue.hpp"
 #include "Aircraft.hpp"
+#include "../../Common/d3dApp.h"
 
 #include <map>
 #include <string>
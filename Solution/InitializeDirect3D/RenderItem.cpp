@@ -0,0 +1,24 @@
+#include "RenderItem.hpp"
+#include "../../Common/d3dUtil.h"
+
+/**
+ * @brief Copies the draw arguments and vertex decoding constants of a submesh
+ * @param submesh Submesh of Geo the item draws
+ */
+void RenderItem::SetSubmesh(const SubmeshGeometry& submesh)
+{
+	IndexCount = submesh.IndexCount;
+	StartIndexLocation = submesh.StartIndexLocation;
+	BaseVertexLocation = submesh.BaseVertexLocation;
+	Index32 = submesh.IndexFormat == DXGI_FORMAT_R32_UINT;
+	Lods = submesh.Lods;
+	LodCount = submesh.Lods != nullptr ? submesh.LodCount : 1;
+	PosCenter = submesh.Bounds.Center;
+	PosExtents = submesh.Bounds.Extents;
+	TexCoordOffset = submesh.TexCoordOffset;
+	TexCoordScale = submesh.TexCoordScale;
+	LocalBounds = submesh.Bounds;
+	LocalSphere = submesh.Sphere;
+	BoundsDirty = true;
+	NumFramesDirty = gNumFrameResources;
+}
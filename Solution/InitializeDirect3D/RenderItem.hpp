@@ -0,0 +1,79 @@
+#pragma once
+#include "../../Common/MathHelper.h"
+#include <DirectXCollision.h>
+#include <cstdint>
+
+using namespace DirectX;
+
+struct Material;
+struct MeshGeometry;
+struct SubmeshGeometry;
+
+/// Frame resources cycled by the renderer, defined by the application.
+extern int gNumFrameResources;
+
+/**
+ * @brief Lightweight structure to store parameters for drawing a shape.
+ *
+ * Only the Direct3D geometry and material are referenced, through pointers, so
+ * the scene graph and the states can be built without the renderer.
+ */
+struct RenderItem
+{
+	RenderItem() = default;
+
+	// World matrix of the shape that describes the object's local space
+	// relative to the world space, which defines the position, orientation,
+	// and scale of the object in the world.
+	XMFLOAT4X4 World = MathHelper::Identity4x4(); ///< World matrix of the shape
+
+	// World as it was before the last simulation tick; frames between ticks draw the
+	// item blended from PrevWorld to World, see Game::InterpolateWorld().
+	XMFLOAT4X4 PrevWorld = MathHelper::Identity4x4(); ///< World before the tick PrevWorldTick
+	std::uint64_t PrevWorldTick = -1; ///< Tick that saved PrevWorld; a stale one means the item is drawn at World
+
+	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4(); ///< Texture transform matrix
+
+	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
+	// Because we have an object cbuffer for each FrameResource, we have to apply the
+	// update to each FrameResource.  Thus, when we modify obect data we should set
+	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
+	int NumFramesDirty = gNumFrameResources; ///< Number of frames the object data has been dirty
+
+	std::uint32_t ObjCBIndex = -1; ///< Slot in the object constant buffer, given by RenderItemRegistry
+
+	Material* Mat = nullptr; ///< Material of the object
+	MeshGeometry* Geo = nullptr; ///< Geometry of the object
+
+	// DrawIndexedInstanced parameters.
+	std::uint32_t IndexCount = 0; ///< Number of indices
+	std::uint32_t StartIndexLocation = 0; ///< Starting index location
+	int BaseVertexLocation = 0; ///< Base vertex location
+	bool Index32 = false; ///< The draw reads the 32-bit index buffer, else the 16-bit one
+	const SubmeshGeometry* Lods = nullptr; ///< Level of detail chain of the submesh, or nullptr
+	std::uint32_t LodCount = 1; ///< Levels in Lods; Game::SelectLod() picks one per frame
+
+	// Decoding constants of the packed vertices, see PackedVertex.
+	XMFLOAT3 PosCenter = { 0.0f, 0.0f, 0.0f }; ///< Centre of the submesh bounds
+	XMFLOAT3 PosExtents = { 1.0f, 1.0f, 1.0f }; ///< Half size of the submesh bounds
+	XMFLOAT2 TexCoordOffset = { 0.0f, 0.0f }; ///< Smallest texture coordinate
+	XMFLOAT2 TexCoordScale = { 1.0f, 1.0f }; ///< Texture coordinate range
+
+	// Bounds of the submesh in object space and of the item in world space, see
+	// State::UpdateBounds().  Set BoundsDirty whenever World changes.
+	BoundingBox LocalBounds; ///< Object space box of the submesh
+	BoundingSphere LocalSphere; ///< Object space sphere of the submesh
+	BoundingBox WorldBounds; ///< World space box, refreshed while BoundsDirty is set
+	BoundingSphere WorldSphere; ///< World space sphere, refreshed with WorldBounds
+	bool BoundsDirty = true; ///< World or the submesh changed since the bounds were computed
+	std::uint32_t BoundsLeaf = -1; ///< Leaf of the item in its state's bounds tree
+	bool Visible = true; ///< WorldBounds intersected the camera frustum and was not occluded, see State::CullRenderItems()
+	bool Occluder = false; ///< The submesh is a solid, opaque box that hides what lies behind it
+
+	/**
+	 * @brief Copies the draw arguments and vertex decoding constants of a submesh
+	 *
+	 * Defined with the renderer in RenderItem.cpp.
+	 */
+	void SetSubmesh(const SubmeshGeometry& submesh);
+};
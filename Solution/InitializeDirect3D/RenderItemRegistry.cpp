@@ -0,0 +1,53 @@
+#include "RenderItemRegistry.hpp"
+#include <algorithm>
+#include <functional>
+
+/**
+ * @brief Gives an item the lowest free slot
+ * @param item Item whose ObjCBIndex is set
+ *
+ * A slot is only added past the top when none was freed.
+ */
+void RenderItemRegistry::Register(RenderItem& item)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFreeSlots.empty())
+    {
+        item.ObjCBIndex = mSlotCount++;
+        return;
+    }
+
+    std::pop_heap(mFreeSlots.begin(), mFreeSlots.end(), std::greater<std::uint32_t>());
+    item.ObjCBIndex = mFreeSlots.back();
+    mFreeSlots.pop_back();
+}
+
+/**
+ * @brief Returns an item's slot for reuse
+ * @param item Item given a slot by Register()
+ *
+ * The slot can be handed out again at once.  Its constants are only
+ * overwritten by frames captured after that, once the item no longer draws.
+ */
+void RenderItemRegistry::Unregister(RenderItem& item)
+{
+    if (item.ObjCBIndex == (std::uint32_t)-1)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFreeSlots.push_back(item.ObjCBIndex);
+    std::push_heap(mFreeSlots.begin(), mFreeSlots.end(), std::greater<std::uint32_t>());
+    item.ObjCBIndex = (std::uint32_t)-1;
+}
+
+std::uint32_t RenderItemRegistry::GetSlotCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSlotCount;
+}
+
+std::uint32_t RenderItemRegistry::GetItemCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSlotCount - (std::uint32_t)mFreeSlots.size();
+}
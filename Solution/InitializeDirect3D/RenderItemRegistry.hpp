@@ -0,0 +1,53 @@
+#pragma once
+#include "RenderItem.hpp"
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Hands out the object constant buffer slots of the render items
+ *
+ * One registry serves every live state, on the stack, in the StateStack cache
+ * or being built, so no two items share a slot and the states can be drawn
+ * together.  An item keeps its slot until it is unregistered, which lets a
+ * state that is uncovered or resumed draw straight away.  Freed slots are
+ * reused lowest first, keeping the slots in use packed at the bottom of the
+ * constant buffer.
+ *
+ * @note Thread-safe: a state built on a worker registers its items there
+ */
+class RenderItemRegistry
+{
+public:
+    RenderItemRegistry() = default;
+    RenderItemRegistry(const RenderItemRegistry&) = delete;
+    RenderItemRegistry& operator=(const RenderItemRegistry&) = delete;
+
+    /**
+     * @brief Gives an item a slot
+     * @param item Item whose ObjCBIndex is set
+     */
+    void Register(RenderItem& item);
+
+    /**
+     * @brief Returns an item's slot for reuse
+     * @param item Item given a slot by Register(), its ObjCBIndex is reset
+     */
+    void Unregister(RenderItem& item);
+
+    /**
+     * @brief Gets one past the highest slot handed out so far
+     * @return Object constants a frame resource must hold for every registered item
+     */
+    std::uint32_t GetSlotCount() const;
+
+    /**
+     * @brief Gets the number of registered items
+     */
+    std::uint32_t GetItemCount() const;
+
+private:
+    mutable std::mutex mMutex;
+    std::vector<std::uint32_t> mFreeSlots;  ///< Min-heap of the freed slots below mSlotCount
+    std::uint32_t mSlotCount = 0;           ///< One past the highest slot handed out
+};
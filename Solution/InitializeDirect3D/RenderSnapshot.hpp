@@ -0,0 +1,103 @@
+#pragma once
+#include "../../Common/MathHelper.h"
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+/**
+ * @brief Object constants of a render item or terrain chunk
+ */
+struct ObjectRecord
+{
+	std::uint32_t ObjCBIndex = 0;  ///< Slot in the frame's object constants, or terrain constants for TerrainChunks
+	XMFLOAT4X4 World = MathHelper::Identity4x4();
+	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+	XMFLOAT3 PosCenter = { 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 PosExtents = { 1.0f, 1.0f, 1.0f };
+	XMFLOAT2 TexCoordOffset = { 0.0f, 0.0f };
+	XMFLOAT2 TexCoordScale = { 1.0f, 1.0f };
+};
+
+/**
+ * @brief Constants of a material that changed
+ */
+struct MaterialRecord
+{
+	std::uint32_t MatCBIndex = 0;
+	XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+	XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+};
+
+/**
+ * @brief Object and material constants of one instance of a sprite batch
+ *
+ * Only the constants are used; the slot indices are ignored.
+ */
+struct SpriteRecord
+{
+	ObjectRecord Object;
+	MaterialRecord Material;
+};
+
+/**
+ * @brief One indexed draw, with everything it binds
+ *
+ * A sprite batch (SpriteCount > 0) draws that many instances of the submesh, whose
+ * constants are Sprites[FirstSprite] onwards, and ignores ObjCBIndex and MatCBIndex.
+ */
+struct DrawRecord
+{
+	std::uint32_t ObjCBIndex = 0;
+	std::uint32_t MatCBIndex = 0;
+	int DiffuseSrvHeapIndex = -1;
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+	bool Index32 = false;
+	bool Terrain = false;  ///< ObjCBIndex is a slot of the frame's terrain constants
+	std::uint32_t FirstSprite = 0;
+	std::uint32_t SpriteCount = 0;  ///< Instances of a sprite batch, 0 for a single object
+};
+
+/**
+ * @brief Everything needed to draw one frame, copied out of the scene
+ *
+ * The simulation fills a snapshot and hands it to the render thread, which reads
+ * nothing else the simulation writes between frames, so the scene can move on
+ * while the snapshot is recorded.  Objects and Materials only hold what changed:
+ * snapshots are drawn into the frame resources in turn, so a change stays in them
+ * for gNumFrameResources snapshots, as NumFramesDirty counts.
+ */
+struct RenderSnapshot
+{
+	std::vector<ObjectRecord> Objects;        ///< Written to the frame's object constants
+	std::vector<MaterialRecord> Materials;    ///< Written to the frame's material constants
+	std::vector<ObjectRecord> TerrainChunks;  ///< Written to the frame's terrain constants, every frame
+	std::vector<SpriteRecord> Sprites;        ///< Written to the frame's sprite instances, every frame
+	std::vector<DrawRecord> Draws;            ///< In scene graph order
+
+	XMFLOAT4X4 View = MathHelper::Identity4x4();
+	XMFLOAT4X4 Proj = MathHelper::Identity4x4();
+	XMFLOAT3 EyePosW = { 0.0f, 0.0f, 0.0f };
+	XMFLOAT2 RenderTargetSize = { 1.0f, 1.0f };
+	float TotalTime = 0.0f;
+	float DeltaTime = 0.0f;
+
+	std::uint32_t ObjectCapacity = 0;    ///< Object constants the frame resource must hold
+	std::uint32_t MaterialCapacity = 0;  ///< Material constants the frame resource must hold
+
+	/**
+	 * @brief Empties the lists, keeping their memory for the next frame
+	 */
+	void Clear()
+	{
+		Objects.clear();
+		Materials.clear();
+		TerrainChunks.clear();
+		Sprites.clear();
+		Draws.clear();
+	}
+};
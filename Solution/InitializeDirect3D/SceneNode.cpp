@@ -1,5 +1,7 @@
 #include "SceneNode.hpp"
-#include "Game.hpp"
+#include "Command.hpp"
+#include <algorithm>
+#include <cassert>
 
 /**
  * @brief Constructor for SceneNode.
@@ -9,6 +11,7 @@ SceneNode::SceneNode(State* state)
 	: mChildren()
 	, mParent(nullptr)
 	, mState(state)
+	, renderer(nullptr)
 {
 	mWorldPosition = XMFLOAT3(0, 0, 0);
 	mWorldScaling = XMFLOAT3(1, 1, 1);
@@ -110,8 +113,6 @@ void SceneNode::drawChildren() const
  */
 void SceneNode::build()
 {
-	OutputDebugStringA("Building...\n");
-
 	buildCurrent();
 	buildChildren();
 }
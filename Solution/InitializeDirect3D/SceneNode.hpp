@@ -1,55 +1,13 @@
 #pragma once
-#include "../../Common/d3dApp.h"
-#include "../../Common/MathHelper.h"
-#include "../../Common/UploadBuffer.h"
-#include "../../Common/GeometryGenerator.h"
-#include "../../Common/Camera.h"
-#include "FrameResource.h"
+#include "../../Common/GameTimer.h"
+#include "RenderItem.hpp"
+#include <memory>
+#include <vector>
 
 #pragma region Step 3
 #include "Category.hpp"
 #pragma endregion
 
-using Microsoft::WRL::ComPtr;
-using namespace DirectX;
-using namespace DirectX::PackedVector;
-
-#pragma comment(lib, "d3dcompiler.lib")
-#pragma comment(lib, "D3D12.lib")
-
-/**
- * @brief Lightweight structure to store parameters for drawing a shape.
- */
-struct RenderItem
-{
-	RenderItem() = default;
-
-	// World matrix of the shape that describes the object's local space
-	// relative to the world space, which defines the position, orientation,
-	// and scale of the object in the world.
-	XMFLOAT4X4 World = MathHelper::Identity4x4(); ///< World matrix of the shape
-
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4(); ///< Texture transform matrix
-
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources; ///< Number of frames the object data has been dirty
-
-	UINT ObjCBIndex = -1; ///< Index into GPU constant buffer
-
-	Material* Mat = nullptr; ///< Material of the object
-	MeshGeometry* Geo = nullptr; ///< Geometry of the object
-
-	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST; ///< Primitive topology
-
-	// DrawIndexedInstanced parameters.
-	UINT IndexCount = 0; ///< Number of indices
-	UINT StartIndexLocation = 0; ///< Starting index location
-	int BaseVertexLocation = 0; ///< Base vertex location
-};
-
 //class Game;
 class State;
 #pragma region Step 7
@@ -71,6 +29,11 @@ public:
 	*/
 	SceneNode(State* state);
 
+	/**
+	 * @brief Virtual so that derived nodes are destroyed whole through Ptr.
+	 */
+	virtual ~SceneNode() = default;
+
 	/**
 	 * @brief Attaches a child node to this node.
 	 * @param child Unique pointer to the child node.
@@ -194,7 +157,7 @@ private:
 
 protected:
 	State*					mState; ///< Pointer to the Game object
-	RenderItem*				renderer; ///< Pointer to the RenderItem for this node
+	RenderItem*				renderer; ///< Pointer to the RenderItem for this node, set by buildCurrent()
 private:
 	XMFLOAT3				mWorldPosition; ///< World position of this node
 	XMFLOAT3				mWorldRotation; ///< World rotation of this node
@@ -39,6 +39,15 @@ cbuffer cbPerObject : register(b0)
 {
     float4x4 gWorld;
     float4x4 gTexTransform;
+
+    // Decode PackedVertex: positions relative to the submesh bounds, texture
+    // coordinates relative to the submesh UV range.
+    float3 gPosCenter;
+    float cbPerObjectPad0;
+    float3 gPosExtents;
+    float cbPerObjectPad2;
+    float2 gTexCoordOffset;
+    float2 gTexCoordScale;
 };
 
 // Constant data that varies per frame.
@@ -76,14 +85,48 @@ cbuffer cbMaterial : register(b2)
     float4x4 gMatTransform;
 };
 
+// Object and material constants of each sprite of a batch (SpriteInstance), read by
+// SpriteVS in place of cbPerObject and cbMaterial.
+struct SpriteData
+{
+    float4x4 World;
+    float4x4 TexTransform;
+    float4x4 MatTransform;
+    float4 DiffuseAlbedo;
+    float3 FresnelR0;
+    float Roughness;
+    float3 PosCenter;
+    float SpritePad0;
+    float3 PosExtents;
+    float SpritePad1;
+    float2 TexCoordOffset;
+    float2 TexCoordScale;
+};
+
+StructuredBuffer<SpriteData> gSprites : register(t1);
+
+// First instance of the batch in gSprites; SV_InstanceID starts from 0 in every draw.
+cbuffer cbSpriteBatch : register(b3)
+{
+    uint gFirstSprite;
+};
+
 struct VertexIn
 {
-	float3 PosL    : POSITION;
-    float3 NormalL : NORMAL;
+	float4 PosL    : POSITION;  // SNORM16, w unused
+    float2 NormalL : NORMAL;    // SNORM16 octahedral
     //step2
-	float2 TexC    : TEXCOORD;
+	float2 TexC    : TEXCOORD;  // UNORM16
 };
 
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f)
+        n.xy = (1.0f - abs(n.yx)) * (n.xy >= 0.0f ? 1.0f : -1.0f);
+    return normalize(n);
+}
+
 struct VertexOut
 {
 	float4 PosH    : SV_POSITION;
@@ -97,12 +140,16 @@ VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
 	
+    float3 posL = gPosCenter + gPosExtents * vin.PosL.xyz;
+    float3 normalL = DecodeOctahedral(vin.NormalL);
+    float2 texL = gTexCoordOffset + gTexCoordScale * vin.TexC;
+
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(posL, 1.0f), gWorld);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(normalL, (float3x3)gWorld);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
@@ -114,18 +161,52 @@ VertexOut VS(VertexIn vin)
     //We use two separate texture transformation matrices gTexTransform and gMatTransform .
     //Because sometimes it makes more sense for the material to transform the textures (for animated materials like water), but sometimes it makes more sense for the texture transform to be a property of the object.
 
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
+    float4 texC = mul(float4(texL, 0.0f, 1.0f), gTexTransform);
     vout.TexC = mul(texC, gMatTransform).xy;
 
     return vout;
 }
 
-float4 PS(VertexOut pin) : SV_Target
+struct SpriteVertexOut
+{
+    float4 PosH    : SV_POSITION;
+    float3 PosW    : POSITION;
+    float3 NormalW : NORMAL;
+    float2 TexC    : TEXCOORD;
+    nointerpolation float4 DiffuseAlbedo : COLOR0;
+    nointerpolation float4 FresnelRoughness : COLOR1;  // FresnelR0, Roughness
+};
+
+// VS with the constants of instance gFirstSprite + instanceID of the batch.
+SpriteVertexOut SpriteVS(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+    SpriteData sprite = gSprites[gFirstSprite + instanceID];
+
+    SpriteVertexOut vout = (SpriteVertexOut)0.0f;
+
+    float3 posL = sprite.PosCenter + sprite.PosExtents * vin.PosL.xyz;
+    float3 normalL = DecodeOctahedral(vin.NormalL);
+    float2 texL = sprite.TexCoordOffset + sprite.TexCoordScale * vin.TexC;
+
+    float4 posW = mul(float4(posL, 1.0f), sprite.World);
+    vout.PosW = posW.xyz;
+    vout.NormalW = mul(normalL, (float3x3)sprite.World);
+    vout.PosH = mul(posW, gViewProj);
+
+    float4 texC = mul(float4(texL, 0.0f, 1.0f), sprite.TexTransform);
+    vout.TexC = mul(texC, sprite.MatTransform).xy;
+
+    vout.DiffuseAlbedo = sprite.DiffuseAlbedo;
+    vout.FresnelRoughness = float4(sprite.FresnelR0, sprite.Roughness);
+    return vout;
+}
+
+float4 Shade(VertexOut pin, float4 materialAlbedo, float3 fresnelR0, float roughness)
 {
     //step17: we add a diffuse albedo texture map to specify the diffuse albedo
     //component of our material
 
-    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamPointWrap, pin.TexC) * gDiffuseAlbedo;
+    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamPointWrap, pin.TexC) * materialAlbedo;
 
     clip(diffuseAlbedo.a - 0.1f);
 
@@ -141,8 +222,8 @@ float4 PS(VertexOut pin) : SV_Target
     // Light terms. Note that we are using diffuseAlbedo instead of gDiffuseAlbedo
     float4 ambient = gAmbientLight*diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - roughness;
+    Material mat = { diffuseAlbedo, fresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
         pin.NormalW, toEyeW, shadowFactor);
@@ -155,4 +236,19 @@ float4 PS(VertexOut pin) : SV_Target
     return litColor;
 }
 
+float4 PS(VertexOut pin) : SV_Target
+{
+    return Shade(pin, gDiffuseAlbedo, gFresnelR0, gRoughness);
+}
+
+float4 SpritePS(SpriteVertexOut pin) : SV_Target
+{
+    VertexOut vertex;
+    vertex.PosH = pin.PosH;
+    vertex.PosW = pin.PosW;
+    vertex.NormalW = pin.NormalW;
+    vertex.TexC = pin.TexC;
+    return Shade(vertex, pin.DiffuseAlbedo, pin.FresnelRoughness.xyz, pin.FresnelRoughness.w);
+}
+
 
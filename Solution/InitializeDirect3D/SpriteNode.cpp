@@ -5,49 +5,23 @@
  * @brief Constructor for SpriteNode.
  * @param game Pointer to the Game object.
  */
-SpriteNode::SpriteNode(State* state) : Entity(state), mIsVisible(true)
+SpriteNode::SpriteNode(State* state) : Entity(state), mSpriteNodeRitem(nullptr), mIsVisible(true)
 {
 }
 
 /**
- * @brief Draws the current sprite node.a
+ * @brief Draws the current sprite node.
  *
- * This method handles the rendering of the sprite node, including setting up
- * the necessary DirectX 12 commands and resources.
+ * This method adds the sprite's draw to the frame's render snapshot, where
+ * it joins the previous sprite's instanced draw if they share the submesh and
+ * texture; the render thread records it once the snapshot is handed over.
  */
 void SpriteNode::drawCurrent() const
 {
 	if (!mIsVisible) return;
 
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
-
-	Game* game = mState->GetContext()->game;
-
-	auto objectCB = game->mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = game->mCurrFrameResource->MaterialCB->Resource();
-
-	if (mSpriteNodeRitem != nullptr)
-	{
-		auto vertexBufferView = mSpriteNodeRitem->Geo->VertexBufferView();
-		auto indexBufferView = mSpriteNodeRitem->Geo->IndexBufferView();
-
-		game->getCmdList()->IASetVertexBuffers(0, 1, &vertexBufferView);
-		game->getCmdList()->IASetIndexBuffer(&indexBufferView);
-		game->getCmdList()->IASetPrimitiveTopology(mSpriteNodeRitem->PrimitiveType);
-
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(game->mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(mSpriteNodeRitem->Mat->DiffuseSrvHeapIndex, game->mCbvSrvDescriptorSize);
-
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + mSpriteNodeRitem->ObjCBIndex * objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + mSpriteNodeRitem->Mat->MatCBIndex * matCBByteSize;
-
-		game->getCmdList()->SetGraphicsRootDescriptorTable(0, tex);
-		game->getCmdList()->SetGraphicsRootConstantBufferView(1, objCBAddress);
-		game->getCmdList()->SetGraphicsRootConstantBufferView(3, matCBAddress);
-
-		game->getCmdList()->DrawIndexedInstanced(mSpriteNodeRitem->IndexCount, 1, mSpriteNodeRitem->StartIndexLocation, mSpriteNodeRitem->BaseVertexLocation, 0);
-	}
+	if (mSpriteNodeRitem != nullptr && mSpriteNodeRitem->Visible)
+		mState->GetContext()->game->CaptureSpriteDraw(*mSpriteNodeRitem);
 }
 
 /**
@@ -64,15 +38,12 @@ void SpriteNode::buildCurrent()
 	renderer = render.get();
 	renderer->World = getTransform();
 	XMStoreFloat4x4(&renderer->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	renderer->ObjCBIndex = (UINT)mState->getRenderItems().size();
-	renderer->Mat = game->getMaterials()[mMat].get();
-	renderer->Geo = game->getGeometries()[mGeo].get(); 
-	renderer->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	renderer->IndexCount = renderer->Geo->DrawArgs[mDrawName].IndexCount;
-	renderer->StartIndexLocation = renderer->Geo->DrawArgs[mDrawName].StartIndexLocation;
-	renderer->BaseVertexLocation = renderer->Geo->DrawArgs[mDrawName].BaseVertexLocation;
+	renderer->Mat = game->AcquireMaterial(mMat);
+	renderer->Geo = game->getGeometries().at(mGeo).get();
+	renderer->SetSubmesh(renderer->Geo->DrawArgs.at(mDrawName));
+	renderer->Occluder = mIsOccluder;
 	mSpriteNodeRitem = render.get();
-	mState->getRenderItems().push_back(std::move(render));
+	mState->addRenderItem(std::move(render));
 }
 
 void SpriteNode::SetDrawName(std::string Mat, std::string Geo, std::string DrawName)
@@ -91,3 +62,10 @@ void SpriteNode::SetVisible(bool visible)
 {
 	mIsVisible = visible;  // Set the visibility flag
 }
+
+void SpriteNode::SetOccluder(bool occluder)
+{
+	mIsOccluder = occluder;
+	if (mSpriteNodeRitem != nullptr)
+		mSpriteNodeRitem->Occluder = occluder;
+}
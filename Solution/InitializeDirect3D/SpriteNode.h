@@ -22,6 +22,11 @@ public:
 	void SetDrawName(std::string Mat, std::string Geo, std::string DrawName);
 	std::string GetDrawName();
 	void SetVisible(bool visible);
+
+	/**
+	 * @brief Lets the sprite hide what lies behind it, see RenderItem::Occluder
+	 */
+	void SetOccluder(bool occluder);
 private:
 	/**
 	 * @brief Draws the current sprite node.
@@ -36,4 +41,5 @@ private:
 	std::string mGeo;
 	std::string mDrawName;
 	bool mIsVisible;
+	bool mIsOccluder = false;
 };
@@ -1,17 +1,35 @@
 #include "State.hpp"
-#include "Game.hpp"
+#include "StateStack.hpp"
+#include <cfloat>
 #include <iostream>
 
+namespace
+{
+    Aabb ToAabb(const DirectX::BoundingBox& box)
+    {
+        Aabb result;
+        result.Min[0] = box.Center.x - box.Extents.x;
+        result.Min[1] = box.Center.y - box.Extents.y;
+        result.Min[2] = box.Center.z - box.Extents.z;
+        result.Max[0] = box.Center.x + box.Extents.x;
+        result.Max[1] = box.Center.y + box.Extents.y;
+        result.Max[2] = box.Center.z + box.Extents.z;
+        return result;
+    }
+}
+
 /**
  * @brief Constructs a Context object with game and player references
  * @param _game Pointer to main Game instance
  * @param _player Pointer to player entity
+ * @param _releaseRenderItem Called for each render item of a state being destroyed
  *
  * @note The Context object becomes invalid if Game/Player pointers are destroyed
  */
-State::Context::Context(Game* _game, Player* _player)
+State::Context::Context(Game* _game, Player* _player, std::function<void(RenderItem&)> _releaseRenderItem)
     : game(_game)
     , player(_player)
+    , releaseRenderItem(std::move(_releaseRenderItem))
 {
 }
 
@@ -35,10 +53,22 @@ State::State(StateStack* stack, Context* context)
 /**
  * @brief Destructor for state cleanup
  *
+ * Hands every render item to Context::releaseRenderItem, which lets the game
+ * return the material references taken while the scene graph was built, and
+ * frees the items' object constant slots.
+ *
  * @note Automatically cleans up scene graph and render items
  */
 State::~State()
 {
+    if (mContext->releaseRenderItem)
+    {
+        for (auto& ritem : mAllRitems)
+            mContext->releaseRenderItem(*ritem);
+    }
+
+    for (auto& ritem : mAllRitems)
+        mStack->GetRenderItemRegistry().Unregister(*ritem);
 }
 
 /**
@@ -52,6 +82,18 @@ void State::RequestStackPush(States::ID stateID)
     mStack->pushState(stateID);
 }
 
+/**
+ * @brief Requests an asynchronous state push
+ * @param stateID Identifier of state to build
+ * @param loadingID Identifier of state shown until it is built
+ *
+ * @note See StateStack::pushStateAsync() for what the built state's constructor may do
+ */
+void State::RequestStackPushAsync(States::ID stateID, States::ID loadingID)
+{
+    mStack->pushStateAsync(stateID, loadingID);
+}
+
 /**
  * @brief Requests a state pop operation
  *
@@ -83,4 +125,182 @@ void State::RequestStateClear()
 State::Context* State::GetContext() const
 {
     return mContext;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Takes ownership of a render item
+ * @param item Item built by a scene node
+ * @return The item
+ *
+ * Called by the scene nodes' buildCurrent(), possibly on the thread building
+ * the state; the registry is shared by every state.
+ */
+RenderItem* State::addRenderItem(std::unique_ptr<RenderItem> item)
+{
+    mStack->GetRenderItemRegistry().Register(*item);
+    mAllRitems.push_back(std::move(item));
+    return mAllRitems.back().get();
+}
+
+/**
+ * @brief Flags every render item for upload
+ *
+ * Used when the frame resources may not hold the items' constants, such as
+ * after they were rebuilt or while the state was cached.
+ */
+void State::MarkRenderItemsDirty()
+{
+    for (auto& ritem : mAllRitems)
+        ritem->NumFramesDirty = gNumFrameResources;
+}
+
+/**
+ * @brief Approximate heap memory kept alive by the state
+ * @return Bytes
+ *
+ * Counts each render item with the scene node that owns it, the bounds tree
+ * at about two nodes per leaf and the culling buffers.  States owning more
+ * than their scene graph should add their own share.
+ */
+std::size_t State::GetMemoryEstimate() const
+{
+    std::size_t bytes = mAllRitems.capacity() * sizeof(std::unique_ptr<RenderItem>);
+    bytes += mAllRitems.size() * (sizeof(RenderItem) + sizeof(SceneNode));
+    bytes += (std::size_t)mBoundsTree.GetLeafCount() * 2 * sizeof(Aabb);
+    bytes += mCullBoxes.Size() * 6 * sizeof(float);
+    bytes += mCullItems.capacity() * sizeof(RenderItem*) + mCullResults.capacity();
+    return bytes;
+}
+
+/**
+ * @brief Refreshes the world bounds of the render items that moved
+ *
+ * Leaves are inserted the first time an item is seen; moved items only update
+ * their leaf, and the tree is refitted (or rebuilt, if refitting has degraded
+ * it) once for all of them.
+ */
+void State::UpdateBounds()
+{
+    for (size_t i = 0; i < mAllRitems.size(); ++i)
+    {
+        RenderItem* item = mAllRitems[i].get();
+        if (!item->BoundsDirty || item->IndexCount == 0)
+            continue;
+        item->BoundsDirty = false;
+
+        XMMATRIX world = XMLoadFloat4x4(&item->World);
+        item->LocalBounds.Transform(item->WorldBounds, world);
+        item->LocalSphere.Transform(item->WorldSphere, world);
+
+        Aabb bounds = ToAabb(item->WorldBounds);
+        if (item->BoundsLeaf == (std::uint32_t)-1)
+            item->BoundsLeaf = mBoundsTree.Insert(bounds, (std::uint32_t)i);
+        else
+            mBoundsTree.Update(item->BoundsLeaf, bounds);
+    }
+
+    mBoundsTree.Refit();
+}
+
+/**
+ * @brief Tests the world boxes of the tracked render items against a frustum
+ * @param frustum Camera frustum
+ * @return Items kept and culled
+ *
+ * The boxes are gathered into one batch so the culler can test several of them
+ * per instruction.  Boxes inside the frustum are then tested for occlusion by the
+ * occluder items that are also inside it.
+ */
+CullingStats State::CullRenderItems(const FrustumPlanes& frustum, OcclusionCuller* occlusion)
+{
+    mCullItems.clear();
+    for (auto& ritem : mAllRitems)
+    {
+        if (ritem->BoundsLeaf == (std::uint32_t)-1)
+            ritem->Visible = true;
+        else
+            mCullItems.push_back(ritem.get());
+    }
+
+    mCullBoxes.Resize(mCullItems.size());
+    mCullResults.resize(mCullItems.size());
+    for (size_t i = 0; i < mCullItems.size(); ++i)
+        mCullBoxes.Set(i, &mCullItems[i]->WorldBounds.Center.x, &mCullItems[i]->WorldBounds.Extents.x);
+
+    CullingStats stats;
+    stats.Visible = FrustumCuller::CullBoxes(frustum, mCullBoxes, mCullResults.data());
+    stats.Culled = mCullItems.size() - stats.Visible;
+
+    if (occlusion != nullptr)
+    {
+        size_t occluderCount = 0;
+        for (size_t i = 0; i < mCullItems.size(); ++i)
+        {
+            const RenderItem* item = mCullItems[i];
+            if (mCullResults[i] && item->Occluder)
+            {
+                occlusion->AddOccluderBox(&item->LocalBounds.Center.x, &item->LocalBounds.Extents.x, &item->World.m[0][0]);
+                ++occluderCount;
+            }
+        }
+
+        // Occluders test against their own depth and stay visible.
+        if (occluderCount > 0)
+        {
+            occlusion->Rasterize();
+            size_t unoccluded = occlusion->TestBoxes(mCullBoxes, mCullResults.data());
+            stats.Occluded = stats.Visible - unoccluded;
+            stats.Visible = unoccluded;
+        }
+    }
+
+    for (size_t i = 0; i < mCullItems.size(); ++i)
+        mCullItems[i]->Visible = mCullResults[i] != 0;
+
+    return stats;
+}
+
+/**
+ * @brief Collects the render items whose world box intersects a box
+ * @param box World space box
+ * @param items Receives the items
+ */
+void State::QueryBounds(const DirectX::BoundingBox& box, std::vector<RenderItem*>& items) const
+{
+    items.clear();
+    mBoundsTree.QueryAabb(ToAabb(box), [&](std::uint32_t leaf)
+    {
+        items.push_back(mAllRitems[mBoundsTree.GetUserData(leaf)].get());
+        return true;
+    });
+}
+
+/**
+ * @brief Finds the nearest render item hit by a ray
+ * @param origin Ray origin
+ * @param direction Unit ray direction
+ * @param distance Distance to the nearest hit
+ * @return Item hit first, or nullptr
+ */
+RenderItem* State::Pick(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float& distance) const
+{
+    XMFLOAT3 rayOrigin, rayDirection;
+    XMStoreFloat3(&rayOrigin, origin);
+    XMStoreFloat3(&rayDirection, direction);
+
+    RenderItem* nearest = nullptr;
+    distance = FLT_MAX;
+
+    // Each hit clips the ray, so farther subtrees are skipped.
+    mBoundsTree.RayCast(&rayOrigin.x, &rayDirection.x, FLT_MAX, [&](std::uint32_t leaf, float entry)
+    {
+        if (entry < distance)
+        {
+            distance = entry;
+            nearest = mAllRitems[mBoundsTree.GetUserData(leaf)].get();
+        }
+        return distance;
+    });
+
+    return nearest;
+}
@@ -1,7 +1,11 @@
 #pragma once
-#include "../../Common/d3dApp.h"
-#include "FrameResource.h"
+#include "../../Common/GameTimer.h"
 #include "SceneNode.hpp"
+#include "../../Common/BoundingVolumeHierarchy.h"
+#include "../../Common/FrustumCuller.h"
+#include "../../Common/OcclusionCuller.h"
+#include <cstdint>
+#include <functional>
 #include <memory>
 
 namespace sf
@@ -24,7 +28,8 @@ namespace States
         Menu,           ///< Main menu state
         Game,           ///< Core gameplay state
         Instructions,   ///< Tutorial/instructions state
-        Pause           ///< Paused game state
+        Pause,          ///< Paused game state
+        Loading         ///< Shown while another state is built
     };
 }
 
@@ -58,11 +63,13 @@ public:
          * @brief Constructs a context with game and player references
          * @param _game Pointer to main Game instance
          * @param _player Pointer to player entity
+         * @param _releaseRenderItem Called for each render item of a state being destroyed
          */
-        Context(Game* _game, Player* _player);
+        Context(Game* _game, Player* _player, std::function<void(RenderItem&)> _releaseRenderItem = nullptr);
 
         Game* game;    ///< Main game instance containing shared resources
         Player* player;///< Player entity reference
+        std::function<void(RenderItem&)> releaseRenderItem; ///< Returns what an item took from the renderer, may be empty
     };
 
 public:
@@ -93,10 +100,10 @@ public:
 
     /**
      * @brief Pure virtual method for event handling
-     * @param btnState Bitmask of button states
+     * @param btnState Bitmask of button states (the WPARAM of the Win32 message)
      * @return True if event was consumed, false to propagate
      */
-    virtual bool HandleEvent(WPARAM btnState) = 0;
+    virtual bool HandleEvent(std::uintptr_t btnState) = 0;
 
     /**
      * @brief Pure virtual method for real-time input handling
@@ -114,6 +121,34 @@ public:
      */
     virtual bool IsTransparent() const { return false; }
 
+    //-------------------------------------------------------------------------
+    // Caching
+    //-------------------------------------------------------------------------
+
+    /**
+     * @brief Called when the state is popped into the StateStack cache
+     *
+     * The scene graph and render items are kept as they are.
+     */
+    virtual void OnSuspend() {}
+
+    /**
+     * @brief Called when the state is pushed again from the StateStack cache
+     */
+    virtual void OnResume() {}
+
+    /**
+     * @brief Approximate heap memory kept alive by the state while it is cached
+     * @return Bytes, counted against the StateStack cache limit
+     */
+    virtual std::size_t GetMemoryEstimate() const;
+
+    /**
+     * @brief Gets the identifier the state was created for
+     * @return The States::ID passed to StateStack::pushState()
+     */
+    States::ID GetStateID() const { return mStateID; }
+
     //-------------------------------------------------------------------------
     // Render Item Access
     //-------------------------------------------------------------------------
@@ -124,6 +159,65 @@ public:
      */
     std::vector<std::unique_ptr<RenderItem>>& getRenderItems() { return mAllRitems; }
 
+    /**
+     * @brief Takes ownership of a render item and gives it an object constant slot
+     * @param item Item built by a scene node
+     * @return The item, now owned by the state
+     *
+     * The slot comes from the StateStack's RenderItemRegistry and is the
+     * item's until the state is destroyed.
+     */
+    RenderItem* addRenderItem(std::unique_ptr<RenderItem> item);
+
+    /**
+     * @brief Flags every render item for upload to each frame resource
+     */
+    void MarkRenderItemsDirty();
+
+    //-------------------------------------------------------------------------
+    // Spatial Queries
+    //-------------------------------------------------------------------------
+
+    /**
+     * @brief Recomputes the world bounds of moved render items and refits the bounds tree
+     *
+     * Items without geometry of their own (IndexCount of 0) are not tracked.
+     */
+    void UpdateBounds();
+
+    /**
+     * @brief Finds the render items whose world bounding box intersects a box
+     * @param box World space box
+     * @param[out] items Receives the items, in no particular order
+     */
+    void QueryBounds(const DirectX::BoundingBox& box, std::vector<RenderItem*>& items) const;
+
+    /**
+     * @brief Finds the nearest render item whose world bounding box a ray hits
+     * @param origin Ray origin in world space
+     * @param direction Unit ray direction
+     * @param[out] distance Distance to the hit along the ray
+     * @return The item hit first, or nullptr
+     */
+    RenderItem* Pick(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float& distance) const;
+
+    /**
+     * @brief Sets the Visible flag of every render item from its world bounds
+     * @param frustum Camera frustum in world space
+     * @param occlusion Culler already started with BeginFrame(), or nullptr to skip occlusion
+     * @return Number of tracked items kept, culled and occluded
+     *
+     * Call after UpdateBounds().  Items that are not tracked stay visible.  The
+     * occluders inside the frustum are rasterized into the occlusion culler, which
+     * can then test other boxes for the rest of the frame.
+     */
+    CullingStats CullRenderItems(const FrustumPlanes& frustum, OcclusionCuller* occlusion = nullptr);
+
+    /**
+     * @brief Tree over the world bounds of the render items, leaf data is the item index
+     */
+    const BoundingVolumeHierarchy& GetBoundsTree() const { return mBoundsTree; }
+
     /**
      * @brief Gets shared context object
      * @return Pointer to context instance
@@ -141,6 +235,13 @@ protected:
      */
     void RequestStackPush(States::ID stateID);
 
+    /**
+     * @brief Requests a state to be built on a worker thread and then pushed
+     * @param stateID ID of state to build
+     * @param loadingID ID of state shown meanwhile, or States::None
+     */
+    void RequestStackPushAsync(States::ID stateID, States::ID loadingID);
+
     /**
      * @brief Requests current state to be popped from stack
      */
@@ -151,6 +252,11 @@ protected:
      */
     void RequestStateClear();
 
+private:
+    friend class StateStack;
+
+    States::ID mStateID = States::None; ///< Set by StateStack::createState()
+
 protected:
     //-------------------------------------------------------------------------
     // Protected Members
@@ -161,5 +267,9 @@ protected:
 
     std::unique_ptr<SceneNode> mSceneGraph; ///< Root scene node for state
     std::vector<std::unique_ptr<RenderItem>> mAllRitems; ///< Renderable items
+    BoundingVolumeHierarchy mBoundsTree; ///< World bounds of mAllRitems
+    BoundsBatch mCullBoxes; ///< World boxes of the tracked items, refilled by CullRenderItems()
+    std::vector<RenderItem*> mCullItems; ///< Item of each box in mCullBoxes
+    std::vector<std::uint8_t> mCullResults; ///< Visibility of each box in mCullBoxes
 };
 
@@ -1,6 +1,7 @@
 #include "StateStack.hpp"
+#include "../../Common/Profiler.h"
+#include <algorithm>
 #include <cassert>
-#include "Game.hpp"
 
 #pragma region step 6 - A3
 /**
@@ -17,6 +18,22 @@ StateStack::StateStack(State::Context context)
 {
 }
 
+/**
+ * @brief Waits for an asynchronous build still running
+ *
+ * The states are destroyed here, while the context and the render item
+ * registry they release their items to are still alive.
+ */
+StateStack::~StateStack()
+{
+    if (mBuild != nullptr)
+        mBuild->thread.join();
+
+    mBuild.reset();
+    mStack.clear();
+    mCache.clear();
+}
+
 /**
  * @brief Updates all active states from top to bottom
  * @param timer Game timer with frame timing information
@@ -26,6 +43,12 @@ StateStack::StateStack(State::Context context)
  */
 void StateStack::Update(const GameTimer& timer)
 {
+    PROFILE_SCOPE("StateStack::Update");
+
+    // A state built on a worker thread replaces the loading state between two updates.
+    if (mBuild != nullptr && mBuild->done)
+        finishAsyncBuild(false);
+
     //Iterate from Top to Bottom, stop as soon as Update returns false
     for (auto itr = mStack.rbegin(); itr != mStack.rend(); ++itr)
     {
@@ -37,16 +60,17 @@ void StateStack::Update(const GameTimer& timer)
 }
 
 /**
- * @brief Draws all active states from bottom to top
+ * @brief Draws the visible states from bottom to top
  *
- * Renders states in reverse order of updates to ensure proper layering
+ * Renders states in reverse order of updates to ensure proper layering.
+ * States under one that is not transparent are hidden and skipped.
  */
 void StateStack::Draw()
 {
-    //Draw all active states from Bottom to Top
-    for (State::StatePtr& state : mStack)
+    //Draw the visible states from Bottom to Top
+    for (std::size_t i = firstVisibleState(); i < mStack.size(); ++i)
     {
-        state->Draw();
+        mStack[i]->Draw();
     }
 }
 
@@ -56,7 +80,7 @@ void StateStack::Draw()
  *
  * Propagates events from top state downward until handled
  */
-void StateStack::HandleEvent(WPARAM btnState)
+void StateStack::HandleEvent(std::uintptr_t btnState)
 {
     //Iterate from Top to Bottom, stops as soon as HandleEvent() returns false
     for (auto itr = mStack.rbegin(); itr != mStack.rend(); ++itr)
@@ -92,6 +116,18 @@ void StateStack::pushState(States::ID stateID)
     mPendingList.push_back(PendingChange(Push, stateID));
 }
 
+/**
+ * @brief Requests a push whose state is built on a worker thread
+ * @param stateID Identifier of state to build
+ * @param loadingID State shown until the build completes, or States::None
+ *
+ * @note The build starts during next applyPendingChanges()
+ */
+void StateStack::pushStateAsync(States::ID stateID, States::ID loadingID)
+{
+    mPendingList.push_back(PendingChange(PushAsync, stateID, loadingID));
+}
+
 /**
  * @brief Requests a state pop operation
  *
@@ -143,6 +179,43 @@ State* StateStack::GetPreviousState()
     return nullptr;  // Explicit null return for safety
 }
 
+/**
+ * @brief Gets the states drawn by Draw(), bottom to top
+ * @param[out] states Cleared, then filled with the visible states
+ */
+void StateStack::GetVisibleStates(std::vector<State*>& states) const
+{
+    states.clear();
+    for (std::size_t i = firstVisibleState(); i < mStack.size(); ++i)
+        states.push_back(mStack[i].get());
+}
+
+/**
+ * @brief Flags the render items of every state on the stack for upload
+ *
+ * Hidden states are included: their constants must be in the frame
+ * resources by the time the states above them are popped.
+ */
+void StateStack::MarkRenderItemsDirty()
+{
+    for (State::StatePtr& state : mStack)
+        state->MarkRenderItemsDirty();
+}
+
+/**
+ * @brief Finds the lowest state Draw() draws
+ * @return Index of the topmost state that is not transparent, 0 if none
+ */
+std::size_t StateStack::firstVisibleState() const
+{
+    for (std::size_t i = mStack.size(); i > 0; --i)
+    {
+        if (!mStack[i - 1]->IsTransparent())
+            return i - 1;
+    }
+    return 0;
+}
+
 /**
  * @brief Creates state instance using registered factory
  * @param stateID Identifier of state to create
@@ -155,7 +228,10 @@ State::StatePtr StateStack::createState(States::ID stateID)
     auto found = mFactories.find(stateID);
     assert(found != mFactories.end());
 
-    return found->second();
+    PROFILE_SCOPE("StateStack::createState");
+    State::StatePtr state = found->second();
+    state->mStateID = stateID;
+    return state;
 }
 
 /**
@@ -175,13 +251,49 @@ void StateStack::applyPendingChanges()
         switch (change.action)
         {
         case Push:
-            mStack.push_back(createState(change.stateID));
+        {
+            State::StatePtr state = resumeState(change.stateID);
+            if (state == nullptr)
+            {
+                state = createState(change.stateID);
+                ++mBuildCount;
+            }
+            mStack.push_back(std::move(state));
             break;
+        }
+        case PushAsync:
+        {
+            State::StatePtr state = resumeState(change.stateID);
+            if (state != nullptr)
+                mStack.push_back(std::move(state));
+            else
+                startAsyncBuild(change.stateID, change.loadingID);
+            break;
+        }
         case Pop:
+        {
+            State::StatePtr state = std::move(mStack.back());
             mStack.pop_back();
+            if (mBuild != nullptr && mBuild->loadingState == state.get())
+            {
+                mBuild->loadingState = nullptr;
+                mBuild->abandoned = true;
+            }
+            suspendState(std::move(state));
             break;
+        }
         case Clear:
-            mStack.clear();
+            if (mBuild != nullptr)
+            {
+                mBuild->loadingState = nullptr;
+                mBuild->abandoned = true;
+            }
+            while (!mStack.empty())
+            {
+                State::StatePtr state = std::move(mStack.back());
+                mStack.pop_back();
+                suspendState(std::move(state));
+            }
             break;
         }
     }
@@ -189,14 +301,222 @@ void StateStack::applyPendingChanges()
     mPendingList.clear();
 }
 
+/**
+ * @brief Blocks until the state being built, if any, is pushed
+ */
+void StateStack::WaitForAsyncBuild()
+{
+    if (mBuild != nullptr)
+        finishAsyncBuild(true);
+}
+
+/**
+ * @brief Pushes the loading state and builds the requested one on a worker thread
+ * @param stateID Identifier of state to build
+ * @param loadingID Identifier of the loading state, or States::None
+ *
+ * One state is built at a time: a build still running is completed first.
+ */
+void StateStack::startAsyncBuild(States::ID stateID, States::ID loadingID)
+{
+    if (mBuild != nullptr)
+        finishAsyncBuild(true);
+
+    mBuild = std::make_unique<AsyncBuild>();
+    mBuild->stateID = stateID;
+    if (loadingID != States::None)
+    {
+        State::StatePtr loading = resumeState(loadingID);
+        if (loading == nullptr)
+        {
+            loading = createState(loadingID);
+            ++mBuildCount;
+        }
+        mBuild->loadingState = loading.get();
+        mStack.push_back(std::move(loading));
+    }
+
+    AsyncBuild* build = mBuild.get();
+    build->thread = std::thread([this, build]()
+    {
+        Profiler::SetThreadName("State Build");
+        try
+        {
+            build->state = createState(build->stateID);
+        }
+        catch (...)
+        {
+            build->error = std::current_exception();
+        }
+        build->done = true;
+    });
+}
+
+/**
+ * @brief Swaps the built state in for the loading state
+ * @param wait True to block until the worker is done
+ *
+ * The built state takes the place of the loading state in the stack, or
+ * goes on top if there is none.  If the loading state was popped or the
+ * stack cleared meanwhile, the player has moved on; the built state then
+ * goes to the cache or is destroyed.  An exception thrown by its
+ * constructor is rethrown here.
+ */
+void StateStack::finishAsyncBuild(bool wait)
+{
+    if (!wait && !mBuild->done)
+        return;
+
+    PROFILE_SCOPE("StateStack::finishAsyncBuild");
+    mBuild->thread.join();
+    std::unique_ptr<AsyncBuild> build = std::move(mBuild);
+    if (build->error != nullptr)
+        std::rethrow_exception(build->error);
+    ++mBuildCount;
+
+    if (build->abandoned)
+    {
+        suspendState(std::move(build->state));
+        return;
+    }
+
+    auto loading = std::find_if(mStack.begin(), mStack.end(),
+        [&build](const State::StatePtr& state) { return state.get() == build->loadingState; });
+    if (build->loadingState != nullptr && loading != mStack.end())
+    {
+        State::StatePtr shown = std::move(*loading);
+        *loading = std::move(build->state);
+        suspendState(std::move(shown));
+    }
+    else
+    {
+        mStack.push_back(std::move(build->state));
+    }
+}
+
+/**
+ * @brief Enables or disables caching of popped states of one type
+ * @param stateID State identifier from States::ID
+ * @param enabled True to keep popped states of the type
+ */
+void StateStack::SetStateCaching(States::ID stateID, bool enabled)
+{
+    if (enabled)
+    {
+        mCachedIDs.insert(stateID);
+        return;
+    }
+
+    mCachedIDs.erase(stateID);
+    for (auto itr = mCache.begin(); itr != mCache.end(); )
+    {
+        if (itr->state->GetStateID() == stateID)
+        {
+            mCachedBytes -= itr->bytes;
+            itr = mCache.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
+/**
+ * @brief Sets the cache limits and evicts states over them
+ * @param maxStates Most states kept
+ * @param maxBytes Most bytes kept
+ */
+void StateStack::SetStateCacheLimits(std::size_t maxStates, std::size_t maxBytes)
+{
+    mCacheMaxStates = maxStates;
+    mCacheMaxBytes = maxBytes;
+    evictStates();
+}
+
+/**
+ * @brief Destroys every cached state
+ */
+void StateStack::ClearStateCache()
+{
+    mCache.clear();
+    mCachedBytes = 0;
+}
+
+/**
+ * @brief Takes the most recently cached state of a type out of the cache
+ * @param stateID Identifier of the state to push
+ * @return The resumed state, or nullptr
+ *
+ * The states pushed since it was cached wrote their own constants to the same
+ * object constant slots, so every render item is marked dirty again.
+ */
+State::StatePtr StateStack::resumeState(States::ID stateID)
+{
+    auto found = mCache.end();
+    for (auto itr = mCache.begin(); itr != mCache.end(); ++itr)
+    {
+        if (itr->state->GetStateID() == stateID && (found == mCache.end() || itr->cachedAt > found->cachedAt))
+            found = itr;
+    }
+    if (found == mCache.end())
+        return nullptr;
+
+    State::StatePtr state = std::move(found->state);
+    mCachedBytes -= found->bytes;
+    mCache.erase(found);
+
+    state->MarkRenderItemsDirty();
+    state->OnResume();
+    ++mResumeCount;
+    return state;
+}
+
+/**
+ * @brief Caches a state leaving the stack if its type is cached
+ * @param state State just removed from the stack
+ *
+ * A state larger than the whole cache is destroyed right away.
+ */
+void StateStack::suspendState(State::StatePtr state)
+{
+    if (mCachedIDs.count(state->GetStateID()) == 0)
+        return;
+
+    std::size_t bytes = state->GetMemoryEstimate();
+    if (mCacheMaxStates == 0 || bytes > mCacheMaxBytes)
+        return;
+
+    state->OnSuspend();
+    mCache.push_back({ std::move(state), bytes, ++mCacheClock });
+    mCachedBytes += bytes;
+    evictStates();
+}
+
+/**
+ * @brief Destroys the least recently cached states until the cache fits
+ */
+void StateStack::evictStates()
+{
+    while (!mCache.empty() && (mCache.size() > mCacheMaxStates || mCachedBytes > mCacheMaxBytes))
+    {
+        auto oldest = std::min_element(mCache.begin(), mCache.end(),
+            [](const CachedState& a, const CachedState& b) { return a.cachedAt < b.cachedAt; });
+        mCachedBytes -= oldest->bytes;
+        mCache.erase(oldest);
+    }
+}
+
 /**
  * @brief Constructs a pending stack operation
  * @param action Operation type (Push/Pop/Clear)
  * @param stateID Relevant state ID (for Push operations)
+ * @param loadingID State shown while stateID is built (for PushAsync operations)
  */
-StateStack::PendingChange::PendingChange(Action action, States::ID stateID)
+StateStack::PendingChange::PendingChange(Action action, States::ID stateID, States::ID loadingID)
     : action(action)
     , stateID(stateID)
+    , loadingID(loadingID)
 {
 }
 
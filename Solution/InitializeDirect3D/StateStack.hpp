@@ -1,9 +1,15 @@
 #pragma once
 #include "State.hpp"
+#include "RenderItemRegistry.hpp"
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <vector>
 #include <utility>
 #include <functional>
 #include <map>
+#include <set>
+#include <thread>
 
 class Game;
 
@@ -15,6 +21,9 @@ class Game;
  * - Update/draw propagation
  * - Input event routing
  * - State factory registration
+ * - Optional caching of popped states, so pushing them again skips the build
+ * - Asynchronous pushes, building the state on a worker thread
+ * - Object constant slots shared by the render items of every live state
  */
 class StateStack
 {
@@ -24,9 +33,10 @@ public:
      */
     enum Action
     {
-        Push,  ///< Add new state to stack
-        Pop,   ///< Remove top state from stack
-        Clear  ///< Clear all states from stack
+        Push,       ///< Add new state to stack
+        Pop,        ///< Remove top state from stack
+        Clear,      ///< Clear all states from stack
+        PushAsync   ///< Build a state on a worker thread, showing another one meanwhile
     };
 
 public:
@@ -36,6 +46,11 @@ public:
      */
     explicit StateStack(State::Context context);
 
+    /**
+     * @brief Waits for an asynchronous build still running
+     */
+    ~StateStack();
+
     /**
      * @brief Registers a state type with the stack factory
      * @tparam T Concrete state type to register
@@ -55,7 +70,7 @@ public:
     void Update(const GameTimer& timer);
 
     /**
-     * @brief Draws all active states from bottom to top
+     * @brief Draws the visible states from bottom to top
      */
     void Draw();
 
@@ -63,7 +78,7 @@ public:
      * @brief Routes input events through the state stack
      * @param btnState Bitmask of button states
      */
-    void HandleEvent(WPARAM btnState);
+    void HandleEvent(std::uintptr_t btnState);
 
     /**
      * @brief Handles real-time input processing
@@ -80,6 +95,18 @@ public:
      */
     void pushState(States::ID stateID);
 
+    /**
+     * @brief Requests a push whose state is built on a worker thread
+     * @param stateID Identifier of state to build
+     * @param loadingID State pushed meanwhile and replaced by the built one, or States::None
+     *
+     * The built state is pushed by the first Update() after its constructor
+     * returns.  Its constructor must only touch the shared context through
+     * functions that are safe to call off the simulation thread.  A cached
+     * state of the type is resumed at once instead.
+     */
+    void pushStateAsync(States::ID stateID, States::ID loadingID);
+
     /**
      * @brief Requests a state pop operation
      */
@@ -112,6 +139,74 @@ public:
      */
     State* GetPreviousState();
 
+    /**
+     * @brief Gets the states drawn by Draw(), bottom to top
+     * @param[out] states Receives the topmost state that is not transparent and
+     *                    every state above it
+     */
+    void GetVisibleStates(std::vector<State*>& states) const;
+
+    //-------------------------------------------------------------------------
+    // Render Items
+    //-------------------------------------------------------------------------
+
+    /**
+     * @brief Gets the registry handing out the object constant slots of every state
+     */
+    RenderItemRegistry& GetRenderItemRegistry() { return mRenderItems; }
+
+    /**
+     * @brief Flags the render items of every state on the stack for upload
+     *
+     * For frame resources rebuilt without their contents.  Cached states are
+     * flagged when resumed, and a state being built starts out flagged.
+     */
+    void MarkRenderItemsDirty();
+
+    //-------------------------------------------------------------------------
+    // State Cache
+    //-------------------------------------------------------------------------
+
+    /**
+     * @brief Keeps popped or cleared states of a type to resume them on the next push
+     * @param stateID State identifier from States::ID
+     * @param enabled False destroys popped states of that type again, and any cached one
+     */
+    void SetStateCaching(States::ID stateID, bool enabled);
+
+    /**
+     * @brief Bounds the cache, evicting the least recently cached states first
+     * @param maxStates Most states kept
+     * @param maxBytes Most bytes kept, as reported by State::GetMemoryEstimate()
+     */
+    void SetStateCacheLimits(std::size_t maxStates, std::size_t maxBytes);
+
+    /**
+     * @brief Destroys every cached state
+     */
+    void ClearStateCache();
+
+    std::size_t GetCachedStateCount() const { return mCache.size(); }  ///< States held by the cache
+    std::size_t GetCachedBytes() const { return mCachedBytes; }  ///< Memory estimate of the cached states
+    std::size_t GetStateBuildCount() const { return mBuildCount; }  ///< States created by their factory so far
+    std::size_t GetStateResumeCount() const { return mResumeCount; }  ///< Pushes served from the cache so far
+
+    //-------------------------------------------------------------------------
+    // Asynchronous Builds
+    //-------------------------------------------------------------------------
+
+    /**
+     * @brief Checks if a state is being built on a worker thread
+     * @return True until the Update() that pushes it
+     */
+    bool IsBuilding() const { return mBuild != nullptr; }
+
+    /**
+     * @brief Blocks until the state being built, if any, is complete and pushed
+     * @throws Whatever the state constructor threw
+     */
+    void WaitForAsyncBuild();
+
 private:
     //-------------------------------------------------------------------------
     // Internal Operations
@@ -121,15 +216,53 @@ private:
      * @brief Creates a new state instance
      * @param stateID Identifier of state to create
      * @return Unique pointer to new state instance
+     * @note Called on the worker thread for asynchronous pushes
      */
     State::StatePtr createState(States::ID stateID);
 
+    /**
+     * @brief Pushes the loading state and starts building a state on a worker thread
+     * @param stateID Identifier of state to build
+     * @param loadingID Identifier of the loading state, or States::None
+     */
+    void startAsyncBuild(States::ID stateID, States::ID loadingID);
+
+    /**
+     * @brief Replaces the loading state by the built state once the worker is done
+     * @param wait True to block until the worker is done
+     */
+    void finishAsyncBuild(bool wait);
+
+    /**
+     * @brief Finds the lowest state Draw() draws
+     * @return Index in mStack of the topmost state that is not transparent, 0 if none
+     */
+    std::size_t firstVisibleState() const;
+
     /**
      * @brief Applies pending stack operations
      * @note Called at safe times to prevent mid-frame state changes
      */
     void applyPendingChanges();
 
+    /**
+     * @brief Takes a cached state of a type out of the cache
+     * @param stateID Identifier of the state to push
+     * @return The state, resumed, or nullptr if none is cached
+     */
+    State::StatePtr resumeState(States::ID stateID);
+
+    /**
+     * @brief Moves a state leaving the stack into the cache, or destroys it
+     * @param state State just removed from the stack
+     */
+    void suspendState(State::StatePtr state);
+
+    /**
+     * @brief Destroys the least recently cached states until the cache fits its limits
+     */
+    void evictStates();
+
 private:
     /**
      * @brief Pending stack operation container
@@ -140,11 +273,37 @@ private:
          * @brief Constructs a pending change request
          * @param action Operation type
          * @param stateID Relevant state identifier (for Push operations)
+         * @param loadingID State shown while stateID is built (for PushAsync operations)
          */
-        explicit PendingChange(Action action, States::ID stateID = States::None);
+        explicit PendingChange(Action action, States::ID stateID = States::None, States::ID loadingID = States::None);
 
         Action action;         ///< Operation type
         States::ID stateID;    ///< Target state identifier
+        States::ID loadingID;  ///< Loading state identifier
+    };
+
+    /**
+     * @brief State being built on a worker thread
+     */
+    struct AsyncBuild
+    {
+        States::ID stateID = States::None;  ///< State being built
+        State* loadingState = nullptr;      ///< Replaced by the built state, or nullptr
+        bool abandoned = false;             ///< The loading state was popped or the stack cleared
+        State::StatePtr state;              ///< Written by the worker before done is set
+        std::exception_ptr error;           ///< Thrown by the state constructor, written before done is set
+        std::atomic<bool> done{ false };    ///< Set by the worker when it returns
+        std::thread thread;                 ///< The worker
+    };
+
+    /**
+     * @brief Suspended state waiting to be pushed again
+     */
+    struct CachedState
+    {
+        State::StatePtr state;   ///< The suspended state
+        std::size_t bytes;       ///< Its State::GetMemoryEstimate() when it was cached
+        std::uint64_t cachedAt;  ///< Order it was cached in, for eviction
     };
 
 private:
@@ -152,6 +311,7 @@ private:
     // Data Members
     //-------------------------------------------------------------------------
 
+    RenderItemRegistry mRenderItems;           ///< Slots of the render items, outlives every state
     std::vector<State::StatePtr> mStack;       ///< Active state stack
     std::vector<PendingChange> mPendingList;   ///< Pending operations
     State::Context mContext;                   ///< Shared state context
@@ -160,6 +320,16 @@ private:
      * @brief State factory registry mapping IDs to creation functions
      */
     std::map<States::ID, std::function<State::StatePtr()>> mFactories;
+
+    std::set<States::ID> mCachedIDs;           ///< Types whose popped states are kept
+    std::vector<CachedState> mCache;           ///< Suspended states, destroyed before mContext
+    std::size_t mCacheMaxStates = 4;           ///< Most states in mCache
+    std::size_t mCacheMaxBytes = 8 * 1024 * 1024; ///< Most bytes in mCache
+    std::size_t mCachedBytes = 0;              ///< Sum of the bytes of mCache
+    std::uint64_t mCacheClock = 0;             ///< Incremented by each state cached
+    std::size_t mBuildCount = 0;               ///< States created by a factory
+    std::size_t mResumeCount = 0;              ///< States resumed from mCache
+    std::unique_ptr<AsyncBuild> mBuild;        ///< Build in progress, or nullptr
 };
 
 // Template Implementation
@@ -0,0 +1,53 @@
+#include "TerrainNode.hpp"
+#include "Game.hpp"
+
+/**
+ * @brief Constructor for TerrainNode.
+ * @param state State owning the scene graph.
+ * @param material Material the terrain is drawn with.
+ */
+TerrainNode::TerrainNode(State* state, const std::string& material) : Entity(state)
+	, mMat(material)
+{
+}
+
+/**
+ * @brief Moves the node and streams the terrain.
+ *
+ * The camera looks down on the world origin, which lies at minus the node's
+ * position in terrain space.
+ *
+ * @param gt Game timer with frame timing.
+ */
+void TerrainNode::updateCurrent(const GameTimer& gt)
+{
+	Entity::updateCurrent(gt);
+
+	XMFLOAT3 position = getWorldPosition();
+	mState->GetContext()->game->UpdateTerrain(-position.x, -position.z);
+}
+
+/**
+ * @brief Captures the resident terrain chunks in view.
+ */
+void TerrainNode::drawCurrent() const
+{
+	mState->GetContext()->game->CaptureTerrain(getWorldTransform(), renderer->Mat);
+}
+
+/**
+ * @brief Builds the RenderItem of the terrain node.
+ *
+ * The item has no geometry of its own; it keeps the material referenced while
+ * the state is alive.
+ */
+void TerrainNode::buildCurrent()
+{
+	Game* game = mState->GetContext()->game;
+
+	auto render = std::make_unique<RenderItem>();
+	renderer = render.get();
+	renderer->World = getTransform();
+	renderer->Mat = game->AcquireMaterial(mMat);
+	mState->addRenderItem(std::move(render));
+}
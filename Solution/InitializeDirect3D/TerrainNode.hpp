@@ -0,0 +1,39 @@
+#pragma once
+#include "Entity.hpp"
+#include <string>
+
+/**
+ * @brief Scene node that draws the streamed hills terrain
+ *
+ * The node moves like any entity; the terrain point under the camera follows it,
+ * so Game's chunk streamer generates the hills ahead of a scrolling node and
+ * retires the ones left behind.  The node's RenderItem only holds its world
+ * transform and material; the chunks are captured by Game::CaptureTerrain().
+ */
+class TerrainNode :
+	public Entity
+{
+public:
+	/**
+	 * @brief Constructs the terrain node
+	 * @param state State owning the scene graph
+	 * @param material Material the terrain is drawn with
+	 */
+	TerrainNode(State* state, const std::string& material);
+
+private:
+	/**
+	 * @brief Moves the node and streams the chunks around the camera
+	 */
+	virtual void		updateCurrent(const GameTimer& gt);
+	/**
+	 * @brief Captures the resident chunks in view
+	 */
+	virtual void		drawCurrent() const;
+	/**
+	 * @brief Creates the RenderItem holding the node's transform and material
+	 */
+	virtual void		buildCurrent();
+
+	std::string mMat;
+};
@@ -50,6 +50,7 @@ void Text::drawCurrent() const
 {
 	renderer->World = getTransform();
 	renderer->NumFramesDirty++;
+	renderer->BoundsDirty = true;
 }
 
 /**
@@ -68,14 +69,10 @@ void Text::buildCurrent()
 	auto render = std::make_unique<RenderItem>();
 	renderer = render.get();
 	renderer->World = getTransform();
-	renderer->ObjCBIndex = (UINT)mState->getRenderItems().size();
-	renderer->Mat = game->getMaterials()[mSprite].get();
-	renderer->Geo = game->getGeometries()["boxGeo"].get();
-	renderer->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	renderer->IndexCount = renderer->Geo->DrawArgs["box"].IndexCount;
-	renderer->StartIndexLocation = renderer->Geo->DrawArgs["box"].StartIndexLocation;
-	renderer->BaseVertexLocation = renderer->Geo->DrawArgs["box"].BaseVertexLocation;
-	mState->getRenderItems().push_back(std::move(render));
+	renderer->Mat = game->AcquireMaterial(mSprite);
+	renderer->Geo = game->getGeometries().at("boxGeo").get();
+	renderer->SetSubmesh(renderer->Geo->DrawArgs.at("box"));
+	mState->addRenderItem(std::move(render));
 }
 
 /**
@@ -11,7 +11,6 @@
  * Initializes:
  * - Scene graph hierarchy
  * - Sprite elements (background, title, planet, star)
- * - Frame resources
  * - Flashing animation system
  */
 TitleState::TitleState(StateStack* stack, Context* context)
@@ -29,11 +28,6 @@ TitleState::TitleState(StateStack* stack, Context* context)
         OutputDebugStringA("mSceneGraph initialized.\n");
     }
 
-    // Reset rendering resources
-    mAllRitems.clear();
-    mContext->game->ResetFrameResources();
-    mContext->game->BuildMaterials();
-
     //-------------------------------------------------------------------------
     // Scene Graph Setup
     //-------------------------------------------------------------------------
@@ -42,6 +36,7 @@ TitleState::TitleState(StateStack* stack, Context* context)
     std::unique_ptr<SpriteNode> backgroundSprite = std::make_unique<SpriteNode>(this);
     backgroundSprite->SetDrawName("Galaxy", "boxGeo", "box");
     backgroundSprite->setScale(10.0, 1.0, 7.0);
+    backgroundSprite->SetOccluder(true);
     backgroundSprite->setPosition(0, 0, 0);
     mSceneGraph->attachChild(std::move(backgroundSprite));
 
@@ -68,7 +63,6 @@ TitleState::TitleState(StateStack* stack, Context* context)
 
     // Finalize scene setup
     mSceneGraph->build();
-    mContext->game->BuildFrameResources(mAllRitems.size());
 }
 
 /**
@@ -132,7 +126,7 @@ bool TitleState::Update(const GameTimer& gt)
  * @param btnState Bitmask of button states
  * @return True if event was consumed, false to propagate
  */
-bool TitleState::HandleEvent(WPARAM btnState)
+bool TitleState::HandleEvent(std::uintptr_t btnState)
 {
     // If any key is pressed, trigger the next screen
     RequestStackPop();
@@ -1,5 +1,8 @@
 #define NOMINMAX
 #include "World.hpp"
+#include "../../Common/Profiler.h"
+#include <algorithm>
+#include <cmath>
 
 /**
  * @brief Constructor for World.
@@ -10,6 +13,7 @@ World::World(State* state)
 	, mState(state)
 	, mPlayerAircraft(nullptr)
 	, mBackground(nullptr)
+	, mTerrain(nullptr)
 	, mWorldBounds(-3.25f, 3.25f, -1.5f, 2.5f) //Left, Right, Down, Up - this can be changed depending on where you want the player to be
 	, mSpawnPosition(0.f, 0.f)
 	, mScrollSpeed(1.0f)
@@ -32,6 +36,8 @@ CommandQueue& World::getCommandQueue()
  */
 void World::update(const GameTimer& gt)
 {
+	PROFILE_SCOPE("World::update");
+
 #pragma region Step 15
 	mPlayerAircraft->setVelocity(0.0f, 0.0f, 0.0f);
 	while (!mCommandQueue.isEmpty())
@@ -89,6 +95,13 @@ void World::buildScene()
 	raptor2->setWorldRotation(0, 0.0, 0);
 	mPlayerAircraft->attachChild(std::move(enemy2));
 
+	// Create and set up the streamed hills, scrolling with the background
+	std::unique_ptr<TerrainNode> terrain(new TerrainNode(mState, "Desert"));
+	mTerrain = terrain.get();
+	mTerrain->setPosition(0, -1.0, 0);
+	mTerrain->setVelocity(0, 0, -mScrollSpeed);
+	mSceneGraph->attachChild(std::move(terrain));
+
 	// Create and set up background sprite
 	std::unique_ptr<SpriteNode> backgroundSprite(new SpriteNode(mState));
 	backgroundSprite->SetDrawName("Galaxy", "boxGeo", "box");
@@ -96,6 +109,7 @@ void World::buildScene()
 	//mBackground->setPosition(mWorldBounds.left, mWorldBounds.top);
 	mBackground->setPosition(0, 0, 0.0);
 	mBackground->setScale(10.0, 1.0, 200.0);
+	mBackground->SetOccluder(true);
 	mBackground->setVelocity(0, 0, -mScrollSpeed); //background scrolling enabled
 	mSceneGraph->attachChild(std::move(backgroundSprite));
 
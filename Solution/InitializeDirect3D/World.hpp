@@ -2,6 +2,7 @@
 #include "SceneNode.hpp"
 #include "Aircraft.hpp"
 #include "SpriteNode.h"
+#include "TerrainNode.hpp"
 
 #pragma region Step 12
 #include "CommandQueue.hpp"
@@ -84,5 +85,6 @@ private:
 	float								mScrollSpeed; ///< Scrolling speed of the world.
 	Aircraft*							mPlayerAircraft; ///< Pointer to the player's aircraft.
 	SpriteNode*							mBackground; ///< Pointer to the background sprite.
+	TerrainNode*						mTerrain; ///< Pointer to the streamed hills below the background.
 	Aircraft*							mEnemy; ///< Pointer to an enemy aircraft.
 };
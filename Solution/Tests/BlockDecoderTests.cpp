@@ -0,0 +1,74 @@
+//***************************************************************************************
+// BlockDecoderTests.cpp
+//
+// Checks that every BlockDecoder kernel the CPU can run decodes BC1 - BC5 exactly as
+// the scalar code does.  The surfaces are pseudo random, which covers both BC1 colour
+// modes and both channel palette modes, and are sized so the AVX2 kernel's block
+// pairs, the odd block left at the end of a row and the partial edge blocks all
+// occur.  Exits with a non-zero status if any check fails.
+//***************************************************************************************
+
+#include "../../Common/BlockDecoder.h"
+#include "TestHarness.h"
+#include <random>
+#include <vector>
+
+namespace
+{
+	std::vector<std::uint8_t> Decode(BlockFormat format, const std::vector<std::uint8_t>& blocks,
+		std::uint32_t width, std::uint32_t height)
+	{
+		std::vector<std::uint8_t> pixels((std::size_t)width * height * 4);
+		BlockDecoder::DecodeSurface(format, blocks.data(), width, height, pixels.data(), (std::size_t)width * 4, 1);
+		return pixels;
+	}
+}
+
+int main()
+{
+	const BlockFormat formats[] =
+	{
+		BlockFormat::BC1, BlockFormat::BC2, BlockFormat::BC3, BlockFormat::BC4UNorm,
+		BlockFormat::BC4SNorm, BlockFormat::BC5UNorm, BlockFormat::BC5SNorm,
+	};
+	const std::uint32_t width = 78;
+	const std::uint32_t height = 38;
+
+	SimdLevel supported = BlockDecoder::GetSupportedSimdLevel();
+	CHECK(BlockDecoder::GetSimdLevel() == supported);
+
+	std::mt19937 random(27);
+	for (BlockFormat format : formats)
+	{
+		std::vector<std::uint8_t> blocks(BlockDecoder::SurfaceSize(format, width, height));
+		for (std::uint8_t& byte : blocks)
+			byte = (std::uint8_t)random();
+
+		BlockDecoder::SetSimdLevel(SimdLevel::Scalar);
+		CHECK(!BlockDecoder::IsSimdEnabled());
+		std::vector<std::uint8_t> expected = Decode(format, blocks, width, height);
+
+		for (SimdLevel level : { SimdLevel::Sse41, SimdLevel::Avx2 })
+		{
+			if (level > supported)
+				continue;
+
+			BlockDecoder::SetSimdLevel(level);
+			CHECK(BlockDecoder::GetSimdLevel() == level);
+			if (Decode(format, blocks, width, height) != expected)
+			{
+				TestHarness::Fail("%s: %s output differs from scalar",
+					BlockDecoder::FormatName(format), BlockDecoder::SimdLevelName(level));
+			}
+		}
+	}
+
+	// Asking for more than the CPU supports is clamped.
+	BlockDecoder::SetSimdLevel(SimdLevel::Avx2);
+	CHECK(BlockDecoder::GetSimdLevel() == supported);
+
+	int status = TestHarness::Finish();
+	if (status == EXIT_SUCCESS)
+		std::printf("BlockDecoder tests passed, up to %s\n", BlockDecoder::SimdLevelName(supported));
+	return status;
+}
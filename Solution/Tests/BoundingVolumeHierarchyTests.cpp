@@ -0,0 +1,186 @@
+//***************************************************************************************
+// BoundingVolumeHierarchyTests.cpp
+//
+// Fuzzes BoundingVolumeHierarchy against brute force.  100k random boxes are
+// inserted, then rounds of moves, removals and reinsertions are applied, each
+// followed by Refit() (which rebuilds the tree once it has degraded) and by random
+// box queries and ray casts whose results must match a scan of every live box.
+// Exits with a non-zero status if any check fails.
+//***************************************************************************************
+
+#include "../../Common/BoundingVolumeHierarchy.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using uint32 = BoundingVolumeHierarchy::uint32;
+
+	const uint32 BoxCount = 100000;
+	const float WorldSize = 1000.0f;
+
+	/**
+	 * @brief A box of the test and the leaf holding it
+	 */
+	struct Object
+	{
+		Aabb Bounds;
+		uint32 Leaf = BoundingVolumeHierarchy::NullNode;  ///< NullNode while removed
+	};
+
+	Aabb RandomBox(std::mt19937& random, float maxExtent)
+	{
+		std::uniform_real_distribution<float> position(0.0f, WorldSize);
+		std::uniform_real_distribution<float> extent(0.1f, maxExtent);
+
+		Aabb box;
+		for (int k = 0; k < 3; ++k)
+		{
+			box.Min[k] = position(random);
+			box.Max[k] = box.Min[k] + extent(random);
+		}
+		return box;
+	}
+
+	void CheckBoxQuery(const BoundingVolumeHierarchy& bvh, const std::vector<Object>& objects, const Aabb& query)
+	{
+		std::vector<uint32> expected;
+		for (uint32 i = 0; i < objects.size(); ++i)
+		{
+			if (objects[i].Leaf != BoundingVolumeHierarchy::NullNode && Aabb::Overlaps(objects[i].Bounds, query))
+				expected.push_back(i);
+		}
+
+		std::vector<uint32> found;
+		bvh.QueryAabb(query, [&](uint32 leaf)
+		{
+			found.push_back(bvh.GetUserData(leaf));
+			return true;
+		});
+
+		std::sort(found.begin(), found.end());
+		CHECK(found == expected);
+	}
+
+	void CheckRayCast(const BoundingVolumeHierarchy& bvh, const std::vector<Object>& objects, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(0.0f, WorldSize);
+		std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+
+		float origin[3] = { position(random), position(random), position(random) };
+		float direction[3] = { axis(random), axis(random), axis(random) };
+		float inverseDirection[3];
+		for (int k = 0; k < 3; ++k)
+			inverseDirection[k] = 1.0f / direction[k];
+		const float maxDistance = WorldSize;
+
+		float expected = -1.0f;
+		for (const Object& object : objects)
+		{
+			if (object.Leaf == BoundingVolumeHierarchy::NullNode)
+				continue;
+			float entry = BoundingVolumeHierarchy::IntersectRay(object.Bounds, origin, inverseDirection, maxDistance);
+			if (entry >= 0.0f && (expected < 0.0f || entry < expected))
+				expected = entry;
+		}
+
+		// The closest hit clips the ray, so farther subtrees are skipped.
+		float closest = -1.0f;
+		bvh.RayCast(origin, direction, maxDistance, [&](uint32, float entry)
+		{
+			if (closest < 0.0f || entry < closest)
+				closest = entry;
+			return closest;
+		});
+
+		CHECK(closest == expected);
+	}
+
+	void CheckQueries(const BoundingVolumeHierarchy& bvh, const std::vector<Object>& objects, std::mt19937& random)
+	{
+		for (int i = 0; i < 20; ++i)
+			CheckBoxQuery(bvh, objects, RandomBox(random, 50.0f));
+		for (int i = 0; i < 20; ++i)
+			CheckRayCast(bvh, objects, random);
+	}
+}
+
+int main()
+{
+	std::mt19937 random(38);
+	BoundingVolumeHierarchy bvh;
+	std::vector<Object> objects(BoxCount);
+
+	for (uint32 i = 0; i < BoxCount; ++i)
+	{
+		objects[i].Bounds = RandomBox(random, 5.0f);
+		objects[i].Leaf = bvh.Insert(objects[i].Bounds, i);
+	}
+	CHECK(bvh.GetLeafCount() == BoxCount);
+	CheckQueries(bvh, objects, random);
+
+	std::uniform_int_distribution<uint32> pick(0, BoxCount - 1);
+	std::uniform_real_distribution<float> step(-10.0f, 10.0f);
+	uint32 live = BoxCount;
+
+	for (int round = 0; round < 10; ++round)
+	{
+		// Moves drift the boxes, degrading the tree until Refit() rebuilds it.
+		for (uint32 i = 0; i < BoxCount / 10; ++i)
+		{
+			Object& object = objects[pick(random)];
+			if (object.Leaf == BoundingVolumeHierarchy::NullNode)
+				continue;
+			for (int k = 0; k < 3; ++k)
+			{
+				float delta = step(random);
+				object.Bounds.Min[k] += delta;
+				object.Bounds.Max[k] += delta;
+			}
+			bvh.Update(object.Leaf, object.Bounds);
+		}
+
+		for (uint32 i = 0; i < BoxCount / 50; ++i)
+		{
+			uint32 index = pick(random);
+			Object& object = objects[index];
+			if (object.Leaf != BoundingVolumeHierarchy::NullNode)
+			{
+				bvh.Remove(object.Leaf);
+				object.Leaf = BoundingVolumeHierarchy::NullNode;
+				--live;
+			}
+			else
+			{
+				object.Bounds = RandomBox(random, 5.0f);
+				object.Leaf = bvh.Insert(object.Bounds, index);
+				++live;
+			}
+		}
+
+		bvh.Refit();
+		CHECK(bvh.GetLeafCount() == live);
+		CheckQueries(bvh, objects, random);
+	}
+
+	// A forced rebuild keeps every leaf id and answer.
+	bvh.Rebuild();
+	CheckQueries(bvh, objects, random);
+
+	for (const Object& object : objects)
+	{
+		if (object.Leaf != BoundingVolumeHierarchy::NullNode)
+		{
+			const Aabb& bounds = bvh.GetBounds(object.Leaf);
+			CHECK(std::equal(bounds.Min, bounds.Min + 3, object.Bounds.Min) && std::equal(bounds.Max, bounds.Max + 3, object.Bounds.Max));
+		}
+	}
+
+	int status = TestHarness::Finish();
+	if (status == EXIT_SUCCESS)
+		std::printf("BoundingVolumeHierarchy tests passed: %u leaves, height %u, %u rebuilds\n",
+			bvh.GetLeafCount(), bvh.GetHeight(), bvh.GetRebuildCount());
+	return status;
+}
@@ -0,0 +1,225 @@
+//***************************************************************************************
+// DescriptorAllocatorTests.cpp
+//
+// Runs DescriptorAllocator against a mock heap: every slot records which allocation
+// last wrote a descriptor into it, so a slot handed out twice shows up as an
+// overwritten descriptor.  A fence counter stands in for the GPU.  Covers exhausting
+// both regions, freeing and reusing persistent ranges, and the ring wrapping around
+// as frames retire.  Exits with a non-zero status if any check fails.
+//***************************************************************************************
+
+#include "../../Common/DescriptorAllocator.h"
+#include "TestHarness.h"
+#include <random>
+#include <vector>
+
+namespace
+{
+	using uint32 = DescriptorAllocator::uint32;
+	using uint64 = DescriptorAllocator::uint64;
+
+	/**
+	 * @brief Descriptor heap whose slots remember the allocation that wrote them
+	 */
+	class MockHeap
+	{
+	public:
+		static constexpr int Empty = -1;
+
+		explicit MockHeap(uint32 size) : mSlots(size, Empty) {}
+
+		/**
+		 * @brief Writes an allocation's descriptors; fails if a live one is overwritten
+		 */
+		void Write(uint32 first, uint32 count, int owner)
+		{
+			CHECK(first != DescriptorAllocator::InvalidIndex);
+			CHECK(first + count <= mSlots.size());
+			for (uint32 i = first; i < first + count && i < mSlots.size(); ++i)
+			{
+				CHECK(mSlots[i] == Empty);
+				mSlots[i] = owner;
+			}
+		}
+
+		/**
+		 * @brief Checks an allocation's descriptors are intact, then clears them
+		 */
+		void Clear(uint32 first, uint32 count, int owner)
+		{
+			for (uint32 i = first; i < first + count; ++i)
+			{
+				CHECK(mSlots[i] == owner);
+				mSlots[i] = Empty;
+			}
+		}
+
+	private:
+		std::vector<int> mSlots;
+	};
+
+	void TestPersistentExhaustion()
+	{
+		DescriptorAllocator allocator(8, 0);
+		MockHeap heap(allocator.GetCapacity());
+
+		for (int i = 0; i < 4; ++i)
+			heap.Write(allocator.Allocate(2), 2, i);
+		CHECK(allocator.GetPersistentUsed() == 8);
+		CHECK(allocator.Allocate() == DescriptorAllocator::InvalidIndex);
+		CHECK(allocator.Allocate(0) == DescriptorAllocator::InvalidIndex);
+		CHECK(allocator.AllocateTransient() == DescriptorAllocator::InvalidIndex);
+	}
+
+	void TestPersistentFreeAndReuse()
+	{
+		DescriptorAllocator allocator(16, 0);
+		MockHeap heap(allocator.GetCapacity());
+
+		uint32 a = allocator.Allocate(4);
+		uint32 b = allocator.Allocate(4);
+		uint32 c = allocator.Allocate(4);
+		heap.Write(a, 4, 0);
+		heap.Write(b, 4, 1);
+		heap.Write(c, 4, 2);
+
+		// The gap left by b is reused first fit, and is too small for 5 slots.
+		heap.Clear(b, 4, 1);
+		allocator.Free(b, 4);
+		CHECK(allocator.Allocate(2) == b);
+		heap.Write(b, 2, 3);
+		CHECK(allocator.Allocate(5) == DescriptorAllocator::InvalidIndex);
+
+		// Freeing a and the rest of b's gap merges them with what follows.
+		heap.Clear(a, 4, 0);
+		allocator.Free(a, 4);
+		heap.Clear(b, 2, 3);
+		allocator.Free(b, 2);
+		heap.Clear(c, 4, 2);
+		allocator.Free(c, 4);
+		CHECK(allocator.GetPersistentUsed() == 0);
+		uint32 all = allocator.Allocate(16);
+		CHECK(all == 0);
+		heap.Write(all, 16, 4);
+	}
+
+	void TestPersistentRandom()
+	{
+		struct Allocation { uint32 First; uint32 Count; int Owner; };
+
+		DescriptorAllocator allocator(256, 0);
+		MockHeap heap(allocator.GetCapacity());
+		std::vector<Allocation> live;
+		std::mt19937 random(29);
+
+		for (int owner = 0; owner < 20000; ++owner)
+		{
+			if (!live.empty() && random() % 2 == 0)
+			{
+				size_t victim = random() % live.size();
+				heap.Clear(live[victim].First, live[victim].Count, live[victim].Owner);
+				allocator.Free(live[victim].First, live[victim].Count);
+				live[victim] = live.back();
+				live.pop_back();
+				continue;
+			}
+
+			uint32 count = 1 + random() % 8;
+			uint32 first = allocator.Allocate(count);
+			if (first == DescriptorAllocator::InvalidIndex)
+				continue;
+			heap.Write(first, count, owner);
+			live.push_back({ first, count, owner });
+		}
+
+		uint32 used = 0;
+		for (const Allocation& allocation : live)
+			used += allocation.Count;
+		CHECK(allocator.GetPersistentUsed() == used);
+	}
+
+	void TestRingExhaustion()
+	{
+		DescriptorAllocator allocator(4, 8);
+		MockHeap heap(allocator.GetCapacity());
+
+		uint32 first = allocator.AllocateTransient(8);
+		CHECK(first == 4);
+		heap.Write(first, 8, 0);
+		CHECK(allocator.AllocateTransient() == DescriptorAllocator::InvalidIndex);
+		CHECK(allocator.AllocateTransient(9) == DescriptorAllocator::InvalidIndex);
+
+		// The slots only come back once the frame that used them has retired.
+		allocator.FinishFrame(1);
+		allocator.ReleaseCompletedFrames(0);
+		CHECK(allocator.AllocateTransient() == DescriptorAllocator::InvalidIndex);
+		allocator.ReleaseCompletedFrames(1);
+		CHECK(allocator.GetTransientUsed() == 0);
+		heap.Clear(first, 8, 0);
+		heap.Write(allocator.AllocateTransient(8), 8, 1);
+	}
+
+	void TestRingWraparound()
+	{
+		const uint32 persistent = 3;
+		const uint32 transient = 10;
+		const uint64 framesInFlight = 3;
+
+		struct Frame { uint64 Fence; std::vector<std::pair<uint32, uint32>> Ranges; };
+
+		DescriptorAllocator allocator(persistent, transient);
+		MockHeap heap(allocator.GetCapacity());
+		std::vector<Frame> inFlight;
+		std::mt19937 random(47);
+		uint64 completed = 0;
+		uint64 allocatedSlots = 0;
+
+		for (uint64 fence = 1; fence <= 5000; ++fence)
+		{
+			// The GPU stays at most framesInFlight frames behind.
+			if (fence > framesInFlight)
+				completed = fence - framesInFlight;
+			allocator.ReleaseCompletedFrames(completed);
+			while (!inFlight.empty() && inFlight.front().Fence <= completed)
+			{
+				for (const auto& range : inFlight.front().Ranges)
+					heap.Clear(range.first, range.second, (int)inFlight.front().Fence);
+				inFlight.erase(inFlight.begin());
+			}
+
+			// A range never straddles the end of the ring.
+			Frame frame{ fence, {} };
+			for (uint32 requests = random() % 3; requests > 0; --requests)
+			{
+				uint32 count = 1 + random() % 3;
+				uint32 first = allocator.AllocateTransient(count);
+				if (first == DescriptorAllocator::InvalidIndex)
+					continue;
+				CHECK(first >= persistent && first + count <= persistent + transient);
+				heap.Write(first, count, (int)fence);
+				frame.Ranges.push_back({ first, count });
+				allocatedSlots += count;
+			}
+			allocator.FinishFrame(fence);
+			CHECK(allocator.GetTransientUsed() <= transient);
+			inFlight.push_back(frame);
+		}
+
+		// Most requests fit, so the ring has wrapped many times.
+		CHECK(allocatedSlots > 100 * transient);
+	}
+}
+
+int main()
+{
+	TestPersistentExhaustion();
+	TestPersistentFreeAndReuse();
+	TestPersistentRandom();
+	TestRingExhaustion();
+	TestRingWraparound();
+
+	int status = TestHarness::Finish();
+	if (status == EXIT_SUCCESS)
+		std::printf("DescriptorAllocator tests passed\n");
+	return status;
+}
@@ -0,0 +1,118 @@
+//***************************************************************************************
+// GeometryGeneratorTests.cpp
+//
+// Checks the vertex and index counts of Subdivide() through CreateGeosphere(), whose
+// level n has 10 * 4^n + 2 vertices, and that Weld() takes meshes whose triangles
+// were split onto vertices of their own back to the shared vertices, with every
+// triangle still on the same corners, and drops the triangles a tolerance collapses.
+// Built with the DirectXMath dependent sources only.  Exits with a non-zero status
+// if any check fails.
+//***************************************************************************************
+
+#include "../../Common/GeometryGenerator.h"
+#include "TestHarness.h"
+#include <vector>
+
+namespace
+{
+	using uint32 = GeometryGenerator::uint32;
+	using MeshData = GeometryGenerator::MeshData;
+
+	bool SamePosition(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	/**
+	 * @brief Gives every triangle three vertices of its own, copied from the ones it indexed
+	 */
+	MeshData Unweld(const MeshData& meshData)
+	{
+		MeshData split;
+		for (uint32 index : meshData.Indices32)
+		{
+			split.Indices32.push_back((uint32)split.Vertices.size());
+			split.Vertices.push_back(meshData.Vertices[index]);
+		}
+		return split;
+	}
+
+	/**
+	 * @brief Welds an unwelded copy of a mesh and expects its vertex count and triangles back
+	 */
+	void CheckWeld(GeometryGenerator& geoGen, const char* name, const MeshData& meshData,
+		float positionTolerance, float attributeTolerance, size_t expectedVertices)
+	{
+		MeshData welded = Unweld(meshData);
+		size_t removed = geoGen.Weld(welded, positionTolerance, attributeTolerance);
+
+		if (welded.Vertices.size() != expectedVertices)
+		{
+			TestHarness::Fail("%s: welded to %zu vertices, expected %zu", name,
+				welded.Vertices.size(), expectedVertices);
+		}
+		CHECK(removed == meshData.Indices32.size() - welded.Vertices.size());
+
+		// The remapped index buffer keeps the triangles in order, on the same corners.
+		CHECK(welded.Indices32.size() == meshData.Indices32.size());
+		if (welded.Indices32.size() != meshData.Indices32.size())
+			return;
+
+		for (size_t i = 0; i < welded.Indices32.size(); ++i)
+		{
+			CHECK(welded.Indices32[i] < welded.Vertices.size());
+			if (welded.Indices32[i] >= welded.Vertices.size())
+				return;
+
+			const DirectX::XMFLOAT3& p = welded.Vertices[welded.Indices32[i]].Position;
+			if (!SamePosition(p, meshData.Vertices[meshData.Indices32[i]].Position))
+			{
+				TestHarness::Fail("%s: index %zu moved to another position", name, i);
+				return;
+			}
+		}
+	}
+}
+
+int main()
+{
+	GeometryGenerator geoGen;
+
+	// Each level splits every triangle into four, and every edge adds one vertex.
+	for (uint32 level = 0; level <= 5; ++level)
+	{
+		uint32 power = 1u << (2 * level);  // 4^level
+		uint32 vertices = 10 * power + 2;
+		uint32 indices = 20 * power * 3;
+
+		MeshData sphere = geoGen.CreateGeosphere(1.0f, level);
+		if (sphere.Vertices.size() != vertices || sphere.Indices32.size() != indices)
+		{
+			TestHarness::Fail("geosphere level %u: %zu vertices and %zu indices, expected %u and %u",
+				level, sphere.Vertices.size(), sphere.Indices32.size(), vertices, indices);
+		}
+	}
+
+	// The grid shares its vertices exactly; the box's faces only share positions.
+	CheckWeld(geoGen, "grid", geoGen.CreateGrid(20.0f, 10.0f, 11, 21), 0.0f, 1e-4f, 11 * 21);
+	CheckWeld(geoGen, "box", geoGen.CreateBox(1.0f, 2.0f, 3.0f, 0), 0.0f, 1e-4f, 24);
+	CheckWeld(geoGen, "box corners", geoGen.CreateBox(1.0f, 2.0f, 3.0f, 0), 0.0f, 10.0f, 8);
+
+	// A tolerance wider than the sliver welds two of its corners; the triangle goes
+	// and the quad next to it stays.
+	MeshData sliver;
+	for (float x : { 0.0f, 1.0f, 1.005f })
+		sliver.Vertices.push_back(GeometryGenerator::Vertex(x, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+	for (float x : { 0.0f, 1.0f })
+		sliver.Vertices.push_back(GeometryGenerator::Vertex(x, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+	sliver.Indices32 = { 0, 1, 2,  0, 3, 4,  0, 4, 1 };
+
+	CHECK(geoGen.Weld(sliver, 0.01f) == 1);
+	CHECK(sliver.Vertices.size() == 4);
+	CHECK((sliver.Indices32 == std::vector<uint32>{ 0, 2, 3,  0, 3, 1 }));
+
+	int status = TestHarness::Finish();
+	if (status == EXIT_SUCCESS)
+		std::printf("GeometryGenerator tests passed\n");
+	return status;
+}
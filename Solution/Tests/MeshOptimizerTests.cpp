@@ -0,0 +1,210 @@
+//***************************************************************************************
+// MeshOptimizerTests.cpp
+//
+// Runs the passes of GeometryGenerator::Optimize() (vertex cache order, overdraw
+// clusters, first use vertex remap) on a regular grid and on a random index soup with
+// unreferenced vertices, and checks that the triangles survive with their winding,
+// that the remap is a bijection onto the referenced vertices, that ACMR and ATVR do
+// not get worse, and that AnalyzeVertexCache() agrees with a plain FIFO simulation
+// written here.  Exits with a non-zero status if any check fails.
+//***************************************************************************************
+
+#include "../../Common/MeshOptimizer.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using uint32 = MeshOptimizer::uint32;
+	using Triangle = std::array<uint32, 3>;
+
+	struct Mesh
+	{
+		const char* Name;
+		std::vector<float> Positions;  // Three floats per vertex
+		std::vector<uint32> Indices;
+	};
+
+	Mesh MakeGrid(uint32 rows, uint32 columns)
+	{
+		Mesh mesh{ "grid" };
+		for (uint32 i = 0; i < rows; ++i)
+		{
+			for (uint32 j = 0; j < columns; ++j)
+			{
+				float x = (float)j, z = (float)i;
+				mesh.Positions.insert(mesh.Positions.end(), { x, 0.5f * std::sin(0.3f * x) * std::cos(0.2f * z), z });
+			}
+		}
+
+		// Row by row, as GeometryGenerator::CreateGrid() lays it out.
+		for (uint32 i = 0; i + 1 < rows; ++i)
+		{
+			for (uint32 j = 0; j + 1 < columns; ++j)
+			{
+				uint32 v = i * columns + j;
+				mesh.Indices.insert(mesh.Indices.end(), { v, v + 1, v + columns, v + columns, v + 1, v + columns + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	Mesh MakeSoup(uint32 vertexCount, uint32 triangleCount, std::mt19937& random)
+	{
+		Mesh mesh{ "soup" };
+		std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+		for (uint32 v = 0; v < vertexCount * 3; ++v)
+			mesh.Positions.push_back(position(random));
+
+		// The last eighth of the vertices is never referenced.
+		std::uniform_int_distribution<uint32> vertex(0, vertexCount - vertexCount / 8 - 1);
+		while (mesh.Indices.size() < (std::size_t)triangleCount * 3)
+		{
+			uint32 a = vertex(random), b = vertex(random), c = vertex(random);
+			if (a != b && b != c && a != c)
+				mesh.Indices.insert(mesh.Indices.end(), { a, b, c });
+		}
+		return mesh;
+	}
+
+	/**
+	 * @brief Reference FIFO post-transform cache that loads each missed vertex as it is looked up
+	 */
+	VertexCacheStatistics SimulateFifo(const std::vector<uint32>& indices, std::size_t vertexCount, uint32 cacheSize)
+	{
+		VertexCacheStatistics stats;
+		std::deque<uint32> cache;
+		std::vector<bool> referenced(vertexCount, false);
+		std::size_t uniqueCount = 0;
+
+		for (uint32 v : indices)
+		{
+			if (std::find(cache.begin(), cache.end(), v) == cache.end())
+			{
+				cache.push_back(v);
+				if (cache.size() > cacheSize)
+					cache.pop_front();
+				stats.VerticesTransformed++;
+			}
+			if (!referenced[v])
+			{
+				referenced[v] = true;
+				++uniqueCount;
+			}
+		}
+
+		stats.ACMR = (float)stats.VerticesTransformed / (float)(indices.size() / 3);
+		stats.ATVR = (float)stats.VerticesTransformed / (float)uniqueCount;
+		return stats;
+	}
+
+	void CheckAnalysis(const std::vector<uint32>& indices, std::size_t vertexCount, uint32 cacheSize)
+	{
+		VertexCacheStatistics reported = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, cacheSize);
+		VertexCacheStatistics expected = SimulateFifo(indices, vertexCount, cacheSize);
+		CHECK(reported.VerticesTransformed == expected.VerticesTransformed);
+		CHECK(reported.ACMR == expected.ACMR);
+		CHECK(reported.ATVR == expected.ATVR);
+	}
+
+	/**
+	 * @brief Triangles rotated to start at their smallest index, which keeps the winding, then sorted
+	 */
+	std::vector<Triangle> CanonicalTriangles(const std::vector<uint32>& indices)
+	{
+		std::vector<Triangle> triangles;
+		for (std::size_t t = 0; t < indices.size(); t += 3)
+		{
+			Triangle triangle = { indices[t], indices[t + 1], indices[t + 2] };
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	void CheckMesh(const Mesh& mesh)
+	{
+		const std::size_t vertexCount = mesh.Positions.size() / 3;
+		const std::size_t indexCount = mesh.Indices.size();
+		const uint32 cacheSize = MeshOptimizer::DefaultCacheSize;
+
+		CheckAnalysis(mesh.Indices, vertexCount, cacheSize);
+		VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), indexCount, vertexCount);
+
+		// The passes of GeometryGenerator::Optimize(), in place as it runs them.
+		std::vector<uint32> indices(indexCount);
+		MeshOptimizer::OptimizeVertexCache(indices.data(), mesh.Indices.data(), indexCount, vertexCount);
+		CHECK(CanonicalTriangles(indices) == CanonicalTriangles(mesh.Indices));
+		VertexCacheStatistics cacheOrder = MeshOptimizer::AnalyzeVertexCache(indices.data(), indexCount, vertexCount);
+
+		MeshOptimizer::OptimizeOverdraw(indices.data(), indices.data(), indexCount, mesh.Positions.data(),
+			vertexCount, 3 * sizeof(float));
+		CHECK(CanonicalTriangles(indices) == CanonicalTriangles(mesh.Indices));
+
+		std::vector<uint32> remap(vertexCount);
+		std::size_t uniqueCount = MeshOptimizer::OptimizeVertexFetchRemap(remap.data(), indices.data(), indexCount, vertexCount);
+
+		// Referenced vertices map one to one onto [0, uniqueCount), the others to Unused.
+		std::vector<bool> referenced(vertexCount, false);
+		for (uint32 index : indices)
+			referenced[index] = true;
+		std::vector<uint32> original(uniqueCount, MeshOptimizer::Unused);
+		for (std::size_t v = 0; v < vertexCount; ++v)
+		{
+			if (!referenced[v])
+			{
+				CHECK(remap[v] == MeshOptimizer::Unused);
+				continue;
+			}
+			CHECK(remap[v] < uniqueCount);
+			if (remap[v] < uniqueCount)
+			{
+				CHECK(original[remap[v]] == MeshOptimizer::Unused);
+				original[remap[v]] = (uint32)v;
+			}
+		}
+		CHECK(std::count(original.begin(), original.end(), MeshOptimizer::Unused) == 0);
+
+		std::vector<uint32> remapped(indexCount);
+		MeshOptimizer::RemapIndices(remapped.data(), indices.data(), indexCount, remap.data());
+
+		// Mapped back through the inverse, the remapped mesh has the input's triangles.
+		std::vector<uint32> restored(indexCount);
+		for (std::size_t i = 0; i < indexCount; ++i)
+			restored[i] = original[remapped[i]];
+		CHECK(CanonicalTriangles(restored) == CanonicalTriangles(mesh.Indices));
+
+		CheckAnalysis(remapped, uniqueCount, cacheSize);
+		VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(remapped.data(), indexCount, uniqueCount);
+		CHECK(cacheOrder.ACMR <= before.ACMR);
+		CHECK(after.ACMR <= before.ACMR);
+		CHECK(after.ATVR <= before.ATVR);
+
+		std::printf("  %-5s ACMR %.3f -> %.3f   ATVR %.3f -> %.3f   vertices %zu -> %zu\n", mesh.Name,
+			before.ACMR, after.ACMR, before.ATVR, after.ATVR, vertexCount, uniqueCount);
+	}
+}
+
+int main()
+{
+	std::mt19937 random(32);
+
+	CheckMesh(MakeGrid(50, 50));
+	CheckMesh(MakeSoup(2000, 4000, random));
+
+	// The simulation against the reference at other cache sizes, in the input order.
+	Mesh soup = MakeSoup(500, 1000, random);
+	for (uint32 cacheSize : { 3u, 8u, 32u })
+		CheckAnalysis(soup.Indices, soup.Positions.size() / 3, cacheSize);
+
+	int status = TestHarness::Finish();
+	if (status == EXIT_SUCCESS)
+		std::printf("MeshOptimizer tests passed\n");
+	return status;
+}
@@ -0,0 +1,47 @@
+//***************************************************************************************
+// TestHarness.h
+//
+// The little the test executables share: CHECK() reports a failed condition and
+// keeps going, so one run lists every failure, and Finish() prints the count and
+// picks the exit status ctest reads.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace TestHarness
+{
+	inline int gFailures = 0;
+
+	/**
+	 * @brief Counts a failure and prints its printf style description
+	 */
+	inline void Fail(const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		std::vfprintf(stderr, format, args);
+		va_end(args);
+		std::fputc('\n', stderr);
+		++gFailures;
+	}
+
+	/**
+	 * @brief Prints the number of failures, if any
+	 * @return EXIT_SUCCESS if every check passed, EXIT_FAILURE otherwise
+	 */
+	inline int Finish()
+	{
+		if (gFailures == 0)
+			return EXIT_SUCCESS;
+
+		std::fprintf(stderr, "%d check(s) failed\n", gFailures);
+		return EXIT_FAILURE;
+	}
+}
+
+#define CHECK(condition) \
+	do { if (!(condition)) TestHarness::Fail("%s:%d: CHECK(%s) failed", __FILE__, __LINE__, #condition); } while (0)